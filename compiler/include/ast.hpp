@@ -69,7 +69,9 @@ enum FieldModifierFlags : uint8_t {
   MOD_REPEATED = 1 << 1,
   MOD_PACKED = 1 << 2,
   MOD_INTERNED = 1 << 3,
-  MOD_BITMAP = 1 << 4
+  MOD_BITMAP = 1 << 4,
+  MOD_COLUMNAR = 1 << 5,
+  MOD_UTF8 = 1 << 6
 };
 
 class Field : public AstNode {
@@ -92,6 +94,8 @@ public:
   inline bool is_packed() const { return has_modifier(MOD_PACKED); }
   inline bool is_interned() const { return has_modifier(MOD_INTERNED); }
   inline bool is_bitmap() const { return has_modifier(MOD_BITMAP); }
+  inline bool is_columnar() const { return has_modifier(MOD_COLUMNAR); }
+  inline bool is_utf8() const { return has_modifier(MOD_UTF8); }
 };
 
 class EnumValue : public AstNode {
@@ -125,11 +129,24 @@ public:
 class ModelDecl : public Declaration {
 public:
   std::vector<std::unique_ptr<Field>> fields;
+  // Encoded with a trailing CRC32C of the preceding bytes.
+  bool checksummed = false;
 
   ModelDecl(std::string n, SourceLocation loc)
       : Declaration(std::move(n), loc) {}
 };
 
+// Fixed-layout record: fields are fixed-size primitives or other structs,
+// encoded back to back in little-endian order without tags. Struct fields
+// carry no field numbers; `number` holds the 1-based position instead.
+class StructDecl : public Declaration {
+public:
+  std::vector<std::unique_ptr<Field>> fields;
+
+  StructDecl(std::string n, SourceLocation loc)
+      : Declaration(std::move(n), loc) {}
+};
+
 class Schema : public AstNode {
 public:
   std::string namespace_name;
@@ -139,6 +156,7 @@ public:
 
   const EnumDecl *find_enum(const std::string &name) const;
   const ModelDecl *find_model(const std::string &name) const;
+  const StructDecl *find_struct(const std::string &name) const;
 };
 
 PrimitiveTypeKind token_to_primitive_type(TokenType token);
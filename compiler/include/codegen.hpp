@@ -4,36 +4,187 @@
 #include "ast.hpp"
 #include <sstream>
 #include <string>
+#include <vector>
 
 namespace serialkit {
 
+struct CodeGenOptions {
+  // Emit a <Model>Decoder per model that accepts a message in chunks.
+  bool resumable_decoder = false;
+  // Emit a <Model>StreamWriter per model that encodes field by field.
+  bool stream_writer = false;
+  // Put every definition in the header as inline (constexpr where the
+  // model allows it) and leave the source file empty.
+  bool header_only = false;
+  // Emit to_json/from_json on every model and struct.
+  bool json = false;
+  // Validate every string field as UTF-8 on decode, as if each carried
+  // the `utf8` modifier.
+  bool utf8 = false;
+  // Emit diff()/apply_patch() on every model for field-level deltas.
+  bool diff = false;
+  // Specialize serialkit::model_traits/enum_traits for every model, struct
+  // and enum. The header then includes serialkit/reflection.hpp.
+  bool reflection = false;
+};
+
 class CodeGenerator {
 public:
-  explicit CodeGenerator(const Schema &schema);
+  explicit CodeGenerator(const Schema &schema,
+                         const CodeGenOptions &options = {});
 
   std::string generate_header();
   std::string generate_source(const std::string & = "");
 
 private:
   void generate_includes();
+  void generate_implementation();
+  void generate_source_helpers();
+  void generate_column_helpers();
+  void generate_json_helpers();
+  void generate_utf8_helpers();
+  void generate_checksum_helpers();
+  void generate_hash_helpers();
+  void generate_diff_helpers();
+  void generate_internal_namespace_open();
+  void generate_internal_namespace_close();
+  void generate_helper_guard_open(const std::string &group);
+  void generate_helper_guard_close();
+  std::string get_helper_guard(const std::string &group) const;
   void generate_namespace_open(std::ostringstream &);
   void generate_namespace_close(std::ostringstream &);
   void generate_enum_declaration(const EnumDecl &enum_decl);
   void generate_model_declaration(const ModelDecl &model);
+  void generate_struct_declaration(const StructDecl &struct_decl);
+  void generate_enum_traits(const EnumDecl &enum_decl);
+  void generate_model_traits(const std::string &name,
+                             const std::vector<std::unique_ptr<Field>> &fields);
   void generate_model_implementation(const ModelDecl &model);
+  void generate_struct_implementation(const StructDecl &struct_decl);
+  void generate_column_codec(const ModelDecl &element);
+  void generate_column_lengths(const ModelDecl &element);
+  void generate_column_writer(const Field &column);
+  void generate_column_reader(const Field &column);
   void generate_serialize_method(const ModelDecl &model);
+  void generate_serialize_iov_method(const ModelDecl &model);
+  void generate_byte_size_method(const ModelDecl &model);
   void generate_deserialize_method(const ModelDecl &model);
+  void generate_clear_field(const Field &field, const std::string &indent);
+  void generate_hash_declaration();
+  void generate_comparison_declarations(
+      const std::string &name,
+      const std::vector<std::unique_ptr<Field>> &fields,
+      const std::string &specifier);
+  void generate_equality_method(
+      const std::string &name,
+      const std::vector<std::unique_ptr<Field>> &fields,
+      const std::string &specifier);
+  void generate_std_hash(const std::string &name);
+  void generate_diff_declarations(const std::string &name);
+  void generate_diff_method(const ModelDecl &model);
+  void generate_diff_field(const Field &field, const std::string &mark,
+                           const std::string &present);
+  void generate_diff_elements(const Field &field, const std::string &mark);
+  void generate_diff_value(const Type &type, const std::string &value,
+                           const std::string &indent);
+  void generate_apply_patch_method(const ModelDecl &model);
+  void generate_patch_elements(const Field &field);
+  void generate_patch_value(const Type &type, const std::string &target,
+                            const std::string &indent);
+  void generate_hash_method(const std::string &name,
+                            const std::vector<std::unique_ptr<Field>> &fields,
+                            bool numbered);
+  void generate_hash_value(const Type &type, const std::string &value,
+                           const std::string &indent);
+  void generate_delimited_methods();
+  void generate_decoder_declarations();
+  void generate_decoder_implementation();
+  void generate_decoder_hooks(const ModelDecl &model);
+  void generate_stream_writer_declarations();
+  void generate_stream_writer_implementation();
+  void generate_stream_writer_method(const ModelDecl &model,
+                                     const Field &field);
+  void generate_json_out_declaration();
+  void generate_json_declarations();
+  void generate_json_implementation();
+  void generate_transcode_declarations();
+  void generate_json_transcoder(const ModelDecl &model);
+  void generate_json_runs_split(const ModelDecl &model);
+  void generate_json_transcode_value(const Field &field,
+                                     const std::string &indent);
+  void generate_json_enum(const EnumDecl &enum_decl);
+  void generate_json_parser(const std::string &name,
+                            const std::vector<std::unique_ptr<Field>> &fields);
+  void generate_json_name_switch(
+      const std::vector<std::pair<std::string, std::string>> &entries,
+      const std::string &indent);
+  void generate_json_methods(const std::string &name,
+                             const std::vector<std::unique_ptr<Field>> &fields);
+  void generate_json_value_writer(const Type &type, const std::string &value,
+                                  const std::string &indent);
+  void generate_tag(uint32_t tag, const std::string &indent);
+  void generate_value_serializer(const Field &field, const std::string &value,
+                                 const std::string &indent);
   void generate_field_serializer(const Field &field, const std::string &indent);
+  void generate_field_size(const Field &field, const std::string &indent);
+  void generate_field_iov(const Field &field, const std::string &indent);
   void generate_field_deserializer(const Field &field,
                                    const std::string &indent);
+  void generate_varint_read(const std::string &target,
+                            const std::string &input,
+                            const std::string &indent);
+  void generate_packed_deserializer(const Field &field,
+                                    const PrimitiveType &type,
+                                    const std::string &indent);
+  void generate_struct_array_deserializer(const Field &field,
+                                          const std::string &indent);
 
   std::string get_cpp_type(const Type &type) const;
   std::string get_wire_type(const Type &type, const Field &field) const;
   std::string get_field_type(const Field &field) const;
+  std::string get_value_size(const Field &field,
+                             const std::string &value) const;
+
+  std::string inline_specifier() const;
+  std::string codec_specifier(const ModelDecl &model) const;
+
+  bool is_enum_type(const Type &type) const;
+  bool is_struct_type(const Type &type) const;
+  bool is_floating_type(const Type &type) const;
+  bool is_length_delimited(const Field &field) const;
+  bool is_reused_on_decode(const Field &field) const;
+  bool has_structs() const;
+  size_t get_comparison_rank(const Field &field) const;
+  std::vector<const Field *>
+  get_comparison_order(const std::vector<std::unique_ptr<Field>> &fields) const;
+  bool is_comparison_defaulted(
+      const std::vector<std::unique_ptr<Field>> &fields) const;
+  std::string
+  get_ordering_type(const std::vector<std::unique_ptr<Field>> &fields) const;
+  bool has_floating_point(const std::vector<std::unique_ptr<Field>> &fields,
+                          std::vector<std::string> &visited) const;
+  bool is_utf8_field(const Field &field) const;
+  bool has_utf8_fields() const;
+  bool has_checksummed_models() const;
+  std::vector<const ModelDecl *> get_columnar_elements() const;
+  bool struct_has_bool(const StructDecl &struct_decl) const;
+  size_t get_struct_size(const StructDecl &struct_decl) const;
+  bool is_constexpr_model(const ModelDecl &model) const;
+  bool is_packable(const PrimitiveType *type) const;
+  bool is_iov_reference_field(const Field &field) const;
+  size_t get_varint_size(uint64_t value) const;
+  size_t get_model_index(const std::string &name) const;
+  std::string get_decode_kind(const Field &field) const;
+  std::string get_param_type(const Field &field) const;
+  std::string get_json_value_parser(const Type &type,
+                                    const std::string &target) const;
+  uint64_t get_json_hash(const std::string &name) const;
 
   uint8_t get_wire_type_value(const Type &type, const Field &field) const;
+  uint8_t get_tag_wire_type(const Field &field) const;
 
   const Schema &schema_;
+  CodeGenOptions options_;
   std::ostringstream header_;
   std::ostringstream source_;
 };
@@ -13,11 +13,15 @@ enum class TokenType : uint8_t {
   NAMESPACE,
   ENUM,
   MODEL,
+  STRUCT,
   OPTIONAL,
   REPEATED,
   PACKED,
   INTERNED,
   BITMAP,
+  COLUMNAR,
+  UTF8,
+  CHECKSUMMED,
 
   // Primitives
   INT8,
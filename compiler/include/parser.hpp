@@ -36,7 +36,9 @@ private:
   std::unique_ptr<Declaration> parse_declaration();
   std::unique_ptr<EnumDecl> parse_enum();
   std::unique_ptr<ModelDecl> parse_model();
+  std::unique_ptr<StructDecl> parse_struct();
   std::unique_ptr<Field> parse_field();
+  std::unique_ptr<Field> parse_struct_field(int position);
   std::unique_ptr<Type> parse_type();
   uint8_t parse_modifiers();
 
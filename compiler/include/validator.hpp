@@ -4,6 +4,7 @@
 #include "ast.hpp"
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace serialkit {
@@ -26,15 +27,18 @@ public:
 
   void register_enum(const std::string &name, const EnumDecl *decl);
   void register_model(const std::string &name, const ModelDecl *decl);
+  void register_struct(const std::string &name, const StructDecl *decl);
 
   const EnumDecl *find_enum(const std::string &name) const;
   const ModelDecl *find_model(const std::string &name) const;
+  const StructDecl *find_struct(const std::string &name) const;
   bool type_exists(const std::string &name) const;
 
 private:
   std::vector<ValidationError> errors_;
   std::unordered_map<std::string, const EnumDecl *> enums_;
   std::unordered_map<std::string, const ModelDecl *> models_;
+  std::unordered_map<std::string, const StructDecl *> structs_;
 };
 
 class AstVisitor {
@@ -44,6 +48,7 @@ public:
   virtual void visit_schema(const Schema &schema) = 0;
   virtual void visit_enum(const EnumDecl &enum_decl) = 0;
   virtual void visit_model(const ModelDecl &model) = 0;
+  virtual void visit_struct(const StructDecl &struct_decl) = 0;
   virtual void visit_field(const Field &field) = 0;
   virtual void visit_enum_value(const EnumValue &value) = 0;
 };
@@ -64,6 +69,7 @@ public:
   void visit_schema(const Schema &schema) override;
   void visit_enum(const EnumDecl &enum_decl) override;
   void visit_model(const ModelDecl &model) override;
+  void visit_struct(const StructDecl &struct_decl) override;
   void visit_field(const Field &field) override;
   void visit_enum_value(const EnumValue &value) override;
 
@@ -72,11 +78,16 @@ private:
   const ModelDecl *current_model_;
 
   void validate_field_number(const Field &field);
+  void validate_field_name(const Field &field);
   void validate_field_modifiers(const Field &field);
   void validate_type_exists(const Type &type, SourceLocation location);
   void check_duplicate_field_numbers(const ModelDecl &model);
   void check_duplicate_enum_values(const EnumDecl &enum_decl);
   void check_modifier_compatibility(const Field &field);
+  void check_columnar_element(const Field &field);
+  void check_struct_field(const StructDecl &struct_decl, const Field &field);
+  bool struct_contains(const StructDecl &outer, const StructDecl *inner,
+                       std::unordered_set<const StructDecl *> &visited) const;
 };
 
 } // namespace serialkit
@@ -14,7 +14,8 @@ void register_options(ArgParser &parser);
 std::string read_file(const std::string &path);
 void write_file(const std::string &path, const std::string &content);
 int compile_schema(const std::string &input_file, const std::string &output_dir,
-                   const std::string &filename, bool verbose);
+                   const std::string &filename, bool verbose,
+                   const serialkit::CodeGenOptions &options);
 
 int main(int argc, char **argv) {
   ArgParser parser;
@@ -51,7 +52,16 @@ int main(int argc, char **argv) {
     std::string filename = parser.value_of("filename");
     bool verbose = parser.is_set("verbose");
 
-    return compile_schema(input_file, output_dir, filename, verbose);
+    serialkit::CodeGenOptions options;
+    options.resumable_decoder = parser.is_set("resumable-decoder");
+    options.stream_writer = parser.is_set("stream-writer");
+    options.header_only = parser.is_set("header-only");
+    options.json = parser.is_set("json");
+    options.utf8 = parser.is_set("utf8");
+    options.diff = parser.is_set("diff");
+    options.reflection = parser.is_set("reflection");
+
+    return compile_schema(input_file, output_dir, filename, verbose, options);
 
   } catch (const std::exception &e) {
     std::cerr << "Error: " << e.what() << "\n";
@@ -68,6 +78,17 @@ void register_options(ArgParser &parser) {
   parser.add_option('f', "filename",
                     "Base filename for generated files (without extension)",
                     true, "");
+  parser.add_flag(0, "resumable-decoder",
+                  "Generate <Model>Decoder classes for chunked input");
+  parser.add_flag(0, "stream-writer",
+                  "Generate <Model>StreamWriter classes for chunked output");
+  parser.add_flag(0, "header-only",
+                  "Generate a single header with inline definitions");
+  parser.add_flag(0, "json", "Generate to_json/from_json for every model");
+  parser.add_flag(0, "utf8", "Reject invalid UTF-8 in every string field");
+  parser.add_flag(0, "diff", "Generate diff/apply_patch for every model");
+  parser.add_flag(0, "reflection",
+                  "Generate serialkit::model_traits for every model");
 }
 
 std::string read_file(const std::string &path) {
@@ -90,7 +111,8 @@ void write_file(const std::string &path, const std::string &content) {
 }
 
 int compile_schema(const std::string &input_file, const std::string &output_dir,
-                   const std::string &filename, bool verbose) {
+                   const std::string &filename, bool verbose,
+                   const serialkit::CodeGenOptions &options) {
   if (verbose) {
     std::cout << "Reading input file: " << input_file << "\n";
   }
@@ -130,7 +152,7 @@ int compile_schema(const std::string &input_file, const std::string &output_dir,
   if (verbose) {
     std::cout << "Generating code...\n";
   }
-  serialkit::CodeGenerator codegen(*schema);
+  serialkit::CodeGenerator codegen(*schema, options);
 
   std::string base_name;
   if (!filename.empty()) {
@@ -139,7 +161,8 @@ int compile_schema(const std::string &input_file, const std::string &output_dir,
     base_name = schema->namespace_name;
   }
   std::string header_content = codegen.generate_header();
-  std::string source_content = codegen.generate_source(base_name);
+  std::string source_content =
+      options.header_only ? "" : codegen.generate_source(base_name);
 
   std::string header_file = output_dir + "/" + base_name + ".hpp";
   std::string source_file = output_dir + "/" + base_name + ".cpp";
@@ -165,14 +188,18 @@ int compile_schema(const std::string &input_file, const std::string &output_dir,
   }
   write_file(header_file, header_content);
 
-  if (verbose) {
-    std::cout << "Writing source: " << source_file << "\n";
+  if (!options.header_only) {
+    if (verbose) {
+      std::cout << "Writing source: " << source_file << "\n";
+    }
+    write_file(source_file, source_content);
   }
-  write_file(source_file, source_content);
 
   std::cout << "Successfully generated:\n";
   std::cout << "  " << header_file << "\n";
-  std::cout << "  " << source_file << "\n";
+  if (!options.header_only) {
+    std::cout << "  " << source_file << "\n";
+  }
 
   return 0;
 }
\ No newline at end of file
@@ -58,6 +58,17 @@ const ModelDecl *Schema::find_model(const std::string &name) const {
   return nullptr;
 }
 
+const StructDecl *Schema::find_struct(const std::string &name) const {
+  for (const auto &decl : declarations) {
+    if (auto *struct_decl = dynamic_cast<StructDecl *>(decl.get())) {
+      if (struct_decl->name == name) {
+        return struct_decl;
+      }
+    }
+  }
+  return nullptr;
+}
+
 PrimitiveTypeKind token_to_primitive_type(TokenType token) {
   switch (token) {
   case TokenType::INT8:
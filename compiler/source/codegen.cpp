@@ -1,9 +1,14 @@
 #include "codegen.hpp"
+#include <algorithm>
+#include <cctype>
 #include <sstream>
+#include <utility>
 
 namespace serialkit {
 
-CodeGenerator::CodeGenerator(const Schema &schema) : schema_(schema) {}
+CodeGenerator::CodeGenerator(const Schema &schema,
+                             const CodeGenOptions &options)
+    : schema_(schema), options_(options) {}
 
 std::string CodeGenerator::generate_header() {
   header_.str("");
@@ -13,15 +18,65 @@ std::string CodeGenerator::generate_header() {
   generate_includes();
   generate_namespace_open(header_);
 
+  if (options_.json) {
+    generate_json_out_declaration();
+  }
+
   for (const auto &decl : schema_.declarations) {
     if (auto *enum_decl = dynamic_cast<const EnumDecl *>(decl.get())) {
       generate_enum_declaration(*enum_decl);
     } else if (auto *model_decl = dynamic_cast<const ModelDecl *>(decl.get())) {
       generate_model_declaration(*model_decl);
+    } else if (auto *struct_decl =
+                   dynamic_cast<const StructDecl *>(decl.get())) {
+      generate_struct_declaration(*struct_decl);
     }
   }
 
+  if (options_.resumable_decoder) {
+    generate_decoder_declarations();
+  }
+  if (options_.stream_writer) {
+    generate_stream_writer_declarations();
+  }
+
   generate_namespace_close(header_);
+
+  if (options_.header_only) {
+    source_.str("");
+    source_.clear();
+    generate_implementation();
+    header_ << "\n" << source_.str();
+  }
+
+  if (options_.reflection) {
+    // The traits templates and descriptors are defined once, in
+    // serialkit/reflection.hpp; the header only specializes them.
+    header_ << "\nnamespace serialkit {\n\n";
+
+    for (const auto &decl : schema_.declarations) {
+      if (auto *enum_decl = dynamic_cast<const EnumDecl *>(decl.get())) {
+        generate_enum_traits(*enum_decl);
+      } else if (auto *model_decl =
+                     dynamic_cast<const ModelDecl *>(decl.get())) {
+        generate_model_traits(model_decl->name, model_decl->fields);
+      } else if (auto *struct_decl =
+                     dynamic_cast<const StructDecl *>(decl.get())) {
+        generate_model_traits(struct_decl->name, struct_decl->fields);
+      }
+    }
+
+    header_ << "} // namespace serialkit\n";
+  }
+
+  header_ << "\nnamespace std {\n\n";
+  for (const auto &decl : schema_.declarations) {
+    if (dynamic_cast<const ModelDecl *>(decl.get()) ||
+        dynamic_cast<const StructDecl *>(decl.get())) {
+      generate_std_hash(decl->name);
+    }
+  }
+  header_ << "} // namespace std\n";
   return header_.str();
 }
 
@@ -29,477 +84,4393 @@ std::string CodeGenerator::generate_source(const std::string &header) {
   source_.str("");
   source_.clear();
 
+  if (options_.header_only) {
+    return source_.str();
+  }
+
   source_ << "#include \"" << (header.empty() ? schema_.namespace_name : header)
           << ".hpp\"\n";
   source_ << "#include <cstring>\n";
   source_ << "#include <stdexcept>\n\n";
 
+  generate_implementation();
+  return source_.str();
+}
+
+void CodeGenerator::generate_implementation() {
   generate_namespace_open(source_);
+  generate_source_helpers();
+
+  std::vector<const ModelDecl *> columnar = get_columnar_elements();
+  if (!columnar.empty()) {
+    generate_internal_namespace_open();
+    for (const ModelDecl *element : columnar) {
+      generate_column_codec(*element);
+    }
+    generate_internal_namespace_close();
+  }
 
   for (const auto &decl : schema_.declarations) {
     if (auto *model_decl = dynamic_cast<const ModelDecl *>(decl.get())) {
       generate_model_implementation(*model_decl);
+    } else if (auto *struct_decl =
+                   dynamic_cast<const StructDecl *>(decl.get())) {
+      generate_struct_implementation(*struct_decl);
     }
   }
 
+  if (options_.json) {
+    generate_json_implementation();
+  }
+  if (options_.resumable_decoder) {
+    generate_decoder_implementation();
+  }
+  if (options_.stream_writer) {
+    generate_stream_writer_implementation();
+  }
+
   generate_namespace_close(source_);
-  return source_.str();
 }
 
 void CodeGenerator::generate_includes() {
+  header_ << "#include <cstddef>\n";
   header_ << "#include <cstdint>\n";
+  header_ << "#include <cstring>\n";
+  header_ << "#include <span>\n";
   header_ << "#include <string>\n";
+  header_ << "#include <utility>\n";
   header_ << "#include <vector>\n";
   header_ << "#include <optional>\n";
-  header_ << "#include <memory>\n\n";
+  header_ << "#include <memory>\n";
+  header_ << "#include <string_view>\n";
+  header_ << "#include <tuple>\n";
+  header_ << "#include <compare>\n";
+  header_ << "#include <functional>\n";
+  bool columnar = !get_columnar_elements().empty();
+  if (has_structs() || columnar || options_.json) {
+    header_ << "#include <bit>\n";
+  }
+  if (options_.stream_writer || has_structs() || options_.json) {
+    header_ << "#include <type_traits>\n";
+  }
+  if (options_.json) {
+    header_ << "#include <charconv>\n";
+    header_ << "#include <limits>\n";
+    header_ << "#include <system_error>\n";
+    header_ << "#if defined(__SSE2__)\n";
+    header_ << "#include <emmintrin.h>\n";
+    header_ << "#endif\n";
+  }
+  if (has_utf8_fields()) {
+    header_ << "#if defined(__SSSE3__)\n";
+    header_ << "#include <tmmintrin.h>\n";
+    header_ << "#endif\n";
+  }
+  if (has_checksummed_models()) {
+    header_ << "#if defined(__SSE4_2__) && defined(__x86_64__)\n";
+    header_ << "#include <nmmintrin.h>\n";
+    header_ << "#endif\n";
+  }
+  if (columnar) {
+    header_ << "#include <unordered_map>\n";
+  }
+  if (options_.reflection) {
+    header_ << "#include \"serialkit/reflection.hpp\"\n";
+  }
+  if (options_.resumable_decoder) {
+    header_ << "#include \"serialkit/decoder.hpp\"\n";
+  }
+  header_ << "\n";
 }
 
-void CodeGenerator::generate_namespace_open(std::ostringstream &out) {
-  out << "namespace " << schema_.namespace_name << " {\n\n";
+void CodeGenerator::generate_internal_namespace_open() {
+  // Helpers go in a nested detail namespace so that they cannot clash with
+  // the schema's types. Inline definitions in a header must not refer to
+  // internal-linkage helpers, so only the source file makes it anonymous.
+  source_ << "namespace detail {\n";
+  if (!options_.header_only) {
+    source_ << "namespace {\n";
+  }
+  source_ << "\n";
 }
 
-void CodeGenerator::generate_namespace_close(std::ostringstream &out) {
-  out << "} // namespace " << schema_.namespace_name << "\n";
+void CodeGenerator::generate_internal_namespace_close() {
+  if (!options_.header_only) {
+    source_ << "} // namespace\n";
+  }
+  source_ << "} // namespace detail\n\n";
 }
 
-void CodeGenerator::generate_enum_declaration(const EnumDecl &enum_decl) {
-  header_ << "enum class " << enum_decl.name << " : int32_t {\n";
+void CodeGenerator::generate_helper_guard_open(const std::string &group) {
+  // Every header-only schema of a namespace emits the same helpers into
+  // its detail namespace; the guard keeps the first copy.
+  if (options_.header_only) {
+    std::string guard = get_helper_guard(group);
+    source_ << "#ifndef " << guard << "\n";
+    source_ << "#define " << guard << "\n\n";
+  }
+}
 
-  for (size_t i = 0; i < enum_decl.values.size(); ++i) {
-    const auto &value = enum_decl.values[i];
-    header_ << "  " << value->name << " = " << value->value;
-    if (i < enum_decl.values.size() - 1) {
-      header_ << ",";
-    }
-    header_ << "\n";
+void CodeGenerator::generate_helper_guard_close() {
+  if (options_.header_only) {
+    source_ << "#endif\n\n";
   }
+}
 
-  header_ << "};\n\n";
+std::string CodeGenerator::get_helper_guard(const std::string &group) const {
+  std::string guard = "SERIALKIT_" + schema_.namespace_name + "_" + group;
+  std::transform(guard.begin(), guard.end(), guard.begin(),
+                 [](unsigned char c) { return std::toupper(c); });
+  return guard;
 }
 
-void CodeGenerator::generate_model_declaration(const ModelDecl &model) {
-  header_ << "class " << model.name << " {\n";
-  header_ << "public:\n";
-  header_ << "  " << model.name << "() = default;\n\n";
+void CodeGenerator::generate_source_helpers() {
+  std::string constexpr_helper =
+      options_.header_only ? "constexpr " : "inline ";
+  generate_internal_namespace_open();
+  generate_helper_guard_open("WIRE_HELPERS");
 
-  for (const auto &field : model.fields) {
-    header_ << "  " << get_field_type(*field) << " " << field->name;
+  source_ << constexpr_helper << "size_t varint_size(uint64_t value) {\n";
+  source_ << "  size_t size = 1;\n";
+  source_ << "  while (value > 0x7F) {\n";
+  source_ << "    value >>= 7;\n";
+  source_ << "    ++size;\n";
+  source_ << "  }\n";
+  source_ << "  return size;\n";
+  source_ << "}\n\n";
 
-    if (field->is_repeated()) {
-      header_ << ";\n";
-    } else if (field->is_optional()) {
-      header_ << ";\n";
-    } else {
-      if (auto *prim = dynamic_cast<const PrimitiveType *>(field->type.get())) {
-        switch (prim->kind) {
-        case PrimitiveTypeKind::BOOL:
-          header_ << " = false;\n";
-          break;
-        case PrimitiveTypeKind::STRING:
-          header_ << ";\n";
-          break;
-        default:
-          header_ << " = 0;\n";
-          break;
-        }
-      } else {
-        header_ << ";\n";
-      }
-    }
+  source_ << constexpr_helper
+          << "size_t length_delimited_size(size_t length) {\n";
+  source_ << "  return varint_size(length) + length;\n";
+  source_ << "}\n\n";
+
+  source_ << constexpr_helper
+          << "uint8_t* write_varint(uint8_t* out, uint64_t value) {\n";
+  source_ << "  while (value > 0x7F) {\n";
+  source_ << "    *out++ = static_cast<uint8_t>((value & 0x7F) | 0x80);\n";
+  source_ << "    value >>= 7;\n";
+  source_ << "  }\n";
+  source_ << "  *out++ = static_cast<uint8_t>(value);\n";
+  source_ << "  return out;\n";
+  source_ << "}\n\n";
+
+  // Fails on a varint that is cut off or runs past 10 bytes.
+  source_ << constexpr_helper
+          << "bool parse_varint(std::span<const uint8_t> data, size_t& pos,\n";
+  source_ << "                  uint64_t& value) {\n";
+  source_ << "  value = 0;\n";
+  source_ << "  for (int shift = 0; shift < 64 && pos < data.size(); "
+             "shift += 7) {\n";
+  source_ << "    uint8_t byte = data[pos++];\n";
+  source_ << "    value |= static_cast<uint64_t>(byte & 0x7F) << shift;\n";
+  source_ << "    if ((byte & 0x80) == 0) return true;\n";
+  source_ << "  }\n";
+  source_ << "  return false;\n";
+  source_ << "}\n\n";
+
+  source_ << "inline uint8_t* append_space(std::vector<uint8_t>& buffer, "
+             "size_t size) {\n";
+  source_ << "  size_t offset = buffer.size();\n";
+  source_ << "  buffer.resize(offset + size);\n";
+  source_ << "  return buffer.data() + offset;\n";
+  source_ << "}\n\n";
+
+  source_ << "// The next element to decode into: one left from an earlier "
+             "message\n";
+  source_ << "// while there are any, so that its buffers are reused, then a "
+             "new one.\n";
+  source_ << "template <typename T>\n";
+  source_ << "inline T& next_element(std::vector<T>& items, size_t& used) {\n";
+  source_ << "  if (used == items.size()) items.emplace_back();\n";
+  source_ << "  return items[used++];\n";
+  source_ << "}\n\n";
+
+  source_ << "inline void append_string_iov(std::vector<uint8_t>& scratch,\n";
+  source_ << "    std::vector<std::pair<size_t, std::span<const uint8_t>>>& "
+             "references,\n";
+  source_ << "    size_t threshold, const std::string& value) {\n";
+  source_ << "  uint8_t* out = append_space(scratch, varint_size(value.size()));\n";
+  source_ << "  write_varint(out, value.size());\n";
+  source_ << "  const uint8_t* data = reinterpret_cast<const uint8_t*>"
+             "(value.data());\n";
+  source_ << "  if (value.size() >= threshold) {\n";
+  source_ << "    references.emplace_back(scratch.size(),\n";
+  source_ << "        std::span<const uint8_t>(data, value.size()));\n";
+  source_ << "  } else {\n";
+  source_ << "    scratch.insert(scratch.end(), data, data + value.size());\n";
+  source_ << "  }\n";
+  source_ << "}\n\n";
+  generate_helper_guard_close();
+
+  if (has_structs() || !get_columnar_elements().empty()) {
+    generate_helper_guard_open("ENDIAN_HELPERS");
+    source_ << "template <typename T>\n";
+    source_ << "inline uint8_t* store_le(uint8_t* out, T value) {\n";
+    source_ << "  if constexpr (std::endian::native == std::endian::little) "
+               "{\n";
+    source_ << "    std::memcpy(out, &value, sizeof(T));\n";
+    source_ << "  } else {\n";
+    source_ << "    uint8_t bytes[sizeof(T)];\n";
+    source_ << "    std::memcpy(bytes, &value, sizeof(T));\n";
+    source_ << "    for (size_t i = 0; i < sizeof(T); ++i) {\n";
+    source_ << "      out[i] = bytes[sizeof(T) - 1 - i];\n";
+    source_ << "    }\n";
+    source_ << "  }\n";
+    source_ << "  return out + sizeof(T);\n";
+    source_ << "}\n\n";
+
+    source_ << "inline uint8_t* store_le(uint8_t* out, bool value) {\n";
+    source_ << "  *out = value ? 1 : 0;\n";
+    source_ << "  return out + 1;\n";
+    source_ << "}\n\n";
+
+    source_ << "template <typename T>\n";
+    source_ << "inline const uint8_t* load_le(const uint8_t* in, T& value) "
+               "{\n";
+    source_ << "  if constexpr (std::endian::native == std::endian::little) "
+               "{\n";
+    source_ << "    std::memcpy(&value, in, sizeof(T));\n";
+    source_ << "  } else {\n";
+    source_ << "    uint8_t bytes[sizeof(T)];\n";
+    source_ << "    for (size_t i = 0; i < sizeof(T); ++i) {\n";
+    source_ << "      bytes[i] = in[sizeof(T) - 1 - i];\n";
+    source_ << "    }\n";
+    source_ << "    std::memcpy(&value, bytes, sizeof(T));\n";
+    source_ << "  }\n";
+    source_ << "  return in + sizeof(T);\n";
+    source_ << "}\n\n";
+
+    source_ << "inline const uint8_t* load_le(const uint8_t* in, bool& value) "
+               "{\n";
+    source_ << "  value = *in != 0;\n";
+    source_ << "  return in + 1;\n";
+    source_ << "}\n\n";
+    generate_helper_guard_close();
   }
 
-  header_ << "\n";
-  header_ << "  std::vector<uint8_t> serialize() const;\n";
-  header_ << "  bool deserialize(const std::vector<uint8_t>& data);\n";
-  header_ << "};\n\n";
+  if (has_structs()) {
+    generate_helper_guard_open("WIRE_LAYOUT");
+    source_ << "// True when T is laid out exactly like its encoding, so "
+               "arrays of T\n";
+    source_ << "// are copied to and from the wire as raw bytes.\n";
+    source_ << "template <typename T>\n";
+    source_ << "constexpr bool has_wire_layout() {\n";
+    source_ << "  return std::endian::native == std::endian::little &&\n";
+    source_ << "         std::is_trivially_copyable_v<T> && sizeof(T) == "
+               "T::WIRE_SIZE;\n";
+    source_ << "}\n\n";
+    generate_helper_guard_close();
+  }
+
+  generate_helper_guard_open("HASH_HELPERS");
+  generate_hash_helpers();
+  generate_helper_guard_close();
+  if (!get_columnar_elements().empty()) {
+    generate_helper_guard_open("COLUMN_HELPERS");
+    generate_column_helpers();
+    generate_helper_guard_close();
+  }
+  if (has_utf8_fields()) {
+    generate_helper_guard_open("UTF8_HELPERS");
+    generate_utf8_helpers();
+    generate_helper_guard_close();
+  }
+  if (has_checksummed_models()) {
+    generate_helper_guard_open("CHECKSUM_HELPERS");
+    generate_checksum_helpers();
+    generate_helper_guard_close();
+  }
+  if (options_.json) {
+    generate_helper_guard_open("JSON_HELPERS");
+    generate_json_helpers();
+    generate_helper_guard_close();
+  }
+  if (options_.diff) {
+    generate_helper_guard_open("DIFF_HELPERS");
+    generate_diff_helpers();
+    generate_helper_guard_close();
+  }
+
+  generate_internal_namespace_close();
 }
 
-void CodeGenerator::generate_model_implementation(const ModelDecl &model) {
-  generate_serialize_method(model);
-  generate_deserialize_method(model);
+void CodeGenerator::generate_utf8_helpers() {
+  source_ << "#if defined(__SSSE3__)\n";
+  source_ << "// Lookup-table UTF-8 validation of 16 bytes at a time "
+             "(Keiser and Lemire,\n";
+  source_ << "// \"Validating UTF-8 In Less Than One Instruction Per "
+             "Byte\"). Each byte is\n";
+  source_ << "// classified by its high nibble and the nibbles of the byte "
+             "before it;\n";
+  source_ << "// the three lookups agree on an error bit only for invalid "
+             "sequences.\n";
+  source_ << "struct Utf8Checker {\n";
+  source_ << "  __m128i error = _mm_setzero_si128();\n";
+  source_ << "  __m128i previous = _mm_setzero_si128();\n";
+  source_ << "  __m128i incomplete = _mm_setzero_si128();\n\n";
+  source_ << "  void check(__m128i input) {\n";
+  source_ << "    if (_mm_movemask_epi8(input) == 0) {\n";
+  source_ << "      error = _mm_or_si128(error, incomplete);\n";
+  source_ << "      incomplete = _mm_setzero_si128();\n";
+  source_ << "      previous = input;\n";
+  source_ << "      return;\n";
+  source_ << "    }\n";
+  source_ << "    constexpr char TOO_SHORT = 1 << 0;\n";
+  source_ << "    constexpr char TOO_LONG = 1 << 1;\n";
+  source_ << "    constexpr char OVERLONG_3 = 1 << 2;\n";
+  source_ << "    constexpr char TOO_LARGE = 1 << 3;\n";
+  source_ << "    constexpr char SURROGATE = 1 << 4;\n";
+  source_ << "    constexpr char OVERLONG_2 = 1 << 5;\n";
+  source_ << "    constexpr char TOO_LARGE_1000 = 1 << 6;\n";
+  source_ << "    constexpr char OVERLONG_4 = 1 << 6;\n";
+  source_ << "    constexpr char TWO_CONTS = static_cast<char>(1 << 7);\n";
+  source_ << "    constexpr char CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;\n";
+  source_ << "    constexpr char LARGE = CARRY | TOO_LARGE | TOO_LARGE_1000;\n";
+  source_ << "    const __m128i nibble = _mm_set1_epi8(0x0F);\n";
+  source_ << "    __m128i prev1 = _mm_alignr_epi8(input, previous, 15);\n";
+  source_ << "    __m128i byte_1_high = _mm_shuffle_epi8(\n";
+  source_ << "        _mm_setr_epi8(TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, "
+             "TOO_LONG,\n";
+  source_ << "                      TOO_LONG, TOO_LONG, TOO_LONG, "
+             "TWO_CONTS, TWO_CONTS,\n";
+  source_ << "                      TWO_CONTS, TWO_CONTS, TOO_SHORT | "
+             "OVERLONG_2,\n";
+  source_ << "                      TOO_SHORT, TOO_SHORT | OVERLONG_3 | "
+             "SURROGATE,\n";
+  source_ << "                      TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 "
+             "| OVERLONG_4),\n";
+  source_ << "        _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));\n";
+  source_ << "    __m128i byte_1_low = _mm_shuffle_epi8(\n";
+  source_ << "        _mm_setr_epi8(CARRY | OVERLONG_3 | OVERLONG_2 | "
+             "OVERLONG_4,\n";
+  source_ << "                      CARRY | OVERLONG_2, CARRY, CARRY, CARRY "
+             "| TOO_LARGE,\n";
+  source_ << "                      LARGE, LARGE, LARGE, LARGE, LARGE, "
+             "LARGE, LARGE,\n";
+  source_ << "                      LARGE, LARGE | SURROGATE, LARGE, LARGE),\n";
+  source_ << "        _mm_and_si128(prev1, nibble));\n";
+  source_ << "    constexpr char CONTINUATION = TOO_LONG | OVERLONG_2 | "
+             "TWO_CONTS;\n";
+  source_ << "    __m128i byte_2_high = _mm_shuffle_epi8(\n";
+  source_ << "        _mm_setr_epi8(TOO_SHORT, TOO_SHORT, TOO_SHORT, "
+             "TOO_SHORT, TOO_SHORT,\n";
+  source_ << "                      TOO_SHORT, TOO_SHORT, TOO_SHORT,\n";
+  source_ << "                      CONTINUATION | OVERLONG_3 | "
+             "TOO_LARGE_1000 |\n";
+  source_ << "                          OVERLONG_4,\n";
+  source_ << "                      CONTINUATION | OVERLONG_3 | TOO_LARGE,\n";
+  source_ << "                      CONTINUATION | SURROGATE | TOO_LARGE,\n";
+  source_ << "                      CONTINUATION | SURROGATE | TOO_LARGE, "
+             "TOO_SHORT,\n";
+  source_ << "                      TOO_SHORT, TOO_SHORT, TOO_SHORT),\n";
+  source_ << "        _mm_and_si128(_mm_srli_epi16(input, 4), nibble));\n";
+  source_ << "    __m128i special =\n";
+  source_ << "        _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), "
+             "byte_2_high);\n";
+  source_ << "    // Third and fourth bytes of longer sequences must be "
+             "continuations,\n";
+  source_ << "    // which is all that TWO_CONTS may flag.\n";
+  source_ << "    __m128i third = _mm_subs_epu8(_mm_alignr_epi8(input, "
+             "previous, 14),\n";
+  source_ << "                                  _mm_set1_epi8(0xE0 - 0x80));\n";
+  source_ << "    __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(input, "
+             "previous, 13),\n";
+  source_ << "                                   _mm_set1_epi8(0xF0 - "
+             "0x80));\n";
+  source_ << "    __m128i must_continue =\n";
+  source_ << "        _mm_and_si128(_mm_or_si128(third, fourth),\n";
+  source_ << "                      _mm_set1_epi8(static_cast<char>(0x80)));\n";
+  source_ << "    error = _mm_or_si128(error, _mm_xor_si128(must_continue, "
+             "special));\n";
+  source_ << "    // A sequence starting in the last three bytes ends in "
+             "the next block.\n";
+  source_ << "    incomplete = _mm_subs_epu8(\n";
+  source_ << "        input, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, "
+             "-1, -1, -1, -1,\n";
+  source_ << "                             -1, static_cast<char>(0xEF),\n";
+  source_ << "                             static_cast<char>(0xDF),\n";
+  source_ << "                             static_cast<char>(0xBF)));\n";
+  source_ << "    previous = input;\n";
+  source_ << "  }\n\n";
+  source_ << "  bool finish() const {\n";
+  source_ << "    __m128i errors = _mm_or_si128(error, incomplete);\n";
+  source_ << "    return _mm_movemask_epi8(_mm_cmpeq_epi8(errors, "
+             "_mm_setzero_si128())) ==\n";
+  source_ << "           0xFFFF;\n";
+  source_ << "  }\n";
+  source_ << "};\n";
+  source_ << "#endif\n\n";
+  source_ << "// Reports whether `size` bytes are valid UTF-8, copying them "
+             "to `out` in the\n";
+  source_ << "// same pass when Copy is set.\n";
+  source_ << "template <bool Copy>\n";
+  source_ << "inline bool utf8_scan(char* out, const uint8_t* in, size_t "
+             "size) {\n";
+  source_ << "#if defined(__SSSE3__)\n";
+  source_ << "  Utf8Checker checker;\n";
+  source_ << "  size_t i = 0;\n";
+  source_ << "  for (; size - i >= 16; i += 16) {\n";
+  source_ << "    __m128i block = _mm_loadu_si128(reinterpret_cast<const "
+             "__m128i*>(in + i));\n";
+  source_ << "    if constexpr (Copy) {\n";
+  source_ << "      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), "
+             "block);\n";
+  source_ << "    }\n";
+  source_ << "    checker.check(block);\n";
+  source_ << "  }\n";
+  source_ << "  if (i < size) {\n";
+  source_ << "    // The zero padding is ASCII, so it cannot hide an error.\n";
+  source_ << "    uint8_t tail[16] = {};\n";
+  source_ << "    std::memcpy(tail, in + i, size - i);\n";
+  source_ << "    if constexpr (Copy) {\n";
+  source_ << "      std::memcpy(out + i, tail, size - i);\n";
+  source_ << "    }\n";
+  source_ << "    checker.check(_mm_loadu_si128(reinterpret_cast<const "
+             "__m128i*>(tail)));\n";
+  source_ << "  }\n";
+  source_ << "  return checker.finish();\n";
+  source_ << "#else\n";
+  source_ << "  if constexpr (Copy) {\n";
+  source_ << "    if (size != 0) std::memcpy(out, in, size);\n";
+  source_ << "  }\n";
+  source_ << "  size_t i = 0;\n";
+  source_ << "  while (i < size) {\n";
+  source_ << "    if (size - i >= 16) {\n";
+  source_ << "      uint64_t words[2];\n";
+  source_ << "      std::memcpy(words, in + i, 16);\n";
+  source_ << "      if (((words[0] | words[1]) & 0x8080808080808080ull) == "
+             "0) {\n";
+  source_ << "        i += 16;\n";
+  source_ << "        continue;\n";
+  source_ << "      }\n";
+  source_ << "    }\n";
+  source_ << "    uint8_t lead = in[i];\n";
+  source_ << "    if (lead < 0x80) {\n";
+  source_ << "      ++i;\n";
+  source_ << "      continue;\n";
+  source_ << "    }\n";
+  source_ << "    size_t length = 4;\n";
+  source_ << "    uint32_t min = 0x10000;\n";
+  source_ << "    uint32_t code = lead & 0x07;\n";
+  source_ << "    if ((lead & 0xE0) == 0xC0) {\n";
+  source_ << "      length = 2;\n";
+  source_ << "      min = 0x80;\n";
+  source_ << "      code = lead & 0x1F;\n";
+  source_ << "    } else if ((lead & 0xF0) == 0xE0) {\n";
+  source_ << "      length = 3;\n";
+  source_ << "      min = 0x800;\n";
+  source_ << "      code = lead & 0x0F;\n";
+  source_ << "    } else if ((lead & 0xF8) != 0xF0) {\n";
+  source_ << "      return false;\n";
+  source_ << "    }\n";
+  source_ << "    if (size - i < length) return false;\n";
+  source_ << "    for (size_t k = 1; k < length; ++k) {\n";
+  source_ << "      if ((in[i + k] & 0xC0) != 0x80) return false;\n";
+  source_ << "      code = (code << 6) | (in[i + k] & 0x3F);\n";
+  source_ << "    }\n";
+  source_ << "    if (code < min || code > 0x10FFFF || (code >= 0xD800 && "
+             "code < 0xE000)) {\n";
+  source_ << "      return false;\n";
+  source_ << "    }\n";
+  source_ << "    i += length;\n";
+  source_ << "  }\n";
+  source_ << "  return true;\n";
+  source_ << "#endif\n";
+  source_ << "}\n\n";
+  source_ << "inline bool utf8_valid(std::string_view text) {\n";
+  source_ << "  return utf8_scan<false>(nullptr, reinterpret_cast<const "
+             "uint8_t*>(text.data()),\n";
+  source_ << "                          text.size());\n";
+  source_ << "}\n\n";
+  source_ << "inline bool utf8_assign(std::string& target, const uint8_t* "
+             "data,\n";
+  source_ << "                        size_t size) {\n";
+  source_ << "  target.resize(size);\n";
+  source_ << "  return utf8_scan<true>(target.data(), data, size);\n";
+  source_ << "}\n\n";
+
 }
 
-void CodeGenerator::generate_serialize_method(const ModelDecl &model) {
-  source_ << "std::vector<uint8_t> " << model.name << "::serialize() const {\n";
-  source_ << "  std::vector<uint8_t> buffer;\n";
-  source_ << "  buffer.reserve(64);\n\n";
+void CodeGenerator::generate_checksum_helpers() {
+  source_ << "// CRC32C (Castagnoli) of `size` bytes, continuing from `crc`.\n";
+  source_ << "#if defined(__SSE4_2__) && defined(__x86_64__)\n";
+  source_ << "inline uint32_t crc32c(const uint8_t* data, size_t size, "
+             "uint32_t crc = 0) {\n";
+  source_ << "  uint64_t value = ~crc;\n";
+  source_ << "  for (; size >= 8; data += 8, size -= 8) {\n";
+  source_ << "    uint64_t word;\n";
+  source_ << "    std::memcpy(&word, data, 8);\n";
+  source_ << "    value = _mm_crc32_u64(value, word);\n";
+  source_ << "  }\n";
+  source_ << "  crc = static_cast<uint32_t>(value);\n";
+  source_ << "  for (; size > 0; ++data, --size) {\n";
+  source_ << "    crc = _mm_crc32_u8(crc, *data);\n";
+  source_ << "  }\n";
+  source_ << "  return ~crc;\n";
+  source_ << "}\n";
+  source_ << "#else\n";
+  source_ << "// Slice-by-8: entry [k][b] is the CRC of byte b followed by k "
+             "zero bytes.\n";
+  source_ << "struct Crc32cTables {\n";
+  source_ << "  uint32_t entries[8][256];\n";
+  source_ << "};\n\n";
+  source_ << "constexpr Crc32cTables make_crc32c_tables() {\n";
+  source_ << "  Crc32cTables tables{};\n";
+  source_ << "  for (uint32_t i = 0; i < 256; ++i) {\n";
+  source_ << "    uint32_t crc = i;\n";
+  source_ << "    for (int bit = 0; bit < 8; ++bit) {\n";
+  source_ << "      crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0);\n";
+  source_ << "    }\n";
+  source_ << "    tables.entries[0][i] = crc;\n";
+  source_ << "  }\n";
+  source_ << "  for (int k = 1; k < 8; ++k) {\n";
+  source_ << "    for (uint32_t i = 0; i < 256; ++i) {\n";
+  source_ << "      uint32_t previous = tables.entries[k - 1][i];\n";
+  source_ << "      tables.entries[k][i] =\n";
+  source_ << "          (previous >> 8) ^ tables.entries[0][previous & "
+             "0xFF];\n";
+  source_ << "    }\n";
+  source_ << "  }\n";
+  source_ << "  return tables;\n";
+  source_ << "}\n\n";
+  source_ << "inline constexpr Crc32cTables CRC32C_TABLES = "
+             "make_crc32c_tables();\n\n";
+  source_ << "inline uint32_t crc32c(const uint8_t* data, size_t size, "
+             "uint32_t crc = 0) {\n";
+  source_ << "  const auto& table = CRC32C_TABLES.entries;\n";
+  source_ << "  crc = ~crc;\n";
+  source_ << "  for (; size >= 8; data += 8, size -= 8) {\n";
+  source_ << "    uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) |\n";
+  source_ << "                          static_cast<uint32_t>(data[1]) << 8 "
+             "|\n";
+  source_ << "                          static_cast<uint32_t>(data[2]) << 16 "
+             "|\n";
+  source_ << "                          static_cast<uint32_t>(data[3]) << "
+             "24);\n";
+  source_ << "    crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] "
+             "^\n";
+  source_ << "          table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] "
+             "^\n";
+  source_ << "          table[3][data[4]] ^ table[2][data[5]] ^ "
+             "table[1][data[6]] ^\n";
+  source_ << "          table[0][data[7]];\n";
+  source_ << "  }\n";
+  source_ << "  for (; size > 0; ++data, --size) {\n";
+  source_ << "    crc = table[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);\n";
+  source_ << "  }\n";
+  source_ << "  return ~crc;\n";
+  source_ << "}\n";
+  source_ << "#endif\n\n";
 
-  for (const auto &field : model.fields) {
-    generate_field_serializer(*field, "  ");
+  source_ << "inline uint8_t* store_crc32c(uint8_t* out, uint32_t crc) {\n";
+  source_ << "  for (int i = 0; i < 4; ++i) {\n";
+  source_ << "    *out++ = static_cast<uint8_t>(crc >> (i * 8));\n";
+  source_ << "  }\n";
+  source_ << "  return out;\n";
+  source_ << "}\n\n";
+
+  source_ << "// Checks the trailer of a checksummed message and drops it "
+             "from `data`.\n";
+  source_ << "inline bool verify_crc32c(std::span<const uint8_t>& data) {\n";
+  source_ << "  if (data.size() < 4) return false;\n";
+  source_ << "  size_t size = data.size() - 4;\n";
+  source_ << "  uint32_t expected = 0;\n";
+  source_ << "  for (int i = 0; i < 4; ++i) {\n";
+  source_ << "    expected |= static_cast<uint32_t>(data[size + i]) << (i * "
+             "8);\n";
+  source_ << "  }\n";
+  source_ << "  if (crc32c(data.data(), size) != expected) return false;\n";
+  source_ << "  data = data.first(size);\n";
+  source_ << "  return true;\n";
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_hash_helpers() {
+  source_ << "// Streaming 64-bit hash over a sequence of words. As in XXH3, "
+             "each word is\n";
+  source_ << "// mixed with a key that depends on its position and the mixes "
+             "are summed,\n";
+  source_ << "// so the work per word does not wait on the previous one; the "
+             "sum gets\n";
+  source_ << "// the XXH64 avalanche. Strings are read as little-endian words, "
+             "so the\n";
+  source_ << "// result is the same on every platform.\n";
+  source_ << "struct FieldHasher {\n";
+  source_ << "  static constexpr uint64_t P1 = 0x9E3779B185EBCA87ull;\n";
+  source_ << "  static constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4Full;\n";
+  source_ << "  static constexpr uint64_t P3 = 0x165667B19E3779F9ull;\n";
+  source_ << "  static constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ull;\n";
+  source_ << "  static constexpr uint64_t P5 = 0x27D4EB2F165667C5ull;\n\n";
+  source_ << "  uint64_t sum;\n";
+  source_ << "  uint64_t key;\n\n";
+  source_ << "  explicit FieldHasher(uint64_t seed) : sum(seed), key(seed ^ "
+             "P5) {}\n\n";
+  source_ << "  void add(uint64_t value) {\n";
+  source_ << "    uint64_t mixed = (value ^ key) * P2;\n";
+  source_ << "    sum += ((mixed << 31) | (mixed >> 33)) * P1;\n";
+  source_ << "    key += P4;\n";
+  source_ << "  }\n\n";
+  source_ << "  void add_bits(float value) {\n";
+  source_ << "    // Values that compare equal hash equally: -0 becomes +0 "
+             "and every NaN\n";
+  source_ << "    // gets the same bits.\n";
+  source_ << "    if (value == 0.0f) value = 0.0f;\n";
+  source_ << "    uint32_t bits;\n";
+  source_ << "    std::memcpy(&bits, &value, sizeof(bits));\n";
+  source_ << "    if (value != value) bits = 0x7FC00000u;\n";
+  source_ << "    add(bits);\n";
+  source_ << "  }\n\n";
+  source_ << "  void add_bits(double value) {\n";
+  source_ << "    if (value == 0.0) value = 0.0;\n";
+  source_ << "    uint64_t bits;\n";
+  source_ << "    std::memcpy(&bits, &value, sizeof(bits));\n";
+  source_ << "    if (value != value) bits = 0x7FF8000000000000ull;\n";
+  source_ << "    add(bits);\n";
+  source_ << "  }\n\n";
+  source_ << "  void add_string(const std::string& value) {\n";
+  source_ << "    const uint8_t* in = reinterpret_cast<const uint8_t*>"
+             "(value.data());\n";
+  source_ << "    size_t size = value.size();\n";
+  source_ << "    add(size);\n";
+  source_ << "    for (; size >= 8; in += 8, size -= 8) {\n";
+  source_ << "      // Compilers turn this into a single load.\n";
+  source_ << "      add(static_cast<uint64_t>(in[0]) |\n";
+  source_ << "          static_cast<uint64_t>(in[1]) << 8 |\n";
+  source_ << "          static_cast<uint64_t>(in[2]) << 16 |\n";
+  source_ << "          static_cast<uint64_t>(in[3]) << 24 |\n";
+  source_ << "          static_cast<uint64_t>(in[4]) << 32 |\n";
+  source_ << "          static_cast<uint64_t>(in[5]) << 40 |\n";
+  source_ << "          static_cast<uint64_t>(in[6]) << 48 |\n";
+  source_ << "          static_cast<uint64_t>(in[7]) << 56);\n";
+  source_ << "    }\n";
+  source_ << "    if (size > 0) {\n";
+  source_ << "      uint64_t word = 0;\n";
+  source_ << "      for (size_t i = 0; i < size; ++i) {\n";
+  source_ << "        word |= static_cast<uint64_t>(in[i]) << (i * 8);\n";
+  source_ << "      }\n";
+  source_ << "      add(word);\n";
+  source_ << "    }\n";
+  source_ << "  }\n\n";
+  source_ << "  uint64_t finish() const {\n";
+  source_ << "    uint64_t h = sum ^ key;\n";
+  source_ << "    h = (h ^ (h >> 33)) * P2;\n";
+  source_ << "    h = (h ^ (h >> 29)) * P3;\n";
+  source_ << "    return h ^ (h >> 32);\n";
+  source_ << "  }\n";
+  source_ << "};\n\n";
+}
+
+void CodeGenerator::generate_diff_helpers() {
+  source_ << "// Patches (--diff). Integers, enums, bools and lengths are "
+             "varints. A float\n";
+  source_ << "// is the varint of its bits XORed with the previous value's "
+             "bits, which is\n";
+  source_ << "// short when only the low mantissa bits changed.\n";
+  source_ << "template <typename T>\n";
+  source_ << "inline void write_patch(std::vector<uint8_t>& patch, T value) "
+             "{\n";
+  source_ << "  uint64_t bits = static_cast<uint64_t>(value);\n";
+  source_ << "  write_varint(append_space(patch, varint_size(bits)), "
+             "bits);\n";
+  source_ << "}\n\n";
+
+  source_ << "inline void write_patch(std::vector<uint8_t>& patch, "
+             "const std::string& value) {\n";
+  source_ << "  write_patch(patch, value.size());\n";
+  source_ << "  patch.insert(patch.end(), value.begin(), value.end());\n";
+  source_ << "}\n\n";
+
+  for (const char *type : {"float", "double"}) {
+    std::string bits =
+        std::string(type) == "float" ? "uint32_t" : "uint64_t";
+    source_ << "inline void write_patch(std::vector<uint8_t>& patch, "
+            << type << " previous,\n";
+    source_ << "                        " << type << " value) {\n";
+    source_ << "  " << bits << " before;\n";
+    source_ << "  " << bits << " after;\n";
+    source_ << "  std::memcpy(&before, &previous, sizeof(before));\n";
+    source_ << "  std::memcpy(&after, &value, sizeof(after));\n";
+    source_ << "  write_patch(patch, before ^ after);\n";
+    source_ << "}\n\n";
+
+    source_ << "inline bool same_bits(" << type << " a, " << type
+            << " b) {\n";
+    source_ << "  return std::memcmp(&a, &b, sizeof(a)) == 0;\n";
+    source_ << "}\n\n";
+  }
+
+  source_ << "template <typename T>\n";
+  source_ << "inline bool read_patch(std::span<const uint8_t> patch, "
+             "size_t& pos, T& value) {\n";
+  source_ << "  uint64_t bits = 0;\n";
+  source_ << "  if (!parse_varint(patch, pos, bits)) return false;\n";
+  source_ << "  value = static_cast<T>(bits);\n";
+  source_ << "  return true;\n";
+  source_ << "}\n\n";
+
+  source_ << "inline bool read_patch(std::span<const uint8_t> patch, "
+             "size_t& pos,\n";
+  source_ << "                       std::string& value) {\n";
+  source_ << "  uint64_t size = 0;\n";
+  source_ << "  if (!parse_varint(patch, pos, size) || size > patch.size() - "
+             "pos) {\n";
+  source_ << "    return false;\n";
+  source_ << "  }\n";
+  source_ << "  value.assign(reinterpret_cast<const char*>(patch.data() + "
+             "pos), size);\n";
+  source_ << "  pos += size;\n";
+  source_ << "  return true;\n";
+  source_ << "}\n\n";
+
+  for (const char *type : {"float", "double"}) {
+    bool single = std::string(type) == "float";
+    std::string bits = single ? "uint32_t" : "uint64_t";
+    source_ << "inline bool read_patch(std::span<const uint8_t> patch, "
+               "size_t& pos,\n";
+    source_ << "                       " << type << "& value) {\n";
+    source_ << "  uint64_t delta = 0;\n";
+    if (single) {
+      source_ << "  if (!parse_varint(patch, pos, delta) || delta > "
+                 "0xFFFFFFFFu) return false;\n";
+    } else {
+      source_ << "  if (!parse_varint(patch, pos, delta)) return false;\n";
+    }
+    source_ << "  " << bits << " bits;\n";
+    source_ << "  std::memcpy(&bits, &value, sizeof(bits));\n";
+    source_ << "  bits ^= static_cast<" << bits << ">(delta);\n";
+    source_ << "  std::memcpy(&value, &bits, sizeof(bits));\n";
+    source_ << "  return true;\n";
+    source_ << "}\n\n";
   }
 
-  source_ << "\n  return buffer;\n";
+  source_ << "// Base for fields that were absent or elements that were "
+             "appended.\n";
+  source_ << "template <typename T>\n";
+  source_ << "inline const T& empty_value() {\n";
+  source_ << "  static const T value{};\n";
+  source_ << "  return value;\n";
   source_ << "}\n\n";
 }
 
-void CodeGenerator::generate_deserialize_method(const ModelDecl &model) {
-  source_ << "bool " << model.name
-          << "::deserialize(const std::vector<uint8_t>& data) {\n";
-  source_ << "  size_t pos = 0;\n";
-  source_ << "  while (pos < data.size()) {\n";
-  source_ << "    if (pos + 1 > data.size()) return false;\n\n";
+void CodeGenerator::generate_column_helpers() {
+  source_ << "// Distinct strings of a column in first-seen order, and the "
+             "index of\n";
+  source_ << "// each value among them.\n";
+  source_ << "struct StringColumn {\n";
+  source_ << "  std::unordered_map<std::string_view, uint32_t> index;\n";
+  source_ << "  std::vector<std::string_view> entries;\n";
+  source_ << "  std::vector<uint32_t> ids;\n\n";
+  source_ << "  void add(const std::string& value) {\n";
+  source_ << "    auto [it, inserted] =\n";
+  source_ << "        index.try_emplace(value, "
+             "static_cast<uint32_t>(entries.size()));\n";
+  source_ << "    if (inserted) entries.push_back(value);\n";
+  source_ << "    ids.push_back(it->second);\n";
+  source_ << "  }\n\n";
+  source_ << "  size_t byte_size() const {\n";
+  source_ << "    size_t size = varint_size(entries.size());\n";
+  source_ << "    for (std::string_view entry : entries) {\n";
+  source_ << "      size += length_delimited_size(entry.size());\n";
+  source_ << "    }\n";
+  source_ << "    for (uint32_t id : ids) size += varint_size(id);\n";
+  source_ << "    return size;\n";
+  source_ << "  }\n\n";
+  source_ << "  uint8_t* write(uint8_t* out) const {\n";
+  source_ << "    out = write_varint(out, entries.size());\n";
+  source_ << "    for (std::string_view entry : entries) {\n";
+  source_ << "      out = write_varint(out, entry.size());\n";
+  source_ << "      std::memcpy(out, entry.data(), entry.size());\n";
+  source_ << "      out += entry.size();\n";
+  source_ << "    }\n";
+  source_ << "    for (uint32_t id : ids) out = write_varint(out, id);\n";
+  source_ << "    return out;\n";
+  source_ << "  }\n";
+  source_ << "};\n\n";
 
-  source_ << "    uint64_t tag = 0;\n";
-  source_ << "    {\n";
-  source_ << "      int shift = 0;\n";
-  source_ << "      while (pos < data.size()) {\n";
-  source_ << "        uint8_t byte = data[pos++];\n";
-  source_ << "        tag |= static_cast<uint64_t>(byte & 0x7F) << shift;\n";
-  source_ << "        if ((byte & 0x80) == 0) break;\n";
-  source_ << "        shift += 7;\n";
-  source_ << "      }\n";
-  source_ << "    }\n\n";
+  source_ << "inline bool parse_dictionary(std::span<const uint8_t> data, "
+             "size_t& pos,\n";
+  source_ << "                             std::vector<std::string_view>& "
+             "entries) {\n";
+  source_ << "  uint64_t count = 0;\n";
+  source_ << "  if (!parse_varint(data, pos, count) || count > data.size() - "
+             "pos) {\n";
+  source_ << "    return false;\n";
+  source_ << "  }\n";
+  source_ << "  entries.reserve(static_cast<size_t>(count));\n";
+  source_ << "  for (uint64_t i = 0; i < count; ++i) {\n";
+  source_ << "    uint64_t length = 0;\n";
+  source_ << "    if (!parse_varint(data, pos, length) || length > data.size() "
+             "- pos) {\n";
+  source_ << "      return false;\n";
+  source_ << "    }\n";
+  source_ << "    entries.emplace_back(reinterpret_cast<const "
+             "char*>(data.data() + pos),\n";
+  source_ << "                         static_cast<size_t>(length));\n";
+  source_ << "    pos += static_cast<size_t>(length);\n";
+  source_ << "  }\n";
+  source_ << "  return true;\n";
+  source_ << "}\n\n";
+}
 
-  source_ << "    uint32_t field_number = static_cast<uint32_t>(tag >> 3);\n";
-  source_ << "    uint8_t wire_type = static_cast<uint8_t>(tag & 0x7);\n\n";
+void CodeGenerator::generate_column_codec(const ModelDecl &element) {
+  const std::string &name = element.name;
+  std::string specifier = inline_specifier();
 
-  source_ << "    switch (field_number) {\n";
+  source_ << "// Encoded size of `rows` as a column block, without its length "
+             "prefix.\n";
+  source_ << specifier << "size_t " << name
+          << "_columns_size(std::span<const " << name << "> rows) {\n";
+  generate_column_lengths(element);
+  source_ << "  return length;\n";
+  source_ << "}\n\n";
 
-  for (const auto &field : model.fields) {
-    generate_field_deserializer(*field, "    ");
+  source_ << "// Writes `rows` as a length-prefixed column block: the row "
+             "count and\n";
+  source_ << "// then one length-delimited column per field, tagged with the "
+             "field number.\n";
+  source_ << specifier << "uint8_t* " << name
+          << "_write_columns(uint8_t* sk_out, std::span<const " << name
+          << "> rows) {\n";
+  generate_column_lengths(element);
+  source_ << "  sk_out = write_varint(sk_out, length);\n";
+  source_ << "  sk_out = write_varint(sk_out, rows.size());\n";
+  for (const auto &column : element.fields) {
+    generate_column_writer(*column);
   }
+  source_ << "  return sk_out;\n";
+  source_ << "}\n\n";
 
+  source_ << "// Appends the rows of a column block to `rows`. Columns missing "
+             "from the\n";
+  source_ << "// block leave their field at its default; unknown ones are "
+             "skipped.\n";
+  source_ << specifier << "bool " << name
+          << "_read_columns(std::span<const uint8_t> data,\n";
+  source_ << "    std::vector<" << name << ">& rows) {\n";
+  source_ << "  size_t pos = 0;\n";
+  source_ << "  uint64_t count = 0;\n";
+  source_ << "  if (!parse_varint(data, pos, count) || "
+             "count / 8 > data.size()) {\n";
+  source_ << "    return false;\n";
+  source_ << "  }\n";
+  source_ << "  size_t offset = rows.size();\n";
+  source_ << "  rows.resize(offset + static_cast<size_t>(count));\n";
+  source_ << "  " << name << "* block = rows.data() + offset;\n";
+  source_ << "  while (pos < data.size()) {\n";
+  source_ << "    uint64_t tag = 0;\n";
+  source_ << "    uint64_t length = 0;\n";
+  source_ << "    if (!parse_varint(data, pos, tag) ||\n";
+  source_ << "        !parse_varint(data, pos, length) ||\n";
+  source_ << "        length > data.size() - pos) {\n";
+  source_ << "      return false;\n";
+  source_ << "    }\n";
+  source_ << "    std::span<const uint8_t> column = data.subspan(pos, "
+             "static_cast<size_t>(length));\n";
+  source_ << "    pos += static_cast<size_t>(length);\n";
+  source_ << "    size_t at = 0;\n";
+  source_ << "    switch (tag >> 3) {\n";
+  for (const auto &column : element.fields) {
+    generate_column_reader(*column);
+  }
   source_ << "    default:\n";
-  source_ << "      // Skip unknown field\n";
-  source_ << "      if (wire_type == 0) {\n";
-  source_ << "        while (pos < data.size() && (data[pos] & 0x80)) pos++;\n";
-  source_ << "        if (pos < data.size()) pos++;\n";
-  source_ << "      } else if (wire_type == 2) {\n";
-  source_ << "        uint64_t length = 0;\n";
-  source_ << "        int shift = 0;\n";
-  source_ << "        while (pos < data.size()) {\n";
-  source_ << "          uint8_t byte = data[pos++];\n";
-  source_
-      << "          length |= static_cast<uint64_t>(byte & 0x7F) << shift;\n";
-  source_ << "          if ((byte & 0x80) == 0) break;\n";
-  source_ << "          shift += 7;\n";
-  source_ << "        }\n";
-  source_ << "        pos += length;\n";
-  source_ << "      } else if (wire_type == 1) {\n";
-  source_ << "        pos += 8;\n";
-  source_ << "      } else if (wire_type == 5) {\n";
-  source_ << "        pos += 4;\n";
-  source_ << "      }\n";
+  source_ << "      at = column.size();\n";
   source_ << "      break;\n";
   source_ << "    }\n";
+  source_ << "    if (at != column.size()) return false;\n";
   source_ << "  }\n";
   source_ << "  return true;\n";
   source_ << "}\n\n";
 }
 
-void CodeGenerator::generate_field_serializer(const Field &field,
-                                              const std::string &indent) {
-  uint8_t wire_type = get_wire_type_value(*field.type, field);
-  uint32_t tag = (field.number << 3) | wire_type;
+// Column lengths go into `<field>_length` and the whole block into `length`.
+void CodeGenerator::generate_column_lengths(const ModelDecl &element) {
+  source_ << "  size_t length = varint_size(rows.size());\n";
+  for (const auto &column : element.fields) {
+    const std::string &field = column->name;
+    auto *prim_type = dynamic_cast<const PrimitiveType *>(column->type.get());
+    bool optional = column->is_optional();
+    std::string value = optional ? "*row." + field : "row." + field;
+    std::string skip =
+        optional ? "    if (!row." + field + ".has_value()) continue;\n" : "";
+    std::string presence = optional ? "(rows.size() + 7) / 8 + " : "";
+    std::string values = "rows.size()";
+    if (optional && prim_type &&
+        (prim_type->kind == PrimitiveTypeKind::BOOL ||
+         prim_type->kind == PrimitiveTypeKind::FLOAT ||
+         prim_type->kind == PrimitiveTypeKind::DOUBLE)) {
+      source_ << "  size_t " << field << "_present = 0;\n";
+      source_ << "  for (const auto& row : rows) {\n";
+      source_ << "    if (row." << field << ".has_value()) ++" << field
+              << "_present;\n";
+      source_ << "  }\n";
+      values = field + "_present";
+    }
 
-  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+    if (prim_type && prim_type->kind == PrimitiveTypeKind::STRING) {
+      source_ << "  StringColumn " << field << "_column;\n";
+      source_ << "  for (const auto& row : rows) {\n" << skip;
+      source_ << "    " << field << "_column.add(" << value << ");\n";
+      source_ << "  }\n";
+      source_ << "  size_t " << field << "_length = " << presence << field
+              << "_column.byte_size();\n";
+    } else if (prim_type && prim_type->kind == PrimitiveTypeKind::BOOL) {
+      source_ << "  size_t " << field << "_length = " << presence << "("
+              << values << " + 7) / 8;\n";
+    } else if (prim_type && (prim_type->kind == PrimitiveTypeKind::FLOAT ||
+                             prim_type->kind == PrimitiveTypeKind::DOUBLE)) {
+      source_ << "  size_t " << field << "_length = " << presence << values
+              << " * sizeof(" << get_cpp_type(*column->type) << ");\n";
+    } else {
+      source_ << "  size_t " << field << "_length = "
+              << (optional ? "(rows.size() + 7) / 8" : "0") << ";\n";
+      source_ << "  for (const auto& row : rows) {\n" << skip;
+      source_ << "    " << field << "_length += varint_size(static_cast<"
+                 "uint64_t>("
+              << value << "));\n";
+      source_ << "  }\n";
+    }
+    source_ << "  length += " << get_varint_size((column->number << 3) | 2)
+            << " + length_delimited_size(" << field << "_length);\n";
+  }
+}
 
-  if (field.is_repeated()) {
-    source_ << indent << "if (!" << field.name << ".empty()) {\n";
+void CodeGenerator::generate_column_writer(const Field &column) {
+  const std::string &field = column.name;
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(column.type.get());
+  bool optional = column.is_optional();
+  std::string value = optional ? "*row." + field : "row." + field;
+  std::string skip =
+      optional ? "    if (!row." + field + ".has_value()) continue;\n" : "";
 
-    if (field.is_packed() && prim_type) {
-      source_ << indent
-              << "  uint32_t packed_tag = " << ((field.number << 3) | 2)
-              << ";\n";
-      source_ << indent << "  {\n";
-      source_ << indent << "    uint64_t val = packed_tag;\n";
-      source_ << indent << "    while (val > 0x7F) {\n";
-      source_ << indent
-              << "      buffer.push_back(static_cast<uint8_t>((val & 0x7F) | "
-                 "0x80));\n";
-      source_ << indent << "      val >>= 7;\n";
-      source_ << indent << "    }\n";
-      source_ << indent << "    buffer.push_back(static_cast<uint8_t>(val));\n";
-      source_ << indent << "  }\n\n";
+  generate_tag((column.number << 3) | 2, "  ");
+  source_ << "  sk_out = write_varint(sk_out, " << field << "_length);\n";
+  if (optional) {
+    source_ << "  std::memset(sk_out, 0, (rows.size() + 7) / 8);\n";
+    source_ << "  for (size_t i = 0; i < rows.size(); ++i) {\n";
+    source_ << "    if (rows[i]." << field << ".has_value()) {\n";
+    source_ << "      sk_out[i / 8] |= static_cast<uint8_t>(1u << (i % 8));\n";
+    source_ << "    }\n";
+    source_ << "  }\n";
+    source_ << "  sk_out += (rows.size() + 7) / 8;\n";
+  }
+
+  if (prim_type && prim_type->kind == PrimitiveTypeKind::STRING) {
+    source_ << "  sk_out = " << field << "_column.write(sk_out);\n";
+  } else if (prim_type && prim_type->kind == PrimitiveTypeKind::BOOL) {
+    source_ << "  {\n";
+    source_ << "    size_t bit = 0;\n";
+    std::string values = optional ? field + "_present" : "rows.size()";
+    source_ << "    std::memset(sk_out, 0, (" << values << " + 7) / 8);\n";
+    source_ << "    for (const auto& row : rows) {\n";
+    if (optional) {
+      source_ << "      if (!row." << field << ".has_value()) continue;\n";
+    }
+    source_ << "      if (" << value
+            << ") sk_out[bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));\n";
+    source_ << "      ++bit;\n";
+    source_ << "    }\n";
+    source_ << "    sk_out += (bit + 7) / 8;\n";
+    source_ << "  }\n";
+  } else if (prim_type && (prim_type->kind == PrimitiveTypeKind::FLOAT ||
+                           prim_type->kind == PrimitiveTypeKind::DOUBLE)) {
+    source_ << "  for (const auto& row : rows) {\n" << skip;
+    source_ << "    sk_out = store_le(sk_out, " << value << ");\n";
+    source_ << "  }\n";
+  } else {
+    source_ << "  for (const auto& row : rows) {\n" << skip;
+    source_ << "    sk_out = write_varint(sk_out, static_cast<uint64_t>("
+            << value << "));\n";
+    source_ << "  }\n";
+  }
+}
+
+void CodeGenerator::generate_column_reader(const Field &column) {
+  const std::string &field = column.name;
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(column.type.get());
+  bool optional = column.is_optional();
+  std::string cpp_type = get_cpp_type(*column.type);
+  std::string target = "block[i]." + field;
+
+  source_ << "    case " << column.number << ": {\n";
+  if (optional) {
+    source_ << "      if (column.size() < (count + 7) / 8) return false;\n";
+    source_ << "      at = static_cast<size_t>((count + 7) / 8);\n";
+  }
+
+  bool is_string = prim_type && prim_type->kind == PrimitiveTypeKind::STRING;
+  bool is_bool = prim_type && prim_type->kind == PrimitiveTypeKind::BOOL;
+  bool is_fixed = prim_type && (prim_type->kind == PrimitiveTypeKind::FLOAT ||
+                                prim_type->kind == PrimitiveTypeKind::DOUBLE);
+  if (is_string) {
+    source_ << "      std::vector<std::string_view> dictionary;\n";
+    source_ << "      if (!parse_dictionary(column, at, dictionary)) return "
+               "false;\n";
+    if (is_utf8_field(column)) {
+      // Each distinct value is validated once, not once per row.
+      source_ << "      for (std::string_view entry : dictionary) {\n";
+      source_ << "        if (!utf8_valid(entry)) return false;\n";
+      source_ << "      }\n";
+    }
+  } else if (is_bool) {
+    source_ << "      size_t base = at;\n";
+    source_ << "      size_t bit = 0;\n";
+  }
+
+  source_ << "      for (size_t i = 0; i < count; ++i) {\n";
+  if (optional) {
+    source_ << "        if (((column[i / 8] >> (i % 8)) & 1) == 0) "
+               "continue;\n";
+  }
+  if (is_string) {
+    source_ << "        uint64_t id = 0;\n";
+    source_ << "        if (!parse_varint(column, at, id) || id >= "
+               "dictionary.size()) {\n";
+    source_ << "          return false;\n";
+    source_ << "        }\n";
+    if (optional) {
+      source_ << "        " << target << " = std::string(dictionary[id]);\n";
+    } else {
+      source_ << "        " << target << ".assign(dictionary[id]);\n";
+    }
+  } else if (is_bool) {
+    source_ << "        if (base + bit / 8 >= column.size()) return false;\n";
+    source_ << "        " << target
+            << " = ((column[base + bit / 8] >> (bit % 8)) & 1) != 0;\n";
+    source_ << "        ++bit;\n";
+  } else if (is_fixed) {
+    source_ << "        " << cpp_type << " value;\n";
+    source_ << "        if (column.size() - at < sizeof(value)) return "
+               "false;\n";
+    source_ << "        load_le(column.data() + at, value);\n";
+    source_ << "        at += sizeof(value);\n";
+    source_ << "        " << target << " = value;\n";
+  } else {
+    source_ << "        uint64_t value = 0;\n";
+    source_ << "        if (!parse_varint(column, at, value)) return false;\n";
+    source_ << "        " << target << " = static_cast<" << cpp_type
+            << ">(value);\n";
+  }
+  source_ << "      }\n";
+  if (is_bool) {
+    source_ << "      at = base + (bit + 7) / 8;\n";
+  }
+  source_ << "      break;\n";
+  source_ << "    }\n";
+}
+
+void CodeGenerator::generate_json_helpers() {
+  source_ << "// FNV-1a; object keys are matched against hashes computed by"
+             " the compiler.\n";
+  source_ << "inline uint64_t json_hash(std::string_view key) {\n";
+  source_ << "  uint64_t hash = 14695981039346656037ull;\n";
+  source_ << "  for (char c : key) {\n";
+  source_ << "    hash = (hash ^ static_cast<uint8_t>(c)) *"
+             " 1099511628211ull;\n";
+  source_ << "  }\n";
+  source_ << "  return hash;\n";
+  source_ << "}\n\n";
+  source_ << "inline void json_write_string(JsonOut& out, std::string_view"
+             " value) {\n";
+  source_ << "  static constexpr char HEX[] = \"0123456789abcdef\";\n";
+  source_ << "  constexpr uint64_t ONES = 0x0101010101010101ull;\n";
+  source_ << "  constexpr uint64_t HIGH = 0x8080808080808080ull;\n";
+  source_ << "  out += '\"';\n";
+  source_ << "  size_t start = 0;\n";
+  source_ << "  size_t i = 0;\n";
+  source_ << "  while (i < value.size()) {\n";
+  source_ << "    // Skip whole blocks while none holds a quote, a backslash "
+             "or a\n";
+  source_ << "    // control character.\n";
+  source_ << "#if defined(__SSE2__)\n";
+  source_ << "    if (value.size() - i >= 16) {\n";
+  source_ << "      __m128i bytes = _mm_loadu_si128(\n";
+  source_ << "          reinterpret_cast<const __m128i*>(value.data() + i));\n";
+  source_ << "      __m128i special = _mm_or_si128(\n";
+  source_ << "          _mm_or_si128(_mm_cmpeq_epi8(bytes, "
+             "_mm_set1_epi8('\"')),\n";
+  source_ << "                       _mm_cmpeq_epi8(bytes, "
+             "_mm_set1_epi8('\\\\'))),\n";
+  source_ << "          _mm_cmpeq_epi8(_mm_min_epu8(bytes, "
+             "_mm_set1_epi8(0x1F)), bytes));\n";
+  source_ << "      unsigned mask = "
+             "static_cast<unsigned>(_mm_movemask_epi8(special));\n";
+  source_ << "      if (mask == 0) {\n";
+  source_ << "        i += 16;\n";
+  source_ << "        continue;\n";
+  source_ << "      }\n";
+  source_ << "      i += static_cast<size_t>(std::countr_zero(mask));\n";
+  source_ << "    }\n";
+  source_ << "#endif\n";
+  source_ << "    if (value.size() - i >= 8) {\n";
+  source_ << "      uint64_t word;\n";
+  source_ << "      std::memcpy(&word, value.data() + i, 8);\n";
+  source_ << "      uint64_t quote = word ^ (ONES * '\"');\n";
+  source_ << "      uint64_t slash = word ^ (ONES * '\\\\');\n";
+  source_ << "      uint64_t special = ((quote - ONES) & ~quote) |\n";
+  source_ << "                         ((slash - ONES) & ~slash) |\n";
+  source_ << "                         ((word - ONES * 0x20) & ~word);\n";
+  source_ << "      if ((special & HIGH) == 0) {\n";
+  source_ << "        i += 8;\n";
+  source_ << "        continue;\n";
+  source_ << "      }\n";
+  source_ << "    }\n";
+  source_ << "    uint8_t c = static_cast<uint8_t>(value[i]);\n";
+  source_ << "    if (c == '\"' || c == '\\\\' || c < 0x20) {\n";
+  source_ << "      out.append(value.data() + start, i - start);\n";
+  source_ << "      switch (c) {\n";
+  source_ << "      case '\"': out += \"\\\\\\\"\"; break;\n";
+  source_ << "      case '\\\\': out += \"\\\\\\\\\"; break;\n";
+  source_ << "      case '\\b': out += \"\\\\b\"; break;\n";
+  source_ << "      case '\\f': out += \"\\\\f\"; break;\n";
+  source_ << "      case '\\n': out += \"\\\\n\"; break;\n";
+  source_ << "      case '\\r': out += \"\\\\r\"; break;\n";
+  source_ << "      case '\\t': out += \"\\\\t\"; break;\n";
+  source_ << "      default:\n";
+  source_ << "        out += \"\\\\u00\";\n";
+  source_ << "        out += HEX[c >> 4];\n";
+  source_ << "        out += HEX[c & 0xF];\n";
+  source_ << "        break;\n";
+  source_ << "      }\n";
+  source_ << "      start = i + 1;\n";
+  source_ << "    }\n";
+  source_ << "    ++i;\n";
+  source_ << "  }\n";
+  source_ << "  out.append(value.data() + start, value.size() - start);\n";
+  source_ << "  out += '\"';\n";
+  source_ << "}\n\n";
+  source_ << "// Shortest representation that reads back to the same value;"
+             " JSON has no\n";
+  source_ << "// literal for non-finite numbers, so those are written as"
+             " strings.\n";
+  source_ << "template <typename T>\n";
+  source_ << "inline void json_write_number(JsonOut& out, T value) {\n";
+  source_ << "  if constexpr (std::is_floating_point_v<T>) {\n";
+  source_ << "    if (value != value) {\n";
+  source_ << "      out += \"\\\"NaN\\\"\";\n";
+  source_ << "      return;\n";
+  source_ << "    }\n";
+  source_ << "    if (value == std::numeric_limits<T>::infinity()) {\n";
+  source_ << "      out += \"\\\"Infinity\\\"\";\n";
+  source_ << "      return;\n";
+  source_ << "    }\n";
+  source_ << "    if (value == -std::numeric_limits<T>::infinity()) {\n";
+  source_ << "      out += \"\\\"-Infinity\\\"\";\n";
+  source_ << "      return;\n";
+  source_ << "    }\n";
+  source_ << "    // Integral values skip the shortest-form search.\n";
+  source_ << "    if (value != 0 && value > -9007199254740992.0 &&\n";
+  source_ << "        value < 9007199254740992.0 &&\n";
+  source_ << "        static_cast<T>(static_cast<int64_t>(value)) == value) {"
+             "\n";
+  source_ << "      json_write_number(out, static_cast<int64_t>(value));\n";
+  source_ << "      return;\n";
+  source_ << "    }\n";
+  source_ << "  }\n";
+  source_ << "  char* buffer = out.reserve(32);\n";
+  source_ << "  auto result = std::to_chars(buffer, buffer + 32, value);\n";
+  source_ << "  out.advance(static_cast<size_t>(result.ptr - buffer));\n";
+  source_ << "}\n\n";
+  source_ << "// Single-pass reader over a JSON document. Every parse method"
+             " skips leading\n";
+  source_ << "// whitespace and returns false on malformed input.\n";
+  source_ << "struct JsonParser {\n";
+  source_ << "  static constexpr int MAX_DEPTH = 64;\n\n";
+  source_ << "  explicit JsonParser(std::string_view text) : json(text) {}\n\n";
+  source_ << "  std::string_view json;\n";
+  source_ << "  size_t pos = 0;\n";
+  source_ << "  int depth = 0;\n";
+  source_ << "  std::string buffer;\n\n";
+  source_ << "  void skip_space() {\n";
+  source_ << "    while (pos < json.size() && (json[pos] == ' ' || json[pos]"
+             " == '\\n' ||\n";
+  source_ << "                                 json[pos] == '\\r' || json[pos]"
+             " == '\\t')) {\n";
+  source_ << "      ++pos;\n";
+  source_ << "    }\n";
+  source_ << "  }\n\n";
+  source_ << "  bool peek(char c) {\n";
+  source_ << "    skip_space();\n";
+  source_ << "    return pos < json.size() && json[pos] == c;\n";
+  source_ << "  }\n\n";
+  source_ << "  bool consume(char c) {\n";
+  source_ << "    if (!peek(c)) return false;\n";
+  source_ << "    ++pos;\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n\n";
+  source_ << "  bool consume(std::string_view literal) {\n";
+  source_ << "    skip_space();\n";
+  source_ << "    if (json.substr(pos, literal.size()) != literal) return"
+             " false;\n";
+  source_ << "    pos += literal.size();\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n\n";
+  source_ << "  bool parse_bool(bool& value) {\n";
+  source_ << "    if (consume(\"true\")) {\n";
+  source_ << "      value = true;\n";
+  source_ << "      return true;\n";
+  source_ << "    }\n";
+  source_ << "    if (consume(\"false\")) {\n";
+  source_ << "      value = false;\n";
+  source_ << "      return true;\n";
+  source_ << "    }\n";
+  source_ << "    return false;\n";
+  source_ << "  }\n\n";
+  source_ << "  template <typename T> bool parse_number(T& value) {\n";
+  source_ << "    if constexpr (std::is_floating_point_v<T>) {\n";
+  source_ << "      if (peek('\"')) {\n";
+  source_ << "        if (consume(\"\\\"NaN\\\"\")) {\n";
+  source_ << "          value = std::numeric_limits<T>::quiet_NaN();\n";
+  source_ << "        } else if (consume(\"\\\"Infinity\\\"\")) {\n";
+  source_ << "          value = std::numeric_limits<T>::infinity();\n";
+  source_ << "        } else if (consume(\"\\\"-Infinity\\\"\")) {\n";
+  source_ << "          value = -std::numeric_limits<T>::infinity();\n";
+  source_ << "        } else {\n";
+  source_ << "          return false;\n";
+  source_ << "        }\n";
+  source_ << "        return true;\n";
+  source_ << "      }\n";
+  source_ << "    }\n";
+  source_ << "    skip_space();\n";
+  source_ << "    auto result = std::from_chars(json.data() + pos,\n";
+  source_ << "                                  json.data() + json.size(),"
+             " value);\n";
+  source_ << "    if (result.ec != std::errc()) return false;\n";
+  source_ << "    pos = static_cast<size_t>(result.ptr - json.data());\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n\n";
+  source_ << "  bool parse_hex(uint32_t& code) {\n";
+  source_ << "    if (json.size() - pos < 4) return false;\n";
+  source_ << "    code = 0;\n";
+  source_ << "    for (size_t end = pos + 4; pos < end; ++pos) {\n";
+  source_ << "      char c = json[pos];\n";
+  source_ << "      uint32_t digit;\n";
+  source_ << "      if (c >= '0' && c <= '9') {\n";
+  source_ << "        digit = static_cast<uint32_t>(c - '0');\n";
+  source_ << "      } else if (c >= 'a' && c <= 'f') {\n";
+  source_ << "        digit = static_cast<uint32_t>(c - 'a' + 10);\n";
+  source_ << "      } else if (c >= 'A' && c <= 'F') {\n";
+  source_ << "        digit = static_cast<uint32_t>(c - 'A' + 10);\n";
+  source_ << "      } else {\n";
+  source_ << "        return false;\n";
+  source_ << "      }\n";
+  source_ << "      code = (code << 4) | digit;\n";
+  source_ << "    }\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n\n";
+  source_ << "  // Decodes the digits of a \\u escape, joining surrogate"
+             " pairs, to UTF-8.\n";
+  source_ << "  bool parse_unicode_escape(std::string& out) {\n";
+  source_ << "    uint32_t code = 0;\n";
+  source_ << "    if (!parse_hex(code)) return false;\n";
+  source_ << "    if (code >= 0xD800 && code < 0xDC00) {\n";
+  source_ << "      uint32_t low = 0;\n";
+  source_ << "      if (json.substr(pos, 2) != \"\\\\u\") return false;\n";
+  source_ << "      pos += 2;\n";
+  source_ << "      if (!parse_hex(low) || low < 0xDC00 || low >= 0xE000)"
+             " return false;\n";
+  source_ << "      code = 0x10000 + ((code - 0xD800) << 10) + (low -"
+             " 0xDC00);\n";
+  source_ << "    } else if (code >= 0xDC00 && code < 0xE000) {\n";
+  source_ << "      return false;\n";
+  source_ << "    }\n";
+  source_ << "    if (code < 0x80) {\n";
+  source_ << "      out += static_cast<char>(code);\n";
+  source_ << "    } else if (code < 0x800) {\n";
+  source_ << "      out += static_cast<char>(0xC0 | (code >> 6));\n";
+  source_ << "      out += static_cast<char>(0x80 | (code & 0x3F));\n";
+  source_ << "    } else if (code < 0x10000) {\n";
+  source_ << "      out += static_cast<char>(0xE0 | (code >> 12));\n";
+  source_ << "      out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));\n";
+  source_ << "      out += static_cast<char>(0x80 | (code & 0x3F));\n";
+  source_ << "    } else {\n";
+  source_ << "      out += static_cast<char>(0xF0 | (code >> 18));\n";
+  source_ << "      out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));\n";
+  source_ << "      out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));\n";
+  source_ << "      out += static_cast<char>(0x80 | (code & 0x3F));\n";
+  source_ << "    }\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n\n";
+  source_ << "  bool parse_string(std::string& out) {\n";
+  source_ << "    out.clear();\n";
+  source_ << "    if (!consume('\"')) return false;\n";
+  source_ << "    size_t start = pos;\n";
+  source_ << "    while (pos < json.size()) {\n";
+  source_ << "      char c = json[pos];\n";
+  source_ << "      if (c == '\"') {\n";
+  source_ << "        out.append(json.data() + start, pos - start);\n";
+  source_ << "        ++pos;\n";
+  source_ << "        return true;\n";
+  source_ << "      }\n";
+  source_ << "      if (static_cast<uint8_t>(c) < 0x20) return false;\n";
+  source_ << "      if (c != '\\\\') {\n";
+  source_ << "        ++pos;\n";
+  source_ << "        continue;\n";
+  source_ << "      }\n";
+  source_ << "      out.append(json.data() + start, pos - start);\n";
+  source_ << "      if (++pos == json.size()) return false;\n";
+  source_ << "      switch (json[pos++]) {\n";
+  source_ << "      case '\"': out += '\"'; break;\n";
+  source_ << "      case '\\\\': out += '\\\\'; break;\n";
+  source_ << "      case '/': out += '/'; break;\n";
+  source_ << "      case 'b': out += '\\b'; break;\n";
+  source_ << "      case 'f': out += '\\f'; break;\n";
+  source_ << "      case 'n': out += '\\n'; break;\n";
+  source_ << "      case 'r': out += '\\r'; break;\n";
+  source_ << "      case 't': out += '\\t'; break;\n";
+  source_ << "      case 'u':\n";
+  source_ << "        if (!parse_unicode_escape(out)) return false;\n";
+  source_ << "        break;\n";
+  source_ << "      default:\n";
+  source_ << "        return false;\n";
+  source_ << "      }\n";
+  source_ << "      start = pos;\n";
+  source_ << "    }\n";
+  source_ << "    return false;\n";
+  source_ << "  }\n\n";
+  source_ << "  // Reads a string and its hash. Strings without escapes are"
+             " returned as a\n";
+  source_ << "  // view of the document; others are decoded into `buffer`.\n";
+  source_ << "  bool parse_name(std::string_view& name, uint64_t& hash) {\n";
+  source_ << "    if (!consume('\"')) return false;\n";
+  source_ << "    size_t start = pos;\n";
+  source_ << "    hash = 14695981039346656037ull;\n";
+  source_ << "    while (pos < json.size() && json[pos] != '\"' && json[pos]"
+             " != '\\\\' &&\n";
+  source_ << "           static_cast<uint8_t>(json[pos]) >= 0x20) {\n";
+  source_ << "      hash = (hash ^ static_cast<uint8_t>(json[pos++])) *"
+             " 1099511628211ull;\n";
+  source_ << "    }\n";
+  source_ << "    if (pos < json.size() && json[pos] == '\"') {\n";
+  source_ << "      name = json.substr(start, pos++ - start);\n";
+  source_ << "      return true;\n";
+  source_ << "    }\n";
+  source_ << "    pos = start - 1;\n";
+  source_ << "    if (!parse_string(buffer)) return false;\n";
+  source_ << "    name = buffer;\n";
+  source_ << "    hash = json_hash(name);\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n\n";
+  source_ << "  // Calls member(key, hash) for each member of an object.\n";
+  source_ << "  template <typename F> bool parse_object(F&& member) {\n";
+  source_ << "    if (!consume('{') || ++depth > MAX_DEPTH) return false;\n";
+  source_ << "    if (!consume('}')) {\n";
+  source_ << "      do {\n";
+  source_ << "        std::string_view key;\n";
+  source_ << "        uint64_t hash = 0;\n";
+  source_ << "        if (!parse_name(key, hash) || !consume(':') ||"
+             " !member(key, hash)) {\n";
+  source_ << "          return false;\n";
+  source_ << "        }\n";
+  source_ << "      } while (consume(','));\n";
+  source_ << "      if (!consume('}')) return false;\n";
+  source_ << "    }\n";
+  source_ << "    --depth;\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n\n";
+  source_ << "  // Replaces `values` with the array elements, each read by"
+             " parse(element).\n";
+  source_ << "  template <typename T, typename F>\n";
+  source_ << "  bool parse_array(std::vector<T>& values, F&& parse) {\n";
+  source_ << "    values.clear();\n";
+  source_ << "    if (!consume('[') || ++depth > MAX_DEPTH) return false;\n";
+  source_ << "    if (!consume(']')) {\n";
+  source_ << "      do {\n";
+  source_ << "        T value{};\n";
+  source_ << "        if (!parse(value)) return false;\n";
+  source_ << "        values.push_back(std::move(value));\n";
+  source_ << "      } while (consume(','));\n";
+  source_ << "      if (!consume(']')) return false;\n";
+  source_ << "    }\n";
+  source_ << "    --depth;\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n\n";
+  source_ << "  // null resets the field; anything else is read by"
+             " parse(value).\n";
+  source_ << "  template <typename T, typename F>\n";
+  source_ << "  bool parse_optional(std::optional<T>& value, F&& parse) {\n";
+  source_ << "    if (consume(\"null\")) {\n";
+  source_ << "      value.reset();\n";
+  source_ << "      return true;\n";
+  source_ << "    }\n";
+  source_ << "    return parse(value.emplace());\n";
+  source_ << "  }\n\n";
+  source_ << "  bool skip_value() {\n";
+  source_ << "    skip_space();\n";
+  source_ << "    if (pos == json.size()) return false;\n";
+  source_ << "    switch (json[pos]) {\n";
+  source_ << "    case '{':\n";
+  source_ << "      return parse_object(\n";
+  source_ << "          [this](std::string_view, uint64_t) { return"
+             " skip_value(); });\n";
+  source_ << "    case '[': {\n";
+  source_ << "      if (!consume('[') || ++depth > MAX_DEPTH) return false;\n";
+  source_ << "      if (!consume(']')) {\n";
+  source_ << "        do {\n";
+  source_ << "          if (!skip_value()) return false;\n";
+  source_ << "        } while (consume(','));\n";
+  source_ << "        if (!consume(']')) return false;\n";
+  source_ << "      }\n";
+  source_ << "      --depth;\n";
+  source_ << "      return true;\n";
+  source_ << "    }\n";
+  source_ << "    case '\"': {\n";
+  source_ << "      std::string_view name;\n";
+  source_ << "      uint64_t hash = 0;\n";
+  source_ << "      return parse_name(name, hash);\n";
+  source_ << "    }\n";
+  source_ << "    case 't':\n";
+  source_ << "      return consume(\"true\");\n";
+  source_ << "    case 'f':\n";
+  source_ << "      return consume(\"false\");\n";
+  source_ << "    case 'n':\n";
+  source_ << "      return consume(\"null\");\n";
+  source_ << "    default: {\n";
+  source_ << "      double number = 0;\n";
+  source_ << "      return parse_number(number);\n";
+  source_ << "    }\n";
+  source_ << "    }\n";
+  source_ << "  }\n";
+  source_ << "};\n\n";
+
+  source_ << "// Writes `key` (the quoted name and colon), after a comma "
+             "unless it\n";
+  source_ << "// starts the object.\n";
+  source_ << "inline void json_key(JsonOut& out, bool& more, std::string_view "
+             "key) {\n";
+  source_ << "  if (more) out += ',';\n";
+  source_ << "  more = true;\n";
+  source_ << "  out += key;\n";
+  source_ << "}\n\n";
+
+  source_ << "// Skips a field the schema does not know, like deserialize() "
+             "does.\n";
+  source_ << "inline void skip_wire_value(std::span<const uint8_t> data, "
+             "size_t& pos,\n";
+  source_ << "                            uint8_t wire_type) {\n";
+  source_ << "  if (wire_type == 0) {\n";
+  source_ << "    while (pos < data.size() && (data[pos] & 0x80)) pos++;\n";
+  source_ << "    if (pos < data.size()) pos++;\n";
+  source_ << "  } else if (wire_type == 2) {\n";
+  source_ << "    uint64_t length = 0;\n";
+  source_ << "    parse_varint(data, pos, length);\n";
+  source_ << "    pos = length > data.size() - pos ? data.size() : pos + "
+             "length;\n";
+  source_ << "  } else if (wire_type == 1) {\n";
+  source_ << "    pos += 8;\n";
+  source_ << "  } else if (wire_type == 5) {\n";
+  source_ << "    pos += 4;\n";
+  source_ << "  }\n";
+  source_ << "}\n\n";
+
+  source_ << "// Decodes the message and writes it with append_json(), for "
+             "wire data\n";
+  source_ << "// that cannot be transcoded in a single pass.\n";
+  source_ << "template <typename T>\n";
+  source_ << "inline bool json_transcode_decoded(std::span<const uint8_t> data,"
+             "\n";
+  source_ << "                                   JsonOut& out) {\n";
+  source_ << "  T message;\n";
+  source_ << "  if (!message.deserialize(data)) return false;\n";
+  source_ << "  message.append_json(out);\n";
+  source_ << "  return true;\n";
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_namespace_open(std::ostringstream &out) {
+  out << "namespace " << schema_.namespace_name << " {\n\n";
+}
+
+void CodeGenerator::generate_namespace_close(std::ostringstream &out) {
+  out << "} // namespace " << schema_.namespace_name << "\n";
+}
+
+void CodeGenerator::generate_enum_declaration(const EnumDecl &enum_decl) {
+  header_ << "enum class " << enum_decl.name << " : int32_t {\n";
+
+  for (size_t i = 0; i < enum_decl.values.size(); ++i) {
+    const auto &value = enum_decl.values[i];
+    header_ << "  " << value->name << " = " << value->value;
+    if (i < enum_decl.values.size() - 1) {
+      header_ << ",";
+    }
+    header_ << "\n";
+  }
+
+  header_ << "};\n\n";
+}
+
+void CodeGenerator::generate_model_declaration(const ModelDecl &model) {
+  header_ << "class " << model.name << " {\n";
+  header_ << "public:\n";
+  header_ << "  " << model.name << "() = default;\n\n";
+
+  for (const auto &field : model.fields) {
+    header_ << "  " << get_field_type(*field) << " " << field->name;
+
+    if (field->is_repeated()) {
+      header_ << ";\n";
+    } else if (field->is_optional()) {
+      header_ << ";\n";
+    } else {
+      if (auto *prim = dynamic_cast<const PrimitiveType *>(field->type.get())) {
+        switch (prim->kind) {
+        case PrimitiveTypeKind::BOOL:
+          header_ << " = false;\n";
+          break;
+        case PrimitiveTypeKind::STRING:
+          header_ << ";\n";
+          break;
+        default:
+          header_ << " = 0;\n";
+          break;
+        }
+      } else {
+        header_ << ";\n";
+      }
+    }
+  }
+
+  header_ << "\n";
+  if (model.checksummed) {
+    header_ << "  // Encoded with a trailing CRC32C of the message bytes; "
+               "deserialize()\n";
+    header_ << "  // rejects input whose checksum does not match.\n";
+  }
+  header_ << "  std::vector<uint8_t> serialize() const;\n";
+  header_ << "  void serialize_to(std::vector<uint8_t>& buffer) const;\n";
+  std::string constexpr_codec =
+      options_.header_only && is_constexpr_model(model) ? "constexpr " : "";
+  header_ << "  " << constexpr_codec
+          << "uint8_t* serialize_to(uint8_t* out) const;\n";
+  header_ << "  " << constexpr_codec << "size_t byte_size() const;\n";
+  header_ << "  // Replaces the contents with the decoded message. Strings, "
+             "vectors and\n";
+  header_ << "  // the elements of repeated strings and models are reused, so "
+             "decoding\n";
+  header_ << "  // into the same object again does not allocate once it has "
+             "grown.\n";
+  header_ << "  bool deserialize(const std::vector<uint8_t>& data);\n";
+  header_ << "  " << constexpr_codec
+          << "bool deserialize(std::span<const uint8_t> data);\n";
+  header_ << "  // Decodes on top of the current contents: fields on the wire "
+             "overwrite\n";
+  header_ << "  // scalars and are appended to repeated fields.\n";
+  header_ << "  " << constexpr_codec
+          << "bool merge(std::span<const uint8_t> data);\n";
+  header_ << "  // Resets every field to its default, keeping the capacity of "
+             "strings\n";
+  header_ << "  // and vectors.\n";
+  header_ << "  " << constexpr_codec << "void clear();\n\n";
+  generate_hash_declaration();
+  generate_comparison_declarations(model.name, model.fields,
+                                   constexpr_codec);
+  header_ << "  void serialize_iov(std::vector<uint8_t>& scratch,\n";
+  header_ << "      std::vector<std::pair<size_t, std::span<const uint8_t>>>& "
+             "references,\n";
+  header_ << "      size_t threshold) const;\n\n";
+  header_ << "  template <typename IovWriter>\n";
+  header_ << "  void serialize_iov(IovWriter& sk_writer) const {\n";
+  header_ << "    serialize_iov(sk_writer.scratch(), sk_writer.references(), "
+             "sk_writer.threshold());\n";
+  header_ << "  }\n\n";
+  if (options_.json) {
+    generate_json_declarations();
+    generate_transcode_declarations();
+  }
+  if (options_.diff) {
+    generate_diff_declarations(model.name);
+  }
+  generate_delimited_methods();
+  header_ << "private:\n";
+  header_ << "  " << constexpr_codec
+          << "bool parse(std::span<const uint8_t> data, bool replace);\n";
+  header_ << "};\n\n";
+}
+
+void CodeGenerator::generate_struct_declaration(
+    const StructDecl &struct_decl) {
+  header_ << "struct " << struct_decl.name << " {\n";
+
+  for (const auto &field : struct_decl.fields) {
+    header_ << "  " << get_cpp_type(*field->type) << " " << field->name;
+    auto *prim = dynamic_cast<const PrimitiveType *>(field->type.get());
+    if (!prim) {
+      header_ << ";\n";
+    } else if (prim->kind == PrimitiveTypeKind::BOOL) {
+      header_ << " = false;\n";
+    } else {
+      header_ << " = 0;\n";
+    }
+  }
+
+  header_ << "\n";
+  header_ << "  // Fields back to back in little-endian order, without tags.\n";
+  header_ << "  static constexpr size_t WIRE_SIZE = "
+          << get_struct_size(struct_decl) << ";\n\n";
+  header_ << "  std::vector<uint8_t> serialize() const;\n";
+  header_ << "  void serialize_to(std::vector<uint8_t>& buffer) const;\n";
+  header_ << "  uint8_t* serialize_to(uint8_t* out) const;\n";
+  header_ << "  static constexpr size_t byte_size() { return WIRE_SIZE; }\n";
+  header_ << "  bool deserialize(const std::vector<uint8_t>& data);\n";
+  header_ << "  bool deserialize(std::span<const uint8_t> data);\n";
+  header_ << "  // Reads WIRE_SIZE bytes without bounds checks.\n";
+  header_ << "  const uint8_t* deserialize_from(const uint8_t* in);\n\n";
+  generate_hash_declaration();
+  generate_comparison_declarations(struct_decl.name, struct_decl.fields,
+                                   "");
+  header_ << "  void serialize_iov(std::vector<uint8_t>& scratch,\n";
+  header_ << "      std::vector<std::pair<size_t, std::span<const uint8_t>>>& "
+             "references,\n";
+  header_ << "      size_t threshold) const;\n\n";
+  header_ << "  template <typename IovWriter>\n";
+  header_ << "  void serialize_iov(IovWriter& sk_writer) const {\n";
+  header_ << "    serialize_iov(sk_writer.scratch(), sk_writer.references(), "
+             "sk_writer.threshold());\n";
+  header_ << "  }\n\n";
+  if (options_.json) {
+    generate_json_declarations();
+  }
+  generate_delimited_methods();
+  header_ << "};\n\n";
+}
+
+void CodeGenerator::generate_enum_traits(const EnumDecl &enum_decl) {
+  std::string type = schema_.namespace_name + "::" + enum_decl.name;
+
+  header_ << "template <> struct enum_traits<" << type << "> {\n";
+  header_ << "  static constexpr std::string_view name = \"" << enum_decl.name
+          << "\";\n";
+  header_ << "  static constexpr enum_value<" << type << "> values[] = {\n";
+  for (size_t i = 0; i < enum_decl.values.size(); ++i) {
+    const EnumValue &value = *enum_decl.values[i];
+    header_ << "      {" << type << "::" << value.name << ", \"" << value.name
+            << "\"}" << (i + 1 < enum_decl.values.size() ? ",\n" : "};\n");
+  }
+  header_ << "};\n\n";
+}
+
+void CodeGenerator::generate_model_traits(
+    const std::string &name,
+    const std::vector<std::unique_ptr<Field>> &fields) {
+  // Struct members are numbered by position; their wire type is that of
+  // the same field in a model.
+  std::string type = schema_.namespace_name + "::" + name;
+
+  header_ << "template <> struct model_traits<" << type << "> {\n";
+  header_ << "  static constexpr std::string_view name = \"" << name
+          << "\";\n";
+  header_ << "  static constexpr auto fields = std::make_tuple(\n";
+  for (size_t i = 0; i < fields.size(); ++i) {
+    const Field &field = *fields[i];
+    std::string modifiers;
+    for (auto [flag, flag_name] :
+         {std::pair{MOD_OPTIONAL, "FIELD_OPTIONAL"},
+          std::pair{MOD_REPEATED, "FIELD_REPEATED"},
+          std::pair{MOD_PACKED, "FIELD_PACKED"},
+          std::pair{MOD_INTERNED, "FIELD_INTERNED"},
+          std::pair{MOD_BITMAP, "FIELD_BITMAP"},
+          std::pair{MOD_COLUMNAR, "FIELD_COLUMNAR"},
+          std::pair{MOD_UTF8, "FIELD_UTF8"}}) {
+      if (field.has_modifier(flag)) {
+        modifiers += (modifiers.empty() ? "" : " | ") + std::string(flag_name);
+      }
+    }
+    header_ << "      field_descriptor<&" << type << "::" << field.name
+            << ">{" << field.number << ", \"" << field.name << "\", "
+            << static_cast<int>(get_tag_wire_type(field)) << ", "
+            << (modifiers.empty() ? "0" : modifiers) << "}"
+            << (i + 1 < fields.size() ? ",\n" : ");\n");
+  }
+  header_ << "};\n\n";
+}
+
+void CodeGenerator::generate_model_implementation(const ModelDecl &model) {
+  generate_byte_size_method(model);
+  generate_serialize_method(model);
+  generate_serialize_iov_method(model);
+  generate_deserialize_method(model);
+  generate_hash_method(model.name, model.fields, true);
+  if (!is_comparison_defaulted(model.fields)) {
+    generate_equality_method(model.name, model.fields,
+                             codec_specifier(model));
+  }
+  if (options_.diff) {
+    generate_diff_method(model);
+    generate_apply_patch_method(model);
+  }
+}
+
+void CodeGenerator::generate_struct_implementation(
+    const StructDecl &struct_decl) {
+  const std::string &name = struct_decl.name;
+  std::string specifier = inline_specifier();
+
+  source_ << specifier << "std::vector<uint8_t> " << name
+          << "::serialize() const {\n";
+  source_ << "  std::vector<uint8_t> sk_buffer(WIRE_SIZE);\n";
+  source_ << "  serialize_to(sk_buffer.data());\n";
+  source_ << "  return sk_buffer;\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "void " << name
+          << "::serialize_to(std::vector<uint8_t>& sk_buffer) const {\n";
+  source_ << "  serialize_to(detail::append_space(sk_buffer, WIRE_SIZE));\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "uint8_t* " << name
+          << "::serialize_to(uint8_t* sk_out) const {\n";
+  for (const auto &field : struct_decl.fields) {
+    if (is_struct_type(*field->type)) {
+      source_ << "  sk_out = " << field->name << ".serialize_to(sk_out);\n";
+    } else {
+      source_ << "  sk_out = detail::store_le(sk_out, " << field->name
+              << ");\n";
+    }
+  }
+  source_ << "  return sk_out;\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "bool " << name
+          << "::deserialize(const std::vector<uint8_t>& sk_data) {\n";
+  source_ << "  return deserialize(std::span<const uint8_t>(sk_data));\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "bool " << name
+          << "::deserialize(std::span<const uint8_t> sk_data) {\n";
+  source_ << "  if (sk_data.size() != WIRE_SIZE) return false;\n";
+  source_ << "  deserialize_from(sk_data.data());\n";
+  source_ << "  return true;\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "const uint8_t* " << name
+          << "::deserialize_from(const uint8_t* sk_in) {\n";
+  for (const auto &field : struct_decl.fields) {
+    if (is_struct_type(*field->type)) {
+      source_ << "  sk_in = " << field->name << ".deserialize_from(sk_in);\n";
+    } else {
+      source_ << "  sk_in = detail::load_le(sk_in, " << field->name << ");\n";
+    }
+  }
+  source_ << "  return sk_in;\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "void " << name
+          << "::serialize_iov(std::vector<uint8_t>& sk_scratch,\n";
+  source_ << "    std::vector<std::pair<size_t, std::span<const uint8_t>>>& "
+             "sk_references,\n";
+  source_ << "    size_t sk_threshold) const {\n";
+  source_ << "  (void)sk_references;\n";
+  source_ << "  (void)sk_threshold;\n";
+  source_ << "  serialize_to(detail::append_space(sk_scratch, WIRE_SIZE));\n";
+  source_ << "}\n\n";
+
+  generate_hash_method(name, struct_decl.fields, false);
+  if (!is_comparison_defaulted(struct_decl.fields)) {
+    generate_equality_method(name, struct_decl.fields, specifier);
+  }
+}
+
+void CodeGenerator::generate_comparison_declarations(
+    const std::string &name, const std::vector<std::unique_ptr<Field>> &fields,
+    const std::string &specifier) {
+  if (is_comparison_defaulted(fields)) {
+    header_ << "  bool operator==(const " << name
+            << "& rhs) const = default;\n";
+  } else {
+    header_ << "  // Compares fixed-size fields first, then strings, nested "
+               "models and\n";
+    header_ << "  // repeated fields. operator<=> goes in declaration "
+               "order.\n";
+    header_ << "  " << specifier << "bool operator==(const " << name
+            << "& rhs) const;\n";
+  }
+  header_ << "  " << get_ordering_type(fields) << " operator<=>(const "
+          << name << "& rhs) const = default;\n\n";
+}
+
+void CodeGenerator::generate_equality_method(
+    const std::string &name, const std::vector<std::unique_ptr<Field>> &fields,
+    const std::string &specifier) {
+  std::vector<const Field *> order = get_comparison_order(fields);
+
+  source_ << specifier << "bool " << name << "::operator==(const " << name
+          << "& sk_rhs) const {\n";
+  for (size_t i = 0; i < order.size(); ++i) {
+    source_ << (i == 0 ? "  return " : "         ") << order[i]->name
+            << " == sk_rhs." << order[i]->name
+            << (i + 1 < order.size() ? " &&\n" : ";\n");
+  }
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_std_hash(const std::string &name) {
+  std::string type = schema_.namespace_name + "::" + name;
+
+  header_ << "template <> struct hash<" << type << "> {\n";
+  header_ << "  size_t operator()(const " << type
+          << "& value) const noexcept {\n";
+  header_ << "    return static_cast<size_t>(value.hash());\n";
+  header_ << "  }\n";
+  header_ << "};\n\n";
+}
+
+void CodeGenerator::generate_diff_declarations(const std::string &name) {
+  header_ << "  // Appends a patch that turns `previous` into `current`: "
+             "bitmasks of the\n";
+  header_ << "  // changed and present fields, then the new values. Returns "
+             "false, with\n";
+  header_ << "  // every bit clear, when the two are equal.\n";
+  header_ << "  static bool diff(const " << name << "& previous, const "
+          << name << "& current,\n";
+  header_ << "                   std::vector<uint8_t>& patch);\n";
+  header_ << "  // Writes the patch to `writer`, building it in `scratch`, which "
+             "keeps\n";
+  header_ << "  // its capacity from one call to the next.\n";
+  header_ << "  template <typename Writer>\n";
+  header_ << "  static bool diff(const " << name << "& sk_previous, const "
+          << name << "& sk_current,\n";
+  header_ << "                   Writer& sk_writer, std::vector<uint8_t>& "
+             "sk_scratch) {\n";
+  header_ << "    sk_scratch.clear();\n";
+  header_ << "    bool sk_changed = diff(sk_previous, sk_current, "
+             "sk_scratch);\n";
+  header_ << "    sk_writer.write(sk_scratch.data(), sk_scratch.size());\n";
+  header_ << "    return sk_changed;\n";
+  header_ << "  }\n";
+  header_ << "  // As above, with one scratch buffer per thread.\n";
+  header_ << "  template <typename Writer>\n";
+  header_ << "  static bool diff(const " << name << "& sk_previous, const "
+          << name << "& sk_current,\n";
+  header_ << "                   Writer& sk_writer) {\n";
+  header_ << "    thread_local std::vector<uint8_t> sk_scratch;\n";
+  header_ << "    return diff(sk_previous, sk_current, sk_writer, "
+             "sk_scratch);\n";
+  header_ << "  }\n";
+  header_ << "  // Applies a patch made by diff() to a copy of its `previous`. "
+             "Returns\n";
+  header_ << "  // false on a malformed patch, which may leave fields "
+             "updated.\n";
+  header_ << "  bool apply_patch(std::span<const uint8_t> patch);\n";
+  header_ << "  bool apply_patch(std::span<const uint8_t> patch, size_t& "
+             "pos);\n\n";
+}
+
+namespace {
+
+std::string mask_bit(size_t index) {
+  static const char *const bits[] = {"0x01", "0x02", "0x04", "0x08",
+                                     "0x10", "0x20", "0x40", "0x80"};
+  return bits[index % 8];
+}
+
+size_t count_optional(const ModelDecl &model) {
+  return static_cast<size_t>(
+      std::count_if(model.fields.begin(), model.fields.end(),
+                    [](const auto &field) { return field->is_optional(); }));
+}
+
+} // namespace
+
+void CodeGenerator::generate_diff_method(const ModelDecl &model) {
+  const std::string &name = model.name;
+  size_t changed_bytes = (model.fields.size() + 7) / 8;
+  size_t mask_size = changed_bytes + (count_optional(model) + 7) / 8;
+
+  source_ << inline_specifier() << "bool " << name << "::diff(const " << name
+          << "& sk_previous, const " << name << "& sk_current,\n";
+  source_ << "    std::vector<uint8_t>& sk_patch) {\n";
+  source_ << "  size_t sk_mask = sk_patch.size();\n";
+  source_ << "  sk_patch.resize(sk_mask + " << mask_size << ");\n";
+
+  size_t optional_index = changed_bytes * 8;
+  for (size_t i = 0; i < model.fields.size(); ++i) {
+    const Field &field = *model.fields[i];
+    std::string mark = "sk_patch[sk_mask + " + std::to_string(i / 8) +
+                       "] |= " + mask_bit(i) + ";";
+    std::string present;
+    if (field.is_optional()) {
+      present = "sk_patch[sk_mask + " + std::to_string(optional_index / 8) +
+                "] |= " + mask_bit(optional_index) + ";";
+      ++optional_index;
+    }
+    source_ << "\n";
+    generate_diff_field(field, mark, present);
+  }
+
+  source_ << "\n";
+  source_ << "  for (size_t sk_i = sk_mask; sk_i < sk_mask + " << changed_bytes
+          << "; ++sk_i) {\n";
+  source_ << "    if (sk_patch[sk_i] != 0) return true;\n";
+  source_ << "  }\n";
+  source_ << "  return false;\n";
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_diff_field(const Field &field,
+                                        const std::string &mark,
+                                        const std::string &present) {
+  std::string before = "sk_previous." + field.name;
+  std::string after = "sk_current." + field.name;
+  const ModelDecl *model = schema_.find_model(field.type->get_name());
+
+  if (field.is_repeated()) {
+    generate_diff_elements(field, mark);
+    return;
+  }
+
+  if (field.is_optional()) {
+    source_ << "  if (" << after << ".has_value()) {\n";
+    if (model) {
+      source_ << "    size_t sk_at = sk_patch.size();\n";
+      source_ << "    if (" << model->name << "::diff(" << before << " ? *"
+              << before << " : detail::empty_value<" << model->name << ">(),\n";
+      source_ << "            *" << after << ", sk_patch) ||\n";
+      source_ << "        !" << before << ".has_value()) {\n";
+      source_ << "      " << mark << "\n";
+      source_ << "      " << present << "\n";
+      source_ << "    } else {\n";
+      source_ << "      sk_patch.resize(sk_at);\n";
+      source_ << "    }\n";
+    } else if (is_floating_type(*field.type)) {
+      source_ << "    if (!" << before << " || !detail::same_bits(*" << before
+              << ", *" << after << ")) {\n";
+      source_ << "      " << mark << "\n";
+      source_ << "      " << present << "\n";
+      source_ << "      detail::write_patch(sk_patch, " << before
+              << ".value_or(0), *" << after << ");\n";
+      source_ << "    }\n";
+    } else {
+      source_ << "    if (" << before << " != " << after << ") {\n";
+      source_ << "      " << mark << "\n";
+      source_ << "      " << present << "\n";
+      generate_diff_value(*field.type, "(*" + after + ")", "      ");
+      source_ << "    }\n";
+    }
+    source_ << "  } else if (" << before << ".has_value()) {\n";
+    source_ << "    " << mark << "\n";
+    source_ << "  }\n";
+    return;
+  }
+
+  if (model) {
+    source_ << "  {\n";
+    source_ << "    size_t sk_at = sk_patch.size();\n";
+    source_ << "    if (" << model->name << "::diff(" << before << ", "
+            << after << ", sk_patch)) {\n";
+    source_ << "      " << mark << "\n";
+    source_ << "    } else {\n";
+    source_ << "      sk_patch.resize(sk_at);\n";
+    source_ << "    }\n";
+    source_ << "  }\n";
+  } else if (is_floating_type(*field.type)) {
+    source_ << "  if (!detail::same_bits(" << before << ", " << after
+            << ")) {\n";
+    source_ << "    " << mark << "\n";
+    source_ << "    detail::write_patch(sk_patch, " << before << ", " << after
+            << ");\n";
+    source_ << "  }\n";
+  } else {
+    source_ << "  if (" << before << " != " << after << ") {\n";
+    source_ << "    " << mark << "\n";
+    generate_diff_value(*field.type, after, "    ");
+    source_ << "  }\n";
+  }
+}
+
+void CodeGenerator::generate_diff_elements(const Field &field,
+                                           const std::string &mark) {
+  const ModelDecl *model = schema_.find_model(field.type->get_name());
+  std::string edit = "sk_patch[sk_edits + sk_i / 8] |= static_cast<uint8_t>(1u "
+                     "<< (sk_i % 8));";
+
+  source_ << "  {\n";
+  source_ << "    const auto& sk_before = sk_previous." << field.name << ";\n";
+  source_ << "    const auto& sk_after = sk_current." << field.name << ";\n";
+  source_ << "    size_t sk_start = sk_patch.size();\n";
+  source_ << "    detail::write_patch(sk_patch, sk_after.size());\n";
+  source_ << "    size_t sk_common =\n";
+  source_ << "        sk_before.size() < sk_after.size() ? sk_before.size() : "
+             "sk_after.size();\n";
+  source_ << "    size_t sk_edits = sk_patch.size();\n";
+  source_ << "    sk_patch.resize(sk_edits + (sk_common + 7) / 8);\n";
+  source_ << "    bool sk_edited = sk_before.size() != sk_after.size();\n";
+  source_ << "    for (size_t sk_i = 0; sk_i < sk_common; ++sk_i) {\n";
+  if (model) {
+    source_ << "      size_t sk_at = sk_patch.size();\n";
+    source_ << "      if (" << model->name
+            << "::diff(sk_before[sk_i], sk_after[sk_i], sk_patch)) {\n";
+    source_ << "        " << edit << "\n";
+    source_ << "        sk_edited = true;\n";
+    source_ << "      } else {\n";
+    source_ << "        sk_patch.resize(sk_at);\n";
+    source_ << "      }\n";
+  } else if (is_floating_type(*field.type)) {
+    source_ << "      if (!detail::same_bits(sk_before[sk_i], sk_after[sk_i])) "
+               "{\n";
+    source_ << "        " << edit << "\n";
+    source_ << "        sk_edited = true;\n";
+    source_ << "        detail::write_patch(sk_patch, sk_before[sk_i], "
+               "sk_after[sk_i]);\n";
+    source_ << "      }\n";
+  } else {
+    source_ << "      if (sk_before[sk_i] != sk_after[sk_i]) {\n";
+    source_ << "        " << edit << "\n";
+    source_ << "        sk_edited = true;\n";
+    generate_diff_value(*field.type, "sk_after[sk_i]", "        ");
+    source_ << "      }\n";
+  }
+  source_ << "    }\n";
+  source_ << "    for (size_t sk_i = sk_common; sk_i < sk_after.size(); "
+             "++sk_i) {\n";
+  if (model) {
+    source_ << "      " << model->name << "::diff(detail::empty_value<"
+            << model->name << ">(), sk_after[sk_i], sk_patch);\n";
+  } else if (is_floating_type(*field.type)) {
+    source_ << "      detail::write_patch(sk_patch, "
+            << get_cpp_type(*field.type) << "{}, sk_after[sk_i]);\n";
+  } else {
+    generate_diff_value(*field.type, "sk_after[sk_i]", "      ");
+  }
+  source_ << "    }\n";
+  source_ << "    if (sk_edited) {\n";
+  source_ << "      " << mark << "\n";
+  source_ << "    } else {\n";
+  source_ << "      sk_patch.resize(sk_start);\n";
+  source_ << "    }\n";
+  source_ << "  }\n";
+}
+
+void CodeGenerator::generate_diff_value(const Type &type,
+                                        const std::string &value,
+                                        const std::string &indent) {
+  if (is_struct_type(type)) {
+    source_ << indent << value << ".serialize_to(sk_patch);\n";
+  } else {
+    source_ << indent << "detail::write_patch(sk_patch, " << value << ");\n";
+  }
+}
+
+void CodeGenerator::generate_apply_patch_method(const ModelDecl &model) {
+  const std::string &name = model.name;
+  size_t changed_bytes = (model.fields.size() + 7) / 8;
+  size_t mask_size = changed_bytes + (count_optional(model) + 7) / 8;
+
+  source_ << inline_specifier() << "bool " << name
+          << "::apply_patch(std::span<const uint8_t> sk_patch) {\n";
+  source_ << "  size_t sk_pos = 0;\n";
+  source_ << "  return apply_patch(sk_patch, sk_pos) && sk_pos == "
+             "sk_patch.size();\n";
+  source_ << "}\n\n";
+
+  source_ << inline_specifier() << "bool " << name
+          << "::apply_patch(std::span<const uint8_t> sk_patch, size_t& sk_pos) "
+             "{\n";
+  source_ << "  if (sk_pos > sk_patch.size() || sk_patch.size() - sk_pos < "
+          << mask_size << ") return false;\n";
+  source_ << "  const uint8_t* sk_field_mask = sk_patch.data() + sk_pos;\n";
+  source_ << "  sk_pos += " << mask_size << ";\n";
+
+  size_t optional_index = changed_bytes * 8;
+  for (size_t i = 0; i < model.fields.size(); ++i) {
+    const Field &field = *model.fields[i];
+    source_ << "\n";
+    source_ << "  if (sk_field_mask[" << i / 8 << "] & " << mask_bit(i)
+            << ") {\n";
+    if (field.is_repeated()) {
+      generate_patch_elements(field);
+    } else if (field.is_optional()) {
+      source_ << "    if (sk_field_mask[" << optional_index / 8 << "] & "
+              << mask_bit(optional_index) << ") {\n";
+      source_ << "      if (!" << field.name << ".has_value()) "
+              << field.name << ".emplace();\n";
+      generate_patch_value(*field.type, "(*" + field.name + ")", "      ");
+      source_ << "    } else {\n";
+      source_ << "      " << field.name << ".reset();\n";
+      source_ << "    }\n";
+      ++optional_index;
+    } else {
+      generate_patch_value(*field.type, field.name, "    ");
+    }
+    source_ << "  }\n";
+  }
+
+  source_ << "\n";
+  source_ << "  return true;\n";
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_patch_elements(const Field &field) {
+  const std::string &name = field.name;
+  auto *prim = dynamic_cast<const PrimitiveType *>(field.type.get());
+
+  source_ << "    uint64_t sk_count = 0;\n";
+  source_ << "    if (!detail::read_patch(sk_patch, sk_pos, sk_count)) return "
+             "false;\n";
+  source_ << "    size_t sk_common = static_cast<size_t>(sk_count);\n";
+  source_ << "    if (" << name << ".size() < sk_common) sk_common = " << name
+          << ".size();\n";
+  source_ << "    size_t sk_edits = sk_pos;\n";
+  source_ << "    sk_pos += (sk_common + 7) / 8;\n";
+  // Every appended element takes at least one byte.
+  source_ << "    if (sk_pos > sk_patch.size() || sk_count - sk_common > "
+             "sk_patch.size() - sk_pos) {\n";
+  source_ << "      return false;\n";
+  source_ << "    }\n";
+  source_ << "    " << name << ".resize(sk_count);\n";
+  source_ << "    for (size_t sk_i = 0; sk_i < sk_count; ++sk_i) {\n";
+  source_ << "      if (sk_i < sk_common && (sk_patch[sk_edits + sk_i / 8] & "
+             "(1u << (sk_i % 8))) == 0) {\n";
+  source_ << "        continue;\n";
+  source_ << "      }\n";
+  if (prim && prim->kind == PrimitiveTypeKind::BOOL) {
+    // std::vector<bool> hands out proxies, not references.
+    source_ << "      bool sk_element = " << name << "[sk_i];\n";
+    source_ << "      if (!detail::read_patch(sk_patch, sk_pos, sk_element)) "
+               "return false;\n";
+    source_ << "      " << name << "[sk_i] = sk_element;\n";
+  } else {
+    generate_patch_value(*field.type, name + "[sk_i]", "      ");
+  }
+  source_ << "    }\n";
+}
+
+void CodeGenerator::generate_patch_value(const Type &type,
+                                         const std::string &target,
+                                         const std::string &indent) {
+  if (schema_.find_model(type.get_name())) {
+    source_ << indent << "if (!" << target
+            << ".apply_patch(sk_patch, sk_pos)) return false;\n";
+  } else if (is_struct_type(type)) {
+    std::string size = type.get_name() + "::WIRE_SIZE";
+    source_ << indent << "if (sk_patch.size() - sk_pos < " << size
+            << ") return false;\n";
+    source_ << indent << target << ".deserialize_from(sk_patch.data() + "
+                                   "sk_pos);\n";
+    source_ << indent << "sk_pos += " << size << ";\n";
+  } else {
+    source_ << indent << "if (!detail::read_patch(sk_patch, sk_pos, " << target
+            << ")) return false;\n";
+  }
+}
+
+void CodeGenerator::generate_hash_method(
+    const std::string &name, const std::vector<std::unique_ptr<Field>> &fields,
+    bool numbered) {
+  std::vector<const Field *> order;
+  for (const auto &field : fields) {
+    order.push_back(field.get());
+  }
+  if (numbered) {
+    std::stable_sort(order.begin(), order.end(),
+                     [](const Field *a, const Field *b) {
+                       return a->number < b->number;
+                     });
+  }
+
+  source_ << inline_specifier() << "uint64_t " << name
+          << "::hash(uint64_t sk_seed) const {\n";
+  source_ << "  detail::FieldHasher sk_hasher(sk_seed);\n";
+  for (const Field *field : order) {
+    std::string indent = "  ";
+    std::string value = field->name;
+    if (field->is_repeated()) {
+      if (numbered) {
+        source_ << "  sk_hasher.add(" << field->number << ");\n";
+      }
+      source_ << "  sk_hasher.add(" << field->name << ".size());\n";
+      source_ << "  for (const auto& sk_element : " << field->name << ") {\n";
+      value = "sk_element";
+      indent += "  ";
+    } else if (field->is_optional()) {
+      source_ << "  if (" << field->name << ".has_value()) {\n";
+      value = "(*" + field->name + ")";
+      indent += "  ";
+      source_ << indent << "sk_hasher.add(" << field->number << ");\n";
+    } else if (numbered) {
+      source_ << "  sk_hasher.add(" << field->number << ");\n";
+    }
+    generate_hash_value(*field->type, value, indent);
+    if (indent.size() > 2) {
+      source_ << "  }\n";
+    }
+  }
+  source_ << "  return sk_hasher.finish();\n";
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_hash_value(const Type &type,
+                                        const std::string &value,
+                                        const std::string &indent) {
+  auto *prim = dynamic_cast<const PrimitiveType *>(&type);
+  if (!prim) {
+    if (is_enum_type(type)) {
+      source_ << indent << "sk_hasher.add(static_cast<uint64_t>(" << value
+              << "));\n";
+    } else {
+      source_ << indent << "sk_hasher.add(" << value << ".hash());\n";
+    }
+    return;
+  }
+  switch (prim->kind) {
+  case PrimitiveTypeKind::STRING:
+    source_ << indent << "sk_hasher.add_string(" << value << ");\n";
+    break;
+  case PrimitiveTypeKind::FLOAT:
+  case PrimitiveTypeKind::DOUBLE:
+    source_ << indent << "sk_hasher.add_bits(" << value << ");\n";
+    break;
+  default:
+    source_ << indent << "sk_hasher.add(static_cast<uint64_t>(" << value
+            << "));\n";
+    break;
+  }
+}
+
+void CodeGenerator::generate_serialize_method(const ModelDecl &model) {
+  source_ << inline_specifier() << "std::vector<uint8_t> " << model.name
+          << "::serialize() const {\n";
+  source_ << "  std::vector<uint8_t> sk_buffer(byte_size());\n";
+  source_ << "  serialize_to(sk_buffer.data());\n";
+  source_ << "  return sk_buffer;\n";
+  source_ << "}\n\n";
+
+  source_ << inline_specifier() << "void " << model.name
+          << "::serialize_to(std::vector<uint8_t>& sk_buffer) const {\n";
+  source_ << "  size_t sk_offset = sk_buffer.size();\n";
+  source_ << "  sk_buffer.resize(sk_offset + byte_size());\n";
+  source_ << "  serialize_to(sk_buffer.data() + sk_offset);\n";
+  source_ << "}\n\n";
+
+  source_ << codec_specifier(model) << "uint8_t* " << model.name
+          << "::serialize_to(uint8_t* sk_out) const {\n";
+  if (model.checksummed) {
+    source_ << "  uint8_t* sk_begin = sk_out;\n";
+  }
+
+  for (const auto &field : model.fields) {
+    generate_field_serializer(*field, "  ");
+  }
+
+  if (model.checksummed) {
+    // Taken right after encoding, while the bytes are still in cache.
+    source_ << "  return detail::store_crc32c(sk_out, detail::crc32c(sk_begin, "
+               "static_cast<size_t>(sk_out - sk_begin)));\n";
+    source_ << "}\n\n";
+    return;
+  }
+  source_ << "  return sk_out;\n";
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_serialize_iov_method(const ModelDecl &model) {
+  source_ << inline_specifier() << "void " << model.name
+          << "::serialize_iov(std::vector<uint8_t>& sk_scratch,\n";
+  source_ << "    std::vector<std::pair<size_t, std::span<const uint8_t>>>& "
+             "sk_references,\n";
+  source_ << "    size_t sk_threshold) const {\n";
+
+  if (model.checksummed) {
+    // The trailer covers every byte, so nothing is left by reference.
+    source_ << "  (void)sk_references;\n";
+    source_ << "  (void)sk_threshold;\n";
+    source_ << "  serialize_to(detail::append_space(sk_scratch, "
+               "byte_size()));\n";
+    source_ << "}\n\n";
+    return;
+  }
+
+  bool uses_references = false;
+  const auto &fields = model.fields;
+  for (size_t i = 0; i < fields.size();) {
+    if (is_iov_reference_field(*fields[i])) {
+      generate_field_iov(*fields[i], "  ");
+      uses_references = true;
+      ++i;
+      continue;
+    }
+
+    size_t end = i;
+    while (end < fields.size() && !is_iov_reference_field(*fields[end])) {
+      ++end;
+    }
+    source_ << "  {\n";
+    source_ << "    size_t sk_size = 0;\n";
+    for (size_t j = i; j < end; ++j) {
+      generate_field_size(*fields[j], "    ");
+    }
+    source_ << "    uint8_t* sk_out = detail::append_space(sk_scratch, "
+               "sk_size);\n";
+    for (size_t j = i; j < end; ++j) {
+      generate_field_serializer(*fields[j], "    ");
+    }
+    source_ << "  }\n\n";
+    i = end;
+  }
+
+  if (!uses_references) {
+    source_ << "  (void)sk_references;\n";
+    source_ << "  (void)sk_threshold;\n";
+  }
+
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_byte_size_method(const ModelDecl &model) {
+  source_ << codec_specifier(model) << "size_t " << model.name
+          << "::byte_size() const {\n";
+  source_ << "  size_t sk_size = 0;\n\n";
+
+  for (const auto &field : model.fields) {
+    generate_field_size(*field, "  ");
+  }
+
+  if (model.checksummed) {
+    source_ << "  sk_size += 4; // CRC32C\n";
+  }
+  source_ << "  return sk_size;\n";
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_deserialize_method(const ModelDecl &model) {
+  source_ << inline_specifier() << "bool " << model.name
+          << "::deserialize(const std::vector<uint8_t>& sk_data) {\n";
+  source_ << "  return deserialize(std::span<const uint8_t>(sk_data));\n";
+  source_ << "}\n\n";
+
+  std::string specifier = codec_specifier(model);
+  source_ << specifier << "bool " << model.name
+          << "::deserialize(std::span<const uint8_t> sk_data) {\n";
+  source_ << "  return parse(sk_data, true);\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "bool " << model.name
+          << "::merge(std::span<const uint8_t> sk_data) {\n";
+  source_ << "  return parse(sk_data, false);\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "void " << model.name << "::clear() {\n";
+  for (const auto &field : model.fields) {
+    generate_clear_field(*field, "  ");
+  }
+  source_ << "}\n\n";
+
+  source_ << specifier << "bool " << model.name
+          << "::parse(std::span<const uint8_t> sk_data, bool sk_replace) {\n";
+  if (model.checksummed) {
+    // Verifying first also pulls the message into cache for the decode.
+    source_ << "  if (!detail::verify_crc32c(sk_data)) return false;\n";
+  }
+  // Repeated strings and models decode into the elements already there,
+  // and nested models into themselves; everything else starts cleared.
+  bool clears = std::any_of(
+      model.fields.begin(), model.fields.end(),
+      [this](const auto &field) { return !is_reused_on_decode(*field); });
+  if (clears) {
+    source_ << "  if (sk_replace) {\n";
+    for (const auto &field : model.fields) {
+      if (!is_reused_on_decode(*field)) {
+        generate_clear_field(*field, "    ");
+      }
+    }
+    source_ << "  }\n";
+  }
+  for (const auto &field : model.fields) {
+    if (!is_reused_on_decode(*field)) {
+      continue;
+    }
+    if (field->is_repeated()) {
+      source_ << "  size_t sk_" << field->name << "_used = sk_replace ? 0 : "
+              << field->name << ".size();\n";
+    } else {
+      source_ << "  bool sk_" << field->name << "_seen = false;\n";
+    }
+  }
+  source_ << "  size_t sk_pos = 0;\n";
+  source_ << "  while (sk_pos < sk_data.size()) {\n";
+
+  generate_varint_read("sk_tag", "sk_data", "  ");
+  source_ << "\n";
+
+  source_ << "    uint32_t sk_field_number = static_cast<uint32_t>(sk_tag >> "
+             "3);\n";
+  source_ << "    uint8_t sk_wire_type = static_cast<uint8_t>(sk_tag & "
+             "0x7);\n\n";
+
+  source_ << "    switch (sk_field_number) {\n";
+
+  for (const auto &field : model.fields) {
+    generate_field_deserializer(*field, "    ");
+  }
+
+  source_ << "    default:\n";
+  source_ << "      // Skip unknown field\n";
+  // Interned strings are tagged STRING_TABLE and bitmap bools BITMAP, but
+  // are written as a length-delimited string and a varint.
+  source_ << "      if (sk_wire_type == 0 || sk_wire_type == 7) {\n";
+  generate_varint_read("sk_value", "sk_data", "        ");
+  source_ << "      } else if (sk_wire_type == 2 || sk_wire_type == 3 || "
+             "sk_wire_type == 6) {\n";
+  generate_varint_read("sk_length", "sk_data", "        ");
+  source_ << "        if (sk_length > sk_data.size() - sk_pos) return false;\n";
+  source_ << "        sk_pos += sk_length;\n";
+  source_ << "      } else if (sk_wire_type == 1 || sk_wire_type == 5) {\n";
+  source_ << "        size_t sk_width = sk_wire_type == 1 ? 8 : 4;\n";
+  source_ << "        if (sk_width > sk_data.size() - sk_pos) return false;\n";
+  source_ << "        sk_pos += sk_width;\n";
+  source_ << "      } else {\n";
+  source_ << "        return false;\n";
+  source_ << "      }\n";
+  source_ << "      break;\n";
+  source_ << "    }\n";
+  source_ << "  }\n";
+  for (const auto &field : model.fields) {
+    if (!is_reused_on_decode(*field)) {
+      continue;
+    }
+    if (field->is_repeated()) {
+      source_ << "  " << field->name << ".resize(sk_" << field->name
+              << "_used);\n";
+    } else {
+      source_ << "  if (sk_replace && !sk_" << field->name << "_seen) "
+              << field->name << ".clear();\n";
+    }
+  }
+  source_ << "  return true;\n";
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_clear_field(const Field &field,
+                                         const std::string &indent) {
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+  if (field.is_optional()) {
+    source_ << indent << field.name << ".reset();\n";
+  } else if (field.is_repeated() ||
+             (prim_type && prim_type->kind == PrimitiveTypeKind::STRING) ||
+             schema_.find_model(field.type->get_name())) {
+    source_ << indent << field.name << ".clear();\n";
+  } else {
+    source_ << indent << field.name << " = {};\n";
+  }
+}
+
+void CodeGenerator::generate_hash_declaration() {
+  header_ << "  // 64-bit hash of the field values, without encoding them. "
+             "Stable across\n";
+  header_ << "  // platforms and independent of modifiers such as packed or "
+             "interned.\n";
+  header_ << "  uint64_t hash(uint64_t seed = 0) const;\n\n";
+}
+
+void CodeGenerator::generate_delimited_methods() {
+  header_ << "  template <typename Writer>\n";
+  header_ << "  void serialize_delimited(Writer& sk_writer) const {\n";
+  header_ << "    size_t sk_size = byte_size();\n";
+  header_ << "    uint8_t sk_prefix[10];\n";
+  header_ << "    size_t sk_prefix_size = 0;\n";
+  header_ << "    for (uint64_t sk_val = sk_size;; sk_val >>= 7) {\n";
+  header_ << "      if (sk_val <= 0x7F) {\n";
+  header_ << "        sk_prefix[sk_prefix_size++] = "
+             "static_cast<uint8_t>(sk_val);\n";
+  header_ << "        break;\n";
+  header_ << "      }\n";
+  header_ << "      sk_prefix[sk_prefix_size++] = static_cast<uint8_t>((sk_val "
+             "& 0x7F) | 0x80);\n";
+  header_ << "    }\n";
+  header_ << "    if constexpr (requires { sk_writer.prepare(sk_size); }) {\n";
+  header_ << "      uint8_t* sk_out = sk_writer.prepare(sk_prefix_size + "
+             "sk_size);\n";
+  header_ << "      std::memcpy(sk_out, sk_prefix, sk_prefix_size);\n";
+  header_ << "      serialize_to(sk_out + sk_prefix_size);\n";
+  header_ << "      sk_writer.commit(sk_prefix_size + sk_size);\n";
+  header_ << "    } else {\n";
+  header_ << "      std::vector<uint8_t> sk_frame(sk_prefix_size + sk_size);\n";
+  header_ << "      std::memcpy(sk_frame.data(), sk_prefix, sk_prefix_size);\n";
+  header_ << "      serialize_to(sk_frame.data() + sk_prefix_size);\n";
+  header_ << "      sk_writer.write(sk_frame.data(), sk_frame.size());\n";
+  header_ << "    }\n";
+  header_ << "  }\n\n";
+
+  header_ << "  // Reads one frame into `sk_buffer`, which keeps its capacity "
+             "across calls,\n";
+  header_ << "  // and decodes it. Frames longer than `sk_max_size` (the "
+             "default of\n";
+  header_ << "  // serialkit::DEFAULT_MAX_MESSAGE_SIZE) are rejected before "
+             "anything is\n";
+  header_ << "  // allocated. The prefix is read a byte at a time so that "
+             "nothing past\n";
+  header_ << "  // the frame is consumed; use the framer overload for "
+             "sockets.\n";
+  header_ << "  template <typename Reader>\n";
+  header_ << "  bool parse_delimited(Reader& sk_reader, std::vector<uint8_t>& "
+             "sk_buffer,\n";
+  header_ << "                       size_t sk_max_size = 64 * 1024 * 1024) "
+             "{\n";
+  header_ << "    uint64_t sk_size = 0;\n";
+  header_ << "    for (int sk_shift = 0;; sk_shift += 7) {\n";
+  header_ << "      uint8_t sk_byte = 0;\n";
+  header_ << "      if (sk_shift >= 64 || sk_reader.read(&sk_byte, 1) != 1) "
+             "return false;\n";
+  header_ << "      sk_size |= static_cast<uint64_t>(sk_byte & 0x7F) << "
+             "sk_shift;\n";
+  header_ << "      if ((sk_byte & 0x80) == 0) break;\n";
+  header_ << "    }\n";
+  header_ << "    if (sk_size > sk_max_size) return false;\n";
+  header_ << "    sk_buffer.resize(static_cast<size_t>(sk_size));\n";
+  header_ << "    for (size_t sk_filled = 0; sk_filled < sk_buffer.size();) "
+             "{\n";
+  header_ << "      size_t sk_read = sk_reader.read(sk_buffer.data() + "
+             "sk_filled,\n";
+  header_ << "                                sk_buffer.size() - sk_filled);\n";
+  header_ << "      if (sk_read == 0) return false;\n";
+  header_ << "      sk_filled += sk_read;\n";
+  header_ << "    }\n";
+  header_ << "    return deserialize(std::span<const uint8_t>(sk_buffer));\n";
+  header_ << "  }\n\n";
+
+  header_ << "  template <typename Reader>\n";
+  header_ << "  bool parse_delimited(Reader& sk_reader) {\n";
+  header_ << "    std::vector<uint8_t> sk_buffer;\n";
+  header_ << "    return parse_delimited(sk_reader, sk_buffer);\n";
+  header_ << "  }\n\n";
+
+  header_ << "  // Decodes the next frame of a framer such as "
+             "serialkit::StreamReader,\n";
+  header_ << "  // refilling it from `sk_reader` in large reads. The message "
+             "is decoded in\n";
+  header_ << "  // place from the framer's buffer, which also enforces its "
+             "size limit.\n";
+  header_ << "  template <typename Framer, typename Reader>\n";
+  header_ << "    requires requires(Framer& sk_framer, std::span<const "
+             "uint8_t>& sk_message) {\n";
+  header_ << "      sk_framer.next(sk_message);\n";
+  header_ << "    }\n";
+  header_ << "  bool parse_delimited(Framer& sk_framer, Reader& sk_reader) {\n";
+  header_ << "    std::span<const uint8_t> sk_message;\n";
+  header_ << "    using Status = decltype(sk_framer.next(sk_message));\n";
+  header_ << "    for (;;) {\n";
+  header_ << "      Status sk_status = sk_framer.next(sk_message);\n";
+  header_ << "      if (sk_status == Status::OK) return "
+             "deserialize(sk_message);\n";
+  header_ << "      if (sk_status == Status::MALFORMED || "
+             "sk_framer.fill(sk_reader) == 0) {\n";
+  header_ << "        return false;\n";
+  header_ << "      }\n";
+  header_ << "    }\n";
+  header_ << "  }\n";
+}
+
+void CodeGenerator::generate_decoder_declarations() {
+  // The shared base lives in detail so that it cannot clash with the
+  // schema's types; only the per-model decoders are public.
+  header_ << "namespace detail {\n\n";
+  header_ << "// Decodes one message from chunks of any size. State is kept "
+             "per\n";
+  header_ << "// nesting level (field, remaining length, partial varint) and "
+             "strings\n";
+  header_ << "// are appended to their fields as bytes arrive, so the encoded "
+             "message\n";
+  header_ << "// is never buffered as a whole.\n";
+  header_ << "class ResumableDecoder {\n";
+  header_ << "public:\n";
+  header_ << "  using DecodeStatus = ::serialkit::DecodeStatus;\n\n";
+  header_ << "  // Consumes bytes of `data` until the message is complete or "
+             "malformed,\n";
+  header_ << "  // or the chunk runs out. `consumed` reports how many bytes "
+             "were used;\n";
+  header_ << "  // anything after a complete message is left alone.\n";
+  header_ << "  DecodeStatus feed(std::span<const uint8_t> data, size_t& "
+             "consumed);\n";
+  header_ << "  DecodeStatus feed(std::span<const uint8_t> data) {\n";
+  header_ << "    size_t consumed = 0;\n";
+  header_ << "    return feed(data, consumed);\n";
+  header_ << "  }\n";
+  header_ << "  DecodeStatus status() const { return status_; }\n\n";
+  header_ << "protected:\n";
+  header_ << "  ResumableDecoder(void* target, uint32_t model, bool "
+             "delimited,\n";
+  header_ << "                   uint64_t size);\n\n";
+  header_ << "private:\n";
+  header_ << "  enum class Step : uint8_t {\n";
+  header_ << "    LENGTH_PREFIX, TAG, VALUE, LENGTH, STRING, STRUCT, "
+             "COLUMNS, PACKED,\n";
+  header_ << "    SKIP_VARINT, SKIP_BYTES\n";
+  header_ << "  };\n\n";
+  header_ << "  struct Level {\n";
+  header_ << "    void* target;\n";
+  header_ << "    uint32_t model;\n";
+  header_ << "    uint64_t end;\n";
+  header_ << "  };\n\n";
+  header_ << "  bool read_varint(uint8_t byte, bool& complete);\n";
+  header_ << "  bool finish_varint(uint64_t value);\n";
+  header_ << "  bool begin_field();\n";
+  header_ << "  bool begin_length(uint64_t length);\n\n";
+  header_ << "  std::vector<Level> levels_;\n";
+  header_ << "  uint64_t position_ = 0;\n";
+  header_ << "  uint64_t value_end_ = 0;\n";
+  header_ << "  uint64_t varint_ = 0;\n";
+  header_ << "  uint64_t fixed_ = 0;\n";
+  header_ << "  std::string* string_ = nullptr;\n";
+  header_ << "  std::vector<uint8_t> struct_;\n";
+  header_ << "  uint64_t struct_size_ = 0;\n";
+  header_ << "  std::vector<uint8_t> columns_;\n";
+  header_ << "  uint32_t shift_ = 0;\n";
+  header_ << "  uint32_t field_ = 0;\n";
+  header_ << "  uint8_t wire_type_ = 0;\n";
+  header_ << "  uint8_t fixed_width_ = 0;\n";
+  header_ << "  uint8_t fixed_count_ = 0;\n";
+  header_ << "  Step step_;\n";
+  header_ << "  DecodeStatus status_ = DecodeStatus::NEED_MORE;\n";
+  header_ << "};\n\n";
+  header_ << "} // namespace detail\n\n";
+
+  for (const auto &decl : schema_.declarations) {
+    auto *model = dynamic_cast<const ModelDecl *>(decl.get());
+    if (!model) {
+      continue;
+    }
+    std::string name = model->name + "Decoder";
+    header_ << "class " << name << " : public detail::ResumableDecoder {\n";
+    header_ << "public:\n";
+    header_ << "  // Length-prefixed message, as written by "
+               "serialize_delimited().\n";
+    header_ << "  explicit " << name << "(" << model->name << "& target);\n";
+    header_ << "  // Bare message of `size` bytes, as written by "
+               "serialize().\n";
+    header_ << "  " << name << "(" << model->name
+            << "& target, uint64_t size);\n";
+    header_ << "};\n\n";
+  }
+}
+
+void CodeGenerator::generate_decoder_implementation() {
+  std::string specifier = inline_specifier();
+  generate_internal_namespace_open();
+  source_ << "enum class FieldKind : uint8_t {\n";
+  source_ << "  UNKNOWN, VARINT, STRING, MESSAGE, STRUCT, STRUCT_ARRAY, "
+             "COLUMNS,\n";
+  source_ << "  PACKED_VARINT, PACKED_FIXED32, PACKED_FIXED64"
+          << (has_utf8_fields() ? ", UTF8_STRING" : "")
+          << (has_checksummed_models() ? ", CHECKSUMMED\n" : "\n");
+  source_ << "};\n\n";
+  source_ << "struct DecodeTarget {\n";
+  source_ << "  void* target;\n";
+  source_ << "  uint32_t model;\n";
+  source_ << "};\n\n";
+
+  std::vector<const ModelDecl *> models;
+  for (const auto &decl : schema_.declarations) {
+    if (auto *model = dynamic_cast<const ModelDecl *>(decl.get())) {
+      generate_decoder_hooks(*model);
+      models.push_back(model);
+    }
+  }
+
+  source_ << "struct DecodeHooks {\n";
+  source_ << "  FieldKind (*kind)(uint32_t field);\n";
+  source_ << "  void (*value)(void* target, uint32_t field, uint64_t value);\n";
+  source_ << "  std::string* (*string)(void* target, uint32_t field);\n";
+  source_ << "  DecodeTarget (*message)(void* target, uint32_t field);\n";
+  source_ << "  size_t (*struct_size)(uint32_t field);\n";
+  source_ << "  void (*structs)(void* target, uint32_t field, const uint8_t* "
+             "bytes);\n";
+  source_ << "  bool (*columns)(void* target, uint32_t field,\n";
+  source_ << "                  std::span<const uint8_t> bytes);\n";
+  source_ << "};\n\n";
+  source_ << specifier << "const DecodeHooks DECODE_HOOKS[] = {\n";
+  for (const ModelDecl *model : models) {
+    source_ << "  {" << model->name << "_decode_kind, " << model->name
+            << "_decode_value, " << model->name << "_decode_string,\n";
+    source_ << "   " << model->name << "_decode_message, " << model->name
+            << "_decode_struct_size, " << model->name << "_decode_struct,\n";
+    source_ << "   " << model->name << "_decode_columns},\n";
+  }
+  source_ << "};\n\n";
+  generate_internal_namespace_close();
+
+  source_ << specifier
+          << "detail::ResumableDecoder::ResumableDecoder(void* target,\n";
+  source_ << "    uint32_t model, bool delimited, uint64_t size)\n";
+  source_ << "    : step_(delimited ? Step::LENGTH_PREFIX : Step::TAG) {\n";
+  source_ << "  levels_.push_back(Level{target, model, size});\n";
+  if (has_checksummed_models()) {
+    // A checksummed message is gathered whole, like one of its fields.
+    source_ << "  if (!delimited && DECODE_HOOKS[model].kind(0) ==\n";
+    source_ << "                        FieldKind::CHECKSUMMED &&\n";
+    source_ << "      !begin_length(size)) {\n";
+    source_ << "    status_ = DecodeStatus::MALFORMED;\n";
+    source_ << "  }\n";
+  }
+  source_ << "}\n\n";
+
+  source_ << specifier << "::serialkit::DecodeStatus "
+                          "detail::ResumableDecoder::feed(\n";
+  source_ << "    std::span<const uint8_t> data, size_t& consumed) {\n";
+  source_ << "  size_t pos = 0;\n";
+  source_ << "  while (status_ == DecodeStatus::NEED_MORE) {\n";
+  source_ << "    if (step_ == Step::TAG && shift_ == 0) {\n";
+  source_ << "      while (!levels_.empty() &&\n";
+  source_ << "             position_ == levels_.back().end) {\n";
+  source_ << "        levels_.pop_back();\n";
+  source_ << "      }\n";
+  source_ << "      if (levels_.empty()) {\n";
+  source_ << "        status_ = DecodeStatus::DONE;\n";
+  source_ << "        break;\n";
+  source_ << "      }\n";
+  source_ << "    }\n\n";
+
+  source_ << "    if (step_ == Step::STRING || step_ == Step::STRUCT ||\n";
+  source_ << "        step_ == Step::COLUMNS || step_ == Step::SKIP_BYTES) {\n";
+  source_ << "      if (pos == data.size()) break;\n";
+  source_ << "      uint64_t count = value_end_ - position_;\n";
+  source_ << "      if (step_ == Step::STRUCT) count = struct_size_ - "
+             "struct_.size();\n";
+  source_ << "      if (count > data.size() - pos) count = data.size() - "
+             "pos;\n";
+  source_ << "      const uint8_t* bytes = data.data() + pos;\n";
+  source_ << "      if (step_ == Step::STRING) {\n";
+  source_ << "        string_->append(reinterpret_cast<const char*>(bytes),\n";
+  source_ << "                        static_cast<size_t>(count));\n";
+  if (has_utf8_fields()) {
+    // Chunks may split a sequence, so the whole string is checked once
+    // its last chunk has arrived.
+    source_ << "        if (position_ + count == value_end_ &&\n";
+    source_ << "            DECODE_HOOKS[levels_.back().model].kind(field_) "
+               "==\n";
+    source_ << "                FieldKind::UTF8_STRING &&\n";
+    source_ << "            !utf8_valid(*string_)) {\n";
+    source_ << "          status_ = DecodeStatus::MALFORMED;\n";
+    source_ << "          break;\n";
+    source_ << "        }\n";
+  }
+  source_ << "      } else if (step_ == Step::STRUCT) {\n";
+  source_ << "        // Whole elements are decoded in place; split ones are "
+             "gathered first.\n";
+  source_ << "        if (!struct_.empty() || count < struct_size_) {\n";
+  source_ << "          struct_.insert(struct_.end(), bytes, bytes + count);\n";
+  source_ << "          bytes = struct_.data();\n";
+  source_ << "        }\n";
+  source_ << "        if (struct_.empty() || struct_.size() == struct_size_) "
+             "{\n";
+  source_ << "          const Level& level = levels_.back();\n";
+  source_ << "          DECODE_HOOKS[level.model].structs(level.target, "
+             "field_, bytes);\n";
+  source_ << "          struct_.clear();\n";
+  source_ << "        }\n";
+  source_ << "      } else if (step_ == Step::COLUMNS) {\n";
+  source_ << "        // A column block is only decodable once it is "
+             "complete.\n";
+  source_ << "        columns_.insert(columns_.end(), bytes, bytes + count);\n";
+  source_ << "        if (position_ + count == value_end_) {\n";
+  source_ << "          const Level& level = levels_.back();\n";
+  source_ << "          if (!DECODE_HOOKS[level.model].columns(\n";
+  source_ << "                  level.target, field_, columns_)) {\n";
+  source_ << "            status_ = DecodeStatus::MALFORMED;\n";
+  source_ << "            break;\n";
+  source_ << "          }\n";
+  source_ << "          columns_.clear();\n";
+  source_ << "        }\n";
+  source_ << "      }\n";
+  source_ << "      pos += static_cast<size_t>(count);\n";
+  source_ << "      position_ += count;\n";
+  source_ << "      if (position_ == value_end_) step_ = Step::TAG;\n";
+  source_ << "      continue;\n";
+  source_ << "    }\n\n";
+
+  source_ << "    // Single bytes of varints and fixed-width values; none may "
+             "cross the\n";
+  source_ << "    // end of the enclosing message or packed run.\n";
+  source_ << "    uint64_t end = step_ == Step::PACKED ? value_end_ : "
+             "levels_.back().end;\n";
+  source_ << "    if (step_ != Step::LENGTH_PREFIX && position_ == end) {\n";
+  source_ << "      status_ = DecodeStatus::MALFORMED;\n";
+  source_ << "      break;\n";
+  source_ << "    }\n";
+  source_ << "    if (pos == data.size()) break;\n";
+  source_ << "    uint8_t byte = data[pos++];\n";
+  source_ << "    ++position_;\n\n";
+
+  source_ << "    if (step_ == Step::PACKED && fixed_width_ != 0) {\n";
+  source_ << "      fixed_ |= static_cast<uint64_t>(byte) << (fixed_count_ * "
+             "8);\n";
+  source_ << "      if (++fixed_count_ == fixed_width_) {\n";
+  source_ << "        const Level& level = levels_.back();\n";
+  source_ << "        DECODE_HOOKS[level.model].value(level.target, field_, "
+             "fixed_);\n";
+  source_ << "        fixed_ = 0;\n";
+  source_ << "        fixed_count_ = 0;\n";
+  source_ << "        if (position_ == value_end_) step_ = Step::TAG;\n";
+  source_ << "      }\n";
+  source_ << "      continue;\n";
+  source_ << "    }\n\n";
+
+  source_ << "    bool complete = false;\n";
+  source_ << "    if (!read_varint(byte, complete) ||\n";
+  source_ << "        (complete && !finish_varint(std::exchange(varint_, 0)))) "
+             "{\n";
+  source_ << "      status_ = DecodeStatus::MALFORMED;\n";
+  source_ << "    }\n";
+  source_ << "  }\n";
+  source_ << "  consumed = pos;\n";
+  source_ << "  return status_;\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "bool detail::ResumableDecoder::read_varint(uint8_t "
+                          "byte,\n";
+  source_ << "    bool& complete) {\n";
+  source_ << "  if (shift_ >= 64) return false;\n";
+  source_ << "  varint_ |= static_cast<uint64_t>(byte & 0x7F) << shift_;\n";
+  source_ << "  shift_ += 7;\n";
+  source_ << "  complete = (byte & 0x80) == 0;\n";
+  source_ << "  if (complete) shift_ = 0;\n";
+  source_ << "  return true;\n";
+  source_ << "}\n\n";
+
+  source_ << specifier
+          << "bool detail::ResumableDecoder::finish_varint(uint64_t value) {\n";
+  source_ << "  const Level& level = levels_.back();\n";
+  source_ << "  switch (step_) {\n";
+  source_ << "  case Step::LENGTH_PREFIX:\n";
+  source_ << "    if (value > UINT64_MAX - position_) return false;\n";
+  source_ << "    levels_.back().end = position_ + value;\n";
+  source_ << "    step_ = Step::TAG;\n";
+  if (has_checksummed_models()) {
+    source_ << "    if (DECODE_HOOKS[level.model].kind(0) == "
+               "FieldKind::CHECKSUMMED) {\n";
+    source_ << "      return begin_length(value);\n";
+    source_ << "    }\n";
+  }
+  source_ << "    return true;\n";
+  source_ << "  case Step::TAG:\n";
+  source_ << "    field_ = static_cast<uint32_t>(value >> 3);\n";
+  source_ << "    wire_type_ = static_cast<uint8_t>(value & 0x7);\n";
+  source_ << "    return begin_field();\n";
+  source_ << "  case Step::VALUE:\n";
+  source_ << "    DECODE_HOOKS[level.model].value(level.target, field_, "
+             "value);\n";
+  source_ << "    step_ = Step::TAG;\n";
+  source_ << "    return true;\n";
+  source_ << "  case Step::LENGTH:\n";
+  source_ << "    if (value > level.end - position_) return false;\n";
+  source_ << "    return begin_length(value);\n";
+  source_ << "  case Step::PACKED:\n";
+  source_ << "    DECODE_HOOKS[level.model].value(level.target, field_, "
+             "value);\n";
+  source_ << "    if (position_ == value_end_) step_ = Step::TAG;\n";
+  source_ << "    return true;\n";
+  source_ << "  case Step::SKIP_VARINT:\n";
+  source_ << "    step_ = Step::TAG;\n";
+  source_ << "    return true;\n";
+  source_ << "  default:\n";
+  source_ << "    return false;\n";
+  source_ << "  }\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "bool detail::ResumableDecoder::begin_field() {\n";
+  source_ << "  const Level& level = levels_.back();\n";
+  source_ << "  switch (DECODE_HOOKS[level.model].kind(field_)) {\n";
+  source_ << "  case FieldKind::VARINT:\n";
+  source_ << "    step_ = Step::VALUE;\n";
+  source_ << "    return true;\n";
+  source_ << "  case FieldKind::UNKNOWN:\n";
+  source_ << "    break;\n";
+  source_ << "  default:\n";
+  source_ << "    step_ = Step::LENGTH;\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n\n";
+  source_ << "  // Skip unknown field\n";
+  source_ << "  switch (wire_type_) {\n";
+  source_ << "  case 0:\n";
+  source_ << "  case 7:\n";
+  source_ << "    step_ = Step::SKIP_VARINT;\n";
+  source_ << "    return true;\n";
+  source_ << "  case 2:\n";
+  source_ << "  case 3:\n";
+  source_ << "  case 6:\n";
+  source_ << "    step_ = Step::LENGTH;\n";
+  source_ << "    return true;\n";
+  source_ << "  case 1:\n";
+  source_ << "  case 5: {\n";
+  source_ << "    uint64_t width = wire_type_ == 1 ? 8 : 4;\n";
+  source_ << "    if (width > level.end - position_) return false;\n";
+  source_ << "    value_end_ = position_ + width;\n";
+  source_ << "    step_ = Step::SKIP_BYTES;\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n";
+  source_ << "  default:\n";
+  source_ << "    return false;\n";
+  source_ << "  }\n";
+  source_ << "}\n\n";
+
+  source_ << specifier
+          << "bool detail::ResumableDecoder::begin_length(uint64_t length) {\n";
+  source_ << "  void* target = levels_.back().target;\n";
+  source_ << "  const DecodeHooks& hooks = "
+             "DECODE_HOOKS[levels_.back().model];\n";
+  source_ << "  value_end_ = position_ + length;\n";
+  source_ << "  step_ = length == 0 ? Step::TAG : Step::SKIP_BYTES;\n";
+  source_ << "  FieldKind kind = hooks.kind(field_);\n";
+  source_ << "  switch (kind) {\n";
+  if (has_utf8_fields()) {
+    source_ << "  case FieldKind::UTF8_STRING:\n";
+  }
+  source_ << "  case FieldKind::STRING:\n";
+  source_ << "    string_ = hooks.string(target, field_);\n";
+  source_ << "    if (length != 0) step_ = Step::STRING;\n";
+  source_ << "    return true;\n";
+  source_ << "  case FieldKind::MESSAGE: {\n";
+  source_ << "    DecodeTarget child = hooks.message(target, field_);\n";
+  source_ << "    levels_.push_back(Level{child.target, child.model, "
+             "value_end_});\n";
+  source_ << "    step_ = Step::TAG;\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n";
+  source_ << "  case FieldKind::STRUCT:\n";
+  source_ << "  case FieldKind::STRUCT_ARRAY:\n";
+  source_ << "    struct_size_ = hooks.struct_size(field_);\n";
+  source_ << "    if (kind == FieldKind::STRUCT ? length != struct_size_\n";
+  source_ << "                                  : length % struct_size_ != 0) "
+             "{\n";
+  source_ << "      return false;\n";
+  source_ << "    }\n";
+  source_ << "    struct_.clear();\n";
+  source_ << "    if (length != 0) step_ = Step::STRUCT;\n";
+  source_ << "    return true;\n";
+  source_ << "  case FieldKind::COLUMNS:\n";
+  source_ << "    // Every column block starts with its row count.\n";
+  source_ << "    if (length == 0) return false;\n";
+  source_ << "    columns_.clear();\n";
+  source_ << "    step_ = Step::COLUMNS;\n";
+  source_ << "    return true;\n";
+  if (has_checksummed_models()) {
+    source_ << "  case FieldKind::CHECKSUMMED:\n";
+    source_ << "    // Decoded once complete, after its trailer is verified.\n";
+    source_ << "    if (length < 4) return false;\n";
+    source_ << "    columns_.clear();\n";
+    source_ << "    step_ = Step::COLUMNS;\n";
+    source_ << "    return true;\n";
+  }
+  source_ << "  case FieldKind::PACKED_VARINT:\n";
+  source_ << "    fixed_width_ = 0;\n";
+  source_ << "    break;\n";
+  source_ << "  case FieldKind::PACKED_FIXED32:\n";
+  source_ << "    fixed_width_ = 4;\n";
+  source_ << "    break;\n";
+  source_ << "  case FieldKind::PACKED_FIXED64:\n";
+  source_ << "    fixed_width_ = 8;\n";
+  source_ << "    break;\n";
+  source_ << "  default:\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n";
+  source_ << "  if (fixed_width_ != 0 && length % fixed_width_ != 0) return "
+             "false;\n";
+  source_ << "  if (length != 0) step_ = Step::PACKED;\n";
+  source_ << "  return true;\n";
+  source_ << "}\n\n";
+
+  for (size_t i = 0; i < models.size(); ++i) {
+    const std::string &model = models[i]->name;
+    source_ << specifier << model << "Decoder::" << model << "Decoder("
+            << model
+            << "& target)\n";
+    source_ << "    : detail::ResumableDecoder(&target, " << i
+            << ", true, 0) {}\n\n";
+    source_ << specifier << model << "Decoder::" << model << "Decoder("
+            << model
+            << "& target, uint64_t size)\n";
+    source_ << "    : detail::ResumableDecoder(&target, " << i
+            << ", false, size) {}\n\n";
+  }
+}
+
+void CodeGenerator::generate_decoder_hooks(const ModelDecl &model) {
+  std::ostringstream kinds;
+  std::ostringstream values;
+  std::ostringstream strings;
+  std::ostringstream messages;
+  std::ostringstream struct_sizes;
+  std::ostringstream structs;
+  std::ostringstream columns;
+
+  if (model.checksummed) {
+    // Field 0 stands for the message itself when it is decoded on its own.
+    kinds << "  case 0:\n";
+    kinds << "    return FieldKind::CHECKSUMMED;\n";
+    columns << "  case 0:\n";
+    columns << "    return message.deserialize(bytes);\n";
+  }
+
+  for (const auto &field : model.fields) {
+    std::string kind = get_decode_kind(*field);
+    kinds << "  case " << field->number << ":\n";
+    kinds << "    return " << kind << ";\n";
+
+    const std::string member = "message." + field->name;
+    if (kind == "FieldKind::STRING" || kind == "FieldKind::UTF8_STRING") {
+      strings << "  case " << field->number << ":\n";
+      if (field->is_repeated()) {
+        strings << "    return &" << member << ".emplace_back();\n";
+      } else if (field->is_optional()) {
+        strings << "    return &" << member << ".emplace();\n";
+      } else {
+        strings << "    " << member << ".clear();\n";
+        strings << "    return &" << member << ";\n";
+      }
+    } else if (kind == "FieldKind::STRUCT" ||
+               kind == "FieldKind::STRUCT_ARRAY") {
+      struct_sizes << "  case " << field->number << ":\n";
+      struct_sizes << "    return " << get_cpp_type(*field->type)
+                   << "::WIRE_SIZE;\n";
+      structs << "  case " << field->number << ":\n";
+      if (field->is_repeated()) {
+        structs << "    " << member
+                << ".emplace_back().deserialize_from(bytes);\n";
+      } else if (field->is_optional()) {
+        structs << "    " << member << ".emplace().deserialize_from(bytes);\n";
+      } else {
+        structs << "    " << member << ".deserialize_from(bytes);\n";
+      }
+      structs << "    break;\n";
+    } else if (kind == "FieldKind::COLUMNS") {
+      columns << "  case " << field->number << ":\n";
+      columns << "    return " << get_cpp_type(*field->type)
+              << "_read_columns(bytes, " << member << ");\n";
+    } else if (kind == "FieldKind::CHECKSUMMED") {
+      std::string target = field->is_repeated()  ? ".emplace_back()"
+                           : field->is_optional() ? ".emplace()"
+                                                  : "";
+      columns << "  case " << field->number << ":\n";
+      columns << "    return " << member << target
+              << ".deserialize(bytes);\n";
+    } else if (kind == "FieldKind::MESSAGE") {
+      std::string child =
+          std::to_string(get_model_index(field->type->get_name()));
+      messages << "  case " << field->number << ":\n";
+      if (field->is_repeated()) {
+        messages << "    return {&" << member << ".emplace_back(), " << child
+                 << "};\n";
+      } else if (field->is_optional()) {
+        messages << "    return {&" << member << ".emplace(), " << child
+                 << "};\n";
+      } else {
+        messages << "    return {&" << member << ", " << child << "};\n";
+      }
+    } else {
+      std::string cpp_type = get_cpp_type(*field->type);
+      values << "  case " << field->number << ": {\n";
+      if (kind == "FieldKind::PACKED_FIXED32" ||
+          kind == "FieldKind::PACKED_FIXED64") {
+        std::string bits_type =
+            kind == "FieldKind::PACKED_FIXED32" ? "uint32_t" : "uint64_t";
+        values << "    " << bits_type << " bits = static_cast<" << bits_type
+               << ">(value);\n";
+        values << "    " << cpp_type << " item;\n";
+        values << "    std::memcpy(&item, &bits, sizeof(item));\n";
+        values << "    " << member << ".push_back(item);\n";
+      } else if (field->is_repeated()) {
+        values << "    " << member << ".push_back(static_cast<" << cpp_type
+               << ">(value));\n";
+      } else {
+        values << "    " << member << " = static_cast<" << cpp_type
+               << ">(value);\n";
+      }
+      values << "    break;\n";
+      values << "  }\n";
+    }
+  }
+
+  auto open = [&](const std::string &cases) {
+    if (cases.empty()) {
+      source_ << "  (void)target;\n";
+    } else {
+      source_ << "  " << model.name << "& message = *static_cast<" << model.name
+              << "*>(target);\n";
+    }
+    source_ << "  switch (field) {\n" << cases;
+  };
+
+  source_ << inline_specifier() << "FieldKind " << model.name
+          << "_decode_kind(uint32_t field) {\n";
+  source_ << "  switch (field) {\n" << kinds.str();
+  source_ << "  default:\n";
+  source_ << "    return FieldKind::UNKNOWN;\n";
+  source_ << "  }\n";
+  source_ << "}\n\n";
+
+  source_ << inline_specifier() << "void " << model.name
+          << "_decode_value(void* target, uint32_t field, uint64_t value) {\n";
+  if (values.str().empty()) {
+    source_ << "  (void)target;\n";
+    source_ << "  (void)field;\n";
+    source_ << "  (void)value;\n";
+  } else {
+    open(values.str());
+    source_ << "  default:\n";
+    source_ << "    break;\n";
+    source_ << "  }\n";
+  }
+  source_ << "}\n\n";
+
+  source_ << inline_specifier() << "std::string* " << model.name
+          << "_decode_string(void* target, uint32_t field) {\n";
+  open(strings.str());
+  source_ << "  default:\n";
+  source_ << "    return nullptr;\n";
+  source_ << "  }\n";
+  source_ << "}\n\n";
+
+  source_ << inline_specifier() << "DecodeTarget " << model.name
+          << "_decode_message(void* target, uint32_t field) {\n";
+  open(messages.str());
+  source_ << "  default:\n";
+  source_ << "    return {nullptr, 0};\n";
+  source_ << "  }\n";
+  source_ << "}\n\n";
+
+  source_ << inline_specifier() << "size_t " << model.name
+          << "_decode_struct_size(uint32_t field) {\n";
+  source_ << "  switch (field) {\n" << struct_sizes.str();
+  source_ << "  default:\n";
+  source_ << "    return 0;\n";
+  source_ << "  }\n";
+  source_ << "}\n\n";
+
+  source_ << inline_specifier() << "void " << model.name
+          << "_decode_struct(void* target, uint32_t field,\n";
+  source_ << "    const uint8_t* bytes) {\n";
+  if (structs.str().empty()) {
+    source_ << "  (void)target;\n";
+    source_ << "  (void)field;\n";
+    source_ << "  (void)bytes;\n";
+  } else {
+    open(structs.str());
+    source_ << "  default:\n";
+    source_ << "    break;\n";
+    source_ << "  }\n";
+  }
+  source_ << "}\n\n";
+
+  source_ << inline_specifier() << "bool " << model.name
+          << "_decode_columns(void* target, uint32_t field,\n";
+  source_ << "    std::span<const uint8_t> bytes) {\n";
+  if (columns.str().empty()) {
+    source_ << "  (void)target;\n";
+    source_ << "  (void)field;\n";
+    source_ << "  (void)bytes;\n";
+    source_ << "  return true;\n";
+  } else {
+    open(columns.str());
+    source_ << "  default:\n";
+    source_ << "    return true;\n";
+    source_ << "  }\n";
+  }
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_stream_writer_declarations() {
+  // Like the decoder base, the shared base lives in detail so that it
+  // cannot clash with the schema's types (a model named Message, say).
+  header_ << "namespace detail {\n\n";
+  header_ << "// Encodes one message field by field into a Writer (anything "
+             "with\n";
+  header_ << "// write(const uint8_t*, size_t)). Output goes out in chunks and "
+             "packed\n";
+  header_ << "// repeated fields are split into consecutive packed runs, so "
+             "memory\n";
+  header_ << "// stays bounded by the chunk size however many elements are "
+             "appended.\n";
+  header_ << "// The result is a bare message, as produced by serialize().\n";
+  header_ << "class MessageStreamWriter {\n";
+  header_ << "public:\n";
+  header_ << "  static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;\n\n";
+  header_ << "  // Writes out everything still buffered. Must be called once "
+             "the last\n";
+  header_ << "  // field has been written; the destructor does not.\n";
+  header_ << "  void finish();\n";
+  header_ << "  uint64_t bytes_written() const { return bytes_written_; }\n\n";
+  header_ << "protected:\n";
+  header_ << "  template <typename Writer>\n";
+  if (has_checksummed_models()) {
+    header_ << "  MessageStreamWriter(Writer& writer, size_t chunk_size,\n";
+    header_ << "                      bool checksummed = false)\n";
+    header_ << "      : sink_(&writer), write_(&write_to<Writer>), "
+               "chunk_size_(chunk_size),\n";
+    header_ << "        checksummed_(checksummed) {}\n\n";
+  } else {
+    header_ << "  MessageStreamWriter(Writer& writer, size_t chunk_size)\n";
+    header_ << "      : sink_(&writer), write_(&write_to<Writer>), "
+               "chunk_size_(chunk_size) {}\n\n";
+  }
+  header_ << "  uint8_t* field_space(size_t size);\n";
+  header_ << "  uint8_t* packed_space(uint32_t tag, size_t size);\n\n";
+  header_ << "private:\n";
+  header_ << "  template <typename Writer>\n";
+  header_ << "  static void write_to(void* sink, const uint8_t* data, size_t "
+             "size) {\n";
+  header_ << "    static_cast<Writer*>(sink)->write(data, size);\n";
+  header_ << "  }\n\n";
+  header_ << "  void close_run();\n";
+  header_ << "  void emit(std::vector<uint8_t>& bytes);\n\n";
+  header_ << "  void* sink_;\n";
+  header_ << "  void (*write_)(void* sink, const uint8_t* data, size_t "
+             "size);\n";
+  header_ << "  size_t chunk_size_;\n";
+  header_ << "  std::vector<uint8_t> buffer_;\n";
+  header_ << "  std::vector<uint8_t> packed_;\n";
+  header_ << "  uint32_t packed_tag_ = 0;\n";
+  header_ << "  uint64_t bytes_written_ = 0;\n";
+  if (has_checksummed_models()) {
+    header_ << "  bool checksummed_;\n";
+    header_ << "  uint32_t crc_ = 0;\n";
+  }
+  header_ << "};\n\n";
+  header_ << "} // namespace detail\n\n";
+
+  for (const auto &decl : schema_.declarations) {
+    auto *model = dynamic_cast<const ModelDecl *>(decl.get());
+    if (!model) {
+      continue;
+    }
+    std::string name = model->name + "StreamWriter";
+    header_ << "class " << name << " : public detail::MessageStreamWriter {\n";
+    header_ << "public:\n";
+    header_ << "  template <typename Writer>\n";
+    header_ << "  explicit " << name << "(Writer& writer,\n";
+    header_ << "      size_t chunk_size = DEFAULT_CHUNK_SIZE)\n";
+    header_ << "      : detail::MessageStreamWriter(writer, chunk_size"
+            << (model->checksummed ? ", true" : "") << ") {}\n\n";
+
+    for (const auto &field : model->fields) {
+      std::string param = get_param_type(*field);
+      if (!field->is_repeated()) {
+        header_ << "  void write_" << field->name << "(" << param
+                << " value);\n";
+        continue;
+      }
+      if (field->is_columnar()) {
+        // A column block is written whole, so rows are taken all at once.
+        header_ << "  void append_" << field->name << "(std::span<const "
+                << get_cpp_type(*field->type) << "> rows);\n";
+        continue;
+      }
+      header_ << "  void append_" << field->name << "(" << param
+              << " item);\n";
+      header_ << "  template <typename Range>\n";
+      header_ << "    requires(!std::is_convertible_v<Range&&, " << param
+              << ">)\n";
+      header_ << "  void append_" << field->name << "(Range&& items) {\n";
+      header_ << "    for (auto&& item : items) append_" << field->name
+              << "(item);\n";
+      header_ << "  }\n";
+    }
+    header_ << "};\n\n";
+  }
+}
+
+void CodeGenerator::generate_stream_writer_implementation() {
+  std::string specifier = inline_specifier();
+  source_ << specifier << "void detail::MessageStreamWriter::finish() {\n";
+  source_ << "  close_run();\n";
+  source_ << "  emit(buffer_);\n";
+  if (has_checksummed_models()) {
+    source_ << "  if (checksummed_) {\n";
+    source_ << "    store_crc32c(append_space(buffer_, 4), crc_);\n";
+    source_ << "    write_(sink_, buffer_.data(), buffer_.size());\n";
+    source_ << "    bytes_written_ += buffer_.size();\n";
+    source_ << "    buffer_.clear();\n";
+    source_ << "  }\n";
+  }
+  source_ << "}\n\n";
+
+  source_ << specifier << "uint8_t* detail::MessageStreamWriter::field_space("
+                          "size_t size) {\n";
+  source_ << "  close_run();\n";
+  source_ << "  if (!buffer_.empty() && buffer_.size() + size > chunk_size_) "
+             "{\n";
+  source_ << "    emit(buffer_);\n";
+  source_ << "  }\n";
+  source_ << "  return append_space(buffer_, size);\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "uint8_t* detail::MessageStreamWriter::packed_space("
+                          "uint32_t tag,\n";
+  source_ << "    size_t size) {\n";
+  source_ << "  if (tag != packed_tag_ || packed_.size() + size > chunk_size_) "
+             "{\n";
+  source_ << "    close_run();\n";
+  source_ << "    packed_tag_ = tag;\n";
+  source_ << "  }\n";
+  source_ << "  return append_space(packed_, size);\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "void detail::MessageStreamWriter::close_run() {\n";
+  source_ << "  if (!packed_.empty()) {\n";
+  source_ << "    uint8_t* out = append_space(buffer_,\n";
+  source_ << "        varint_size(packed_tag_) + "
+             "varint_size(packed_.size()));\n";
+  source_ << "    out = write_varint(out, packed_tag_);\n";
+  source_ << "    write_varint(out, packed_.size());\n";
+  source_ << "    emit(buffer_);\n";
+  source_ << "    emit(packed_);\n";
+  source_ << "  }\n";
+  source_ << "  packed_tag_ = 0;\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "void detail::MessageStreamWriter::emit(\n";
+  source_ << "    std::vector<uint8_t>& bytes) {\n";
+  source_ << "  if (!bytes.empty()) {\n";
+  if (has_checksummed_models()) {
+    source_ << "    if (checksummed_) crc_ = crc32c(bytes.data(), "
+               "bytes.size(), crc_);\n";
+  }
+  source_ << "    write_(sink_, bytes.data(), bytes.size());\n";
+  source_ << "    bytes_written_ += bytes.size();\n";
+  source_ << "  }\n";
+  source_ << "  bytes.clear();\n";
+  source_ << "}\n\n";
+
+  for (const auto &decl : schema_.declarations) {
+    if (auto *model = dynamic_cast<const ModelDecl *>(decl.get())) {
+      for (const auto &field : model->fields) {
+        generate_stream_writer_method(*model, *field);
+      }
+    }
+  }
+}
+
+void CodeGenerator::generate_stream_writer_method(const ModelDecl &model,
+                                                  const Field &field) {
+  if (field.is_columnar()) {
+    std::string element = get_cpp_type(*field.type);
+    uint32_t tag = (field.number << 3) | 2;
+    source_ << inline_specifier() << "void " << model.name
+            << "StreamWriter::append_" << field.name
+            << "(std::span<const " << element << "> rows) {\n";
+    source_ << "  if (rows.empty()) return;\n";
+    source_ << "  uint8_t* sk_out = field_space(" << get_varint_size(tag)
+            << " + detail::length_delimited_size(detail::" << element
+            << "_columns_size(rows)));\n";
+    generate_tag(tag, "  ");
+    source_ << "  detail::" << element << "_write_columns(sk_out, rows);\n";
+    source_ << "}\n\n";
+    return;
+  }
+
+  std::string value = field.is_repeated() ? "item" : "value";
+  source_ << inline_specifier() << "void " << model.name << "StreamWriter::"
+          << (field.is_repeated() ? "append_" : "write_") << field.name << "("
+          << get_param_type(field) << " " << value << ") {\n";
+
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+  if (field.is_repeated() && field.is_packed() && is_packable(prim_type)) {
+    std::string tag = std::to_string((field.number << 3) | 2);
+    if (prim_type->kind == PrimitiveTypeKind::FLOAT ||
+        prim_type->kind == PrimitiveTypeKind::DOUBLE) {
+      bool is_float = prim_type->kind == PrimitiveTypeKind::FLOAT;
+      std::string bits_type = is_float ? "uint32_t" : "uint64_t";
+      int width = is_float ? 4 : 8;
+
+      source_ << "  " << bits_type << " bits;\n";
+      source_ << "  std::memcpy(&bits, &item, sizeof(bits));\n";
+      source_ << "  uint8_t* sk_out = packed_space(" << tag << ", " << width
+              << ");\n";
+      source_ << "  for (int i = 0; i < " << width << "; ++i) {\n";
+      source_ << "    *sk_out++ = static_cast<uint8_t>((bits >> (i * 8)) & "
+                 "0xFF);\n";
+      source_ << "  }\n";
+    } else {
+      source_ << "  uint8_t* sk_out = packed_space(" << tag
+              << ", detail::varint_size(static_cast<uint64_t>(item)));\n";
+      source_ << "  detail::write_varint(sk_out, "
+                 "static_cast<uint64_t>(item));\n";
+    }
+  } else if (field.is_repeated() && is_struct_type(*field.type)) {
+    source_ << "  item.serialize_to(packed_space(" << ((field.number << 3) | 2)
+            << ", " << get_cpp_type(*field.type) << "::WIRE_SIZE));\n";
+  } else {
+    uint32_t tag =
+        (field.number << 3) | get_wire_type_value(*field.type, field);
+    source_ << "  uint8_t* sk_out = field_space(" << get_varint_size(tag)
+            << " + " << get_value_size(field, value) << ");\n";
+    generate_tag(tag, "  ");
+    generate_value_serializer(field, value, "  ");
+  }
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_json_out_declaration() {
+  // Declared in every header of the namespace that uses JSON, so guarded
+  // like the header-only helpers.
+  std::string guard = get_helper_guard("JSON_OUT");
+  header_ << "namespace detail {\n\n";
+  header_ << "#ifndef " << guard << "\n";
+  header_ << "#define " << guard << "\n\n";
+  header_ << "// Output of the generated JSON writers. Text goes straight "
+             "into a window of\n";
+  header_ << "// the target: the tail of a std::string, space from the "
+             "Writer's\n";
+  header_ << "// prepare()/commit(), or a small buffer handed to its write() "
+             "when full.\n";
+  header_ << "// finish() hands over the rest; call it once, last.\n";
+  header_ << "class JsonOut {\n";
+  header_ << "public:\n";
+  header_ << "  static constexpr size_t CHUNK_SIZE = 512;\n\n";
+  header_ << "  explicit JsonOut(std::string& out) : target_(&out) {\n";
+  header_ << "    flush_ = [](JsonOut& self, size_t size) {\n";
+  header_ << "      std::string& text = *static_cast<std::string*>("
+             "self.target_);\n";
+  header_ << "      size_t used = static_cast<size_t>(self.pos_ - "
+             "text.data());\n";
+  header_ << "      size_t grow = used > CHUNK_SIZE ? used : CHUNK_SIZE;\n";
+  header_ << "      text.resize(size == 0 ? used : used + (grow > size ? grow "
+             ": size));\n";
+  header_ << "      self.pos_ = text.data() + used;\n";
+  header_ << "      self.end_ = text.data() + text.size();\n";
+  header_ << "    };\n";
+  header_ << "    size_t used = out.size();\n";
+  header_ << "    out.resize(used + CHUNK_SIZE);\n";
+  header_ << "    pos_ = out.data() + used;\n";
+  header_ << "    end_ = out.data() + out.size();\n";
+  header_ << "  }\n\n";
+  header_ << "  template <typename Writer>\n";
+  header_ << "  explicit JsonOut(Writer& writer) : target_(&writer) {\n";
+  header_ << "    if constexpr (requires { writer.prepare(CHUNK_SIZE); }) {\n";
+  header_ << "      flush_ = [](JsonOut& self, size_t size) {\n";
+  header_ << "        Writer& target = *static_cast<Writer*>(self.target_);\n";
+  header_ << "        target.commit(static_cast<size_t>(self.pos_ - "
+             "self.begin_));\n";
+  header_ << "        if (size != 0) self.open_window(target, size);\n";
+  header_ << "      };\n";
+  header_ << "      open_window(writer, CHUNK_SIZE);\n";
+  header_ << "    } else {\n";
+  header_ << "      flush_ = [](JsonOut& self, size_t) {\n";
+  header_ << "        static_cast<Writer*>(self.target_)->write(\n";
+  header_ << "            reinterpret_cast<const uint8_t*>(self.buffer_),\n";
+  header_ << "            static_cast<size_t>(self.pos_ - self.buffer_));\n";
+  header_ << "        self.pos_ = self.buffer_;\n";
+  header_ << "      };\n";
+  header_ << "      pos_ = buffer_;\n";
+  header_ << "      end_ = buffer_ + CHUNK_SIZE;\n";
+  header_ << "    }\n";
+  header_ << "  }\n\n";
+  header_ << "  JsonOut(const JsonOut&) = delete;\n";
+  header_ << "  JsonOut& operator=(const JsonOut&) = delete;\n\n";
+  header_ << "  JsonOut& operator+=(char c) {\n";
+  header_ << "    if (pos_ == end_) flush_(*this, 1);\n";
+  header_ << "    *pos_++ = c;\n";
+  header_ << "    return *this;\n";
+  header_ << "  }\n\n";
+  header_ << "  JsonOut& operator+=(std::string_view text) {\n";
+  header_ << "    append(text.data(), text.size());\n";
+  header_ << "    return *this;\n";
+  header_ << "  }\n\n";
+  header_ << "  void append(const char* data, size_t size) {\n";
+  header_ << "    while (size > static_cast<size_t>(end_ - pos_)) {\n";
+  header_ << "      size_t room = static_cast<size_t>(end_ - pos_);\n";
+  header_ << "      std::memcpy(pos_, data, room);\n";
+  header_ << "      pos_ += room;\n";
+  header_ << "      data += room;\n";
+  header_ << "      size -= room;\n";
+  header_ << "      flush_(*this, size);\n";
+  header_ << "    }\n";
+  header_ << "    if (size != 0) {\n";
+  header_ << "      std::memcpy(pos_, data, size);\n";
+  header_ << "      pos_ += size;\n";
+  header_ << "    }\n";
+  header_ << "  }\n\n";
+  header_ << "  // Room for `size` bytes, at most CHUNK_SIZE, at the cursor; "
+             "advance()\n";
+  header_ << "  // moves past the ones used.\n";
+  header_ << "  char* reserve(size_t size) {\n";
+  header_ << "    if (size > static_cast<size_t>(end_ - pos_)) flush_(*this, "
+             "size);\n";
+  header_ << "    return pos_;\n";
+  header_ << "  }\n\n";
+  header_ << "  void advance(size_t size) { pos_ += size; }\n\n";
+  header_ << "  void finish() { flush_(*this, 0); }\n\n";
+  header_ << "private:\n";
+  header_ << "  template <typename Writer> void open_window(Writer& writer, "
+             "size_t size) {\n";
+  header_ << "    if (size < CHUNK_SIZE) size = CHUNK_SIZE;\n";
+  header_ << "    begin_ = reinterpret_cast<char*>(writer.prepare(size));\n";
+  header_ << "    pos_ = begin_;\n";
+  header_ << "    end_ = begin_ + size;\n";
+  header_ << "  }\n\n";
+  header_ << "  void* target_;\n";
+  header_ << "  // Hands over the text before pos_ and, unless `size` is 0, "
+             "makes room\n";
+  header_ << "  // for at least `size` more bytes.\n";
+  header_ << "  void (*flush_)(JsonOut& self, size_t size) = nullptr;\n";
+  header_ << "  char* begin_ = nullptr;\n";
+  header_ << "  char* pos_ = nullptr;\n";
+  header_ << "  char* end_ = nullptr;\n";
+  header_ << "  char buffer_[CHUNK_SIZE];\n";
+  header_ << "};\n\n";
+  header_ << "#endif\n\n";
+  header_ << "} // namespace detail\n\n";
+}
+
+void CodeGenerator::generate_json_declarations() {
+  header_ << "  // One member per field; absent optional fields are left "
+             "out.\n";
+  header_ << "  std::string to_json() const;\n";
+  header_ << "  void append_json(std::string& out) const;\n";
+  header_ << "  void append_json(detail::JsonOut& out) const;\n";
+  header_ << "  // Writes straight into `sk_writer`, through the same "
+             "append_json() as\n";
+  header_ << "  // the string overloads.\n";
+  header_ << "  template <typename Writer>\n";
+  header_ << "  void to_json(Writer& sk_writer) const {\n";
+  header_ << "    detail::JsonOut sk_out(sk_writer);\n";
+  header_ << "    append_json(sk_out);\n";
+  header_ << "    sk_out.finish();\n";
+  header_ << "  }\n";
+  header_ << "  // Sets the fields named in `json`. Other fields keep their "
+             "values and\n";
+  header_ << "  // unknown members are skipped.\n";
+  header_ << "  bool from_json(std::string_view json);\n\n";
+}
+
+void CodeGenerator::generate_json_implementation() {
+  using Fields = std::vector<std::unique_ptr<Field>>;
+  std::vector<std::pair<std::string, const Fields *>> records;
+  for (const auto &decl : schema_.declarations) {
+    if (auto *model_decl = dynamic_cast<const ModelDecl *>(decl.get())) {
+      records.emplace_back(model_decl->name, &model_decl->fields);
+    } else if (auto *struct_decl =
+                   dynamic_cast<const StructDecl *>(decl.get())) {
+      records.emplace_back(struct_decl->name, &struct_decl->fields);
+    }
+  }
+
+  generate_internal_namespace_open();
+  for (const auto &[name, fields] : records) {
+    source_ << "inline bool " << name << "_parse_json(JsonParser& parser, "
+            << name << "& message);\n";
+  }
+  for (const auto &decl : schema_.declarations) {
+    if (auto *model_decl = dynamic_cast<const ModelDecl *>(decl.get())) {
+      source_ << "inline bool " << model_decl->name
+              << "_transcode_json(std::span<const uint8_t> data,\n";
+      source_ << "    JsonOut& out);\n";
+    }
+  }
+  source_ << "\n";
+  for (const auto &decl : schema_.declarations) {
+    if (auto *enum_decl = dynamic_cast<const EnumDecl *>(decl.get())) {
+      generate_json_enum(*enum_decl);
+    }
+  }
+  for (const auto &[name, fields] : records) {
+    generate_json_parser(name, *fields);
+  }
+  for (const auto &decl : schema_.declarations) {
+    if (auto *model_decl = dynamic_cast<const ModelDecl *>(decl.get())) {
+      generate_json_transcoder(*model_decl);
+    }
+  }
+  generate_internal_namespace_close();
+
+  for (const auto &[name, fields] : records) {
+    generate_json_methods(name, *fields);
+  }
+  for (const auto &decl : schema_.declarations) {
+    if (auto *model_decl = dynamic_cast<const ModelDecl *>(decl.get())) {
+      const std::string &name = model_decl->name;
+      source_ << inline_specifier() << "bool " << name
+              << "::transcode_to_json(std::span<const uint8_t> sk_data,\n";
+      source_ << "    std::string& sk_out) {\n";
+      source_ << "  size_t sk_begin = sk_out.size();\n";
+      source_ << "  detail::JsonOut sk_json(sk_out);\n";
+      source_ << "  bool sk_ok = detail::" << name
+              << "_transcode_json(sk_data, sk_json);\n";
+      source_ << "  sk_json.finish();\n";
+      source_ << "  if (!sk_ok) sk_out.resize(sk_begin);\n";
+      source_ << "  return sk_ok;\n";
+      source_ << "}\n\n";
+      source_ << inline_specifier() << "bool " << name
+              << "::transcode_to_json(std::span<const uint8_t> sk_data,\n";
+      source_ << "    detail::JsonOut& sk_out) {\n";
+      source_ << "  return detail::" << name
+              << "_transcode_json(sk_data, sk_out);\n";
+      source_ << "}\n\n";
+    }
+  }
+}
+
+void CodeGenerator::generate_transcode_declarations() {
+  header_ << "  // Appends the JSON of an encoded message, read straight from "
+             "its wire\n";
+  header_ << "  // bytes. Members come in wire order.\n";
+  header_ << "  static bool transcode_to_json(std::span<const uint8_t> data,\n";
+  header_ << "                                std::string& out);\n";
+  header_ << "  static bool transcode_to_json(std::span<const uint8_t> data,\n";
+  header_ << "                                detail::JsonOut& out);\n";
+  header_ << "  // Writes the JSON into `sk_writer` as the input is read. On "
+             "failure the\n";
+  header_ << "  // writer may already hold the start of the document.\n";
+  header_ << "  template <typename Writer>\n";
+  header_ << "  static bool transcode_to_json(std::span<const uint8_t> "
+             "sk_data, Writer& sk_writer) {\n";
+  header_ << "    detail::JsonOut sk_out(sk_writer);\n";
+  header_ << "    bool sk_ok = transcode_to_json(sk_data, sk_out);\n";
+  header_ << "    sk_out.finish();\n";
+  header_ << "    return sk_ok;\n";
+  header_ << "  }\n\n";
+}
+
+void CodeGenerator::generate_json_transcoder(const ModelDecl &model) {
+  const std::string &name = model.name;
+  bool has_arrays = std::any_of(
+      model.fields.begin(), model.fields.end(),
+      [](const auto &field) { return field->is_repeated(); });
+
+  bool all_optional = std::all_of(
+      model.fields.begin(), model.fields.end(),
+      [](const auto &field) { return field->is_optional(); });
+
+  if (has_arrays) {
+    generate_json_runs_split(model);
+  }
+
+  source_ << "inline bool " << name
+          << "_transcode_json(std::span<const uint8_t> data,\n";
+  source_ << "    JsonOut& sk_out) {\n";
+  // The decoded fallback needs the message with its trailer.
+  std::string message = "data";
+  if (model.checksummed) {
+    if (has_arrays) {
+      message = "message";
+      source_ << "  std::span<const uint8_t> message = data;\n";
+    }
+    source_ << "  if (!verify_crc32c(data)) return false;\n";
+  }
+  if (has_arrays) {
+    // Output is never taken back, so a split field is found up front.
+    source_ << "  // Merging the runs of a split repeated field needs the "
+               "decoded message.\n";
+    source_ << "  if (" << name << "_runs_split(data)) {\n";
+    source_ << "    return json_transcode_decoded<" << name << ">(" << message
+            << ", sk_out);\n";
+    source_ << "  }\n";
+  }
+  if (!all_optional) {
+    source_ << "  bool seen[" << model.fields.size() << "] = {};\n";
+  }
+  if (has_arrays) {
+    // Adjacent tags of a repeated field are collected into one array.
+    source_ << "  uint32_t open = 0;\n";
+    source_ << "  size_t items = 0;\n";
+  }
+  source_ << "  bool more = false;\n";
+  source_ << "  sk_out += '{';\n";
+  source_ << "  size_t pos = 0;\n";
+  source_ << "  while (pos < data.size()) {\n";
+  source_ << "    uint64_t tag = 0;\n";
+  source_ << "    if (!parse_varint(data, pos, tag)) return false;\n";
+  source_ << "    uint32_t field_number = static_cast<uint32_t>(tag >> 3);\n";
+  source_ << "    uint8_t wire_type = static_cast<uint8_t>(tag & 0x7);\n";
+  if (has_arrays) {
+    source_ << "    if (open != 0 && open != field_number) {\n";
+    source_ << "      sk_out += ']';\n";
+    source_ << "      open = 0;\n";
+    source_ << "    }\n";
+  }
+  source_ << "    switch (field_number) {\n";
+  for (size_t i = 0; i < model.fields.size(); ++i) {
+    const Field &field = *model.fields[i];
+    std::string key = "\"\\\"" + field.name + "\\\":";
+    source_ << "    case " << field.number << ": {\n";
+    if (field.is_repeated()) {
+      source_ << "      if (open != " << field.number << ") {\n";
+      source_ << "        json_key(sk_out, more, " << key << "[\");\n";
+      source_ << "        items = 0;\n";
+      source_ << "        open = " << field.number << ";\n";
+      source_ << "      }\n";
+    } else {
+      source_ << "      json_key(sk_out, more, " << key << "\");\n";
+    }
+    if (!field.is_optional()) {
+      source_ << "      seen[" << i << "] = true;\n";
+    }
+    generate_json_transcode_value(field, "      ");
+    source_ << "      break;\n";
+    source_ << "    }\n";
+  }
+  source_ << "    default:\n";
+  source_ << "      skip_wire_value(data, pos, wire_type);\n";
+  source_ << "      break;\n";
+  source_ << "    }\n";
+  source_ << "  }\n";
+  if (has_arrays) {
+    source_ << "  if (open != 0) sk_out += ']';\n";
+  }
+
+  // Fields missing from the wire keep their defaults, as in deserialize().
+  for (size_t i = 0; i < model.fields.size(); ++i) {
+    const Field &field = *model.fields[i];
+    if (field.is_optional()) {
+      continue;
+    }
+    std::string key = "\"\\\"" + field.name + "\\\":";
+    source_ << "  if (!seen[" << i << "]) {\n";
+    if (field.is_repeated()) {
+      source_ << "    json_key(sk_out, more, " << key << "[]\");\n";
+    } else {
+      source_ << "    json_key(sk_out, more, " << key << "\");\n";
+      generate_json_value_writer(*field.type,
+                                 get_cpp_type(*field.type) + "()", "    ");
+    }
+    source_ << "  }\n";
+  }
+  source_ << "  sk_out += '}';\n";
+  source_ << "  return true;\n";
+  source_ << "}\n\n";
+}
+
+// Emits <Model>_runs_split(), which tells whether a repeated field comes
+// in more than one run, split by other fields. Only tags and lengths are
+// read.
+void CodeGenerator::generate_json_runs_split(const ModelDecl &model) {
+  source_ << "inline bool " << model.name
+          << "_runs_split(std::span<const uint8_t> data) {\n";
+  source_ << "  bool seen[" << model.fields.size() << "] = {};\n";
+  source_ << "  uint32_t open = 0;\n";
+  source_ << "  size_t pos = 0;\n";
+  source_ << "  while (pos < data.size()) {\n";
+  source_ << "    uint64_t tag = 0;\n";
+  source_ << "    uint64_t value = 0;\n";
+  source_ << "    if (!parse_varint(data, pos, tag)) return false;\n";
+  source_ << "    uint32_t field_number = static_cast<uint32_t>(tag >> 3);\n";
+  source_ << "    switch (field_number) {\n";
+  for (size_t i = 0; i < model.fields.size(); ++i) {
+    const Field &field = *model.fields[i];
+    source_ << "    case " << field.number << ":\n";
+    if (field.is_repeated()) {
+      source_ << "      if (open != " << field.number << ") {\n";
+      source_ << "        if (seen[" << i << "]) return true;\n";
+      source_ << "        seen[" << i << "] = true;\n";
+      source_ << "        open = " << field.number << ";\n";
+      source_ << "      }\n";
+    } else {
+      source_ << "      open = 0;\n";
+    }
+    if (is_length_delimited(field)) {
+      source_ << "      if (!parse_varint(data, pos, value) || value > "
+                 "data.size() - pos) {\n";
+      source_ << "        return false;\n";
+      source_ << "      }\n";
+      source_ << "      pos += value;\n";
+    } else {
+      source_ << "      if (!parse_varint(data, pos, value)) return false;\n";
+    }
+    source_ << "      break;\n";
+  }
+  source_ << "    default:\n";
+  source_ << "      open = 0;\n";
+  source_ << "      skip_wire_value(data, pos, static_cast<uint8_t>(tag & "
+             "0x7));\n";
+  source_ << "      break;\n";
+  source_ << "    }\n";
+  source_ << "  }\n";
+  source_ << "  return false;\n";
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_json_transcode_value(const Field &field,
+                                                  const std::string &indent) {
+  auto *prim = dynamic_cast<const PrimitiveType *>(field.type.get());
+  std::string type = get_cpp_type(*field.type);
+  std::string separator =
+      field.is_repeated() ? indent + "if (items++ != 0) sk_out += ',';\n"
+                          : "";
+
+  if (!is_length_delimited(field)) {
+    source_ << indent << "uint64_t value = 0;\n";
+    source_ << indent << "if (!parse_varint(data, pos, value)) return false;\n";
+    source_ << separator;
+    generate_json_value_writer(*field.type,
+                               "static_cast<" + type + ">(value)", indent);
+    return;
+  }
+
+  source_ << indent << "uint64_t length = 0;\n";
+  source_ << indent << "if (!parse_varint(data, pos, length) || length > "
+                       "data.size() - pos) {\n";
+  source_ << indent << "  return false;\n";
+  source_ << indent << "}\n";
+  source_ << indent << "std::span<const uint8_t> value = data.subspan(pos, "
+                       "length);\n";
+  source_ << indent << "pos += length;\n";
+
+  if (field.is_columnar()) {
+    // Rows are only complete once every column is read.
+    source_ << indent << "std::vector<" << type << "> rows;\n";
+    source_ << indent << "if (!" << type
+            << "_read_columns(value, rows)) return false;\n";
+    source_ << indent << "for (const auto& row : rows) {\n";
+    source_ << indent << "  if (items++ != 0) sk_out += ',';\n";
+    source_ << indent << "  row.append_json(sk_out);\n";
+    source_ << indent << "}\n";
+  } else if (field.is_repeated() && is_struct_type(*field.type)) {
+    source_ << indent << "if (length % " << type
+            << "::WIRE_SIZE != 0) return false;\n";
+    source_ << indent << "for (const uint8_t* in = value.data(); in != "
+                         "value.data() + length;) {\n";
+    source_ << indent << "  " << type << " item;\n";
+    source_ << indent << "  in = item.deserialize_from(in);\n";
+    source_ << indent << "  if (items++ != 0) sk_out += ',';\n";
+    source_ << indent << "  item.append_json(sk_out);\n";
+    source_ << indent << "}\n";
+  } else if (field.is_packed() && is_packable(prim)) {
+    if (prim->kind == PrimitiveTypeKind::FLOAT ||
+        prim->kind == PrimitiveTypeKind::DOUBLE) {
+      bool is_float = prim->kind == PrimitiveTypeKind::FLOAT;
+      std::string bits_type = is_float ? "uint32_t" : "uint64_t";
+      int width = is_float ? 4 : 8;
+      source_ << indent << "if (length % " << width
+              << " != 0) return false;\n";
+      source_ << indent << "for (size_t i = 0; i < length; i += " << width
+              << ") {\n";
+      source_ << indent << "  " << bits_type << " bits = 0;\n";
+      source_ << indent << "  for (int j = 0; j < " << width << "; ++j) {\n";
+      source_ << indent << "    bits |= static_cast<" << bits_type
+              << ">(value[i + j]) << (j * 8);\n";
+      source_ << indent << "  }\n";
+      source_ << indent << "  " << type << " item;\n";
+      source_ << indent << "  std::memcpy(&item, &bits, sizeof(item));\n";
+      source_ << indent << "  if (items++ != 0) sk_out += ',';\n";
+      source_ << indent << "  json_write_number(sk_out, item);\n";
+      source_ << indent << "}\n";
+    } else {
+      source_ << indent << "for (size_t i = 0; i < length;) {\n";
+      source_ << indent << "  uint64_t item = 0;\n";
+      source_ << indent << "  if (!parse_varint(value, i, item)) return "
+                           "false;\n";
+      source_ << indent << "  if (items++ != 0) sk_out += ',';\n";
+      generate_json_value_writer(*field.type,
+                                 "static_cast<" + type + ">(item)",
+                                 indent + "  ");
+      source_ << indent << "}\n";
+    }
+  } else if (prim) {
+    // String bytes are escaped straight from the input.
+    if (is_utf8_field(field)) {
+      source_ << indent << "std::string_view text(\n";
+      source_ << indent << "    reinterpret_cast<const char*>(value.data()), "
+                           "length);\n";
+      source_ << indent << "if (!utf8_valid(text)) return false;\n";
+      source_ << separator;
+      source_ << indent << "json_write_string(sk_out, text);\n";
+    } else {
+      source_ << separator;
+      source_ << indent << "json_write_string(sk_out, std::string_view("
+                           "reinterpret_cast<const char*>(value.data()), "
+                           "length));\n";
+    }
+  } else if (is_struct_type(*field.type)) {
+    source_ << indent << type << " item;\n";
+    source_ << indent << "if (!item.deserialize(value)) return false;\n";
+    source_ << separator;
+    source_ << indent << "item.append_json(sk_out);\n";
+  } else {
+    source_ << separator;
+    source_ << indent << "if (!" << type
+            << "_transcode_json(value, sk_out)) return false;\n";
+  }
+}
+
+void CodeGenerator::generate_json_enum(const EnumDecl &enum_decl) {
+  const std::string &name = enum_decl.name;
+
+  source_ << "inline void " << name << "_write_json(JsonOut& out, " << name
+          << " value) {\n";
+  source_ << "  switch (value) {\n";
+  for (const auto &value : enum_decl.values) {
+    source_ << "  case " << name << "::" << value->name << ":\n";
+    source_ << "    out += \"\\\"" << value->name << "\\\"\";\n";
+    source_ << "    return;\n";
+  }
+  source_ << "  }\n";
+  source_ << "  json_write_number(out, static_cast<int32_t>(value));\n";
+  source_ << "}\n\n";
+
+  // Enumerators are read by name, or by number for values written by a
+  // newer schema.
+  source_ << "inline bool " << name << "_parse_json(JsonParser& parser, "
+          << name << "& value) {\n";
+  source_ << "  if (!parser.peek('\"')) {\n";
+  source_ << "    int32_t number = 0;\n";
+  source_ << "    if (!parser.parse_number(number)) return false;\n";
+  source_ << "    value = static_cast<" << name << ">(number);\n";
+  source_ << "    return true;\n";
+  source_ << "  }\n";
+  source_ << "  std::string_view key;\n";
+  source_ << "  uint64_t hash = 0;\n";
+  source_ << "  if (!parser.parse_name(key, hash)) return false;\n";
+  std::vector<std::pair<std::string, std::string>> cases;
+  for (const auto &value : enum_decl.values) {
+    cases.emplace_back(value->name,
+                       "(value = " + name + "::" + value->name + ", true)");
+  }
+  generate_json_name_switch(cases, "  ");
+  source_ << "  return false;\n";
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_json_parser(
+    const std::string &name,
+    const std::vector<std::unique_ptr<Field>> &fields) {
+  source_ << "inline bool " << name << "_parse_json(JsonParser& parser, "
+          << name << "& message) {\n";
+  source_ << "  return parser.parse_object([&](std::string_view key, uint64_t "
+             "hash) {\n";
+  std::vector<std::pair<std::string, std::string>> cases;
+  for (const auto &field : fields) {
+    std::string target = "message." + field->name;
+    std::string parse;
+    if (field->is_repeated()) {
+      parse = "parser.parse_array(" + target + ", [&](auto& value) { return " +
+              get_json_value_parser(*field->type, "value") + "; })";
+    } else if (field->is_optional()) {
+      parse = "parser.parse_optional(" + target +
+              ", [&](auto& value) { return " +
+              get_json_value_parser(*field->type, "value") + "; })";
+    } else {
+      parse = get_json_value_parser(*field->type, target);
+    }
+    cases.emplace_back(field->name, parse);
+  }
+  generate_json_name_switch(cases, "    ");
+  source_ << "    return parser.skip_value();\n";
+  source_ << "  });\n";
+  source_ << "}\n\n";
+}
+
+// Emits a switch on `hash` that returns `result` for the entry whose name
+// equals `key`; names with colliding hashes share a case.
+void CodeGenerator::generate_json_name_switch(
+    const std::vector<std::pair<std::string, std::string>> &entries,
+    const std::string &indent) {
+  std::vector<std::pair<uint64_t, size_t>> hashes;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    hashes.emplace_back(get_json_hash(entries[i].first), i);
+  }
+  std::sort(hashes.begin(), hashes.end());
+
+  source_ << indent << "switch (hash) {\n";
+  for (size_t i = 0; i < hashes.size(); ++i) {
+    if (i == 0 || hashes[i].first != hashes[i - 1].first) {
+      std::ostringstream label;
+      label << "0x" << std::hex << hashes[i].first << "ull";
+      source_ << indent << "case " << label.str() << ":\n";
+    }
+    const auto &[name, result] = entries[hashes[i].second];
+    source_ << indent << "  if (key == \"" << name << "\") return " << result
+            << ";\n";
+    if (i + 1 == hashes.size() || hashes[i + 1].first != hashes[i].first) {
+      source_ << indent << "  break;\n";
+    }
+  }
+  source_ << indent << "}\n";
+}
+
+void CodeGenerator::generate_json_methods(
+    const std::string &name,
+    const std::vector<std::unique_ptr<Field>> &fields) {
+  std::string specifier = inline_specifier();
+
+  source_ << specifier << "void " << name
+          << "::append_json(std::string& sk_out) const {\n";
+  source_ << "  detail::JsonOut sk_json(sk_out);\n";
+  source_ << "  append_json(sk_json);\n";
+  source_ << "  sk_json.finish();\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "void " << name
+          << "::append_json(detail::JsonOut& sk_out) const {\n";
+  source_ << "  sk_out += '{';\n";
+  // A comma is due before every member but the first. Once a field that is
+  // always written has been, that is known here; until then it depends on
+  // which optional fields are present.
+  bool written = false;
+  if (fields.size() > 1 && fields.front()->is_optional()) {
+    source_ << "  bool sk_more = false;\n";
+  }
+  for (size_t i = 0; i < fields.size(); ++i) {
+    const Field &field = *fields[i];
+    const std::string &field_name = field.name;
+    std::string key = "\"" + std::string(written ? "," : "") + "\\\"" +
+                      field_name + "\\\":";
+    std::string comma = !written && i != 0 ? "if (sk_more) sk_out += ',';\n"
+                                           : "";
+    if (field.is_optional()) {
+      source_ << "  if (" << field_name << ".has_value()) {\n";
+      if (!comma.empty()) {
+        source_ << "    " << comma;
+      }
+      if (!written && i + 1 < fields.size()) {
+        source_ << "    sk_more = true;\n";
+      }
+      source_ << "    sk_out += " << key << "\";\n";
+      generate_json_value_writer(*field.type, "(*" + field_name + ")",
+                                 "    ");
+      source_ << "  }\n";
+      continue;
+    }
+    if (!comma.empty()) {
+      source_ << "  " << comma;
+    }
+    written = true;
+    if (field.is_repeated()) {
+      source_ << "  sk_out += " << key << "[\";\n";
+      source_ << "  for (size_t sk_i = 0; sk_i < " << field_name
+              << ".size(); ++sk_i) {\n";
+      source_ << "    if (sk_i != 0) sk_out += ',';\n";
+      generate_json_value_writer(*field.type, field_name + "[sk_i]", "    ");
+      source_ << "  }\n";
+      source_ << "  sk_out += ']';\n";
+    } else {
+      source_ << "  sk_out += " << key << "\";\n";
+      generate_json_value_writer(*field.type, field_name, "  ");
+    }
+  }
+  source_ << "  sk_out += '}';\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "std::string " << name << "::to_json() const {\n";
+  source_ << "  std::string sk_out;\n";
+  source_ << "  append_json(sk_out);\n";
+  source_ << "  return sk_out;\n";
+  source_ << "}\n\n";
+
+  source_ << specifier << "bool " << name
+          << "::from_json(std::string_view sk_json) {\n";
+  source_ << "  detail::JsonParser sk_parser(sk_json);\n";
+  source_ << "  if (!detail::" << name
+          << "_parse_json(sk_parser, *this)) return false;\n";
+  source_ << "  sk_parser.skip_space();\n";
+  source_ << "  return sk_parser.pos == sk_json.size();\n";
+  source_ << "}\n\n";
+}
+
+void CodeGenerator::generate_json_value_writer(const Type &type,
+                                               const std::string &value,
+                                               const std::string &indent) {
+  auto *prim = dynamic_cast<const PrimitiveType *>(&type);
+  if (prim && prim->kind == PrimitiveTypeKind::STRING) {
+    source_ << indent << "detail::json_write_string(sk_out, " << value
+            << ");\n";
+  } else if (prim && prim->kind == PrimitiveTypeKind::BOOL) {
+    source_ << indent << "sk_out += " << value << " ? \"true\" : \"false\";\n";
+  } else if (prim) {
+    source_ << indent << "detail::json_write_number(sk_out, " << value
+            << ");\n";
+  } else if (is_enum_type(type)) {
+    source_ << indent << "detail::" << get_cpp_type(type)
+            << "_write_json(sk_out, " << value << ");\n";
+  } else {
+    source_ << indent << value << ".append_json(sk_out);\n";
+  }
+}
+
+std::string
+CodeGenerator::get_json_value_parser(const Type &type,
+                                     const std::string &target) const {
+  auto *prim = dynamic_cast<const PrimitiveType *>(&type);
+  if (prim && prim->kind == PrimitiveTypeKind::STRING) {
+    return "parser.parse_string(" + target + ")";
+  } else if (prim && prim->kind == PrimitiveTypeKind::BOOL) {
+    return "parser.parse_bool(" + target + ")";
+  } else if (prim) {
+    return "parser.parse_number(" + target + ")";
+  }
+  return get_cpp_type(type) + "_parse_json(parser, " + target + ")";
+}
+
+// FNV-1a, matching json_hash() in the generated code.
+uint64_t CodeGenerator::get_json_hash(const std::string &name) const {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : name) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+void CodeGenerator::generate_tag(uint32_t tag, const std::string &indent) {
+  do {
+    uint32_t byte = tag & 0x7F;
+    tag >>= 7;
+    if (tag != 0) {
+      byte |= 0x80;
+    }
+    source_ << indent << "*sk_out++ = 0x" << std::hex << std::uppercase
+            << (byte < 0x10 ? "0" : "") << byte << std::dec
+            << std::nouppercase << ";\n";
+  } while (tag != 0);
+}
+
+void CodeGenerator::generate_value_serializer(const Field &field,
+                                              const std::string &value,
+                                              const std::string &indent) {
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+
+  if (prim_type && prim_type->kind == PrimitiveTypeKind::STRING) {
+    source_ << indent << "sk_out = detail::write_varint(sk_out, " << value
+            << ".size());\n";
+    source_ << indent << "std::memcpy(sk_out, " << value << ".data(), " << value
+            << ".size());\n";
+    source_ << indent << "sk_out += " << value << ".size();\n";
+  } else if (prim_type && prim_type->kind == PrimitiveTypeKind::BOOL) {
+    source_ << indent << "*sk_out++ = " << value << " ? 1 : 0;\n";
+  } else if (prim_type || is_enum_type(*field.type)) {
+    source_ << indent
+            << "sk_out = detail::write_varint(sk_out, static_cast<uint64_t>("
+            << value << "));\n";
+  } else {
+    source_ << indent << "sk_out = detail::write_varint(sk_out, " << value
+            << ".byte_size());\n";
+    source_ << indent << "sk_out = " << value << ".serialize_to(sk_out);\n";
+  }
+}
+
+std::string CodeGenerator::get_value_size(const Field &field,
+                                          const std::string &value) const {
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+
+  if (prim_type && prim_type->kind == PrimitiveTypeKind::STRING) {
+    return "detail::length_delimited_size(" + value + ".size())";
+  } else if (prim_type && prim_type->kind == PrimitiveTypeKind::BOOL) {
+    return "1";
+  } else if (prim_type || is_enum_type(*field.type)) {
+    return "detail::varint_size(static_cast<uint64_t>(" + value + "))";
+  }
+  return "detail::length_delimited_size(" + value + ".byte_size())";
+}
+
+void CodeGenerator::generate_field_serializer(const Field &field,
+                                              const std::string &indent) {
+  uint8_t wire_type = get_wire_type_value(*field.type, field);
+  uint32_t tag = (field.number << 3) | wire_type;
+
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+
+  if (field.is_repeated() && field.is_packed() && is_packable(prim_type)) {
+    source_ << indent << "if (!" << field.name << ".empty()) {\n";
+    generate_tag((field.number << 3) | 2, indent + "  ");
+
+    if (prim_type->kind == PrimitiveTypeKind::FLOAT ||
+        prim_type->kind == PrimitiveTypeKind::DOUBLE) {
+      bool is_float = prim_type->kind == PrimitiveTypeKind::FLOAT;
+      std::string bits_type = is_float ? "uint32_t" : "uint64_t";
+      int width = is_float ? 4 : 8;
+
+      source_ << indent << "  sk_out = detail::write_varint(sk_out, "
+              << field.name << ".size() * " << width << ");\n";
+      source_ << indent << "  for (" << get_cpp_type(*field.type)
+              << " sk_item : " << field.name << ") {\n";
+      source_ << indent << "    " << bits_type << " sk_bits;\n";
+      source_ << indent << "    std::memcpy(&sk_bits, &sk_item, "
+                           "sizeof(sk_bits));\n";
+      source_ << indent << "    for (int sk_i = 0; sk_i < " << width
+              << "; ++sk_i) {\n";
+      source_ << indent
+              << "      *sk_out++ = static_cast<uint8_t>((sk_bits >> (sk_i * "
+                 "8)) & 0xFF);\n";
+      source_ << indent << "    }\n";
+      source_ << indent << "  }\n";
+    } else {
+      source_ << indent << "  size_t sk_packed_size = 0;\n";
+      source_ << indent << "  for (const auto& sk_item : " << field.name
+              << ") {\n";
+      source_ << indent
+              << "    sk_packed_size += "
+                 "detail::varint_size(static_cast<uint64_t>(sk_item));\n";
+      source_ << indent << "  }\n";
+      source_ << indent << "  sk_out = detail::write_varint(sk_out, "
+                           "sk_packed_size);\n";
+      source_ << indent << "  for (const auto& sk_item : " << field.name
+              << ") {\n";
+      source_ << indent
+              << "    sk_out = detail::write_varint(sk_out, "
+                 "static_cast<uint64_t>(sk_item));\n";
+      source_ << indent << "  }\n";
+    }
+
+    source_ << indent << "}\n\n";
+  } else if (field.is_columnar()) {
+    source_ << indent << "if (!" << field.name << ".empty()) {\n";
+    generate_tag(tag, indent + "  ");
+    source_ << indent << "  sk_out = detail::" << get_cpp_type(*field.type)
+            << "_write_columns(sk_out, " << field.name << ");\n";
+    source_ << indent << "}\n\n";
+  } else if (field.is_repeated() && is_struct_type(*field.type)) {
+    // One length-delimited run holding every element back to back.
+    std::string type = get_cpp_type(*field.type);
+    source_ << indent << "if (!" << field.name << ".empty()) {\n";
+    generate_tag(tag, indent + "  ");
+    source_ << indent << "  size_t sk_length = " << field.name << ".size() * "
+            << type << "::WIRE_SIZE;\n";
+    source_ << indent
+            << "  sk_out = detail::write_varint(sk_out, sk_length);\n";
+    source_ << indent << "  if constexpr (detail::has_wire_layout<" << type
+            << ">()) {\n";
+    source_ << indent << "    std::memcpy(sk_out, " << field.name
+            << ".data(), sk_length);\n";
+    source_ << indent << "    sk_out += sk_length;\n";
+    source_ << indent << "  } else {\n";
+    source_ << indent << "    for (const auto& sk_item : " << field.name
+            << ") {\n";
+    source_ << indent << "      sk_out = sk_item.serialize_to(sk_out);\n";
+    source_ << indent << "    }\n";
+    source_ << indent << "  }\n";
+    source_ << indent << "}\n\n";
+  } else if (field.is_repeated()) {
+    source_ << indent << "for (const auto& sk_item : " << field.name << ") {\n";
+    generate_tag(tag, indent + "  ");
+    generate_value_serializer(field, "sk_item", indent + "  ");
+    source_ << indent << "}\n\n";
+  } else if (field.is_optional()) {
+    source_ << indent << "if (" << field.name << ".has_value()) {\n";
+    source_ << indent << "  const auto& sk_value = *" << field.name << ";\n";
+    generate_tag(tag, indent + "  ");
+    generate_value_serializer(field, "sk_value", indent + "  ");
+    source_ << indent << "}\n\n";
+  } else {
+    generate_tag(tag, indent);
+    generate_value_serializer(field, field.name, indent);
+    source_ << "\n";
+  }
+}
+
+void CodeGenerator::generate_field_iov(const Field &field,
+                                      const std::string &indent) {
+  uint8_t wire_type = get_wire_type_value(*field.type, field);
+  uint32_t tag = (field.number << 3) | wire_type;
+  size_t tag_size = get_varint_size(tag);
+
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+  bool is_string = prim_type && prim_type->kind == PrimitiveTypeKind::STRING;
+
+  std::string value = field.name;
+  std::string inner = indent;
+  if (field.is_repeated()) {
+    source_ << indent << "for (const auto& sk_item : " << field.name << ") {\n";
+    value = "sk_item";
+    inner += "  ";
+  } else if (field.is_optional()) {
+    source_ << indent << "if (" << field.name << ".has_value()) {\n";
+    value = "(*" + field.name + ")";
+    inner += "  ";
+  }
+
+  if (is_string) {
+    source_ << inner << "{\n";
+    source_ << inner << "  uint8_t* sk_out = detail::append_space(sk_scratch, "
+            << tag_size << ");\n";
+    generate_tag(tag, inner + "  ");
+    source_ << inner << "}\n";
+    source_ << inner << "detail::append_string_iov(sk_scratch, sk_references, "
+                        "sk_threshold, "
+            << value << ");\n";
+  } else {
+    source_ << inner << "{\n";
+    source_ << inner << "  size_t sk_nested_size = " << value
+            << ".byte_size();\n";
+    source_ << inner << "  uint8_t* sk_out = detail::append_space(sk_scratch, "
+            << tag_size << " + detail::varint_size(sk_nested_size));\n";
+    generate_tag(tag, inner + "  ");
+    source_ << inner << "  detail::write_varint(sk_out, sk_nested_size);\n";
+    source_ << inner << "}\n";
+    source_ << inner << value
+            << ".serialize_iov(sk_scratch, sk_references, sk_threshold);\n";
+  }
+
+  if (inner != indent) {
+    source_ << indent << "}\n";
+  }
+  source_ << "\n";
+}
+
+bool CodeGenerator::is_iov_reference_field(const Field &field) const {
+  if (field.is_columnar()) {
+    return false;
+  }
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+  if (prim_type) {
+    return prim_type->kind == PrimitiveTypeKind::STRING;
+  }
+  return !is_enum_type(*field.type) && !is_struct_type(*field.type);
+}
 
-      source_ << indent << "  std::vector<uint8_t> packed_data;\n";
-      source_ << indent << "  for (const auto& item : " << field.name
-              << ") {\n";
+void CodeGenerator::generate_field_size(const Field &field,
+                                        const std::string &indent) {
+  uint8_t wire_type = get_wire_type_value(*field.type, field);
+  uint32_t tag = (field.number << 3) | wire_type;
+  size_t tag_size = get_varint_size(tag);
 
-      if (prim_type->kind == PrimitiveTypeKind::INT8 ||
-          prim_type->kind == PrimitiveTypeKind::INT16 ||
-          prim_type->kind == PrimitiveTypeKind::INT32 ||
-          prim_type->kind == PrimitiveTypeKind::INT64 ||
-          prim_type->kind == PrimitiveTypeKind::UINT8 ||
-          prim_type->kind == PrimitiveTypeKind::UINT16 ||
-          prim_type->kind == PrimitiveTypeKind::UINT32 ||
-          prim_type->kind == PrimitiveTypeKind::UINT64) {
-        source_ << indent
-                << "    uint64_t val = static_cast<uint64_t>(item);\n";
-        source_ << indent << "    while (val > 0x7F) {\n";
-        source_ << indent
-                << "      packed_data.push_back(static_cast<uint8_t>((val & "
-                   "0x7F) | 0x80));\n";
-        source_ << indent << "      val >>= 7;\n";
-        source_ << indent << "    }\n";
-        source_ << indent
-                << "    packed_data.push_back(static_cast<uint8_t>(val));\n";
-      } else if (prim_type->kind == PrimitiveTypeKind::FLOAT) {
-        source_ << indent << "    float fval = item;\n";
-        source_ << indent << "    uint32_t val;\n";
-        source_ << indent << "    std::memcpy(&val, &fval, sizeof(float));\n";
-        source_
-            << indent
-            << "    packed_data.push_back(static_cast<uint8_t>(val & 0xFF));\n";
-        source_ << indent
-                << "    packed_data.push_back(static_cast<uint8_t>((val >> 8) "
-                   "& 0xFF));\n";
-        source_ << indent
-                << "    packed_data.push_back(static_cast<uint8_t>((val >> 16) "
-                   "& 0xFF));\n";
-        source_ << indent
-                << "    packed_data.push_back(static_cast<uint8_t>((val >> 24) "
-                   "& 0xFF));\n";
-      } else if (prim_type->kind == PrimitiveTypeKind::DOUBLE) {
-        source_ << indent << "    double dval = item;\n";
-        source_ << indent << "    uint64_t val;\n";
-        source_ << indent << "    std::memcpy(&val, &dval, sizeof(double));\n";
-        source_ << indent << "    for (int i = 0; i < 8; ++i) {\n";
-        source_ << indent
-                << "      packed_data.push_back(static_cast<uint8_t>((val >> "
-                   "(i * 8)) & 0xFF));\n";
-        source_ << indent << "    }\n";
-      }
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
 
-      source_ << indent << "  }\n\n";
+  if (field.is_repeated() && field.is_packed() && is_packable(prim_type)) {
+    source_ << indent << "if (!" << field.name << ".empty()) {\n";
 
-      source_ << indent << "  uint64_t length = packed_data.size();\n";
-      source_ << indent << "  while (length > 0x7F) {\n";
-      source_ << indent
-              << "    buffer.push_back(static_cast<uint8_t>((length & 0x7F) | "
-                 "0x80));\n";
-      source_ << indent << "    length >>= 7;\n";
-      source_ << indent << "  }\n";
-      source_ << indent
-              << "  buffer.push_back(static_cast<uint8_t>(length));\n";
-      source_ << indent
-              << "  buffer.insert(buffer.end(), packed_data.begin(), "
-                 "packed_data.end());\n";
+    if (prim_type->kind == PrimitiveTypeKind::FLOAT) {
+      source_ << indent << "  size_t sk_packed_size = " << field.name
+              << ".size() * 4;\n";
+    } else if (prim_type->kind == PrimitiveTypeKind::DOUBLE) {
+      source_ << indent << "  size_t sk_packed_size = " << field.name
+              << ".size() * 8;\n";
     } else {
-      source_ << indent << "  for (const auto& item : " << field.name
+      source_ << indent << "  size_t sk_packed_size = 0;\n";
+      source_ << indent << "  for (const auto& sk_item : " << field.name
               << ") {\n";
-      source_ << indent << "    uint32_t item_tag = " << tag << ";\n";
-      source_ << indent << "    {\n";
-      source_ << indent << "      uint64_t val = item_tag;\n";
-      source_ << indent << "      while (val > 0x7F) {\n";
-      source_ << indent
-              << "        buffer.push_back(static_cast<uint8_t>((val & 0x7F) | "
-                 "0x80));\n";
-      source_ << indent << "        val >>= 7;\n";
-      source_ << indent << "      }\n";
       source_ << indent
-              << "      buffer.push_back(static_cast<uint8_t>(val));\n";
-      source_ << indent << "    }\n";
-
-      if (prim_type) {
-        if (prim_type->kind == PrimitiveTypeKind::STRING) {
-          source_ << indent << "    uint64_t length = item.size();\n";
-          source_ << indent << "    while (length > 0x7F) {\n";
-          source_ << indent
-                  << "      buffer.push_back(static_cast<uint8_t>((length & "
-                     "0x7F) | 0x80));\n";
-          source_ << indent << "      length >>= 7;\n";
-          source_ << indent << "    }\n";
-          source_ << indent
-                  << "    buffer.push_back(static_cast<uint8_t>(length));\n";
-          source_
-              << indent
-              << "    buffer.insert(buffer.end(), item.begin(), item.end());\n";
-        } else {
-          source_ << indent
-                  << "    uint64_t val = static_cast<uint64_t>(item);\n";
-          source_ << indent << "    while (val > 0x7F) {\n";
-          source_ << indent
-                  << "      buffer.push_back(static_cast<uint8_t>((val & 0x7F) "
-                     "| 0x80));\n";
-          source_ << indent << "      val >>= 7;\n";
-          source_ << indent << "    }\n";
-          source_ << indent
-                  << "    buffer.push_back(static_cast<uint8_t>(val));\n";
-        }
-      } else {
-        // Check if this is an enum type
-        auto *user_type = dynamic_cast<const UserType *>(field.type.get());
-        if (user_type && schema_.find_enum(user_type->name)) {
-          // Serialize enum as integer
-          source_ << indent
-                  << "    uint64_t val = static_cast<uint64_t>(item);\n";
-          source_ << indent << "    while (val > 0x7F) {\n";
-          source_ << indent
-                  << "      buffer.push_back(static_cast<uint8_t>((val & 0x7F) "
-                     "| 0x80));\n";
-          source_ << indent << "      val >>= 7;\n";
-          source_ << indent << "    }\n";
-          source_ << indent
-                  << "    buffer.push_back(static_cast<uint8_t>(val));\n";
-        } else {
-          source_ << indent << "    auto item_data = item.serialize();\n";
-          source_ << indent << "    uint64_t length = item_data.size();\n";
-          source_ << indent << "    while (length > 0x7F) {\n";
-          source_ << indent
-                  << "      buffer.push_back(static_cast<uint8_t>((length & "
-                     "0x7F) | 0x80));\n";
-          source_ << indent << "      length >>= 7;\n";
-          source_ << indent << "    }\n";
-          source_ << indent
-                  << "    buffer.push_back(static_cast<uint8_t>(length));\n";
-          source_ << indent
-                  << "    buffer.insert(buffer.end(), item_data.begin(), "
-                     "item_data.end());\n";
-        }
-      }
-
+              << "    sk_packed_size += "
+                 "detail::varint_size(static_cast<uint64_t>(sk_item));\n";
       source_ << indent << "  }\n";
     }
 
+    source_ << indent << "  sk_size += "
+            << get_varint_size((field.number << 3) | 2)
+            << " + detail::length_delimited_size(sk_packed_size);\n";
     source_ << indent << "}\n\n";
-  } else if (field.is_optional()) {
-    source_ << indent << "if (" << field.name << ".has_value()) {\n";
-    source_ << indent << "  uint32_t field_tag = " << tag << ";\n";
-    source_ << indent << "  {\n";
-    source_ << indent << "    uint64_t val = field_tag;\n";
-    source_ << indent << "    while (val > 0x7F) {\n";
-    source_ << indent
-            << "      buffer.push_back(static_cast<uint8_t>((val & 0x7F) | "
-               "0x80));\n";
-    source_ << indent << "      val >>= 7;\n";
-    source_ << indent << "    }\n";
-    source_ << indent << "    buffer.push_back(static_cast<uint8_t>(val));\n";
-    source_ << indent << "  }\n";
-
-    if (prim_type) {
-      if (prim_type->kind == PrimitiveTypeKind::STRING) {
-        source_ << indent << "  uint64_t length = " << field.name
-                << "->size();\n";
-        source_ << indent << "  while (length > 0x7F) {\n";
-        source_ << indent
-                << "    buffer.push_back(static_cast<uint8_t>((length & 0x7F) "
-                   "| 0x80));\n";
-        source_ << indent << "    length >>= 7;\n";
-        source_ << indent << "  }\n";
-        source_ << indent
-                << "  buffer.push_back(static_cast<uint8_t>(length));\n";
-        source_ << indent << "  buffer.insert(buffer.end(), " << field.name
-                << "->begin(), " << field.name << "->end());\n";
-      } else {
-        source_ << indent << "  uint64_t val = static_cast<uint64_t>(*"
-                << field.name << ");\n";
-        source_ << indent << "  while (val > 0x7F) {\n";
-        source_ << indent
-                << "    buffer.push_back(static_cast<uint8_t>((val & 0x7F) | "
-                   "0x80));\n";
-        source_ << indent << "    val >>= 7;\n";
-        source_ << indent << "  }\n";
-        source_ << indent << "  buffer.push_back(static_cast<uint8_t>(val));\n";
-      }
+  } else if (field.is_columnar()) {
+    source_ << indent << "if (!" << field.name << ".empty()) {\n";
+    source_ << indent << "  sk_size += " << tag_size
+            << " + detail::length_delimited_size(detail::"
+            << get_cpp_type(*field.type) << "_columns_size(" << field.name
+            << "));\n";
+    source_ << indent << "}\n\n";
+  } else if (field.is_repeated() && is_struct_type(*field.type)) {
+    source_ << indent << "if (!" << field.name << ".empty()) {\n";
+    source_ << indent << "  sk_size += " << tag_size
+            << " + detail::length_delimited_size(" << field.name << ".size() * "
+            << get_cpp_type(*field.type) << "::WIRE_SIZE);\n";
+    source_ << indent << "}\n\n";
+  } else if (field.is_repeated()) {
+    if (prim_type && prim_type->kind == PrimitiveTypeKind::BOOL) {
+      source_ << indent << "sk_size += " << field.name << ".size() * "
+              << (tag_size + 1) << ";\n\n";
     } else {
-      auto *user_type = dynamic_cast<const UserType *>(field.type.get());
-      if (user_type && schema_.find_enum(user_type->name)) {
-        source_ << indent << "  uint64_t val = static_cast<uint64_t>(*"
-                << field.name << ");\n";
-        source_ << indent << "  while (val > 0x7F) {\n";
-        source_ << indent
-                << "    buffer.push_back(static_cast<uint8_t>((val & 0x7F) | "
-                   "0x80));\n";
-        source_ << indent << "    val >>= 7;\n";
-        source_ << indent << "  }\n";
-        source_ << indent << "  buffer.push_back(static_cast<uint8_t>(val));\n";
-      } else {
-        source_ << indent << "  auto field_data = " << field.name
-                << "->serialize();\n";
-        source_ << indent << "  uint64_t length = field_data.size();\n";
-        source_ << indent << "  while (length > 0x7F) {\n";
-        source_
-            << indent
-            << "    buffer.push_back(static_cast<uint8_t>((length & 0x7F) | "
-               "0x80));\n";
-        source_ << indent << "    length >>= 7;\n";
-        source_ << indent << "  }\n";
-        source_ << indent
-                << "  buffer.push_back(static_cast<uint8_t>(length));\n";
-        source_ << indent
-                << "  buffer.insert(buffer.end(), field_data.begin(), "
-                   "field_data.end());\n";
-      }
+      source_ << indent << "for (const auto& sk_item : " << field.name
+              << ") {\n";
+      source_ << indent << "  sk_size += " << tag_size << " + "
+              << get_value_size(field, "sk_item") << ";\n";
+      source_ << indent << "}\n\n";
     }
-
-    source_ << indent << "}\n\n";
-  } else {
-    source_ << indent << "{\n";
-    source_ << indent << "  uint32_t field_tag = " << tag << ";\n";
-    source_ << indent << "  {\n";
-    source_ << indent << "    uint64_t val = field_tag;\n";
-    source_ << indent << "    while (val > 0x7F) {\n";
-    source_ << indent
-            << "      buffer.push_back(static_cast<uint8_t>((val & 0x7F) | "
-               "0x80));\n";
-    source_ << indent << "      val >>= 7;\n";
-    source_ << indent << "    }\n";
-    source_ << indent << "    buffer.push_back(static_cast<uint8_t>(val));\n";
-    source_ << indent << "  }\n";
-
-    if (prim_type) {
-      if (prim_type->kind == PrimitiveTypeKind::STRING) {
-        source_ << indent << "  uint64_t length = " << field.name
-                << ".size();\n";
-        source_ << indent << "  while (length > 0x7F) {\n";
-        source_ << indent
-                << "    buffer.push_back(static_cast<uint8_t>((length & 0x7F) "
-                   "| 0x80));\n";
-        source_ << indent << "    length >>= 7;\n";
-        source_ << indent << "  }\n";
-        source_ << indent
-                << "  buffer.push_back(static_cast<uint8_t>(length));\n";
-        source_ << indent << "  buffer.insert(buffer.end(), " << field.name
-                << ".begin(), " << field.name << ".end());\n";
-      } else if (prim_type->kind == PrimitiveTypeKind::BOOL) {
-        source_ << indent << "  buffer.push_back(" << field.name
-                << " ? 1 : 0);\n";
-      } else {
-        source_ << indent << "  uint64_t val = static_cast<uint64_t>("
-                << field.name << ");\n";
-        source_ << indent << "  while (val > 0x7F) {\n";
-        source_ << indent
-                << "    buffer.push_back(static_cast<uint8_t>((val & 0x7F) | "
-                   "0x80));\n";
-        source_ << indent << "    val >>= 7;\n";
-        source_ << indent << "  }\n";
-        source_ << indent << "  buffer.push_back(static_cast<uint8_t>(val));\n";
-      }
+  } else if (field.is_optional()) {
+    if (prim_type && prim_type->kind == PrimitiveTypeKind::BOOL) {
+      source_ << indent << "if (" << field.name << ".has_value()) sk_size += "
+              << (tag_size + 1) << ";\n\n";
     } else {
-      // Check if this is an enum type
-      auto *user_type = dynamic_cast<const UserType *>(field.type.get());
-      if (user_type && schema_.find_enum(user_type->name)) {
-        // Serialize enum as integer
-        source_ << indent << "  uint64_t val = static_cast<uint64_t>("
-                << field.name << ");\n";
-        source_ << indent << "  while (val > 0x7F) {\n";
-        source_ << indent
-                << "    buffer.push_back(static_cast<uint8_t>((val & 0x7F) | "
-                   "0x80));\n";
-        source_ << indent << "    val >>= 7;\n";
-        source_ << indent << "  }\n";
-        source_ << indent << "  buffer.push_back(static_cast<uint8_t>(val));\n";
-      } else {
-        source_ << indent << "  auto field_data = " << field.name
-                << ".serialize();\n";
-        source_ << indent << "  uint64_t length = field_data.size();\n";
-        source_ << indent << "  while (length > 0x7F) {\n";
-        source_
-            << indent
-            << "    buffer.push_back(static_cast<uint8_t>((length & 0x7F) | "
-               "0x80));\n";
-        source_ << indent << "    length >>= 7;\n";
-        source_ << indent << "  }\n";
-        source_ << indent
-                << "  buffer.push_back(static_cast<uint8_t>(length));\n";
-        source_ << indent
-                << "  buffer.insert(buffer.end(), field_data.begin(), "
-                   "field_data.end());\n";
-      }
+      source_ << indent << "if (" << field.name << ".has_value()) {\n";
+      source_ << indent << "  const auto& sk_value = *" << field.name << ";\n";
+      source_ << indent << "  sk_size += " << tag_size << " + "
+              << get_value_size(field, "sk_value") << ";\n";
+      source_ << indent << "}\n\n";
     }
-
-    source_ << indent << "}\n\n";
+  } else {
+    source_ << indent << "sk_size += " << tag_size << " + "
+            << get_value_size(field, field.name) << ";\n\n";
   }
 }
 
@@ -509,56 +4480,69 @@ void CodeGenerator::generate_field_deserializer(const Field &field,
 
   auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
 
-  if (prim_type) {
+  if (field.is_repeated() && field.is_packed() && is_packable(prim_type)) {
+    generate_packed_deserializer(field, *prim_type, indent);
+  } else if (field.is_repeated() && is_struct_type(*field.type)) {
+    generate_struct_array_deserializer(field, indent);
+  } else if (field.is_columnar()) {
+    generate_varint_read("sk_length", "sk_data", indent);
+    source_ << indent << "  if (sk_length > sk_data.size() - sk_pos) return "
+                         "false;\n";
+    source_ << indent << "  if (!detail::" << get_cpp_type(*field.type)
+            << "_read_columns(sk_data.subspan(sk_pos, sk_length), "
+            << field.name << ")) {\n";
+    source_ << indent << "    return false;\n";
+    source_ << indent << "  }\n";
+    source_ << indent << "  sk_pos += sk_length;\n";
+  } else if (prim_type) {
     if (prim_type->kind == PrimitiveTypeKind::STRING) {
-      source_ << indent << "  uint64_t length = 0;\n";
-      source_ << indent << "  int shift = 0;\n";
-      source_ << indent << "  while (pos < data.size()) {\n";
-      source_ << indent << "    uint8_t byte = data[pos++];\n";
-      source_ << indent
-              << "    length |= static_cast<uint64_t>(byte & 0x7F) << shift;\n";
-      source_ << indent << "    if ((byte & 0x80) == 0) break;\n";
-      source_ << indent << "    shift += 7;\n";
-      source_ << indent << "  }\n";
+      generate_varint_read("sk_length", "sk_data", indent);
 
-      if (field.is_repeated()) {
-        source_ << indent
-                << "  std::string str(reinterpret_cast<const "
-                   "char*>(&data[pos]), length);\n";
-        source_ << indent << "  " << field.name
-                << ".push_back(std::move(str));\n";
+      source_ << indent << "  if (sk_length > sk_data.size() - sk_pos) return "
+                           "false;\n";
+
+      if (is_utf8_field(field)) {
+        // Validated while copying, in one pass over the bytes.
+        std::string target =
+            field.is_repeated()
+                ? "detail::next_element(" + field.name + ", sk_" +
+                      field.name + "_used)"
+            : field.is_optional() ? field.name + ".emplace()"
+                                  : field.name;
+        source_ << indent << "  if (!detail::utf8_assign(" << target
+                << ", sk_data.data() + sk_pos, sk_length)) {\n";
+        source_ << indent << "    return false;\n";
+        source_ << indent << "  }\n";
+      } else if (field.is_repeated()) {
+        source_ << indent << "  detail::next_element(" << field.name << ", sk_"
+                << field.name << "_used)\n";
+        source_ << indent << "      .assign(reinterpret_cast<const "
+                   "char*>(sk_data.data() + sk_pos), sk_length);\n";
       } else if (field.is_optional()) {
         source_ << indent << "  " << field.name
-                << " = std::string(reinterpret_cast<const char*>(&data[pos]), "
-                   "length);\n";
+                << " = std::string(reinterpret_cast<const "
+                   "char*>(sk_data.data() + sk_pos), sk_length);\n";
       } else {
         source_
             << indent << "  " << field.name
-            << ".assign(reinterpret_cast<const char*>(&data[pos]), length);\n";
+            << ".assign(reinterpret_cast<const char*>(sk_data.data() + "
+               "sk_pos), sk_length);\n";
       }
-      source_ << indent << "  pos += length;\n";
+      source_ << indent << "  sk_pos += sk_length;\n";
     } else {
-      source_ << indent << "  uint64_t value = 0;\n";
-      source_ << indent << "  int shift = 0;\n";
-      source_ << indent << "  while (pos < data.size()) {\n";
-      source_ << indent << "    uint8_t byte = data[pos++];\n";
-      source_ << indent
-              << "    value |= static_cast<uint64_t>(byte & 0x7F) << shift;\n";
-      source_ << indent << "    if ((byte & 0x80) == 0) break;\n";
-      source_ << indent << "    shift += 7;\n";
-      source_ << indent << "  }\n";
+      generate_varint_read("sk_value", "sk_data", indent);
 
       std::string cpp_type = get_cpp_type(*field.type);
 
       if (field.is_repeated()) {
         source_ << indent << "  " << field.name << ".push_back(static_cast<"
-                << cpp_type << ">(value));\n";
+                << cpp_type << ">(sk_value));\n";
       } else if (field.is_optional()) {
         source_ << indent << "  " << field.name << " = static_cast<" << cpp_type
-                << ">(value);\n";
+                << ">(sk_value);\n";
       } else {
         source_ << indent << "  " << field.name << " = static_cast<" << cpp_type
-                << ">(value);\n";
+                << ">(sk_value);\n";
       }
     }
   } else {
@@ -568,64 +4552,56 @@ void CodeGenerator::generate_field_deserializer(const Field &field,
     auto *user_type = dynamic_cast<const UserType *>(field.type.get());
     if (user_type && schema_.find_enum(user_type->name)) {
       // Deserialize enum as integer
-      source_ << indent << "  uint64_t value = 0;\n";
-      source_ << indent << "  int shift = 0;\n";
-      source_ << indent << "  while (pos < data.size()) {\n";
-      source_ << indent << "    uint8_t byte = data[pos++];\n";
-      source_ << indent
-              << "    value |= static_cast<uint64_t>(byte & 0x7F) << shift;\n";
-      source_ << indent << "    if ((byte & 0x80) == 0) break;\n";
-      source_ << indent << "    shift += 7;\n";
-      source_ << indent << "  }\n";
+      generate_varint_read("sk_value", "sk_data", indent);
 
       if (field.is_repeated()) {
         source_ << indent << "  " << field.name << ".push_back(static_cast<"
-                << type_name << ">(value));\n";
+                << type_name << ">(sk_value));\n";
       } else if (field.is_optional()) {
         source_ << indent << "  " << field.name << " = static_cast<"
-                << type_name << ">(value);\n";
+                << type_name << ">(sk_value);\n";
       } else {
         source_ << indent << "  " << field.name << " = static_cast<"
-                << type_name << ">(value);\n";
+                << type_name << ">(sk_value);\n";
       }
     } else {
       // Deserialize as model (complex type)
-      source_ << indent << "  uint64_t length = 0;\n";
-      source_ << indent << "  int shift = 0;\n";
-      source_ << indent << "  while (pos < data.size()) {\n";
-      source_ << indent << "    uint8_t byte = data[pos++];\n";
-      source_ << indent
-              << "    length |= static_cast<uint64_t>(byte & 0x7F) << shift;\n";
-      source_ << indent << "    if ((byte & 0x80) == 0) break;\n";
-      source_ << indent << "    shift += 7;\n";
-      source_ << indent << "  }\n";
+      generate_varint_read("sk_length", "sk_data", indent);
+
+      source_ << indent << "  if (sk_length > sk_data.size() - sk_pos) return "
+                           "false;\n";
 
       if (field.is_repeated()) {
-        source_ << indent << "  " << type_name << " item;\n";
-        source_ << indent
-                << "  std::vector<uint8_t> item_data(data.begin() + pos, "
-                   "data.begin() + pos + length);\n";
+        source_ << indent << "  auto& sk_item = detail::next_element("
+                << field.name << ", sk_" << field.name << "_used);\n";
         source_ << indent
-                << "  if (!item.deserialize(item_data)) return false;\n";
-        source_ << indent << "  " << field.name
-                << ".push_back(std::move(item));\n";
+                << "  if (!sk_item.deserialize(sk_data.subspan(sk_pos, "
+                   "sk_length))) return false;\n";
       } else if (field.is_optional()) {
-        source_ << indent << "  " << type_name << " value;\n";
-        source_ << indent
-                << "  std::vector<uint8_t> item_data(data.begin() + pos, "
-                   "data.begin() + pos + length);\n";
+        source_ << indent << "  " << type_name << " sk_value;\n";
         source_ << indent
-                << "  if (!value.deserialize(item_data)) return false;\n";
-        source_ << indent << "  " << field.name << " = std::move(value);\n";
-      } else {
-        source_ << indent
-                << "  std::vector<uint8_t> item_data(data.begin() + pos, "
-                   "data.begin() + pos + length);\n";
+                << "  if (!sk_value.deserialize(sk_data.subspan(sk_pos, "
+                   "sk_length))) return false;\n";
+        source_ << indent << "  " << field.name << " = std::move(sk_value);\n";
+      } else if (!is_reused_on_decode(field)) {
         source_ << indent << "  if (!" << field.name
-                << ".deserialize(item_data)) return false;\n";
+                << ".deserialize(sk_data.subspan(sk_pos, sk_length))) return "
+                   "false;\n";
+      } else {
+        source_ << indent << "  std::span<const uint8_t> sk_message = "
+                   "sk_data.subspan(sk_pos, sk_length);\n";
+        // A second occurrence merges into the first, as in merge mode.
+        std::string condition = "sk_replace && !sk_" + field.name + "_seen";
+        source_ << indent << "  if (!(" << condition << " ? " << field.name
+                << ".deserialize(sk_message)\n";
+        source_ << indent << std::string(condition.size() + 7, ' ') << ": "
+                << field.name << ".merge(sk_message))) {\n";
+        source_ << indent << "    return false;\n";
+        source_ << indent << "  }\n";
+        source_ << indent << "  sk_" << field.name << "_seen = true;\n";
       }
 
-      source_ << indent << "  pos += length;\n";
+      source_ << indent << "  sk_pos += sk_length;\n";
     }
   }
 
@@ -633,6 +4609,95 @@ void CodeGenerator::generate_field_deserializer(const Field &field,
   source_ << indent << "}\n";
 }
 
+void CodeGenerator::generate_varint_read(const std::string &target,
+                                         const std::string &input,
+                                         const std::string &indent) {
+  source_ << indent << "  uint64_t " << target << " = 0;\n";
+  source_ << indent << "  if (!detail::parse_varint(" << input << ", sk_pos, "
+          << target << ")) return false;\n";
+}
+
+void CodeGenerator::generate_packed_deserializer(const Field &field,
+                                                 const PrimitiveType &type,
+                                                 const std::string &indent) {
+  std::string cpp_type = get_cpp_type(type);
+
+  generate_varint_read("sk_length", "sk_data", indent);
+  source_ << indent << "  if (sk_length > sk_data.size() - sk_pos) return "
+                       "false;\n";
+  source_ << indent << "  size_t sk_end = sk_pos + sk_length;\n";
+
+  if (type.kind == PrimitiveTypeKind::FLOAT ||
+      type.kind == PrimitiveTypeKind::DOUBLE) {
+    bool is_float = type.kind == PrimitiveTypeKind::FLOAT;
+    std::string bits_type = is_float ? "uint32_t" : "uint64_t";
+    int width = is_float ? 4 : 8;
+
+    source_ << indent << "  if (sk_length % " << width
+            << " != 0) return false;\n";
+    source_ << indent << "  " << field.name << ".reserve(" << field.name
+            << ".size() + sk_length / " << width << ");\n";
+    source_ << indent << "  for (; sk_pos < sk_end; sk_pos += " << width
+            << ") {\n";
+    source_ << indent << "    " << bits_type << " sk_bits = 0;\n";
+    source_ << indent << "    for (int sk_i = 0; sk_i < " << width
+            << "; ++sk_i) {\n";
+    source_ << indent << "      sk_bits |= static_cast<" << bits_type
+            << ">(sk_data[sk_pos + sk_i]) << (sk_i * 8);\n";
+    source_ << indent << "    }\n";
+    source_ << indent << "    " << cpp_type << " sk_item;\n";
+    source_ << indent << "    std::memcpy(&sk_item, &sk_bits, "
+                         "sizeof(sk_item));\n";
+    source_ << indent << "    " << field.name << ".push_back(sk_item);\n";
+    source_ << indent << "  }\n";
+  } else {
+    source_ << indent << "  while (sk_pos < sk_end) {\n";
+    generate_varint_read("sk_value", "sk_data.first(sk_end)", indent + "  ");
+    source_ << indent << "    " << field.name << ".push_back(static_cast<"
+            << cpp_type << ">(sk_value));\n";
+    source_ << indent << "  }\n";
+  }
+}
+
+void CodeGenerator::generate_struct_array_deserializer(
+    const Field &field, const std::string &indent) {
+  std::string type = get_cpp_type(*field.type);
+
+  generate_varint_read("sk_length", "sk_data", indent);
+  source_ << indent << "  if (sk_length > sk_data.size() - sk_pos) return "
+                       "false;\n";
+  source_ << indent << "  if (sk_length % " << type
+          << "::WIRE_SIZE != 0) return false;\n";
+  source_ << indent << "  size_t sk_count = sk_length / " << type
+          << "::WIRE_SIZE;\n";
+  source_ << indent << "  size_t sk_offset = " << field.name << ".size();\n";
+  source_ << indent << "  " << field.name << ".resize(sk_offset + sk_count);\n";
+
+  // Bytes other than 0 and 1 are not valid bools, so structs holding one
+  // are always decoded field by field.
+  const StructDecl *struct_decl = schema_.find_struct(type);
+  std::string inner = indent + "  ";
+  if (!struct_has_bool(*struct_decl)) {
+    source_ << indent << "  if constexpr (detail::has_wire_layout<" << type
+            << ">()) {\n";
+    source_ << indent << "    if (sk_count != 0) {\n";
+    source_ << indent << "      std::memcpy(" << field.name
+            << ".data() + sk_offset, sk_data.data() + sk_pos, sk_length);\n";
+    source_ << indent << "    }\n";
+    source_ << indent << "  } else {\n";
+    inner += "  ";
+  }
+  source_ << inner << "const uint8_t* sk_in = sk_data.data() + sk_pos;\n";
+  source_ << inner << "for (size_t sk_i = 0; sk_i < sk_count; ++sk_i) {\n";
+  source_ << inner << "  sk_in = " << field.name
+          << "[sk_offset + sk_i].deserialize_from(sk_in);\n";
+  source_ << inner << "}\n";
+  if (!struct_has_bool(*struct_decl)) {
+    source_ << indent << "  }\n";
+  }
+  source_ << indent << "  sk_pos += sk_length;\n";
+}
+
 std::string CodeGenerator::get_cpp_type(const Type &type) const {
   if (auto *prim_type = dynamic_cast<const PrimitiveType *>(&type)) {
     switch (prim_type->kind) {
@@ -718,6 +4783,337 @@ uint8_t CodeGenerator::get_wire_type_value(const Type &type,
   return 2; // LENGTH_DELIMITED for user types
 }
 
+uint8_t CodeGenerator::get_tag_wire_type(const Field &field) const {
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+  if (field.is_repeated() && field.is_packed() && is_packable(prim_type)) {
+    return 2; // Packed runs are length-delimited on the wire
+  }
+  return get_wire_type_value(*field.type, field);
+}
+
+std::string CodeGenerator::inline_specifier() const {
+  return options_.header_only ? "inline " : "";
+}
+
+std::string CodeGenerator::codec_specifier(const ModelDecl &model) const {
+  return options_.header_only && is_constexpr_model(model) ? "constexpr "
+                                                           : inline_specifier();
+}
+
+bool CodeGenerator::is_constexpr_model(const ModelDecl &model) const {
+  // Fixed-size scalars only: no strings, nested models or vectors, whose
+  // codecs need memcpy or allocation.
+  if (model.checksummed) {
+    return false;
+  }
+  for (const auto &field : model.fields) {
+    auto *prim_type = dynamic_cast<const PrimitiveType *>(field->type.get());
+    if (field->is_repeated() || (!prim_type && !is_enum_type(*field->type)) ||
+        (prim_type && prim_type->kind == PrimitiveTypeKind::STRING)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CodeGenerator::is_enum_type(const Type &type) const {
+  auto *user_type = dynamic_cast<const UserType *>(&type);
+  return user_type && schema_.find_enum(user_type->name);
+}
+
+bool CodeGenerator::is_struct_type(const Type &type) const {
+  auto *user_type = dynamic_cast<const UserType *>(&type);
+  return user_type && schema_.find_struct(user_type->name);
+}
+
+size_t CodeGenerator::get_comparison_rank(const Field &field) const {
+  // Cheapest first: scalars compare in one instruction, structs and
+  // optional scalars in a few; strings, nested models and vectors may
+  // touch memory elsewhere.
+  if (field.is_repeated()) {
+    return 4;
+  }
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+  if (prim_type && prim_type->kind == PrimitiveTypeKind::STRING) {
+    return 2;
+  }
+  if (!prim_type && !is_enum_type(*field.type)) {
+    return is_struct_type(*field.type) && !field.is_optional() ? 1 : 3;
+  }
+  return field.is_optional() ? 1 : 0;
+}
+
+std::vector<const Field *> CodeGenerator::get_comparison_order(
+    const std::vector<std::unique_ptr<Field>> &fields) const {
+  std::vector<const Field *> order;
+  for (const auto &field : fields) {
+    order.push_back(field.get());
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [this](const Field *a, const Field *b) {
+                     return get_comparison_rank(*a) < get_comparison_rank(*b);
+                   });
+  return order;
+}
+
+bool CodeGenerator::is_comparison_defaulted(
+    const std::vector<std::unique_ptr<Field>> &fields) const {
+  // A defaulted operator== compares in declaration order, which is fine
+  // when that already puts the cheap fields first.
+  std::vector<const Field *> order = get_comparison_order(fields);
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (order[i] != fields[i].get()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string CodeGenerator::get_ordering_type(
+    const std::vector<std::unique_ptr<Field>> &fields) const {
+  std::vector<std::string> visited;
+  return has_floating_point(fields, visited) ? "std::partial_ordering"
+                                             : "std::strong_ordering";
+}
+
+bool CodeGenerator::has_floating_point(
+    const std::vector<std::unique_ptr<Field>> &fields,
+    std::vector<std::string> &visited) const {
+  for (const auto &field : fields) {
+    auto *prim_type = dynamic_cast<const PrimitiveType *>(field->type.get());
+    if (prim_type) {
+      if (prim_type->kind == PrimitiveTypeKind::FLOAT ||
+          prim_type->kind == PrimitiveTypeKind::DOUBLE) {
+        return true;
+      }
+      continue;
+    }
+    auto *user_type = dynamic_cast<const UserType *>(field->type.get());
+    if (!user_type || std::find(visited.begin(), visited.end(),
+                                user_type->name) != visited.end()) {
+      continue;
+    }
+    visited.push_back(user_type->name);
+    if (auto *model = schema_.find_model(user_type->name)) {
+      if (has_floating_point(model->fields, visited)) {
+        return true;
+      }
+    } else if (auto *nested = schema_.find_struct(user_type->name)) {
+      if (has_floating_point(nested->fields, visited)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool CodeGenerator::is_reused_on_decode(const Field &field) const {
+  if (field.is_optional() || field.is_columnar()) {
+    return false;
+  }
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+  if (field.is_repeated()) {
+    return (prim_type && prim_type->kind == PrimitiveTypeKind::STRING) ||
+           schema_.find_model(field.type->get_name());
+  }
+  return schema_.find_model(field.type->get_name()) != nullptr;
+}
+
+// Whether the transcoder reads the field's value as length and bytes
+// rather than as a single varint.
+bool CodeGenerator::is_length_delimited(const Field &field) const {
+  auto *prim = dynamic_cast<const PrimitiveType *>(field.type.get());
+  return field.is_columnar() || is_struct_type(*field.type) ||
+         (prim && prim->kind == PrimitiveTypeKind::STRING) ||
+         (!prim && !is_enum_type(*field.type)) ||
+         (field.is_packed() && is_packable(prim));
+}
+
+bool CodeGenerator::is_floating_type(const Type &type) const {
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(&type);
+  return prim_type && (prim_type->kind == PrimitiveTypeKind::FLOAT ||
+                       prim_type->kind == PrimitiveTypeKind::DOUBLE);
+}
+
+bool CodeGenerator::is_utf8_field(const Field &field) const {
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+  return prim_type && prim_type->kind == PrimitiveTypeKind::STRING &&
+         (field.is_utf8() || options_.utf8);
+}
+
+bool CodeGenerator::has_utf8_fields() const {
+  for (const auto &decl : schema_.declarations) {
+    auto *model = dynamic_cast<const ModelDecl *>(decl.get());
+    if (!model) {
+      continue;
+    }
+    for (const auto &field : model->fields) {
+      if (is_utf8_field(*field)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool CodeGenerator::has_checksummed_models() const {
+  for (const auto &decl : schema_.declarations) {
+    auto *model = dynamic_cast<const ModelDecl *>(decl.get());
+    if (model && model->checksummed) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool CodeGenerator::has_structs() const {
+  for (const auto &decl : schema_.declarations) {
+    if (dynamic_cast<const StructDecl *>(decl.get())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Element models of every columnar field, each listed once, in declaration
+// order.
+std::vector<const ModelDecl *> CodeGenerator::get_columnar_elements() const {
+  std::vector<const ModelDecl *> elements;
+  for (const auto &decl : schema_.declarations) {
+    auto *model = dynamic_cast<const ModelDecl *>(decl.get());
+    if (!model) {
+      continue;
+    }
+    for (const auto &field : model->fields) {
+      if (field->is_columnar()) {
+        elements.push_back(schema_.find_model(field->type->get_name()));
+      }
+    }
+  }
+  std::vector<const ModelDecl *> ordered;
+  for (const auto &decl : schema_.declarations) {
+    auto *model = dynamic_cast<const ModelDecl *>(decl.get());
+    if (model && std::find(elements.begin(), elements.end(), model) !=
+                     elements.end()) {
+      ordered.push_back(model);
+    }
+  }
+  return ordered;
+}
+
+bool CodeGenerator::struct_has_bool(const StructDecl &struct_decl) const {
+  for (const auto &field : struct_decl.fields) {
+    auto *prim_type = dynamic_cast<const PrimitiveType *>(field->type.get());
+    if (prim_type ? prim_type->kind == PrimitiveTypeKind::BOOL
+                  : struct_has_bool(
+                        *schema_.find_struct(field->type->get_name()))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t CodeGenerator::get_struct_size(const StructDecl &struct_decl) const {
+  size_t size = 0;
+  for (const auto &field : struct_decl.fields) {
+    auto *prim_type = dynamic_cast<const PrimitiveType *>(field->type.get());
+    if (!prim_type) {
+      size += get_struct_size(*schema_.find_struct(field->type->get_name()));
+      continue;
+    }
+    switch (prim_type->kind) {
+    case PrimitiveTypeKind::INT16:
+    case PrimitiveTypeKind::UINT16:
+      size += 2;
+      break;
+    case PrimitiveTypeKind::INT32:
+    case PrimitiveTypeKind::UINT32:
+    case PrimitiveTypeKind::FLOAT:
+      size += 4;
+      break;
+    case PrimitiveTypeKind::INT64:
+    case PrimitiveTypeKind::UINT64:
+    case PrimitiveTypeKind::DOUBLE:
+      size += 8;
+      break;
+    default:
+      size += 1;
+      break;
+    }
+  }
+  return size;
+}
+
+bool CodeGenerator::is_packable(const PrimitiveType *type) const {
+  return type && type->kind != PrimitiveTypeKind::STRING;
+}
+
+size_t CodeGenerator::get_varint_size(uint64_t value) const {
+  size_t size = 1;
+  while (value > 0x7F) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+size_t CodeGenerator::get_model_index(const std::string &name) const {
+  size_t index = 0;
+  for (const auto &decl : schema_.declarations) {
+    if (dynamic_cast<const ModelDecl *>(decl.get())) {
+      if (decl->name == name) {
+        return index;
+      }
+      ++index;
+    }
+  }
+  return index;
+}
+
+std::string CodeGenerator::get_decode_kind(const Field &field) const {
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+  if (!prim_type) {
+    if (is_struct_type(*field.type)) {
+      return field.is_repeated() ? "FieldKind::STRUCT_ARRAY"
+                                 : "FieldKind::STRUCT";
+    }
+    if (field.is_columnar()) {
+      return "FieldKind::COLUMNS";
+    }
+    const ModelDecl *model = schema_.find_model(field.type->get_name());
+    if (model && model->checksummed) {
+      return "FieldKind::CHECKSUMMED";
+    }
+    return is_enum_type(*field.type) ? "FieldKind::VARINT"
+                                     : "FieldKind::MESSAGE";
+  }
+  if (prim_type->kind == PrimitiveTypeKind::STRING) {
+    return is_utf8_field(field) ? "FieldKind::UTF8_STRING"
+                                : "FieldKind::STRING";
+  }
+  if (field.is_repeated() && field.is_packed()) {
+    switch (prim_type->kind) {
+    case PrimitiveTypeKind::FLOAT:
+      return "FieldKind::PACKED_FIXED32";
+    case PrimitiveTypeKind::DOUBLE:
+      return "FieldKind::PACKED_FIXED64";
+    default:
+      return "FieldKind::PACKED_VARINT";
+    }
+  }
+  return "FieldKind::VARINT";
+}
+
+std::string CodeGenerator::get_param_type(const Field &field) const {
+  auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+  std::string cpp_type = get_cpp_type(*field.type);
+  if ((prim_type && prim_type->kind == PrimitiveTypeKind::STRING) ||
+      (!prim_type && !is_enum_type(*field.type))) {
+    return "const " + cpp_type + "&";
+  }
+  return cpp_type;
+}
+
 std::string CodeGenerator::get_field_type(const Field &field) const {
   std::string base_type = get_cpp_type(*field.type);
 
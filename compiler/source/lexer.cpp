@@ -9,9 +9,12 @@ namespace serialkit {
 
 static const std::unordered_map<std::string_view, TokenType> keywords = {
     {"namespace", TokenType::NAMESPACE}, {"enum", TokenType::ENUM},
-    {"model", TokenType::MODEL},         {"optional", TokenType::OPTIONAL},
-    {"repeated", TokenType::REPEATED},   {"packed", TokenType::PACKED},
-    {"interned", TokenType::INTERNED},   {"bitmap", TokenType::BITMAP},
+    {"model", TokenType::MODEL},         {"struct", TokenType::STRUCT},
+    {"optional", TokenType::OPTIONAL},   {"repeated", TokenType::REPEATED},
+    {"packed", TokenType::PACKED},       {"interned", TokenType::INTERNED},
+    {"bitmap", TokenType::BITMAP},       {"columnar", TokenType::COLUMNAR},
+    {"utf8", TokenType::UTF8},
+    {"checksummed", TokenType::CHECKSUMMED},
 
     {"int8", TokenType::INT8},           {"int16", TokenType::INT16},
     {"int32", TokenType::INT32},         {"int64", TokenType::INT64},
@@ -242,6 +245,8 @@ const char *token_type_to_string(TokenType type) {
     return "ENUM";
   case TokenType::MODEL:
     return "MODEL";
+  case TokenType::STRUCT:
+    return "STRUCT";
   case TokenType::OPTIONAL:
     return "OPTIONAL";
   case TokenType::REPEATED:
@@ -252,6 +257,12 @@ const char *token_type_to_string(TokenType type) {
     return "INTERNED";
   case TokenType::BITMAP:
     return "BITMAP";
+  case TokenType::COLUMNAR:
+    return "COLUMNAR";
+  case TokenType::UTF8:
+    return "UTF8";
+  case TokenType::CHECKSUMMED:
+    return "CHECKSUMMED";
 
   case TokenType::INT8:
     return "INT8";
@@ -62,10 +62,12 @@ void Parser::parse_namespace(Schema &schema) {
 std::unique_ptr<Declaration> Parser::parse_declaration() {
   if (check(TokenType::ENUM)) {
     return parse_enum();
-  } else if (check(TokenType::MODEL)) {
+  } else if (check(TokenType::MODEL) || check(TokenType::CHECKSUMMED)) {
     return parse_model();
+  } else if (check(TokenType::STRUCT)) {
+    return parse_struct();
   } else {
-    error("Expected 'enum' or 'model' declaration");
+    error("Expected 'enum', 'model' or 'struct' declaration");
   }
 }
 
@@ -104,11 +106,13 @@ std::unique_ptr<EnumDecl> Parser::parse_enum() {
 
 std::unique_ptr<ModelDecl> Parser::parse_model() {
   SourceLocation loc = current_token_.location;
+  bool checksummed = match(TokenType::CHECKSUMMED);
   consume(TokenType::MODEL, "Expected 'model'");
 
   std::string name =
       std::string(consume(TokenType::IDENTIFIER, "Expected model name").value);
   auto model_decl = std::make_unique<ModelDecl>(std::move(name), loc);
+  model_decl->checksummed = checksummed;
   model_decl->fields.reserve(16);
 
   consume(TokenType::LBRACE, "Expected '{' after model name");
@@ -122,6 +126,27 @@ std::unique_ptr<ModelDecl> Parser::parse_model() {
   return model_decl;
 }
 
+std::unique_ptr<StructDecl> Parser::parse_struct() {
+  SourceLocation loc = current_token_.location;
+  consume(TokenType::STRUCT, "Expected 'struct'");
+
+  std::string name =
+      std::string(consume(TokenType::IDENTIFIER, "Expected struct name").value);
+  auto struct_decl = std::make_unique<StructDecl>(std::move(name), loc);
+  struct_decl->fields.reserve(8);
+
+  consume(TokenType::LBRACE, "Expected '{' after struct name");
+
+  while (!check(TokenType::RBRACE) && !check(TokenType::END_OF_FILE)) {
+    int position = static_cast<int>(struct_decl->fields.size()) + 1;
+    struct_decl->fields.push_back(parse_struct_field(position));
+  }
+
+  consume(TokenType::RBRACE, "Expected '}' after struct body");
+
+  return struct_decl;
+}
+
 std::unique_ptr<Field> Parser::parse_field() {
   SourceLocation loc = current_token_.location;
 
@@ -145,6 +170,25 @@ std::unique_ptr<Field> Parser::parse_field() {
   return field;
 }
 
+std::unique_ptr<Field> Parser::parse_struct_field(int position) {
+  SourceLocation loc = current_token_.location;
+
+  // Modifiers are parsed so that the validator can report them.
+  uint8_t modifiers = parse_modifiers();
+  auto type = parse_type();
+
+  std::string field_name =
+      std::string(consume(TokenType::IDENTIFIER, "Expected field name").value);
+
+  consume(TokenType::SEMICOLON, "Expected ';' after struct field");
+
+  auto field = std::make_unique<Field>(std::move(type), std::move(field_name),
+                                       position, loc);
+  field->modifiers = modifiers;
+
+  return field;
+}
+
 std::unique_ptr<Type> Parser::parse_type() {
   SourceLocation loc = current_token_.location;
 
@@ -181,6 +225,12 @@ uint8_t Parser::parse_modifiers() {
     case TokenType::BITMAP:
       modifiers |= MOD_BITMAP;
       break;
+    case TokenType::COLUMNAR:
+      modifiers |= MOD_COLUMNAR;
+      break;
+    case TokenType::UTF8:
+      modifiers |= MOD_UTF8;
+      break;
     default:
       break;
     }
@@ -218,6 +268,8 @@ bool Parser::is_field_modifier(TokenType type) const {
   case TokenType::PACKED:
   case TokenType::INTERNED:
   case TokenType::BITMAP:
+  case TokenType::COLUMNAR:
+  case TokenType::UTF8:
     return true;
   default:
     return false;
@@ -24,6 +24,11 @@ void ValidationContext::register_model(const std::string &name,
   models_[name] = decl;
 }
 
+void ValidationContext::register_struct(const std::string &name,
+                                        const StructDecl *decl) {
+  structs_[name] = decl;
+}
+
 const EnumDecl *ValidationContext::find_enum(const std::string &name) const {
   auto it = enums_.find(name);
   return it != enums_.end() ? it->second : nullptr;
@@ -34,9 +39,16 @@ const ModelDecl *ValidationContext::find_model(const std::string &name) const {
   return it != models_.end() ? it->second : nullptr;
 }
 
+const StructDecl *
+ValidationContext::find_struct(const std::string &name) const {
+  auto it = structs_.find(name);
+  return it != structs_.end() ? it->second : nullptr;
+}
+
 bool ValidationContext::type_exists(const std::string &name) const {
   return enums_.find(name) != enums_.end() ||
-         models_.find(name) != models_.end();
+         models_.find(name) != models_.end() ||
+         structs_.find(name) != structs_.end();
 }
 
 bool Validator::validate(const Schema &schema) {
@@ -73,6 +85,9 @@ void SemanticValidator::visit_schema(const Schema &schema) {
       context_.register_enum(enum_decl->name, enum_decl);
     } else if (auto *model_decl = dynamic_cast<const ModelDecl *>(decl.get())) {
       context_.register_model(model_decl->name, model_decl);
+    } else if (auto *struct_decl =
+                   dynamic_cast<const StructDecl *>(decl.get())) {
+      context_.register_struct(struct_decl->name, struct_decl);
     }
   }
 
@@ -81,6 +96,9 @@ void SemanticValidator::visit_schema(const Schema &schema) {
       visit_enum(*enum_decl);
     } else if (auto *model_decl = dynamic_cast<const ModelDecl *>(decl.get())) {
       visit_model(*model_decl);
+    } else if (auto *struct_decl =
+                   dynamic_cast<const StructDecl *>(decl.get())) {
+      visit_struct(*struct_decl);
     }
   }
 }
@@ -118,8 +136,29 @@ void SemanticValidator::visit_model(const ModelDecl &model) {
   current_model_ = nullptr;
 }
 
+void SemanticValidator::visit_struct(const StructDecl &struct_decl) {
+  if (struct_decl.fields.empty()) {
+    std::ostringstream oss;
+    oss << "Struct '" << struct_decl.name << "' must have at least one field";
+    context_.add_error(oss.str(), struct_decl.location);
+    return;
+  }
+
+  for (const auto &field : struct_decl.fields) {
+    check_struct_field(struct_decl, *field);
+  }
+
+  std::unordered_set<const StructDecl *> visited;
+  if (struct_contains(struct_decl, &struct_decl, visited)) {
+    std::ostringstream oss;
+    oss << "Struct '" << struct_decl.name << "' cannot contain itself";
+    context_.add_error(oss.str(), struct_decl.location);
+  }
+}
+
 void SemanticValidator::visit_field(const Field &field) {
   validate_field_number(field);
+  validate_field_name(field);
   validate_field_modifiers(field);
   validate_type_exists(*field.type, field.location);
   check_modifier_compatibility(field);
@@ -149,6 +188,16 @@ void SemanticValidator::validate_field_number(const Field &field) {
   }
 }
 
+void SemanticValidator::validate_field_name(const Field &field) {
+  // Generated code names its locals sk_*, so a field with that prefix
+  // could be hidden by one of them.
+  if (field.name.starts_with("sk_")) {
+    std::ostringstream oss;
+    oss << "Field name '" << field.name << "' uses the reserved prefix 'sk_'";
+    context_.add_error(oss.str(), field.location);
+  }
+}
+
 void SemanticValidator::validate_field_modifiers(const Field &field) {
   bool has_repeated = field.is_repeated();
   bool has_packed = field.is_packed();
@@ -169,6 +218,11 @@ void SemanticValidator::validate_field_modifiers(const Field &field) {
     context_.add_error("'bitmap' modifier requires 'repeated'", field.location);
   }
 
+  if (field.is_columnar() && !has_repeated) {
+    context_.add_error("'columnar' modifier requires 'repeated'",
+                       field.location);
+  }
+
   if (has_packed && has_bitmap) {
     context_.add_error("Field cannot have both 'packed' and 'bitmap' modifiers",
                        field.location);
@@ -254,6 +308,100 @@ void SemanticValidator::check_modifier_compatibility(const Field &field) {
                          field.location);
     }
   }
+
+  if (field.is_utf8()) {
+    auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get());
+    if (!prim_type || prim_type->kind != PrimitiveTypeKind::STRING) {
+      context_.add_error("'utf8' modifier can only be used with 'string' type",
+                         field.location);
+    }
+  }
+
+  if (field.is_columnar()) {
+    check_columnar_element(field);
+  }
+}
+
+void SemanticValidator::check_columnar_element(const Field &field) {
+  const ModelDecl *element = context_.find_model(field.type->get_name());
+  if (field.type->is_primitive() || !element) {
+    context_.add_error(
+        "'columnar' modifier can only be used with model types",
+        field.location);
+    return;
+  }
+
+  if (element->checksummed) {
+    std::ostringstream oss;
+    oss << "Model '" << element->name
+        << "' cannot be stored columnar: it is checksummed";
+    context_.add_error(oss.str(), field.location);
+  }
+
+  // Each element field becomes one column of scalars.
+  for (const auto &column : element->fields) {
+    if (column->is_repeated() ||
+        (!column->type->is_primitive() &&
+         !context_.find_enum(column->type->get_name()))) {
+      std::ostringstream oss;
+      oss << "Model '" << element->name
+          << "' cannot be stored columnar: field '" << column->name
+          << "' must be a primitive or enum that is not repeated";
+      context_.add_error(oss.str(), field.location);
+    }
+  }
+}
+
+void SemanticValidator::check_struct_field(const StructDecl &struct_decl,
+                                           const Field &field) {
+  validate_field_name(field);
+
+  if (field.modifiers != MOD_NONE) {
+    std::ostringstream oss;
+    oss << "Field '" << field.name << "' of struct '" << struct_decl.name
+        << "' cannot have modifiers";
+    context_.add_error(oss.str(), field.location);
+  }
+
+  if (auto *prim_type = dynamic_cast<const PrimitiveType *>(field.type.get())) {
+    if (prim_type->kind == PrimitiveTypeKind::STRING) {
+      std::ostringstream oss;
+      oss << "Field '" << field.name << "' of struct '" << struct_decl.name
+          << "' must have a fixed size; 'string' is not allowed";
+      context_.add_error(oss.str(), field.location);
+    }
+    return;
+  }
+
+  const std::string type_name = field.type->get_name();
+  if (!context_.type_exists(type_name)) {
+    validate_type_exists(*field.type, field.location);
+  } else if (!context_.find_struct(type_name)) {
+    std::ostringstream oss;
+    oss << "Field '" << field.name << "' of struct '" << struct_decl.name
+        << "' must be a fixed-size primitive or struct, not '" << type_name
+        << "'";
+    context_.add_error(oss.str(), field.location);
+  }
+}
+
+bool SemanticValidator::struct_contains(
+    const StructDecl &outer, const StructDecl *inner,
+    std::unordered_set<const StructDecl *> &visited) const {
+  for (const auto &field : outer.fields) {
+    const StructDecl *nested = context_.find_struct(field->type->get_name());
+    if (!nested || field->type->is_primitive()) {
+      continue;
+    }
+    if (nested == inner) {
+      return true;
+    }
+    if (visited.insert(nested).second &&
+        struct_contains(*nested, inner, visited)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 } // namespace serialkit
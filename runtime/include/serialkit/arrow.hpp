@@ -0,0 +1,780 @@
+#ifndef SERIALKIT_ARROW_HPP
+#define SERIALKIT_ARROW_HPP
+
+#include "reflection.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Arrow C Data Interface, as specified by Apache Arrow. Any Arrow
+// implementation can import these structs without linking to SerialKit, and
+// SerialKit does not need libarrow to produce or read them.
+extern "C" {
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  const char *format;
+  const char *name;
+  const char *metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+  void (*release)(struct ArrowSchema *);
+  void *private_data;
+};
+
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+  void (*release)(struct ArrowArray *);
+  void *private_data;
+};
+
+#endif
+}
+
+namespace serialkit {
+
+namespace detail {
+
+template <typename T> struct is_optional : std::false_type {};
+template <typename T> struct is_optional<std::optional<T>> : std::true_type {};
+
+template <typename T> struct is_vector : std::false_type {};
+template <typename T> struct is_vector<std::vector<T>> : std::true_type {};
+
+template <typename> inline constexpr bool unsupported_arrow_type = false;
+
+// Format string of a fixed-width Arrow primitive.
+template <typename T> constexpr const char *arrow_format() {
+  if constexpr (std::is_same_v<T, bool>) {
+    return "b";
+  } else if constexpr (std::is_same_v<T, float>) {
+    return "f";
+  } else if constexpr (std::is_same_v<T, double>) {
+    return "g";
+  } else if constexpr (std::is_signed_v<T>) {
+    constexpr const char *formats[] = {"c", "s", "", "i", "", "", "", "l"};
+    return formats[sizeof(T) - 1];
+  } else {
+    constexpr const char *formats[] = {"C", "S", "", "I", "", "", "", "L"};
+    return formats[sizeof(T) - 1];
+  }
+}
+
+// Arrays built here before being handed out as ArrowSchema/ArrowArray.
+// buffers[0] is always the validity bitmap; empty means no nulls.
+struct ArrowColumn {
+  std::string format;
+  std::string name;
+  int64_t flags = 0;
+  int64_t length = 0;
+  int64_t null_count = 0;
+  std::vector<std::vector<uint8_t>> buffers;
+  std::vector<ArrowColumn> children;
+  std::unique_ptr<ArrowColumn> dictionary;
+};
+
+template <typename T> void append_value(std::vector<uint8_t> &buffer, T value) {
+  size_t at = buffer.size();
+  buffer.resize(at + sizeof(T));
+  std::memcpy(buffer.data() + at, &value, sizeof(T));
+}
+
+inline int32_t arrow_offset(size_t offset) {
+  if (offset > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+    throw std::length_error("Arrow column exceeds 32-bit offsets");
+  }
+  return static_cast<int32_t>(offset);
+}
+
+template <typename Get>
+ArrowColumn utf8_column(std::string_view name, size_t count, const Get &get) {
+  ArrowColumn column;
+  column.format = "u";
+  column.name = name;
+  column.length = static_cast<int64_t>(count);
+  std::vector<uint8_t> offsets;
+  std::vector<uint8_t> data;
+  offsets.reserve((count + 1) * sizeof(int32_t));
+  append_value<int32_t>(offsets, 0);
+  for (size_t i = 0; i < count; ++i) {
+    std::string_view value = get(i);
+    data.insert(data.end(), value.begin(), value.end());
+    append_value(offsets, arrow_offset(data.size()));
+  }
+  column.buffers.push_back({});
+  column.buffers.push_back(std::move(offsets));
+  column.buffers.push_back(std::move(data));
+  return column;
+}
+
+template <typename Get>
+std::vector<uint8_t> bitmap(size_t count, const Get &get, int64_t *unset) {
+  std::vector<uint8_t> bits((count + 7) / 8);
+  for (size_t i = 0; i < count; ++i) {
+    if (get(i)) {
+      bits[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+    } else if (unset) {
+      ++*unset;
+    }
+  }
+  return bits;
+}
+
+// Column of `count` values of type V, where get(i) returns the i-th one.
+template <typename V, typename Get>
+ArrowColumn build_column(std::string_view name, size_t count, const Get &get,
+                         uint8_t modifiers) {
+  ArrowColumn column;
+  if constexpr (is_optional<V>::value) {
+    using U = typename V::value_type;
+    const U empty{};
+    column = build_column<U>(
+        name, count,
+        [&](size_t i) -> const U & {
+          const V &value = get(i);
+          return value ? *value : empty;
+        },
+        modifiers);
+    // Keep slots the value column already marks null (unknown enumerators).
+    std::vector<uint8_t> inner = std::move(column.buffers[0]);
+    column.null_count = 0;
+    column.buffers[0] = bitmap(
+        count,
+        [&](size_t i) {
+          return get(i).has_value() &&
+                 (inner.empty() || (inner[i / 8] >> (i % 8)) & 1);
+        },
+        &column.null_count);
+    column.flags |= ARROW_FLAG_NULLABLE;
+    return column;
+  } else if constexpr (is_vector<V>::value) {
+    using U = typename V::value_type;
+    column.format = "+l";
+    std::vector<uint8_t> offsets;
+    offsets.reserve((count + 1) * sizeof(int32_t));
+    append_value<int32_t>(offsets, 0);
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+      total += get(i).size();
+      append_value(offsets, arrow_offset(total));
+    }
+
+    ArrowColumn child;
+    if constexpr (std::is_same_v<U, bool>) {
+      child.format = "b";
+      child.name = "item";
+      child.length = static_cast<int64_t>(total);
+      std::vector<uint8_t> bits((total + 7) / 8);
+      size_t at = 0;
+      for (size_t i = 0; i < count; ++i) {
+        for (bool value : get(i)) {
+          bits[at / 8] |= static_cast<uint8_t>(value ? 1u << (at % 8) : 0);
+          ++at;
+        }
+      }
+      child.buffers.push_back({});
+      child.buffers.push_back(std::move(bits));
+    } else if constexpr (std::is_arithmetic_v<U>) {
+      // Element arrays are copied whole, one memcpy per row.
+      child.format = arrow_format<U>();
+      child.name = "item";
+      child.length = static_cast<int64_t>(total);
+      std::vector<uint8_t> values(total * sizeof(U));
+      size_t at = 0;
+      for (size_t i = 0; i < count; ++i) {
+        const V &items = get(i);
+        if (!items.empty()) {
+          std::memcpy(values.data() + at, items.data(),
+                      items.size() * sizeof(U));
+          at += items.size() * sizeof(U);
+        }
+      }
+      child.buffers.push_back({});
+      child.buffers.push_back(std::move(values));
+    } else {
+      std::vector<const U *> items;
+      items.reserve(total);
+      for (size_t i = 0; i < count; ++i) {
+        for (const U &item : get(i)) {
+          items.push_back(&item);
+        }
+      }
+      child = build_column<U>(
+          "item", total, [&](size_t j) -> const U & { return *items[j]; },
+          modifiers);
+    }
+    column.buffers.push_back({});
+    column.buffers.push_back(std::move(offsets));
+    column.children.push_back(std::move(child));
+  } else if constexpr (std::is_same_v<V, std::string>) {
+    if ((modifiers & FIELD_INTERNED) == 0) {
+      column = utf8_column(name, count, get);
+      return column;
+    }
+    // Interned strings become indices into a dictionary of distinct values.
+    std::unordered_map<std::string_view, int32_t> index;
+    std::vector<std::string_view> entries;
+    std::vector<uint8_t> indices;
+    indices.reserve(count * sizeof(int32_t));
+    for (size_t i = 0; i < count; ++i) {
+      auto [it, inserted] = index.try_emplace(
+          get(i), static_cast<int32_t>(entries.size()));
+      if (inserted) {
+        entries.push_back(it->first);
+      }
+      append_value(indices, it->second);
+    }
+    column.format = "i";
+    column.buffers.push_back({});
+    column.buffers.push_back(std::move(indices));
+    column.dictionary = std::make_unique<ArrowColumn>(utf8_column(
+        "", entries.size(), [&](size_t j) { return entries[j]; }));
+  } else if constexpr (std::is_enum_v<V> && ReflectedEnum<V>) {
+    // Indices into the enumerator names; values outside the enum are null.
+    constexpr auto &values = enum_traits<V>::values;
+    std::vector<uint8_t> indices;
+    indices.reserve(count * sizeof(int32_t));
+    column.buffers.push_back(bitmap(
+        count,
+        [&](size_t i) {
+          for (size_t j = 0; j < std::size(values); ++j) {
+            if (values[j].value == get(i)) {
+              append_value(indices, static_cast<int32_t>(j));
+              return true;
+            }
+          }
+          append_value<int32_t>(indices, 0);
+          return false;
+        },
+        &column.null_count));
+    if (column.null_count == 0) {
+      column.buffers[0].clear();
+    } else {
+      column.flags |= ARROW_FLAG_NULLABLE;
+    }
+    column.format = "i";
+    column.buffers.push_back(std::move(indices));
+    column.dictionary = std::make_unique<ArrowColumn>(utf8_column(
+        "", std::size(values), [&](size_t j) { return values[j].name; }));
+  } else if constexpr (std::is_enum_v<V>) {
+    using Underlying = std::underlying_type_t<V>;
+    column = build_column<Underlying>(
+        name, count,
+        [&](size_t i) { return static_cast<Underlying>(get(i)); }, modifiers);
+    return column;
+  } else if constexpr (std::is_same_v<V, bool>) {
+    column.format = "b";
+    column.buffers.push_back({});
+    column.buffers.push_back(bitmap(count, get, nullptr));
+  } else if constexpr (std::is_arithmetic_v<V>) {
+    column.format = arrow_format<V>();
+    std::vector<uint8_t> values(count * sizeof(V));
+    for (size_t i = 0; i < count; ++i) {
+      V value = get(i);
+      std::memcpy(values.data() + i * sizeof(V), &value, sizeof(V));
+    }
+    column.buffers.push_back({});
+    column.buffers.push_back(std::move(values));
+  } else if constexpr (Reflected<V>) {
+    column.format = "+s";
+    column.buffers.push_back({});
+    for_each_descriptor<V>([&](const auto &field) {
+      using Member = std::remove_cvref_t<decltype(std::declval<const V &>().*
+                                                  (field.member))>;
+      column.children.push_back(build_column<Member>(
+          field.name, count,
+          [&](size_t i) -> const Member & { return get(i).*(field.member); },
+          field.modifiers));
+    });
+  } else {
+    static_assert(unsupported_arrow_type<V>,
+                  "Only primitives, strings, enums, std::optional, "
+                  "std::vector and models with model_traits map to Arrow");
+  }
+  column.name = name;
+  column.length = static_cast<int64_t>(count);
+  return column;
+}
+
+struct ArrowSchemaData {
+  std::string format;
+  std::string name;
+  std::vector<ArrowSchema> children;
+  std::vector<ArrowSchema *> pointers;
+  ArrowSchema dictionary{};
+
+  ~ArrowSchemaData() {
+    // The consumer may have moved children out, marking them released.
+    for (ArrowSchema &child : children) {
+      if (child.release) {
+        child.release(&child);
+      }
+    }
+    if (dictionary.release) {
+      dictionary.release(&dictionary);
+    }
+  }
+};
+
+struct ArrowArrayData {
+  std::vector<std::vector<uint8_t>> buffers;
+  std::vector<const void *> pointers;
+  std::vector<ArrowArray> children;
+  std::vector<ArrowArray *> child_pointers;
+  ArrowArray dictionary{};
+
+  ~ArrowArrayData() {
+    for (ArrowArray &child : children) {
+      if (child.release) {
+        child.release(&child);
+      }
+    }
+    if (dictionary.release) {
+      dictionary.release(&dictionary);
+    }
+  }
+};
+
+inline void release_arrow_schema(ArrowSchema *schema) {
+  delete static_cast<ArrowSchemaData *>(schema->private_data);
+  schema->release = nullptr;
+}
+
+inline void release_arrow_array(ArrowArray *array) {
+  delete static_cast<ArrowArrayData *>(array->private_data);
+  array->release = nullptr;
+}
+
+inline void export_schema(const ArrowColumn &column, ArrowSchema *out) {
+  auto data = std::make_unique<ArrowSchemaData>();
+  data->format = column.format;
+  data->name = column.name;
+  data->children.resize(column.children.size());
+  for (size_t i = 0; i < column.children.size(); ++i) {
+    export_schema(column.children[i], &data->children[i]);
+    data->pointers.push_back(&data->children[i]);
+  }
+  if (column.dictionary) {
+    export_schema(*column.dictionary, &data->dictionary);
+  }
+
+  *out = ArrowSchema{};
+  out->format = data->format.c_str();
+  out->name = data->name.c_str();
+  out->flags = column.flags;
+  out->n_children = static_cast<int64_t>(data->children.size());
+  out->children = data->pointers.empty() ? nullptr : data->pointers.data();
+  out->dictionary = column.dictionary ? &data->dictionary : nullptr;
+  out->release = release_arrow_schema;
+  out->private_data = data.release();
+}
+
+// Moves the buffers of `column` into `out`.
+inline void export_array(ArrowColumn &column, ArrowArray *out) {
+  // Only the validity bitmap may be null; other empty buffers point here.
+  static const uint64_t empty_buffer = 0;
+
+  auto data = std::make_unique<ArrowArrayData>();
+  data->buffers = std::move(column.buffers);
+  for (size_t i = 0; i < data->buffers.size(); ++i) {
+    const std::vector<uint8_t> &buffer = data->buffers[i];
+    if (!buffer.empty()) {
+      data->pointers.push_back(buffer.data());
+    } else {
+      data->pointers.push_back(i == 0 ? nullptr : &empty_buffer);
+    }
+  }
+  data->children.resize(column.children.size());
+  for (size_t i = 0; i < column.children.size(); ++i) {
+    export_array(column.children[i], &data->children[i]);
+    data->child_pointers.push_back(&data->children[i]);
+  }
+  if (column.dictionary) {
+    export_array(*column.dictionary, &data->dictionary);
+  }
+
+  *out = ArrowArray{};
+  out->length = column.length;
+  out->null_count = column.null_count;
+  out->n_buffers = static_cast<int64_t>(data->pointers.size());
+  out->n_children = static_cast<int64_t>(data->children.size());
+  out->buffers = data->pointers.data();
+  out->children =
+      data->child_pointers.empty() ? nullptr : data->child_pointers.data();
+  out->dictionary = column.dictionary ? &data->dictionary : nullptr;
+  out->release = release_arrow_array;
+  out->private_data = data.release();
+}
+
+[[noreturn]] inline void arrow_error(const ArrowSchema &schema,
+                                     const std::string &message) {
+  throw std::runtime_error("Arrow field '" +
+                           std::string(schema.name ? schema.name : "") +
+                           "': " + message);
+}
+
+inline void expect_format(const ArrowSchema &schema, std::string_view format) {
+  if (format != schema.format) {
+    arrow_error(schema, "expected format '" + std::string(format) +
+                            "', got '" + schema.format + "'");
+  }
+}
+
+template <typename T>
+const T *arrow_buffer(const ArrowSchema &schema, const ArrowArray &array,
+                      int64_t index) {
+  if (index >= array.n_buffers || !array.buffers[index]) {
+    arrow_error(schema, "missing buffer " + std::to_string(index));
+  }
+  return static_cast<const T *>(array.buffers[index]);
+}
+
+inline void check_range(const ArrowSchema &schema, const ArrowArray &array,
+                        int64_t first, size_t count) {
+  if (first < 0 || first > array.length ||
+      count > static_cast<size_t>(array.length - first)) {
+    arrow_error(schema, "slot range out of bounds");
+  }
+}
+
+inline bool arrow_valid(const ArrowArray &array, int64_t physical) {
+  if (array.null_count == 0 || array.n_buffers == 0 || !array.buffers[0]) {
+    return true;
+  }
+  const auto *bits = static_cast<const uint8_t *>(array.buffers[0]);
+  return (bits[physical / 8] >> (physical % 8)) & 1;
+}
+
+inline bool arrow_bit(const uint8_t *bits, int64_t physical) {
+  return (bits[physical / 8] >> (physical % 8)) & 1;
+}
+
+// Index stored in an integer array of any width, as used for dictionaries.
+inline int64_t arrow_index(const ArrowSchema &schema, const ArrowArray &array,
+                           int64_t physical) {
+  const void *values = arrow_buffer<void>(schema, array, 1);
+  std::string_view format(schema.format);
+  switch (format.size() == 1 ? format[0] : '\0') {
+  case 'c':
+    return static_cast<const int8_t *>(values)[physical];
+  case 'C':
+    return static_cast<const uint8_t *>(values)[physical];
+  case 's':
+    return static_cast<const int16_t *>(values)[physical];
+  case 'S':
+    return static_cast<const uint16_t *>(values)[physical];
+  case 'i':
+    return static_cast<const int32_t *>(values)[physical];
+  case 'I':
+    return static_cast<const uint32_t *>(values)[physical];
+  case 'l':
+    return static_cast<const int64_t *>(values)[physical];
+  case 'L':
+    return static_cast<int64_t>(
+        static_cast<const uint64_t *>(values)[physical]);
+  default:
+    arrow_error(schema, std::string("unsupported index format '") +
+                            schema.format + "'");
+  }
+}
+
+// Slot `index` (logical, before the array offset) of a utf8 or large utf8
+// array.
+inline std::string_view arrow_string(const ArrowSchema &schema,
+                                     const ArrowArray &array, int64_t index) {
+  check_range(schema, array, index, 1);
+  int64_t physical = array.offset + index;
+  int64_t begin = 0;
+  int64_t end = 0;
+  if (std::string_view(schema.format) == "u") {
+    const int32_t *offsets = arrow_buffer<int32_t>(schema, array, 1);
+    begin = offsets[physical];
+    end = offsets[physical + 1];
+  } else if (std::string_view(schema.format) == "U") {
+    const int64_t *offsets = arrow_buffer<int64_t>(schema, array, 1);
+    begin = offsets[physical];
+    end = offsets[physical + 1];
+  } else {
+    expect_format(schema, "u");
+  }
+  if (begin < 0 || end < begin) {
+    arrow_error(schema, "invalid string offsets");
+  }
+  if (begin == end) {
+    return {};
+  }
+  const char *bytes = arrow_buffer<char>(schema, array, 2);
+  return std::string_view(bytes + begin, static_cast<size_t>(end - begin));
+}
+
+template <typename V, typename Get>
+void read_column(const ArrowSchema &schema, const ArrowArray &array,
+                 int64_t first, size_t count, const Get &get);
+
+template <typename Offset, typename V, typename Get>
+void read_list(const ArrowSchema &schema, const ArrowArray &array,
+               int64_t first, size_t count, const Get &get) {
+  using U = typename V::value_type;
+  if (schema.n_children != 1 || array.n_children != 1) {
+    arrow_error(schema, "list must have one child");
+  }
+  const ArrowSchema &item_schema = *schema.children[0];
+  const ArrowArray &items = *array.children[0];
+  const Offset *offsets = arrow_buffer<Offset>(schema, array, 1);
+
+  for (size_t i = 0; i < count; ++i) {
+    int64_t physical = array.offset + first + static_cast<int64_t>(i);
+    V &target = get(i);
+    target.clear();
+    if (!arrow_valid(array, physical)) {
+      continue;
+    }
+    int64_t begin = static_cast<int64_t>(offsets[physical]);
+    int64_t end = static_cast<int64_t>(offsets[physical + 1]);
+    if (end < begin) {
+      arrow_error(schema, "invalid list offsets");
+    }
+    size_t size = static_cast<size_t>(end - begin);
+    check_range(item_schema, items, begin, size);
+
+    if constexpr (std::is_same_v<U, bool>) {
+      expect_format(item_schema, "b");
+      const uint8_t *bits = arrow_buffer<uint8_t>(item_schema, items, 1);
+      target.resize(size);
+      for (size_t j = 0; j < size; ++j) {
+        int64_t at = items.offset + begin + static_cast<int64_t>(j);
+        target[j] = arrow_valid(items, at) && arrow_bit(bits, at);
+      }
+    } else if constexpr (std::is_arithmetic_v<U>) {
+      expect_format(item_schema, arrow_format<U>());
+      if (size == 0) {
+        continue;
+      }
+      // Elements are copied whole; nulls become zero afterwards.
+      const U *values = arrow_buffer<U>(item_schema, items, 1);
+      target.assign(values + items.offset + begin,
+                    values + items.offset + end);
+      if (items.null_count != 0) {
+        for (size_t j = 0; j < size; ++j) {
+          if (!arrow_valid(items, items.offset + begin +
+                                      static_cast<int64_t>(j))) {
+            target[j] = U{};
+          }
+        }
+      }
+    } else {
+      target.resize(size);
+      read_column<U>(item_schema, items, begin, size,
+                     [&](size_t j) -> U & { return target[j]; });
+    }
+  }
+}
+
+// Reads slots [first, first + count) of `array` (logical, before its
+// offset) into get(0) .. get(count - 1).
+template <typename V, typename Get>
+void read_column(const ArrowSchema &schema, const ArrowArray &array,
+                 int64_t first, size_t count, const Get &get) {
+  check_range(schema, array, first, count);
+  int64_t base = array.offset + first;
+  [[maybe_unused]] auto valid = [&](size_t i) {
+    return arrow_valid(array, base + static_cast<int64_t>(i));
+  };
+
+  if constexpr (is_optional<V>::value) {
+    using U = typename V::value_type;
+    U scratch{};
+    read_column<U>(schema, array, first, count, [&](size_t i) -> U & {
+      V &target = get(i);
+      if (!valid(i)) {
+        target.reset();
+        return scratch;
+      }
+      return target ? *target : target.emplace();
+    });
+  } else if constexpr (is_vector<V>::value) {
+    if (std::string_view(schema.format) == "+l") {
+      read_list<int32_t, V>(schema, array, first, count, get);
+    } else if (std::string_view(schema.format) == "+L") {
+      read_list<int64_t, V>(schema, array, first, count, get);
+    } else {
+      expect_format(schema, "+l");
+    }
+  } else if constexpr (std::is_same_v<V, std::string>) {
+    if (schema.dictionary) {
+      if (!array.dictionary) {
+        arrow_error(schema, "missing dictionary");
+      }
+      for (size_t i = 0; i < count; ++i) {
+        if (valid(i)) {
+          get(i).assign(arrow_string(
+              *schema.dictionary, *array.dictionary,
+              arrow_index(schema, array, base + static_cast<int64_t>(i))));
+        } else {
+          get(i).clear();
+        }
+      }
+    } else {
+      for (size_t i = 0; i < count; ++i) {
+        get(i).assign(valid(i) ? arrow_string(schema, array,
+                                              first + static_cast<int64_t>(i))
+                               : std::string_view());
+      }
+    }
+  } else if constexpr (std::is_enum_v<V>) {
+    if (!schema.dictionary) {
+      using Underlying = std::underlying_type_t<V>;
+      std::vector<Underlying> values(count);
+      read_column<Underlying>(
+          schema, array, first, count,
+          [&](size_t i) -> Underlying & { return values[i]; });
+      for (size_t i = 0; i < count; ++i) {
+        get(i) = static_cast<V>(values[i]);
+      }
+    } else if constexpr (ReflectedEnum<V>) {
+      if (!array.dictionary) {
+        arrow_error(schema, "missing dictionary");
+      }
+      // Dictionary entries are matched to enumerators by name.
+      constexpr auto &enumerators = enum_traits<V>::values;
+      const ArrowArray &dictionary = *array.dictionary;
+      std::vector<std::optional<V>> mapping(
+          static_cast<size_t>(dictionary.length));
+      for (int64_t j = 0; j < dictionary.length; ++j) {
+        std::string_view name = arrow_string(*schema.dictionary, dictionary, j);
+        for (const auto &enumerator : enumerators) {
+          if (enumerator.name == name) {
+            mapping[static_cast<size_t>(j)] = enumerator.value;
+          }
+        }
+      }
+      for (size_t i = 0; i < count; ++i) {
+        if (!valid(i)) {
+          get(i) = V{};
+          continue;
+        }
+        int64_t index =
+            arrow_index(schema, array, base + static_cast<int64_t>(i));
+        if (index < 0 || index >= dictionary.length ||
+            !mapping[static_cast<size_t>(index)]) {
+          arrow_error(schema, "dictionary value is not an enumerator");
+        }
+        get(i) = *mapping[static_cast<size_t>(index)];
+      }
+    } else {
+      arrow_error(schema, "dictionary-encoded enum without enum_traits");
+    }
+  } else if constexpr (std::is_same_v<V, bool>) {
+    expect_format(schema, "b");
+    const uint8_t *bits = count ? arrow_buffer<uint8_t>(schema, array, 1)
+                                : nullptr;
+    for (size_t i = 0; i < count; ++i) {
+      get(i) = valid(i) && arrow_bit(bits, base + static_cast<int64_t>(i));
+    }
+  } else if constexpr (std::is_arithmetic_v<V>) {
+    expect_format(schema, arrow_format<V>());
+    const V *values = count ? arrow_buffer<V>(schema, array, 1) : nullptr;
+    for (size_t i = 0; i < count; ++i) {
+      get(i) = valid(i) ? values[base + static_cast<int64_t>(i)] : V{};
+    }
+  } else if constexpr (Reflected<V>) {
+    expect_format(schema, "+s");
+    if (schema.n_children != array.n_children) {
+      arrow_error(schema, "schema and array children differ");
+    }
+    // Children are matched by name; fields without one keep their value.
+    for_each_descriptor<V>([&](const auto &field) {
+      using Member = std::remove_cvref_t<decltype(std::declval<V &>().*
+                                                  (field.member))>;
+      for (int64_t c = 0; c < schema.n_children; ++c) {
+        const ArrowSchema &child = *schema.children[c];
+        if (child.name && field.name == child.name) {
+          read_column<Member>(
+              child, *array.children[c], base, count,
+              [&](size_t i) -> Member & { return get(i).*(field.member); });
+          break;
+        }
+      }
+    });
+  } else {
+    static_assert(unsupported_arrow_type<V>,
+                  "Only primitives, strings, enums, std::optional, "
+                  "std::vector and models with model_traits map to Arrow");
+  }
+}
+
+} // namespace detail
+
+// Exports `rows` as an Arrow struct array (a record batch) with one child
+// per field. Scalars map to primitive arrays, strings to utf8, optional
+// fields to nullable children, repeated fields to lists and nested models
+// to structs. Enums and interned strings are dictionary-encoded. Both
+// structs are owned by the caller, who must call their release callbacks.
+template <Reflected T>
+void to_arrow_columns(std::span<const T> rows, ArrowSchema *schema,
+                      ArrowArray *array) {
+  detail::ArrowColumn column = detail::build_column<T>(
+      "", rows.size(), [&](size_t i) -> const T & { return rows[i]; }, 0);
+  detail::export_schema(column, schema);
+  try {
+    detail::export_array(column, array);
+  } catch (...) {
+    schema->release(schema);
+    throw;
+  }
+}
+
+template <Reflected T>
+void to_arrow_columns(const std::vector<T> &rows, ArrowSchema *schema,
+                      ArrowArray *array) {
+  to_arrow_columns(std::span<const T>(rows), schema, array);
+}
+
+// Appends one row per slot of an Arrow struct array to `rows`. Children are
+// matched to fields by name; fields without a child keep their defaults.
+// Accepts what to_arrow_columns() produces, as well as large (64-bit
+// offset) lists and strings, any integer dictionary index and plain integer
+// enums. Throws std::runtime_error if a child's type does not fit its field.
+// Neither struct is released.
+template <Reflected T>
+void from_arrow(const ArrowSchema *schema, const ArrowArray *array,
+                std::vector<T> &rows) {
+  size_t offset = rows.size();
+  size_t count = static_cast<size_t>(array->length);
+  rows.resize(offset + count);
+  try {
+    detail::read_column<T>(*schema, *array, 0, count,
+                           [&](size_t i) -> T & { return rows[offset + i]; });
+  } catch (...) {
+    rows.resize(offset);
+    throw;
+  }
+}
+
+} // namespace serialkit
+
+#endif // SERIALKIT_ARROW_HPP
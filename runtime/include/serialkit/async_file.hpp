@@ -0,0 +1,815 @@
+#ifndef SERIALKIT_ASYNC_FILE_HPP
+#define SERIALKIT_ASYNC_FILE_HPP
+
+#include "record_file.hpp"
+
+#if !defined(_WIN32)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define SERIALKIT_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace serialkit {
+
+constexpr size_t DEFAULT_ASYNC_BUFFER_SIZE = 256 * 1024;
+constexpr size_t DEFAULT_ASYNC_QUEUE_DEPTH = 8;
+
+// AUTO uses io_uring when the kernel allows it and pread()/pwrite()
+// otherwise; the other two force a backend, e.g. to benchmark one against
+// the other.
+enum class IoBackend : uint8_t { AUTO, IO_URING, SYNC };
+
+struct AsyncFileOptions {
+  size_t buffer_size = DEFAULT_ASYNC_BUFFER_SIZE;
+  size_t queue_depth = DEFAULT_ASYNC_QUEUE_DEPTH;
+  IoBackend backend = IoBackend::AUTO;
+};
+
+namespace detail {
+
+inline void sys_pwrite_all(int fd, const uint8_t *data, size_t size,
+                           uint64_t offset) {
+  while (size > 0) {
+    ssize_t result = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "pwrite");
+    }
+    data += result;
+    size -= static_cast<size_t>(result);
+    offset += static_cast<uint64_t>(result);
+  }
+}
+
+// Reads until `size` bytes or end of file; returns the number read.
+inline size_t sys_pread_full(int fd, uint8_t *data, size_t size,
+                             uint64_t offset) {
+  size_t total = 0;
+  while (total < size) {
+    ssize_t result = ::pread(fd, data + total, size - total,
+                             static_cast<off_t>(offset + total));
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "pread");
+    }
+    if (result == 0) {
+      break;
+    }
+    total += static_cast<size_t>(result);
+  }
+  return total;
+}
+
+#if defined(SERIALKIT_HAS_IO_URING)
+
+// Minimal io_uring instance on raw system calls: one submission and one
+// completion ring mapped into user space, so that queueing an operation is
+// a plain memory write and a single io_uring_enter() submits a whole batch.
+class IoUring {
+public:
+  explicit IoUring(unsigned entries) {
+    io_uring_params params{};
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+    }
+    fd_ = fd;
+
+    try {
+      sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+      if (single_mmap) {
+        sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+      }
+
+      sq_ring_ = map(sq_size_, IORING_OFF_SQ_RING);
+      cq_ring_ = single_mmap ? sq_ring_ : map(cq_size_, IORING_OFF_CQ_RING);
+      sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+      sqes_ = static_cast<io_uring_sqe *>(map(sqes_size_, IORING_OFF_SQES));
+    } catch (...) {
+      release();
+      throw;
+    }
+
+    auto *sq = static_cast<uint8_t *>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+    auto *cq = static_cast<uint8_t *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  }
+
+  IoUring(const IoUring &) = delete;
+  IoUring &operator=(const IoUring &) = delete;
+
+  ~IoUring() { release(); }
+
+  // Pins `buffers` in the kernel so that fixed reads and writes skip the
+  // per-operation page mapping. Fails e.g. under a low RLIMIT_MEMLOCK.
+  bool register_buffers(const iovec *buffers, unsigned count) {
+    return ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS,
+                     buffers, count) == 0;
+  }
+
+  // Queues an operation; the caller keeps at most `entries` outstanding.
+  void push(uint8_t opcode, int fd, uint8_t *data, size_t size,
+            uint64_t offset, int buffer_index, uint64_t user_data) {
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & sq_mask_;
+    io_uring_sqe &sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = opcode;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<uint64_t>(data);
+    sqe.len = static_cast<uint32_t>(size);
+    sqe.off = offset;
+    sqe.buf_index = static_cast<uint16_t>(buffer_index);
+    sqe.user_data = user_data;
+    sq_array_[index] = index;
+    std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1,
+                                               std::memory_order_release);
+    ++queued_;
+  }
+
+  // Submits everything queued and waits for at least `min_complete`
+  // completions.
+  void enter(unsigned min_complete) {
+    while (queued_ > 0 || min_complete > 0) {
+      unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+      long result = ::syscall(__NR_io_uring_enter, fd_, queued_, min_complete,
+                              flags, nullptr, 0);
+      if (result < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::system_error(errno, std::generic_category(),
+                                "io_uring_enter");
+      }
+      queued_ -= static_cast<unsigned>(result);
+      if (queued_ == 0) {
+        return;
+      }
+      min_complete = 0;
+    }
+  }
+
+  unsigned queued() const { return queued_; }
+
+  // Calls on_complete(user_data, result) for every available completion.
+  template <typename F> size_t reap(F &&on_complete) {
+    unsigned head = *cq_head_;
+    unsigned tail =
+        std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+    size_t count = 0;
+    for (; head != tail; ++head, ++count) {
+      const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+      uint64_t user_data = cqe.user_data;
+      int result = cqe.res;
+      std::atomic_ref<unsigned>(*cq_head_).store(head + 1,
+                                                 std::memory_order_release);
+      on_complete(user_data, result);
+    }
+    return count;
+  }
+
+private:
+  void *map(size_t size, off_t offset) {
+    void *mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd_, offset);
+    if (mapping == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(), "mmap");
+    }
+    return mapping;
+  }
+
+  void release() {
+    if (sqes_ != nullptr) {
+      ::munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+      ::munmap(cq_ring_, cq_size_);
+    }
+    if (sq_ring_ != nullptr) {
+      ::munmap(sq_ring_, sq_size_);
+    }
+    ::close(fd_);
+  }
+
+  int fd_ = -1;
+  void *sq_ring_ = nullptr;
+  void *cq_ring_ = nullptr;
+  size_t sq_size_ = 0;
+  size_t cq_size_ = 0;
+  size_t sqes_size_ = 0;
+  io_uring_sqe *sqes_ = nullptr;
+  unsigned *sq_tail_ = nullptr;
+  unsigned *sq_array_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+  unsigned queued_ = 0;
+};
+
+#endif
+
+} // namespace detail
+
+// Positional reads and writes on a file descriptor through a fixed pool of
+// `queue_depth` buffers of `buffer_size` bytes. With io_uring the buffers
+// are registered with the kernel, operations are queued without system
+// calls and submitted in batches, and completed writes hand their buffer
+// back to the pool. The SYNC backend performs each operation immediately
+// with pread()/pwrite(), so the same code runs everywhere.
+//
+// A buffer is acquire()d, filled, and passed to submit_write(); or passed
+// to submit_read(), then wait()ed for and release()d. I/O errors surface
+// from the call that observes them: submit_*() on the SYNC backend,
+// acquire(), wait() or drain() with io_uring. Not thread-safe.
+class AsyncFile {
+public:
+  explicit AsyncFile(int fd, const AsyncFileOptions &options = {})
+      : fd_(fd), buffer_size_(std::max<size_t>(options.buffer_size, 1)),
+        slots_(std::max<size_t>(options.queue_depth, 1)) {
+    memory_.reset(new uint8_t[buffer_size_ * slots_.size()]);
+    for (size_t i = slots_.size(); i-- > 0;) {
+      free_.push_back(static_cast<uint32_t>(i));
+    }
+    submit_batch_ = std::max<size_t>(slots_.size() / 2, 1);
+
+#if defined(SERIALKIT_HAS_IO_URING)
+    if (options.backend != IoBackend::SYNC) {
+      try {
+        ring_ = std::make_unique<detail::IoUring>(
+            static_cast<unsigned>(slots_.size()));
+      } catch (const std::system_error &) {
+        if (options.backend == IoBackend::IO_URING) {
+          throw;
+        }
+      }
+    }
+    if (ring_) {
+      std::vector<iovec> buffers(slots_.size());
+      for (size_t i = 0; i < slots_.size(); ++i) {
+        buffers[i] = {buffer(i), buffer_size_};
+      }
+      fixed_buffers_ = ring_->register_buffers(
+          buffers.data(), static_cast<unsigned>(buffers.size()));
+    }
+#endif
+    if (options.backend == IoBackend::IO_URING && !uses_io_uring()) {
+      throw std::system_error(std::make_error_code(std::errc::not_supported),
+                              "io_uring");
+    }
+  }
+
+  AsyncFile(const AsyncFile &) = delete;
+  AsyncFile &operator=(const AsyncFile &) = delete;
+
+  // Waits for outstanding operations, since they use the buffers.
+  ~AsyncFile() {
+    try {
+      drain();
+    } catch (...) {
+    }
+  }
+
+  IoBackend backend() const {
+    return uses_io_uring() ? IoBackend::IO_URING : IoBackend::SYNC;
+  }
+
+  size_t buffer_size() const { return buffer_size_; }
+
+  // Returns a free buffer, waiting for in-flight writes if necessary.
+  uint8_t *acquire() {
+    while (free_.empty()) {
+      if (in_flight_ == 0) {
+        throw std::logic_error("Every AsyncFile buffer is held by a read");
+      }
+      wait_for_completions(1);
+    }
+    return take_free();
+  }
+
+  // Like acquire(), but returns nullptr instead of waiting.
+  uint8_t *try_acquire() {
+    throw_write_error();
+    return free_.empty() ? nullptr : take_free();
+  }
+
+  // Writes `size` bytes of `data` (an acquired buffer) at `offset`. The
+  // buffer returns to the pool once written.
+  void submit_write(uint8_t *data, size_t size, uint64_t offset) {
+    Slot &slot = slot_for(data);
+    if (!uses_io_uring()) {
+      free_.push_back(index_of(data));
+      detail::sys_pwrite_all(fd_, data, size, offset);
+      return;
+    }
+    start(slot, Operation::WRITE, size, offset);
+  }
+
+  // Reads up to `size` bytes at `offset` into an acquired buffer.
+  void submit_read(uint8_t *data, size_t size, uint64_t offset) {
+    Slot &slot = slot_for(data);
+    if (!uses_io_uring()) {
+      slot.operation = Operation::READ;
+      slot.state = State::DONE;
+      slot.error = 0;
+      slot.done = detail::sys_pread_full(fd_, data, size, offset);
+      return;
+    }
+    start(slot, Operation::READ, size, offset);
+  }
+
+  // Waits for the read into `data`; returns the number of bytes read, which
+  // is smaller than requested only at end of file.
+  size_t wait(uint8_t *data) {
+    Slot &slot = slot_for(data);
+    while (slot.state != State::DONE) {
+      wait_for_completions(1);
+    }
+    if (slot.error != 0) {
+      throw std::system_error(slot.error, std::generic_category(), "read");
+    }
+    return slot.done;
+  }
+
+  // Returns a buffer whose read has been waited for.
+  void release(uint8_t *data) {
+    Slot &slot = slot_for(data);
+    slot.state = State::FREE;
+    free_.push_back(index_of(data));
+  }
+
+  // Submits queued operations without waiting for them.
+  void flush() {
+#if defined(SERIALKIT_HAS_IO_URING)
+    if (ring_) {
+      ring_->enter(0);
+    }
+#endif
+  }
+
+  // Waits until nothing is in flight.
+  void drain() {
+    while (in_flight_ > 0) {
+      wait_for_completions(1);
+    }
+    throw_write_error();
+  }
+
+private:
+  enum class Operation : uint8_t { READ, WRITE };
+  enum class State : uint8_t { FREE, IN_FLIGHT, DONE };
+
+  struct Slot {
+    Operation operation = Operation::READ;
+    State state = State::FREE;
+    int error = 0;
+    uint64_t offset = 0;
+    size_t size = 0;
+    size_t done = 0;
+  };
+
+  bool uses_io_uring() const {
+#if defined(SERIALKIT_HAS_IO_URING)
+    return ring_ != nullptr;
+#else
+    return false;
+#endif
+  }
+
+  uint8_t *buffer(size_t index) { return memory_.get() + index * buffer_size_; }
+
+  uint32_t index_of(const uint8_t *data) const {
+    return static_cast<uint32_t>(static_cast<size_t>(data - memory_.get()) /
+                                 buffer_size_);
+  }
+
+  Slot &slot_for(const uint8_t *data) { return slots_[index_of(data)]; }
+
+  uint8_t *take_free() {
+    uint32_t index = free_.back();
+    free_.pop_back();
+    slots_[index].state = State::FREE;
+    return buffer(index);
+  }
+
+  void throw_write_error() {
+    if (write_error_ != 0) {
+      int error = write_error_;
+      write_error_ = 0;
+      throw std::system_error(error, std::generic_category(), "write");
+    }
+  }
+
+#if defined(SERIALKIT_HAS_IO_URING)
+  void start(Slot &slot, Operation operation, size_t size, uint64_t offset) {
+    slot.operation = operation;
+    slot.state = State::IN_FLIGHT;
+    slot.error = 0;
+    slot.offset = offset;
+    slot.size = size;
+    slot.done = 0;
+    ++in_flight_;
+    push(static_cast<uint32_t>(&slot - slots_.data()));
+    if (ring_->queued() >= submit_batch_) {
+      ring_->enter(0);
+    }
+  }
+
+  void push(uint32_t index) {
+    const Slot &slot = slots_[index];
+    uint8_t opcode;
+    if (slot.operation == Operation::WRITE) {
+      opcode = fixed_buffers_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    } else {
+      opcode = fixed_buffers_ ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    }
+    ring_->push(opcode, fd_, buffer(index) + slot.done, slot.size - slot.done,
+                slot.offset + slot.done,
+                fixed_buffers_ ? static_cast<int>(index) : 0, index);
+  }
+
+  void wait_for_completions(unsigned count) {
+    ring_->enter(count);
+    ring_->reap([this](uint64_t index, int result) {
+      complete(static_cast<uint32_t>(index), result);
+    });
+  }
+
+  // Short transfers are resumed where they stopped; a read that returns 0
+  // has reached end of file.
+  void complete(uint32_t index, int result) {
+    Slot &slot = slots_[index];
+    if (result == -EINTR || result == -EAGAIN) {
+      push(index);
+      return;
+    }
+    if (result > 0) {
+      slot.done += static_cast<size_t>(result);
+      if (slot.done < slot.size) {
+        push(index);
+        return;
+      }
+    }
+
+    --in_flight_;
+    int error = result < 0 ? -result : 0;
+    if (slot.operation == Operation::WRITE) {
+      if (error == 0 && slot.done < slot.size) {
+        error = EIO;
+      }
+      if (error != 0 && write_error_ == 0) {
+        write_error_ = error;
+      }
+      slot.state = State::FREE;
+      free_.push_back(index);
+    } else {
+      slot.error = error;
+      slot.state = State::DONE;
+    }
+  }
+#else
+  void start(Slot &, Operation, size_t, uint64_t) {}
+  void wait_for_completions(unsigned) {}
+#endif
+
+  int fd_;
+  size_t buffer_size_;
+  std::unique_ptr<uint8_t[]> memory_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_;
+  size_t in_flight_ = 0;
+  size_t submit_batch_ = 1;
+  int write_error_ = 0;
+#if defined(SERIALKIT_HAS_IO_URING)
+  std::unique_ptr<detail::IoUring> ring_;
+  bool fixed_buffers_ = false;
+#endif
+};
+
+// Sequential ByteWriter over an AsyncFile: bytes are staged in the file's
+// buffers and each full buffer is written at the next file offset while the
+// caller keeps filling the following one.
+class AsyncFileWriter {
+public:
+  explicit AsyncFileWriter(int fd, const AsyncFileOptions &options = {})
+      : file_(fd, options) {}
+
+  AsyncFileWriter(const AsyncFileWriter &) = delete;
+  AsyncFileWriter &operator=(const AsyncFileWriter &) = delete;
+
+  ~AsyncFileWriter() {
+    try {
+      flush();
+    } catch (...) {
+    }
+  }
+
+  void write(const uint8_t *data, size_t size) {
+    while (size > 0) {
+      if (current_ == nullptr) {
+        current_ = file_.acquire();
+      }
+      size_t count = std::min(size, file_.buffer_size() - used_);
+      std::memcpy(current_ + used_, data, count);
+      used_ += count;
+      data += count;
+      size -= count;
+      if (used_ == file_.buffer_size()) {
+        submit();
+      }
+    }
+  }
+
+  // Frames larger than a buffer are staged separately and copied in commit().
+  uint8_t *prepare(size_t size) {
+    if (size > file_.buffer_size()) {
+      oversized_.resize(size);
+      return oversized_.data();
+    }
+    if (current_ != nullptr && size > file_.buffer_size() - used_) {
+      submit();
+    }
+    if (current_ == nullptr) {
+      current_ = file_.acquire();
+    }
+    return current_ + used_;
+  }
+
+  void commit(size_t size) {
+    if (!oversized_.empty()) {
+      std::vector<uint8_t> staged;
+      staged.swap(oversized_);
+      write(staged.data(), size);
+      return;
+    }
+    used_ += size;
+    if (used_ == file_.buffer_size()) {
+      submit();
+    }
+  }
+
+  // Writes the partially filled buffer and waits for every write.
+  void flush() {
+    if (used_ > 0) {
+      submit();
+    }
+    file_.drain();
+  }
+
+  IoBackend backend() const { return file_.backend(); }
+
+private:
+  void submit() {
+    uint8_t *buffer = current_;
+    size_t size = used_;
+    current_ = nullptr;
+    used_ = 0;
+    file_.submit_write(buffer, size, offset_);
+    offset_ += size;
+  }
+
+  AsyncFile file_;
+  uint8_t *current_ = nullptr;
+  size_t used_ = 0;
+  uint64_t offset_ = 0;
+  std::vector<uint8_t> oversized_;
+};
+
+// Record file writer whose output goes through AsyncFileWriter. Produces
+// the same files as RecordFileWriter; pass AsyncFileOptions after the block
+// size to choose the backend, buffer size and queue depth.
+using AsyncRecordFileWriter = BasicRecordFileWriter<AsyncFileWriter>;
+
+// Reads every record of a record file in order without mapping it: the
+// body is read in buffer-sized chunks with up to `queue_depth` reads in
+// flight ahead of the consumer, which suits files larger than memory or
+// streamed once. Compressed blocks are decompressed as they are reached.
+class RecordFileScanner {
+public:
+  explicit RecordFileScanner(const std::string &path,
+                             const Codec &codec = default_codec(),
+                             const AsyncFileOptions &options = {})
+      : fd_(detail::sys_open(path, false)), codec_(codec) {
+    try {
+      read_layout(path);
+      file_ = std::make_unique<AsyncFile>(fd_, options);
+    } catch (...) {
+      detail::sys_close(fd_);
+      throw;
+    }
+    read_offset_ = RECORD_FILE_HEADER_SIZE;
+  }
+
+  RecordFileScanner(const RecordFileScanner &) = delete;
+  RecordFileScanner &operator=(const RecordFileScanner &) = delete;
+
+  ~RecordFileScanner() {
+    file_.reset();
+    detail::sys_close(fd_);
+  }
+
+  size_t size() const { return static_cast<size_t>(count_); }
+
+  bool compressed() const { return compressed_; }
+
+  IoBackend backend() const { return file_->backend(); }
+
+  // Yields the next record, valid until the following call; returns false
+  // after the last one. Throws std::runtime_error on corruption.
+  bool next(std::span<const uint8_t> &record) {
+    if (compressed_) {
+      while (block_position_ == block_buffer_.size()) {
+        std::span<const uint8_t> frame;
+        if (!next_frame(frame)) {
+          return finish();
+        }
+        if (!decode_block(codec_, frame, block_buffer_,
+                          DEFAULT_MAX_MESSAGE_SIZE)) {
+          throw std::runtime_error("Corrupted record block");
+        }
+        block_position_ = 0;
+      }
+
+      std::span<const uint8_t> rest =
+          std::span<const uint8_t>(block_buffer_).subspan(block_position_);
+      uint64_t length = 0;
+      size_t prefix_size = 0;
+      if (read_varint(rest, length, prefix_size) != ReadStatus::OK ||
+          length > rest.size() - prefix_size) {
+        throw std::runtime_error("Corrupted record block");
+      }
+      record = rest.subspan(prefix_size, static_cast<size_t>(length));
+      block_position_ += prefix_size + static_cast<size_t>(length);
+    } else if (!next_frame(record)) {
+      return finish();
+    }
+
+    if (++scanned_ > count_) {
+      throw std::runtime_error("Record file holds more records than indexed");
+    }
+    return true;
+  }
+
+  // Decodes the next record into `message`; returns false after the last.
+  template <typename T> bool read(T &message) {
+    std::span<const uint8_t> record;
+    if (!next(record)) {
+      return false;
+    }
+    if (!message.deserialize(record)) {
+      throw std::runtime_error("Malformed record");
+    }
+    return true;
+  }
+
+private:
+  void read_layout(const std::string &path) {
+    struct stat info;
+    if (::fstat(fd_, &info) != 0) {
+      throw std::system_error(errno, std::generic_category(), "fstat");
+    }
+    uint64_t file_size = static_cast<uint64_t>(info.st_size);
+
+    uint8_t header[RECORD_FILE_HEADER_SIZE];
+    uint8_t footer[RECORD_FILE_FOOTER_SIZE];
+    if (file_size < RECORD_FILE_HEADER_SIZE + RECORD_FILE_FOOTER_SIZE ||
+        detail::sys_pread_full(fd_, header, sizeof(header), 0) !=
+            sizeof(header) ||
+        detail::load_le32(header) != RECORD_FILE_MAGIC) {
+      throw std::runtime_error("Not a record file: " + path);
+    }
+    if (detail::load_le32(header + 4) != RECORD_FILE_VERSION) {
+      throw std::runtime_error("Unsupported record file version: " + path);
+    }
+
+    uint64_t footer_offset = file_size - RECORD_FILE_FOOTER_SIZE;
+    if (detail::sys_pread_full(fd_, footer, sizeof(footer), footer_offset) !=
+        sizeof(footer)) {
+      throw std::runtime_error("Corrupted record file footer: " + path);
+    }
+    records_end_ = detail::load_le64(footer);
+    count_ = detail::load_le64(footer + 8);
+    uint32_t flags = detail::load_le32(footer + 16);
+    compressed_ = (flags & RECORD_FILE_COMPRESSED) != 0;
+    if ((flags & RECORD_FILE_CRC32C) != 0) {
+      framer_ = StreamReader(DEFAULT_MAX_MESSAGE_SIZE, Checksum::CRC32C);
+    }
+    if (detail::load_le32(footer + 20) != RECORD_FILE_MAGIC ||
+        records_end_ < RECORD_FILE_HEADER_SIZE ||
+        records_end_ > footer_offset) {
+      throw std::runtime_error("Corrupted record file footer: " + path);
+    }
+  }
+
+  bool finish() {
+    if (scanned_ != count_) {
+      throw std::runtime_error("Record file holds fewer records than indexed");
+    }
+    return false;
+  }
+
+  // Keeps every free buffer busy reading ahead, then submits the batch.
+  void read_ahead() {
+    while (read_offset_ < records_end_) {
+      uint8_t *buffer = file_->try_acquire();
+      if (buffer == nullptr) {
+        break;
+      }
+      size_t size = static_cast<size_t>(
+          std::min<uint64_t>(file_->buffer_size(), records_end_ - read_offset_));
+      file_->submit_read(buffer, size, read_offset_);
+      pending_.push_back({buffer, size});
+      read_offset_ += size;
+    }
+    file_->flush();
+  }
+
+  bool next_frame(std::span<const uint8_t> &frame) {
+    while (true) {
+      ReadStatus status = framer_.next(frame);
+      if (status == ReadStatus::OK) {
+        return true;
+      }
+      if (status == ReadStatus::MALFORMED) {
+        throw std::runtime_error("Corrupted record frame");
+      }
+
+      read_ahead();
+      if (pending_.empty()) {
+        if (framer_.buffered() > 0) {
+          throw std::runtime_error("Truncated record frame");
+        }
+        return false;
+      }
+      auto [buffer, size] = pending_.front();
+      pending_.pop_front();
+      size_t count = file_->wait(buffer);
+      if (count != size) {
+        file_->release(buffer);
+        throw std::runtime_error("Record file is truncated");
+      }
+      framer_.feed(std::span<const uint8_t>(buffer, count));
+      file_->release(buffer);
+    }
+  }
+
+  struct PendingRead {
+    uint8_t *buffer;
+    size_t size;
+  };
+
+  int fd_;
+  const Codec &codec_;
+  std::unique_ptr<AsyncFile> file_;
+  uint64_t records_end_ = 0;
+  uint64_t count_ = 0;
+  bool compressed_ = false;
+
+  uint64_t read_offset_ = 0;
+  std::deque<PendingRead> pending_;
+  StreamReader framer_;
+  uint64_t scanned_ = 0;
+  std::vector<uint8_t> block_buffer_;
+  size_t block_position_ = 0;
+};
+
+} // namespace serialkit
+
+#endif
+
+#endif // SERIALKIT_ASYNC_FILE_HPP
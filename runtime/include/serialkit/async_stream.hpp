@@ -0,0 +1,89 @@
+#ifndef SERIALKIT_ASYNC_STREAM_HPP
+#define SERIALKIT_ASYNC_STREAM_HPP
+
+#include "stream.hpp"
+#include "task.hpp"
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+namespace serialkit {
+
+// Source of bytes for coroutines: async_read(buffer) returns an awaitable
+// that completes with the number of bytes stored into `buffer`, 0 at end of
+// stream. The awaitable decides how to wait, e.g. by registering the
+// suspended coroutine with an event loop until the socket is readable.
+template <typename R>
+concept AsyncByteReader = requires(R &reader, std::span<uint8_t> buffer) {
+  { reader.async_read(buffer) };
+};
+
+// Coroutine counterpart of StreamReader::fill() and next(). Reads go
+// straight into the framer's buffer, which is sized to the rest of a
+// pending frame, and a partial frame is never re-scanned: each resumption
+// only checks the length prefix against the bytes buffered so far, so a
+// large message arriving in many chunks costs one copy and one decode.
+template <AsyncByteReader Reader> class AsyncStreamReader {
+public:
+  explicit AsyncStreamReader(Reader &reader,
+                             size_t max_message_size = DEFAULT_MAX_MESSAGE_SIZE,
+                             size_t read_size = 4096)
+      : reader_(reader), framer_(max_message_size), read_size_(read_size) {}
+
+  // Completes with OK and the next frame (valid until the next call),
+  // MALFORMED, or NEED_MORE once the stream has ended; a partial frame left
+  // at that point shows up in buffered().
+  task<ReadStatus> next(std::span<const uint8_t> &frame) {
+    while (true) {
+      ReadStatus status = framer_.next(frame);
+      if (status != ReadStatus::NEED_MORE || ended_) {
+        co_return status;
+      }
+
+      std::span<uint8_t> space = framer_.prepare(read_size_);
+      size_t count = co_await reader_.async_read(space);
+      if (count == 0) {
+        ended_ = true;
+      }
+      framer_.commit(count);
+    }
+  }
+
+  size_t buffered() const { return framer_.buffered(); }
+
+private:
+  Reader &reader_;
+  StreamReader framer_;
+  size_t read_size_;
+  bool ended_ = false;
+};
+
+// Awaits the next length-delimited message of `stream` and decodes it.
+// Completes with std::nullopt at a clean end of stream; throws
+// std::runtime_error for malformed frames or messages and for a stream that
+// ends inside a frame.
+template <typename T, typename Reader>
+task<std::optional<T>> async_parse_delimited(AsyncStreamReader<Reader> &stream) {
+  std::span<const uint8_t> frame;
+  ReadStatus status = co_await stream.next(frame);
+  if (status == ReadStatus::NEED_MORE) {
+    if (stream.buffered() > 0) {
+      throw std::runtime_error("Stream ended inside a message");
+    }
+    co_return std::nullopt;
+  }
+
+  T message;
+  if (status == ReadStatus::MALFORMED || !message.deserialize(frame)) {
+    throw std::runtime_error("Malformed message in stream");
+  }
+  co_return std::optional<T>(std::move(message));
+}
+
+} // namespace serialkit
+
+#endif // SERIALKIT_ASYNC_STREAM_HPP
@@ -0,0 +1,149 @@
+#ifndef SERIALKIT_BATCH_HPP
+#define SERIALKIT_BATCH_HPP
+
+#include "executor.hpp"
+#include "stream.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace serialkit {
+
+constexpr size_t DEFAULT_BATCH_GRAIN = 256;
+
+// Writes `messages` as length-delimited frames, byte-identical to calling
+// serialize_delimited() on each in order. Sizes are computed in parallel,
+// a prefix sum assigns every frame its offset, and workers then encode
+// straight into disjoint slices of one output buffer.
+template <typename T, ByteWriter Writer, Executor E>
+void serialize_batch(std::span<const T> messages, Writer &writer, E &executor,
+                     size_t grain = DEFAULT_BATCH_GRAIN) {
+  if (messages.empty()) {
+    return;
+  }
+
+  std::vector<size_t> sizes(messages.size());
+  executor.parallel_for(messages.size(), grain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      sizes[i] = messages[i].byte_size();
+    }
+  });
+
+  std::vector<size_t> offsets(messages.size() + 1);
+  for (size_t i = 0; i < messages.size(); ++i) {
+    offsets[i + 1] = offsets[i] + varint_size(sizes[i]) + sizes[i];
+  }
+  size_t total = offsets.back();
+
+  auto encode = [&](uint8_t *out) {
+    executor.parallel_for(
+        messages.size(), grain, [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            messages[i].serialize_to(write_varint(out + offsets[i], sizes[i]));
+          }
+        });
+  };
+
+  if constexpr (requires { writer.prepare(total); }) {
+    encode(writer.prepare(total));
+    writer.commit(total);
+  } else {
+    std::vector<uint8_t> buffer(total);
+    encode(buffer.data());
+    writer.write(buffer.data(), buffer.size());
+  }
+}
+
+template <typename T, ByteWriter Writer, Executor E>
+void serialize_batch(const std::vector<T> &messages, Writer &writer,
+                     E &executor, size_t grain = DEFAULT_BATCH_GRAIN) {
+  serialize_batch(std::span<const T>(messages), writer, executor, grain);
+}
+
+template <typename T, ByteWriter Writer>
+void serialize_batch(std::span<const T> messages, Writer &writer) {
+  serialize_batch(messages, writer, default_executor());
+}
+
+template <typename T, ByteWriter Writer>
+void serialize_batch(const std::vector<T> &messages, Writer &writer) {
+  serialize_batch(std::span<const T>(messages), writer, default_executor());
+}
+
+// Boundary-indexing pass for parallel decoding: records the offset of every
+// frame in `data`, plus data.size() as a final sentinel. Only the length
+// prefixes are read; one-byte prefixes (messages under 128 bytes) skip the
+// general varint decoder. Returns NEED_MORE if the last frame is incomplete.
+inline ReadStatus index_frames(std::span<const uint8_t> data,
+                               std::vector<size_t> &offsets) {
+  offsets.clear();
+  size_t position = 0;
+  while (position < data.size()) {
+    offsets.push_back(position);
+
+    uint8_t first = data[position];
+    uint64_t length = first;
+    size_t prefix_size = 1;
+    if (first & 0x80) {
+      ReadStatus status =
+          read_varint(data.subspan(position), length, prefix_size);
+      if (status != ReadStatus::OK) {
+        return status;
+      }
+    }
+
+    if (length > data.size() - position - prefix_size) {
+      return ReadStatus::NEED_MORE;
+    }
+    position += prefix_size + static_cast<size_t>(length);
+  }
+  offsets.push_back(data.size());
+  return ReadStatus::OK;
+}
+
+// Decodes a whole delimited stream in parallel. After a sequential
+// index_frames() pass, `messages` is sized to the number of frames and
+// workers decode disjoint ranges of it in place. Returns MALFORMED if any
+// message fails to decode; `messages` then holds partial results.
+template <typename T, Executor E>
+ReadStatus parallel_parse_stream(std::span<const uint8_t> data,
+                                 std::vector<T> &messages, E &executor,
+                                 size_t grain = DEFAULT_BATCH_GRAIN) {
+  std::vector<size_t> offsets;
+  ReadStatus status = index_frames(data, offsets);
+  if (status != ReadStatus::OK) {
+    return status;
+  }
+
+  size_t count = offsets.size() - 1;
+  messages.clear();
+  messages.resize(count);
+
+  std::atomic<bool> failed{false};
+  executor.parallel_for(count, grain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      uint64_t length = 0;
+      size_t prefix_size = 0;
+      std::span<const uint8_t> frame =
+          data.subspan(offsets[i], offsets[i + 1] - offsets[i]);
+      read_varint(frame, length, prefix_size);
+      if (!messages[i].deserialize(frame.subspan(prefix_size))) {
+        failed.store(true, std::memory_order_relaxed);
+        return;
+      }
+    }
+  });
+  return failed.load() ? ReadStatus::MALFORMED : ReadStatus::OK;
+}
+
+template <typename T>
+ReadStatus parallel_parse_stream(std::span<const uint8_t> data,
+                                 std::vector<T> &messages) {
+  return parallel_parse_stream(data, messages, default_executor());
+}
+
+} // namespace serialkit
+
+#endif // SERIALKIT_BATCH_HPP
@@ -0,0 +1,106 @@
+#ifndef SERIALKIT_CHECKSUM_HPP
+#define SERIALKIT_CHECKSUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#if defined(__SSE4_2__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace serialkit {
+
+// Integrity check appended to frames (see write_delimited() and the record
+// file flags). CRC32C is stored as 4 little-endian bytes after the payload.
+enum class Checksum : uint8_t { NONE = 0, CRC32C = 1 };
+
+constexpr size_t CRC32C_SIZE = 4;
+
+namespace detail {
+
+// Slice-by-8 tables for the reflected Castagnoli polynomial: entry [k][b] is
+// the CRC of byte b followed by k zero bytes.
+struct Crc32cTables {
+  uint32_t entries[8][256];
+};
+
+constexpr Crc32cTables make_crc32c_tables() {
+  Crc32cTables tables{};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0);
+    }
+    tables.entries[0][i] = crc;
+  }
+  for (int k = 1; k < 8; ++k) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t previous = tables.entries[k - 1][i];
+      tables.entries[k][i] =
+          (previous >> 8) ^ tables.entries[0][previous & 0xFF];
+    }
+  }
+  return tables;
+}
+
+inline constexpr Crc32cTables CRC32C_TABLES = make_crc32c_tables();
+
+} // namespace detail
+
+// CRC32C (Castagnoli) of `data`, continuing from `crc` so that a message can
+// be checksummed in pieces. Uses the SSE4.2 crc32 instruction when the
+// build enables it (-msse4.2 or -march=native) and slice-by-8 tables
+// otherwise.
+inline uint32_t crc32c(std::span<const uint8_t> data, uint32_t crc = 0) {
+  const uint8_t *in = data.data();
+  size_t size = data.size();
+  crc = ~crc;
+#if defined(__SSE4_2__) && defined(__x86_64__)
+  uint64_t value = crc;
+  for (; size >= 8; in += 8, size -= 8) {
+    uint64_t word;
+    std::memcpy(&word, in, 8);
+    value = _mm_crc32_u64(value, word);
+  }
+  crc = static_cast<uint32_t>(value);
+  for (; size > 0; ++in, --size) {
+    crc = _mm_crc32_u8(crc, *in);
+  }
+#else
+  const auto &table = detail::CRC32C_TABLES.entries;
+  for (; size >= 8; in += 8, size -= 8) {
+    uint32_t low = crc ^ (static_cast<uint32_t>(in[0]) |
+                          static_cast<uint32_t>(in[1]) << 8 |
+                          static_cast<uint32_t>(in[2]) << 16 |
+                          static_cast<uint32_t>(in[3]) << 24);
+    crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+          table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+          table[3][in[4]] ^ table[2][in[5]] ^ table[1][in[6]] ^
+          table[0][in[7]];
+  }
+  for (; size > 0; ++in, --size) {
+    crc = table[0][(crc ^ *in) & 0xFF] ^ (crc >> 8);
+  }
+#endif
+  return ~crc;
+}
+
+inline void store_crc32c(uint8_t *out, uint32_t crc) {
+  for (size_t i = 0; i < CRC32C_SIZE; ++i) {
+    out[i] = static_cast<uint8_t>(crc >> (i * 8));
+  }
+}
+
+inline uint32_t load_crc32c(const uint8_t *in) {
+  uint32_t crc = 0;
+  for (size_t i = 0; i < CRC32C_SIZE; ++i) {
+    crc |= static_cast<uint32_t>(in[i]) << (i * 8);
+  }
+  return crc;
+}
+
+} // namespace serialkit
+
+#endif // SERIALKIT_CHECKSUM_HPP
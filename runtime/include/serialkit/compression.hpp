@@ -0,0 +1,431 @@
+#ifndef SERIALKIT_COMPRESSION_HPP
+#define SERIALKIT_COMPRESSION_HPP
+
+#include "stream.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#if defined(SERIALKIT_HAS_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace serialkit {
+
+constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+enum class CodecId : uint8_t { STORED = 0, LZ4 = 1, ZSTD = 2 };
+
+// Compresses whole blocks. Implementations must be stateless or internally
+// synchronized: one codec instance is shared by every writer and reader.
+class Codec {
+public:
+  virtual ~Codec() = default;
+
+  // Stored in each block header; a reader only accepts blocks written with
+  // the same id (or uncompressed blocks).
+  virtual uint8_t id() const = 0;
+
+  virtual size_t max_compressed_size(size_t size) const = 0;
+
+  // Compresses `input` into `output`, which holds max_compressed_size()
+  // bytes. Returns the compressed size, or 0 if the codec gave up.
+  virtual size_t compress(std::span<const uint8_t> input,
+                          uint8_t *output) const = 0;
+
+  // Decompresses into `output`, which is exactly the original size.
+  // Returns false if the input is malformed.
+  virtual bool decompress(std::span<const uint8_t> input,
+                          std::span<uint8_t> output) const = 0;
+};
+
+// Compressor and decoder for the LZ4 block format: greedy single-probe
+// matching, 64 KiB window. Fast enough to stay off the profile and
+// interoperable with liblz4's LZ4_decompress_safe().
+class Lz4Codec : public Codec {
+public:
+  uint8_t id() const override { return static_cast<uint8_t>(CodecId::LZ4); }
+
+  size_t max_compressed_size(size_t size) const override {
+    return size + size / 255 + 16;
+  }
+
+  size_t compress(std::span<const uint8_t> input,
+                  uint8_t *output) const override {
+    const uint8_t *in = input.data();
+    const size_t size = input.size();
+    uint8_t *out = output;
+    size_t anchor = 0;
+
+    if (size >= MIN_INPUT_SIZE) {
+      // 16 KiB on the stack, so compressing a block does not allocate.
+      uint32_t table[HASH_SIZE] = {};
+      const size_t match_limit = size - LAST_LITERALS;
+      size_t pos = 0;
+
+      while (pos + MATCH_FIND_LIMIT <= size) {
+        uint32_t sequence = load32(in + pos);
+        uint32_t &slot = table[hash(sequence)];
+        size_t candidate = slot;
+        slot = static_cast<uint32_t>(pos);
+
+        if (candidate >= pos || pos - candidate > MAX_OFFSET ||
+            load32(in + candidate) != sequence) {
+          ++pos;
+          continue;
+        }
+
+        size_t length = MIN_MATCH;
+        while (pos + length < match_limit &&
+               in[candidate + length] == in[pos + length]) {
+          ++length;
+        }
+
+        out = write_sequence(out, in + anchor, pos - anchor, pos - candidate,
+                             length);
+        pos += length;
+        anchor = pos;
+      }
+    }
+
+    size_t literals = size - anchor;
+    *out++ = static_cast<uint8_t>((literals < 15 ? literals : 15) << 4);
+    out = write_length(out, literals);
+    if (literals > 0) {
+      std::memcpy(out, in + anchor, literals);
+    }
+    out += literals;
+    return static_cast<size_t>(out - output);
+  }
+
+  bool decompress(std::span<const uint8_t> input,
+                  std::span<uint8_t> output) const override {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (true) {
+      if (in >= input.size()) {
+        return false;
+      }
+      uint8_t token = input[in++];
+
+      size_t literals = token >> 4;
+      if (literals == 15 && !read_length(input, in, literals)) {
+        return false;
+      }
+      if (literals > input.size() - in || literals > output.size() - out) {
+        return false;
+      }
+      if (literals > 0) {
+        std::memcpy(output.data() + out, input.data() + in, literals);
+      }
+      in += literals;
+      out += literals;
+
+      if (in == input.size()) {
+        return out == output.size();
+      }
+
+      if (input.size() - in < 2) {
+        return false;
+      }
+      size_t offset = input[in] | (static_cast<size_t>(input[in + 1]) << 8);
+      in += 2;
+      if (offset == 0 || offset > out) {
+        return false;
+      }
+
+      size_t length = token & 0x0F;
+      if (length == 15 && !read_length(input, in, length)) {
+        return false;
+      }
+      length += MIN_MATCH;
+      if (length > output.size() - out) {
+        return false;
+      }
+
+      uint8_t *dest = output.data() + out;
+      const uint8_t *source = dest - offset;
+      if (offset >= length) {
+        std::memcpy(dest, source, length);
+      } else {
+        for (size_t i = 0; i < length; ++i) {
+          dest[i] = source[i];
+        }
+      }
+      out += length;
+    }
+  }
+
+private:
+  static constexpr size_t MIN_MATCH = 4;
+  static constexpr size_t LAST_LITERALS = 5;
+  static constexpr size_t MATCH_FIND_LIMIT = 12;
+  static constexpr size_t MIN_INPUT_SIZE = MATCH_FIND_LIMIT + 1;
+  static constexpr size_t MAX_OFFSET = 65535;
+  static constexpr int HASH_BITS = 12;
+  static constexpr size_t HASH_SIZE = size_t{1} << HASH_BITS;
+
+  static uint32_t load32(const uint8_t *data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+  static uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+  }
+
+  static uint8_t *write_length(uint8_t *out, size_t length) {
+    if (length < 15) {
+      return out;
+    }
+    length -= 15;
+    while (length >= 255) {
+      *out++ = 255;
+      length -= 255;
+    }
+    *out++ = static_cast<uint8_t>(length);
+    return out;
+  }
+
+  static bool read_length(std::span<const uint8_t> input, size_t &pos,
+                          size_t &length) {
+    uint8_t byte;
+    do {
+      if (pos >= input.size()) {
+        return false;
+      }
+      byte = input[pos++];
+      length += byte;
+    } while (byte == 255);
+    return true;
+  }
+
+  static uint8_t *write_sequence(uint8_t *out, const uint8_t *literals,
+                                 size_t literal_count, size_t offset,
+                                 size_t match_length) {
+    size_t match_code = match_length - MIN_MATCH;
+    uint8_t *token = out++;
+    *token = static_cast<uint8_t>(
+        ((literal_count < 15 ? literal_count : 15) << 4) |
+        (match_code < 15 ? match_code : 15));
+
+    out = write_length(out, literal_count);
+    if (literal_count > 0) {
+      std::memcpy(out, literals, literal_count);
+    }
+    out += literal_count;
+
+    *out++ = static_cast<uint8_t>(offset);
+    *out++ = static_cast<uint8_t>(offset >> 8);
+    return write_length(out, match_code);
+  }
+};
+
+#if defined(SERIALKIT_HAS_ZSTD)
+class ZstdCodec : public Codec {
+public:
+  explicit ZstdCodec(int level = 3) : level_(level) {}
+
+  uint8_t id() const override { return static_cast<uint8_t>(CodecId::ZSTD); }
+
+  size_t max_compressed_size(size_t size) const override {
+    return ZSTD_compressBound(size);
+  }
+
+  size_t compress(std::span<const uint8_t> input,
+                  uint8_t *output) const override {
+    size_t result =
+        ZSTD_compress(output, max_compressed_size(input.size()), input.data(),
+                      input.size(), level_);
+    return ZSTD_isError(result) ? 0 : result;
+  }
+
+  bool decompress(std::span<const uint8_t> input,
+                  std::span<uint8_t> output) const override {
+    size_t result = ZSTD_decompress(output.data(), output.size(),
+                                    input.data(), input.size());
+    return !ZSTD_isError(result) && result == output.size();
+  }
+
+private:
+  int level_;
+};
+#endif
+
+inline const Codec &default_codec() {
+  static const Lz4Codec codec;
+  return codec;
+}
+
+// Block payload: [codec id:1] [raw size:varint] [compressed bytes]. Blocks
+// that do not shrink are stored as-is under CodecId::STORED.
+inline void encode_block(const Codec &codec, std::span<const uint8_t> raw,
+                         std::vector<uint8_t> &block) {
+  size_t header_size = 1 + varint_size(raw.size());
+  block.resize(header_size + codec.max_compressed_size(raw.size()));
+  uint8_t *header = block.data();
+  write_varint(header + 1, raw.size());
+
+  size_t compressed = codec.compress(raw, block.data() + header_size);
+  if (compressed == 0 || compressed >= raw.size()) {
+    header[0] = static_cast<uint8_t>(CodecId::STORED);
+    block.resize(header_size + raw.size());
+    if (!raw.empty()) {
+      std::memcpy(block.data() + header_size, raw.data(), raw.size());
+    }
+    return;
+  }
+  header[0] = codec.id();
+  block.resize(header_size + compressed);
+}
+
+inline bool decode_block(const Codec &codec, std::span<const uint8_t> block,
+                         std::vector<uint8_t> &raw, size_t max_raw_size) {
+  if (block.empty()) {
+    return false;
+  }
+  uint8_t id = block[0];
+  uint64_t raw_size = 0;
+  size_t consumed = 0;
+  if (read_varint(block.subspan(1), raw_size, consumed) != ReadStatus::OK ||
+      raw_size > max_raw_size) {
+    return false;
+  }
+  std::span<const uint8_t> payload = block.subspan(1 + consumed);
+
+  raw.resize(static_cast<size_t>(raw_size));
+  if (id == static_cast<uint8_t>(CodecId::STORED)) {
+    if (payload.size() != raw.size()) {
+      return false;
+    }
+    if (!raw.empty()) {
+      std::memcpy(raw.data(), payload.data(), raw.size());
+    }
+    return true;
+  }
+  return id == codec.id() && codec.decompress(payload, raw);
+}
+
+// Groups length-delimited messages into blocks of about `block_size` bytes
+// and writes each block, compressed, as one delimited frame. Messages never
+// straddle blocks, so a single large message yields a larger block.
+template <ByteWriter Writer> class BlockWriter {
+public:
+  explicit BlockWriter(Writer &writer, const Codec &codec = default_codec(),
+                       size_t block_size = DEFAULT_BLOCK_SIZE)
+      : writer_(writer), codec_(codec), block_size_(block_size) {}
+
+  BlockWriter(const BlockWriter &) = delete;
+  BlockWriter &operator=(const BlockWriter &) = delete;
+
+  ~BlockWriter() {
+    try {
+      flush();
+    } catch (...) {
+    }
+  }
+
+  void append(std::span<const uint8_t> message) {
+    VectorWriter writer(pending_);
+    write_delimited(writer, message);
+    flush_if_full();
+  }
+
+  template <typename T>
+    requires requires(const T &message) { message.byte_size(); }
+  void append(const T &message) {
+    VectorWriter writer(pending_);
+    message.serialize_delimited(writer);
+    flush_if_full();
+  }
+
+  // Compresses and writes the pending block. Does not flush `writer`.
+  void flush() {
+    if (pending_.empty()) {
+      return;
+    }
+    encode_block(codec_, pending_, block_);
+    write_delimited(writer_, block_);
+    pending_.clear();
+  }
+
+private:
+  void flush_if_full() {
+    if (pending_.size() >= block_size_) {
+      flush();
+    }
+  }
+
+  Writer &writer_;
+  const Codec &codec_;
+  size_t block_size_;
+  std::vector<uint8_t> pending_;
+  std::vector<uint8_t> block_;
+};
+
+// Reads a stream written by BlockWriter. Input is supplied exactly as for
+// StreamReader; next() decompresses one block at a time into a buffer that
+// is reused for every block and yields its messages as spans into it.
+class BlockReader {
+public:
+  explicit BlockReader(const Codec &codec = default_codec(),
+                       size_t max_block_size = DEFAULT_MAX_MESSAGE_SIZE)
+      : codec_(codec), frames_(max_block_size),
+        max_block_size_(max_block_size) {}
+
+  std::span<uint8_t> prepare(size_t min_size = 4096) {
+    return frames_.prepare(min_size);
+  }
+
+  void commit(size_t size) { frames_.commit(size); }
+
+  void feed(std::span<const uint8_t> data) { frames_.feed(data); }
+
+  template <ByteReader Reader>
+  size_t fill(Reader &reader, size_t min_size = 4096) {
+    return frames_.fill(reader, min_size);
+  }
+
+  // Spans stay valid until the next call to next().
+  ReadStatus next(std::span<const uint8_t> &message) {
+    while (position_ == block_.size()) {
+      std::span<const uint8_t> frame;
+      ReadStatus status = frames_.next(frame);
+      if (status != ReadStatus::OK) {
+        return status;
+      }
+      position_ = 0;
+      if (!decode_block(codec_, frame, block_, max_block_size_)) {
+        block_.clear();
+        return ReadStatus::MALFORMED;
+      }
+    }
+
+    std::span<const uint8_t> rest(block_.data() + position_,
+                                  block_.size() - position_);
+    uint64_t length = 0;
+    size_t prefix_size = 0;
+    if (read_varint(rest, length, prefix_size) != ReadStatus::OK ||
+        length > rest.size() - prefix_size) {
+      return ReadStatus::MALFORMED;
+    }
+    message = rest.subspan(prefix_size, static_cast<size_t>(length));
+    position_ += prefix_size + static_cast<size_t>(length);
+    return ReadStatus::OK;
+  }
+
+private:
+  const Codec &codec_;
+  StreamReader frames_;
+  size_t max_block_size_;
+  std::vector<uint8_t> block_;
+  size_t position_ = 0;
+};
+
+} // namespace serialkit
+
+#endif // SERIALKIT_COMPRESSION_HPP
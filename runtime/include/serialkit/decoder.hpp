@@ -0,0 +1,14 @@
+#ifndef SERIALKIT_DECODER_HPP
+#define SERIALKIT_DECODER_HPP
+
+#include <cstdint>
+
+namespace serialkit {
+
+// Result of feeding a chunk to a generated <Model>Decoder (compiled with
+// --resumable-decoder). DONE and MALFORMED are final.
+enum class DecodeStatus : uint8_t { NEED_MORE, DONE, MALFORMED };
+
+} // namespace serialkit
+
+#endif // SERIALKIT_DECODER_HPP
@@ -0,0 +1,372 @@
+#ifndef SERIALKIT_EXECUTOR_HPP
+#define SERIALKIT_EXECUTOR_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace serialkit {
+
+// Anything that can run body(begin, end) over disjoint chunks of at most
+// `grain` indices covering [0, count), returning once every chunk is done.
+// Batch APIs are templates over this, so user schedulers plug in directly.
+template <typename E>
+concept Executor =
+    requires(E &executor, size_t count, size_t grain,
+             const std::function<void(size_t, size_t)> &body) {
+      executor.parallel_for(count, grain, body);
+    };
+
+// Runs everything on the calling thread.
+class InlineExecutor {
+public:
+  template <typename Body>
+  void parallel_for(size_t count, size_t /*grain*/, Body &&body) {
+    if (count > 0) {
+      body(size_t{0}, count);
+    }
+  }
+};
+
+namespace detail {
+
+// Chase-Lev work-stealing deque: the owning worker pushes and pops at the
+// bottom, any other thread steals from the top. The ring grows on demand;
+// retired rings are kept until destruction so that concurrent thieves never
+// read freed memory.
+template <typename T> class WorkDeque {
+public:
+  explicit WorkDeque(size_t capacity = 256) {
+    rings_.push_back(std::make_unique<Ring>(capacity));
+    ring_.store(rings_.back().get(), std::memory_order_relaxed);
+  }
+
+  void push(T *item) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Ring *ring = ring_.load(std::memory_order_relaxed);
+    if (bottom - top >= static_cast<int64_t>(ring->capacity)) {
+      ring = grow(ring, top, bottom);
+    }
+    ring->put(bottom, item);
+    bottom_.store(bottom + 1, std::memory_order_release);
+  }
+
+  T *pop() {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Ring *ring = ring_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T *item = ring->get(bottom);
+    if (top == bottom) {
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  T *steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+    Ring *ring = ring_.load(std::memory_order_acquire);
+    T *item = ring->get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  bool empty() const {
+    return top_.load(std::memory_order_acquire) >=
+           bottom_.load(std::memory_order_acquire);
+  }
+
+private:
+  struct Ring {
+    explicit Ring(size_t size)
+        : capacity(size), slots(new std::atomic<T *>[size]) {}
+
+    T *get(int64_t index) const {
+      return slots[static_cast<size_t>(index) & (capacity - 1)].load(
+          std::memory_order_relaxed);
+    }
+    void put(int64_t index, T *item) {
+      slots[static_cast<size_t>(index) & (capacity - 1)].store(
+          item, std::memory_order_relaxed);
+    }
+
+    size_t capacity;
+    std::unique_ptr<std::atomic<T *>[]> slots;
+  };
+
+  Ring *grow(Ring *ring, int64_t top, int64_t bottom) {
+    rings_.push_back(std::make_unique<Ring>(ring->capacity * 2));
+    Ring *bigger = rings_.back().get();
+    for (int64_t i = top; i < bottom; ++i) {
+      bigger->put(i, ring->get(i));
+    }
+    ring_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  std::atomic<int64_t> top_{0};
+  std::atomic<int64_t> bottom_{0};
+  std::atomic<Ring *> ring_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+};
+
+} // namespace detail
+
+// Work-stealing pool. parallel_for() splits its range in halves down to
+// `grain`: a worker keeps the left half and pushes the right half onto its
+// own deque, so it walks memory in order while idle workers steal the
+// largest pending pieces from the other end. Idle workers spin briefly and
+// then park until new work is pushed. The calling thread executes tasks
+// while it waits, so nested calls from inside a body cannot deadlock.
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+    size_t workers = threads > 1 ? threads - 1 : 0;
+    for (size_t i = 0; i < workers; ++i) {
+      deques_.push_back(std::make_unique<detail::WorkDeque<Task>>());
+    }
+    workers_.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+      workers_.emplace_back([this, i] { run(i); });
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    stopping_.store(true);
+    epoch_.fetch_add(1);
+    epoch_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  // Number of threads that execute chunks, including the caller.
+  size_t concurrency() const { return workers_.size() + 1; }
+
+  template <typename Body>
+  void parallel_for(size_t count, size_t grain, Body &&body) {
+    if (count == 0) {
+      return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    if (count <= grain || workers_.empty()) {
+      body(size_t{0}, count);
+      return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->grain = grain;
+    job->remaining.store(count);
+    job->body = [&body](size_t begin, size_t end) { body(begin, end); };
+
+    size_t self = worker_index();
+    push(self, new Task{job, 0, count});
+
+    while (true) {
+      size_t remaining = job->remaining.load(std::memory_order_acquire);
+      if (remaining == 0) {
+        break;
+      }
+      if (Task *task = find_task(self)) {
+        execute(self, task);
+        continue;
+      }
+      job->remaining.wait(remaining, std::memory_order_acquire);
+    }
+
+    if (job->error) {
+      std::rethrow_exception(job->error);
+    }
+  }
+
+private:
+  static constexpr size_t NOT_A_WORKER = static_cast<size_t>(-1);
+  static constexpr int SPIN_ROUNDS = 64;
+
+  struct Job {
+    size_t grain = 1;
+    std::function<void(size_t, size_t)> body;
+    std::atomic<size_t> remaining{0};
+    std::atomic<bool> failed{false};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+  };
+
+  struct Task {
+    std::shared_ptr<Job> job;
+    size_t begin;
+    size_t end;
+  };
+
+  struct WorkerSlot {
+    const ThreadPool *pool = nullptr;
+    size_t index = NOT_A_WORKER;
+  };
+
+  static WorkerSlot &current_worker() {
+    static thread_local WorkerSlot slot;
+    return slot;
+  }
+
+  size_t worker_index() const {
+    const WorkerSlot &slot = current_worker();
+    return slot.pool == this ? slot.index : NOT_A_WORKER;
+  }
+
+  void push(size_t self, Task *task) {
+    if (self != NOT_A_WORKER) {
+      deques_[self]->push(task);
+    } else {
+      std::lock_guard<std::mutex> lock(injected_mutex_);
+      injected_.push_back(task);
+      injected_size_.fetch_add(1, std::memory_order_release);
+    }
+    epoch_.fetch_add(1);
+    if (sleepers_.load() > 0) {
+      epoch_.notify_one();
+    }
+  }
+
+  Task *find_task(size_t self) {
+    if (self != NOT_A_WORKER) {
+      if (Task *task = deques_[self]->pop()) {
+        return task;
+      }
+    }
+
+    if (injected_size_.load(std::memory_order_acquire) > 0) {
+      std::lock_guard<std::mutex> lock(injected_mutex_);
+      if (!injected_.empty()) {
+        Task *task = injected_.front();
+        injected_.pop_front();
+        injected_size_.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+      }
+    }
+
+    size_t count = deques_.size();
+    size_t start = self != NOT_A_WORKER ? self + 1 : 0;
+    for (size_t i = 0; i < count; ++i) {
+      size_t victim = (start + i) % count;
+      if (victim == self) {
+        continue;
+      }
+      if (Task *task = deques_[victim]->steal()) {
+        return task;
+      }
+    }
+    return nullptr;
+  }
+
+  void execute(size_t self, Task *task) {
+    std::unique_ptr<Task> owned(task);
+    Job &job = *task->job;
+
+    size_t begin = task->begin;
+    size_t end = task->end;
+    while (end - begin > job.grain) {
+      size_t middle = begin + (end - begin) / 2;
+      push(self, new Task{task->job, middle, end});
+      end = middle;
+    }
+
+    if (!job.failed.load(std::memory_order_relaxed)) {
+      try {
+        job.body(begin, end);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(job.error_mutex);
+        if (!job.error) {
+          job.error = std::current_exception();
+        }
+        job.failed.store(true, std::memory_order_relaxed);
+      }
+    }
+
+    // The Task keeps the Job alive, so notifying after the last decrement
+    // is safe even once the caller has returned.
+    size_t done = end - begin;
+    if (job.remaining.fetch_sub(done, std::memory_order_acq_rel) == done) {
+      job.remaining.notify_all();
+    }
+  }
+
+  void run(size_t index) {
+    current_worker() = {this, index};
+    while (true) {
+      Task *task = find_task(index);
+      for (int i = 0; task == nullptr && i < SPIN_ROUNDS; ++i) {
+        std::this_thread::yield();
+        task = find_task(index);
+      }
+
+      if (task == nullptr) {
+        sleepers_.fetch_add(1);
+        uint32_t epoch = epoch_.load();
+        task = find_task(index);
+        if (task == nullptr && !stopping_.load()) {
+          epoch_.wait(epoch);
+        }
+        sleepers_.fetch_sub(1);
+      }
+
+      if (task != nullptr) {
+        execute(index, task);
+      } else if (stopping_.load()) {
+        return;
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<detail::WorkDeque<Task>>> deques_;
+  std::vector<std::thread> workers_;
+
+  std::mutex injected_mutex_;
+  std::deque<Task *> injected_;
+  std::atomic<size_t> injected_size_{0};
+
+  std::atomic<uint32_t> epoch_{0};
+  std::atomic<size_t> sleepers_{0};
+  std::atomic<bool> stopping_{false};
+};
+
+// Process-wide pool with one thread per core, created on first use. Batch
+// APIs use it when no executor is passed.
+inline ThreadPool &default_executor() {
+  static ThreadPool pool;
+  return pool;
+}
+
+} // namespace serialkit
+
+#endif // SERIALKIT_EXECUTOR_HPP
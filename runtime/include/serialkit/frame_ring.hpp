@@ -0,0 +1,200 @@
+#ifndef SERIALKIT_FRAME_RING_HPP
+#define SERIALKIT_FRAME_RING_HPP
+
+#include "stream.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace serialkit {
+
+// Fixed-capacity lock-free ring of serialized frames for many producers and
+// one consumer. Producers reserve space, encode into it and commit; the
+// consumer sees frames in reservation order as views into the ring and
+// releases them once written out, e.g. with writev(). Nothing is allocated
+// or copied after construction.
+//
+// Every frame is preceded by an 8-byte header: the record length (0 until
+// committed) and the payload size. Records are 8-byte aligned and never
+// wrap; a padding record fills the end of the ring instead. Released space
+// is zeroed by the consumer so that an uncommitted header always reads 0.
+class FrameRing {
+public:
+  static constexpr size_t HEADER_SIZE = 8;
+
+  explicit FrameRing(size_t capacity) {
+    capacity_ = 64;
+    while (capacity_ < capacity) {
+      capacity_ <<= 1;
+    }
+    // Raw storage from operator new, so the record headers' uint32_t
+    // lengths can live in it and be accessed through std::atomic_ref.
+    data_ = static_cast<uint8_t *>(
+        ::operator new(capacity_, std::align_val_t{RECORD_ALIGNMENT}));
+    std::memset(data_, 0, capacity_);
+
+    static_assert(offsetof(FrameRing, tail_) % CACHE_LINE_SIZE == 0 &&
+                  offsetof(FrameRing, head_) % CACHE_LINE_SIZE == 0 &&
+                  offsetof(FrameRing, head_) - offsetof(FrameRing, tail_) >=
+                      CACHE_LINE_SIZE);
+  }
+
+  ~FrameRing() {
+    ::operator delete(data_, std::align_val_t{RECORD_ALIGNMENT});
+  }
+
+  FrameRing(const FrameRing &) = delete;
+  FrameRing &operator=(const FrameRing &) = delete;
+
+  size_t capacity() const { return capacity_; }
+
+  // Largest frame that always fits into an empty ring.
+  size_t max_frame_size() const { return capacity_ / 2 - HEADER_SIZE; }
+
+  // Producer side, any thread. Returns room for `size` bytes, or nullptr if
+  // the ring is currently too full. Every reservation must be committed,
+  // otherwise the consumer stalls at it.
+  uint8_t *reserve(size_t size) {
+    if (size > max_frame_size()) {
+      throw std::length_error("Frame larger than FrameRing::max_frame_size()");
+    }
+    size_t record = align(HEADER_SIZE + size);
+
+    uint64_t tail = tail_.value.load(std::memory_order_relaxed);
+    while (true) {
+      uint64_t head = head_.value.load(std::memory_order_acquire);
+      size_t index = static_cast<size_t>(tail) & (capacity_ - 1);
+      size_t to_end = capacity_ - index;
+      size_t needed = record <= to_end ? record : to_end + record;
+      if (needed > capacity_ - static_cast<size_t>(tail - head)) {
+        return nullptr;
+      }
+      if (tail_.value.compare_exchange_weak(tail, tail + needed,
+                                            std::memory_order_relaxed)) {
+        if (needed != record) {
+          store_size(index, PADDING);
+          record_length(index).store(static_cast<uint32_t>(to_end),
+                                     std::memory_order_release);
+          index = 0;
+        }
+        store_size(index, static_cast<uint32_t>(record));
+        return data_ + index + HEADER_SIZE;
+      }
+    }
+  }
+
+  // Publishes a reserved frame; `size` may be smaller than reserved.
+  void commit(uint8_t *frame, size_t size) {
+    size_t index = static_cast<size_t>(frame - data_) - HEADER_SIZE;
+    uint32_t record = load_size(index);
+    store_size(index, static_cast<uint32_t>(size));
+    record_length(index).store(record, std::memory_order_release);
+  }
+
+  // Appends `message` as a length-delimited frame, so the consumer's output
+  // can be read back with StreamReader. Returns false if the ring is full.
+  template <typename T>
+    requires requires(const T &message) { message.byte_size(); }
+  bool try_push(const T &message) {
+    size_t size = message.byte_size();
+    size_t frame_size = varint_size(size) + size;
+    uint8_t *frame = reserve(frame_size);
+    if (frame == nullptr) {
+      return false;
+    }
+    message.serialize_to(write_varint(frame, size));
+    commit(frame, frame_size);
+    return true;
+  }
+
+  bool try_push(std::span<const uint8_t> message) {
+    size_t frame_size = varint_size(message.size()) + message.size();
+    uint8_t *frame = reserve(frame_size);
+    if (frame == nullptr) {
+      return false;
+    }
+    uint8_t *payload = write_varint(frame, message.size());
+    if (!message.empty()) {
+      std::memcpy(payload, message.data(), message.size());
+    }
+    commit(frame, frame_size);
+    return true;
+  }
+
+  // Consumer side, one thread. Replaces `frames` with up to `max_frames`
+  // committed frames in order. They stay valid until release().
+  size_t poll(std::vector<std::span<const uint8_t>> &frames,
+              size_t max_frames = SIZE_MAX) {
+    frames.clear();
+    uint64_t head = head_.value.load(std::memory_order_relaxed);
+    while (frames.size() < max_frames && scan_ - head < capacity_) {
+      size_t index = static_cast<size_t>(scan_) & (capacity_ - 1);
+      uint32_t record = record_length(index).load(std::memory_order_acquire);
+      if (record == 0) {
+        break;
+      }
+      uint32_t size = load_size(index);
+      if (size != PADDING) {
+        frames.emplace_back(data_ + index + HEADER_SIZE, size);
+      }
+      scan_ += record;
+    }
+    return frames.size();
+  }
+
+  // Returns the space of every frame handed out by poll() to producers.
+  void release() {
+    uint64_t head = head_.value.load(std::memory_order_relaxed);
+    size_t length = static_cast<size_t>(scan_ - head);
+    size_t index = static_cast<size_t>(head) & (capacity_ - 1);
+    size_t first = length < capacity_ - index ? length : capacity_ - index;
+    std::memset(data_ + index, 0, first);
+    std::memset(data_, 0, length - first);
+    head_.value.store(scan_, std::memory_order_release);
+  }
+
+private:
+  static constexpr uint32_t PADDING = UINT32_MAX;
+  static constexpr size_t RECORD_ALIGNMENT = 8;
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  // Keeps the producer and consumer cursors on separate cache lines,
+  // wherever the ring itself is placed.
+  struct alignas(CACHE_LINE_SIZE) PaddedCursor {
+    std::atomic<uint64_t> value{0};
+  };
+
+  static size_t align(size_t size) {
+    return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+  }
+
+  std::atomic_ref<uint32_t> record_length(size_t index) {
+    return std::atomic_ref<uint32_t>(
+        *reinterpret_cast<uint32_t *>(data_ + index));
+  }
+
+  uint32_t load_size(size_t index) const {
+    uint32_t size;
+    std::memcpy(&size, data_ + index + 4, sizeof(size));
+    return size;
+  }
+
+  void store_size(size_t index, uint32_t size) {
+    std::memcpy(data_ + index + 4, &size, sizeof(size));
+  }
+
+  PaddedCursor tail_;
+  PaddedCursor head_;
+  uint64_t scan_ = 0;
+  size_t capacity_;
+  uint8_t *data_;
+};
+
+} // namespace serialkit
+
+#endif // SERIALKIT_FRAME_RING_HPP
@@ -0,0 +1,141 @@
+#ifndef SERIALKIT_IOVEC_WRITER_HPP
+#define SERIALKIT_IOVEC_WRITER_HPP
+
+#include "stream.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <climits>
+#include <sys/uio.h>
+#endif
+
+namespace serialkit {
+
+constexpr size_t DEFAULT_IOV_THRESHOLD = 4096;
+
+// Scatter/gather output for generated serialize_iov(). Tags, varints and
+// short strings are encoded into a scratch buffer; strings of at least
+// `threshold` bytes are recorded as references to the message's own memory
+// instead of being copied. slices() interleaves the two in wire order, so
+// the message must stay alive and unmodified until the output is written.
+class IovecWriter {
+public:
+  using References = std::vector<std::pair<size_t, std::span<const uint8_t>>>;
+
+  explicit IovecWriter(size_t threshold = DEFAULT_IOV_THRESHOLD)
+      : threshold_(threshold) {}
+
+  // Called by generated code: references are (scratch offset, bytes) pairs
+  // in ascending offset order.
+  std::vector<uint8_t> &scratch() { return scratch_; }
+  References &references() { return references_; }
+  size_t threshold() const { return threshold_; }
+
+  template <typename T> void append(const T &message) {
+    message.serialize_iov(*this);
+  }
+
+  // Appends `message` as a length-delimited frame, byte-identical to
+  // serialize_delimited().
+  template <typename T> void append_delimited(const T &message) {
+    size_t size = message.byte_size();
+    size_t offset = scratch_.size();
+    scratch_.resize(offset + varint_size(size));
+    write_varint(scratch_.data() + offset, size);
+    message.serialize_iov(*this);
+  }
+
+  // The output as ordered, non-empty byte ranges. Invalidated by the next
+  // append().
+  std::vector<std::span<const uint8_t>> slices() const {
+    std::vector<std::span<const uint8_t>> result;
+    result.reserve(2 * references_.size() + 1);
+    size_t position = 0;
+    for (const auto &[offset, bytes] : references_) {
+      if (offset > position) {
+        result.emplace_back(scratch_.data() + position, offset - position);
+      }
+      if (!bytes.empty()) {
+        result.push_back(bytes);
+      }
+      position = offset;
+    }
+    if (scratch_.size() > position) {
+      result.emplace_back(scratch_.data() + position,
+                          scratch_.size() - position);
+    }
+    return result;
+  }
+
+  // Total number of bytes across all slices.
+  size_t size() const {
+    size_t total = scratch_.size();
+    for (const auto &reference : references_) {
+      total += reference.second.size();
+    }
+    return total;
+  }
+
+  // Drops the output but keeps the scratch capacity for reuse.
+  void clear() {
+    scratch_.clear();
+    references_.clear();
+  }
+
+#if !defined(_WIN32)
+  std::vector<iovec> iovecs() const {
+    std::vector<iovec> result;
+    for (auto slice : slices()) {
+      result.push_back({const_cast<uint8_t *>(slice.data()), slice.size()});
+    }
+    return result;
+  }
+
+  // Writes everything to `fd` with writev(), in batches of at most IOV_MAX
+  // entries and resuming after partial writes.
+  void write_all(int fd) const {
+    std::vector<iovec> vectors = iovecs();
+    size_t first = 0;
+    while (first < vectors.size()) {
+      size_t count = vectors.size() - first;
+      if (count > static_cast<size_t>(IOV_MAX)) {
+        count = static_cast<size_t>(IOV_MAX);
+      }
+      ssize_t result =
+          ::writev(fd, vectors.data() + first, static_cast<int>(count));
+      if (result < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::system_error(errno, std::generic_category(), "writev");
+      }
+
+      size_t written = static_cast<size_t>(result);
+      while (first < vectors.size() && written >= vectors[first].iov_len) {
+        written -= vectors[first].iov_len;
+        ++first;
+      }
+      if (written > 0) {
+        vectors[first].iov_base =
+            static_cast<uint8_t *>(vectors[first].iov_base) + written;
+        vectors[first].iov_len -= written;
+      }
+    }
+  }
+#endif
+
+private:
+  std::vector<uint8_t> scratch_;
+  References references_;
+  size_t threshold_;
+};
+
+} // namespace serialkit
+
+#endif // SERIALKIT_IOVEC_WRITER_HPP
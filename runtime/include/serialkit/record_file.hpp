@@ -0,0 +1,506 @@
+#ifndef SERIALKIT_RECORD_FILE_HPP
+#define SERIALKIT_RECORD_FILE_HPP
+
+#include "compression.hpp"
+#include "stream.hpp"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace serialkit {
+
+// Record file layout (all integers little-endian):
+//
+//   header   "SKRF" magic (4 bytes), format version (uint32)
+//   records  length-delimited messages, back to back
+//   index    uint64 file offset of every record
+//   footer   index offset (uint64), record count (uint64),
+//            flags (uint32), "SKRF" magic (4 bytes)
+//
+// With RECORD_FILE_COMPRESSED set, the body holds compressed blocks (see
+// compression.hpp) and each index entry is the block offset followed by the
+// number of the block's first record. With RECORD_FILE_CRC32C set, every
+// frame in the body (record or block) is followed by the CRC32C of its
+// payload.
+constexpr uint32_t RECORD_FILE_MAGIC = 0x46524B53; // "SKRF"
+constexpr uint32_t RECORD_FILE_VERSION = 1;
+constexpr uint32_t RECORD_FILE_COMPRESSED = 1;
+constexpr uint32_t RECORD_FILE_CRC32C = 2;
+constexpr size_t RECORD_FILE_HEADER_SIZE = 8;
+constexpr size_t RECORD_FILE_FOOTER_SIZE = 24;
+
+namespace detail {
+
+inline void store_le32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+}
+
+inline void store_le64(uint8_t *out, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+}
+
+inline uint32_t load_le32(const uint8_t *in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(in[i]) << (i * 8);
+  }
+  return value;
+}
+
+inline uint64_t load_le64(const uint8_t *in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) {
+    value |= static_cast<uint64_t>(in[i]) << (i * 8);
+  }
+  return value;
+}
+
+inline int sys_open(const std::string &path, bool for_writing) {
+#if defined(_WIN32)
+  int flags = for_writing ? (_O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY)
+                          : (_O_RDONLY | _O_BINARY);
+  int fd = ::_open(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+  int flags = for_writing ? (O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY;
+  int fd = ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+#endif
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "Failed to open file: " + path);
+  }
+  return fd;
+}
+
+inline void sys_close(int fd) {
+#if defined(_WIN32)
+  ::_close(fd);
+#else
+  ::close(fd);
+#endif
+}
+
+} // namespace detail
+
+// Read-only view of a whole file. Uses mmap() where available so that
+// records are decoded straight from the page cache; elsewhere the file is
+// read into memory once.
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+    int fd = detail::sys_open(path, false);
+#if defined(_WIN32)
+    try {
+      FdReader reader(fd);
+      uint8_t chunk[64 * 1024];
+      size_t count;
+      while ((count = reader.read(chunk, sizeof(chunk))) > 0) {
+        fallback_.insert(fallback_.end(), chunk, chunk + count);
+      }
+    } catch (...) {
+      detail::sys_close(fd);
+      throw;
+    }
+    detail::sys_close(fd);
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+#else
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+      int error = errno;
+      detail::sys_close(fd);
+      throw std::system_error(error, std::generic_category(), "fstat");
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ > 0) {
+      void *mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping == MAP_FAILED) {
+        int error = errno;
+        detail::sys_close(fd);
+        throw std::system_error(error, std::generic_category(), "mmap");
+      }
+      data_ = static_cast<const uint8_t *>(mapping);
+    }
+    detail::sys_close(fd);
+#endif
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile() {
+#if !defined(_WIN32)
+    if (size_ > 0) {
+      ::munmap(const_cast<uint8_t *>(data_), size_);
+    }
+#endif
+  }
+
+  std::span<const uint8_t> bytes() const { return {data_, size_}; }
+  size_t size() const { return size_; }
+
+private:
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+#if defined(_WIN32)
+  std::vector<uint8_t> fallback_;
+#endif
+};
+
+// Writes a record file. With a codec, records are grouped into blocks of
+// about `block_size` bytes that are compressed independently, and the index
+// points at blocks instead of individual records. With a checksum, each
+// record (or block) frame is followed by one, and readers verify it.
+//
+// `Output` is constructed from the file descriptor plus any extra
+// constructor arguments and must provide write()/prepare()/commit()/flush()
+// like FdWriter; flush() must leave every byte on the file.
+template <typename Output> class BasicRecordFileWriter {
+public:
+  template <typename... OutputArgs>
+  explicit BasicRecordFileWriter(const std::string &path,
+                                 const Codec *codec = nullptr,
+                                 size_t block_size = DEFAULT_BLOCK_SIZE,
+                                 OutputArgs &&...output_args)
+      : BasicRecordFileWriter(path, Checksum::NONE, codec, block_size,
+                              std::forward<OutputArgs>(output_args)...) {}
+
+  template <typename... OutputArgs>
+  BasicRecordFileWriter(const std::string &path, Checksum checksum,
+                        const Codec *codec = nullptr,
+                        size_t block_size = DEFAULT_BLOCK_SIZE,
+                        OutputArgs &&...output_args)
+      : fd_(detail::sys_open(path, true)), codec_(codec),
+        block_size_(block_size), checksum_(checksum) {
+    try {
+      writer_.emplace(fd_, std::forward<OutputArgs>(output_args)...);
+    } catch (...) {
+      detail::sys_close(fd_);
+      throw;
+    }
+    uint8_t header[RECORD_FILE_HEADER_SIZE];
+    detail::store_le32(header, RECORD_FILE_MAGIC);
+    detail::store_le32(header + 4, RECORD_FILE_VERSION);
+    writer_->write(header, sizeof(header));
+    offset_ = sizeof(header);
+  }
+
+  BasicRecordFileWriter(const BasicRecordFileWriter &) = delete;
+  BasicRecordFileWriter &operator=(const BasicRecordFileWriter &) = delete;
+
+  ~BasicRecordFileWriter() {
+    try {
+      close();
+    } catch (...) {
+    }
+  }
+
+  void append(std::span<const uint8_t> record) {
+    if (codec_ == nullptr) {
+      offsets_.push_back(offset_);
+      CountingWriter counter{*writer_, offset_};
+      write_delimited(counter, record, checksum_);
+    } else {
+      VectorWriter pending(pending_);
+      write_delimited(pending, record);
+    }
+    record_appended();
+  }
+
+  template <typename T>
+    requires requires(const T &message) { message.byte_size(); }
+  void append(const T &message) {
+    if (codec_ == nullptr) {
+      offsets_.push_back(offset_);
+      CountingWriter counter{*writer_, offset_};
+      write_message(counter, message, checksum_);
+    } else {
+      VectorWriter pending(pending_);
+      message.serialize_delimited(pending);
+    }
+    record_appended();
+  }
+
+  // Writes the offset index and footer. Called by the destructor if needed,
+  // but calling it explicitly surfaces I/O errors.
+  void close() {
+    if (fd_ < 0) {
+      return;
+    }
+
+    int fd = fd_;
+    fd_ = -1;
+    try {
+      flush_block();
+
+      uint64_t index_offset = offset_;
+      for (uint64_t offset : offsets_) {
+        uint8_t entry[8];
+        detail::store_le64(entry, offset);
+        writer_->write(entry, sizeof(entry));
+      }
+
+      uint8_t footer[RECORD_FILE_FOOTER_SIZE];
+      detail::store_le64(footer, index_offset);
+      detail::store_le64(footer + 8, count_);
+      detail::store_le32(
+          footer + 16, (codec_ != nullptr ? RECORD_FILE_COMPRESSED : 0) |
+                           (checksum_ == Checksum::CRC32C ? RECORD_FILE_CRC32C
+                                                          : 0));
+      detail::store_le32(footer + 20, RECORD_FILE_MAGIC);
+      writer_->write(footer, sizeof(footer));
+      writer_->flush();
+    } catch (...) {
+      writer_.reset();
+      detail::sys_close(fd);
+      throw;
+    }
+    writer_.reset();
+    detail::sys_close(fd);
+  }
+
+  size_t size() const { return static_cast<size_t>(count_); }
+
+private:
+  struct CountingWriter {
+    Output &writer;
+    uint64_t &offset;
+
+    void write(const uint8_t *data, size_t size) {
+      writer.write(data, size);
+      offset += size;
+    }
+    uint8_t *prepare(size_t size) { return writer.prepare(size); }
+    void commit(size_t size) {
+      writer.commit(size);
+      offset += size;
+    }
+  };
+
+  void record_appended() {
+    ++count_;
+    if (codec_ != nullptr && pending_.size() >= block_size_) {
+      flush_block();
+    }
+  }
+
+  void flush_block() {
+    if (pending_.empty()) {
+      return;
+    }
+    offsets_.push_back(offset_);
+    offsets_.push_back(block_first_record_);
+
+    encode_block(*codec_, pending_, block_);
+    CountingWriter counter{*writer_, offset_};
+    write_delimited(counter, block_, checksum_);
+
+    pending_.clear();
+    block_first_record_ = count_;
+  }
+
+  int fd_;
+  std::optional<Output> writer_;
+  const Codec *codec_;
+  size_t block_size_;
+  Checksum checksum_;
+  uint64_t offset_ = 0;
+  uint64_t count_ = 0;
+  std::vector<uint64_t> offsets_;
+  std::vector<uint8_t> pending_;
+  std::vector<uint8_t> block_;
+  uint64_t block_first_record_ = 0;
+};
+
+using RecordFileWriter = BasicRecordFileWriter<FdWriter>;
+
+// Random access to the records of a file written by RecordFileWriter.
+// For uncompressed files record(n) is O(1) and returns a view into the
+// mapping, so const member functions may be called from many threads at
+// once. For compressed files the block holding record n is decompressed on
+// demand into a buffer owned by the reader and reused for the next block;
+// the returned span is valid until record() needs a different block, and
+// each thread needs its own reader.
+class RecordFileReader {
+public:
+  explicit RecordFileReader(const std::string &path,
+                            const Codec &codec = default_codec())
+      : file_(path), codec_(codec) {
+    std::span<const uint8_t> bytes = file_.bytes();
+    if (bytes.size() < RECORD_FILE_HEADER_SIZE + RECORD_FILE_FOOTER_SIZE ||
+        detail::load_le32(bytes.data()) != RECORD_FILE_MAGIC) {
+      throw std::runtime_error("Not a record file: " + path);
+    }
+    if (detail::load_le32(bytes.data() + 4) != RECORD_FILE_VERSION) {
+      throw std::runtime_error("Unsupported record file version: " + path);
+    }
+
+    const uint8_t *footer =
+        bytes.data() + bytes.size() - RECORD_FILE_FOOTER_SIZE;
+    uint64_t index_offset = detail::load_le64(footer);
+    count_ = detail::load_le64(footer + 8);
+    uint32_t flags = detail::load_le32(footer + 16);
+    compressed_ = (flags & RECORD_FILE_COMPRESSED) != 0;
+    checksummed_ = (flags & RECORD_FILE_CRC32C) != 0;
+    size_t index_end = bytes.size() - RECORD_FILE_FOOTER_SIZE;
+    size_t entry_size = compressed_ ? 16 : 8;
+
+    if (detail::load_le32(footer + 20) != RECORD_FILE_MAGIC ||
+        index_offset < RECORD_FILE_HEADER_SIZE || index_offset > index_end ||
+        (index_end - index_offset) % entry_size != 0) {
+      throw std::runtime_error("Corrupted record file footer: " + path);
+    }
+
+    index_ = bytes.data() + index_offset;
+    entries_ = (index_end - index_offset) / entry_size;
+    records_end_ = static_cast<size_t>(index_offset);
+
+    bool valid_index =
+        compressed_ ? (entries_ <= count_ && (entries_ == 0) == (count_ == 0) &&
+                       (entries_ == 0 || block_first_record(0) == 0))
+                    : entries_ == count_;
+    if (!valid_index) {
+      throw std::runtime_error("Corrupted record file index: " + path);
+    }
+  }
+
+  size_t size() const { return static_cast<size_t>(count_); }
+
+  bool compressed() const { return compressed_; }
+
+  bool checksummed() const { return checksummed_; }
+
+  // For checksummed files, the record (or its block, when first loaded) is
+  // verified here and std::runtime_error is thrown on a mismatch.
+  std::span<const uint8_t> record(size_t index) const {
+    if (index >= count_) {
+      throw std::out_of_range("Record index out of range");
+    }
+    if (!compressed_) {
+      return frame_at(detail::load_le64(index_ + index * 8));
+    }
+
+    size_t block = find_block(index);
+    if (block != cached_block_) {
+      load_block(block);
+    }
+    return block_records_[index - block_first_record(block)];
+  }
+
+  template <typename T> bool read(size_t index, T &message) const {
+    return message.deserialize(record(index));
+  }
+
+private:
+  std::span<const uint8_t> frame_at(uint64_t offset) const {
+    if (offset >= records_end_) {
+      throw std::runtime_error("Corrupted record offset");
+    }
+
+    std::span<const uint8_t> frame =
+        file_.bytes().subspan(static_cast<size_t>(offset),
+                              records_end_ - static_cast<size_t>(offset));
+    uint64_t length = 0;
+    size_t prefix_size = 0;
+    size_t trailer_size = checksummed_ ? CRC32C_SIZE : 0;
+    if (read_varint(frame, length, prefix_size) != ReadStatus::OK ||
+        length > frame.size() - prefix_size ||
+        trailer_size > frame.size() - prefix_size - length) {
+      throw std::runtime_error("Corrupted record frame");
+    }
+    std::span<const uint8_t> payload =
+        frame.subspan(prefix_size, static_cast<size_t>(length));
+    if (checksummed_ &&
+        crc32c(payload) != load_crc32c(payload.data() + payload.size())) {
+      throw std::runtime_error("Record checksum mismatch");
+    }
+    return payload;
+  }
+
+  uint64_t block_first_record(size_t block) const {
+    return detail::load_le64(index_ + block * 16 + 8);
+  }
+
+  size_t find_block(size_t index) const {
+    size_t low = 0;
+    size_t high = entries_;
+    while (high - low > 1) {
+      size_t middle = low + (high - low) / 2;
+      if (block_first_record(middle) <= index) {
+        low = middle;
+      } else {
+        high = middle;
+      }
+    }
+    return low;
+  }
+
+  void load_block(size_t block) const {
+    cached_block_ = SIZE_MAX;
+    block_records_.clear();
+
+    std::span<const uint8_t> frame =
+        frame_at(detail::load_le64(index_ + block * 16));
+    if (!decode_block(codec_, frame, block_buffer_,
+                      DEFAULT_MAX_MESSAGE_SIZE)) {
+      throw std::runtime_error("Corrupted record block");
+    }
+
+    std::span<const uint8_t> rest(block_buffer_);
+    while (!rest.empty()) {
+      uint64_t length = 0;
+      size_t prefix_size = 0;
+      if (read_varint(rest, length, prefix_size) != ReadStatus::OK ||
+          length > rest.size() - prefix_size) {
+        throw std::runtime_error("Corrupted record block");
+      }
+      block_records_.push_back(
+          rest.subspan(prefix_size, static_cast<size_t>(length)));
+      rest = rest.subspan(prefix_size + static_cast<size_t>(length));
+    }
+
+    uint64_t first = block_first_record(block);
+    uint64_t last = block + 1 < entries_ ? block_first_record(block + 1)
+                                         : count_;
+    if (last < first || block_records_.size() != last - first) {
+      block_records_.clear();
+      throw std::runtime_error("Corrupted record block");
+    }
+    cached_block_ = block;
+  }
+
+  MappedFile file_;
+  const Codec &codec_;
+  const uint8_t *index_ = nullptr;
+  size_t entries_ = 0;
+  uint64_t count_ = 0;
+  size_t records_end_ = 0;
+  bool compressed_ = false;
+  bool checksummed_ = false;
+
+  mutable std::vector<uint8_t> block_buffer_;
+  mutable std::vector<std::span<const uint8_t>> block_records_;
+  mutable size_t cached_block_ = SIZE_MAX;
+};
+
+} // namespace serialkit
+
+#endif // SERIALKIT_RECORD_FILE_HPP
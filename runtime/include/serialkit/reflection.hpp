@@ -0,0 +1,77 @@
+#ifndef SERIALKIT_REFLECTION_HPP
+#define SERIALKIT_REFLECTION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace serialkit {
+
+// Modifier bits of field_descriptor::modifiers.
+enum FieldModifier : uint8_t {
+  FIELD_OPTIONAL = 1 << 0,
+  FIELD_REPEATED = 1 << 1,
+  FIELD_PACKED = 1 << 2,
+  FIELD_INTERNED = 1 << 3,
+  FIELD_BITMAP = 1 << 4,
+  FIELD_COLUMNAR = 1 << 5,
+  FIELD_UTF8 = 1 << 6
+};
+
+// Compile-time description of one field of a generated model.
+template <auto Member> struct field_descriptor {
+  static constexpr auto member = Member;
+  uint32_t number;
+  std::string_view name;
+  uint8_t wire_type;
+  uint8_t modifiers;
+};
+
+// One enumerator of a generated enum.
+template <typename E> struct enum_value {
+  E value;
+  std::string_view name;
+};
+
+// Specialized by generated headers for every model: `name` and `fields`, a
+// constexpr std::tuple of field_descriptor in declaration order.
+template <typename T> struct model_traits;
+
+// Specialized by generated headers for every enum: `name` and `values`, a
+// constexpr array of enum_value in declaration order.
+template <typename T> struct enum_traits;
+
+template <typename T>
+concept Reflected = requires { model_traits<T>::fields; };
+
+template <typename T>
+concept ReflectedEnum = requires { enum_traits<T>::values; };
+
+template <Reflected T>
+inline constexpr size_t field_count =
+    std::tuple_size_v<std::remove_const_t<decltype(model_traits<T>::fields)>>;
+
+// Calls f(descriptor, member) for every field of `model`, expanded at
+// compile time; `member` is a (const) reference into `model`.
+template <typename T, typename F>
+  requires Reflected<std::remove_const_t<T>>
+constexpr void for_each_field(T &model, F &&f) {
+  std::apply(
+      [&](const auto &...descriptors) {
+        (f(descriptors, model.*(descriptors.member)), ...);
+      },
+      model_traits<std::remove_const_t<T>>::fields);
+}
+
+// Calls f(descriptor) for every field of T, without an instance.
+template <Reflected T, typename F> constexpr void for_each_descriptor(F &&f) {
+  std::apply([&](const auto &...descriptors) { (f(descriptors), ...); },
+             model_traits<T>::fields);
+}
+
+} // namespace serialkit
+
+#endif // SERIALKIT_REFLECTION_HPP
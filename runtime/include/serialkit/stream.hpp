@@ -0,0 +1,409 @@
+#ifndef SERIALKIT_STREAM_HPP
+#define SERIALKIT_STREAM_HPP
+
+#include "checksum.hpp"
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace serialkit {
+
+constexpr size_t MAX_VARINT_SIZE = 10;
+constexpr size_t DEFAULT_MAX_MESSAGE_SIZE = 64 * 1024 * 1024;
+
+enum class ReadStatus : uint8_t { OK, NEED_MORE, MALFORMED };
+
+template <typename W>
+concept ByteWriter = requires(W &writer, const uint8_t *data, size_t size) {
+  writer.write(data, size);
+};
+
+template <typename R>
+concept ByteReader = requires(R &reader, uint8_t *data, size_t size) {
+  { reader.read(data, size) } -> std::convertible_to<size_t>;
+};
+
+inline size_t varint_size(uint64_t value) {
+  size_t size = 1;
+  while (value > 0x7F) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+inline uint8_t *write_varint(uint8_t *out, uint64_t value) {
+  while (value > 0x7F) {
+    *out++ = static_cast<uint8_t>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  *out++ = static_cast<uint8_t>(value);
+  return out;
+}
+
+// Decodes a varint from the front of `data`. NEED_MORE means the input ends
+// in the middle of the varint; MALFORMED means it is longer than 10 bytes.
+inline ReadStatus read_varint(std::span<const uint8_t> data, uint64_t &value,
+                              size_t &consumed) {
+  value = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (i == MAX_VARINT_SIZE) {
+      return ReadStatus::MALFORMED;
+    }
+    value |= static_cast<uint64_t>(data[i] & 0x7F) << (7 * i);
+    if ((data[i] & 0x80) == 0) {
+      consumed = i + 1;
+      return ReadStatus::OK;
+    }
+  }
+  return data.size() >= MAX_VARINT_SIZE ? ReadStatus::MALFORMED
+                                        : ReadStatus::NEED_MORE;
+}
+
+namespace detail {
+
+inline size_t sys_read(int fd, uint8_t *data, size_t size) {
+  while (true) {
+#if defined(_WIN32)
+    int result = ::_read(fd, data, static_cast<unsigned int>(size));
+#else
+    ssize_t result = ::read(fd, data, size);
+#endif
+    if (result >= 0) {
+      return static_cast<size_t>(result);
+    }
+    if (errno != EINTR) {
+      throw std::system_error(errno, std::generic_category(), "read");
+    }
+  }
+}
+
+inline void sys_write_all(int fd, const uint8_t *data, size_t size) {
+  while (size > 0) {
+#if defined(_WIN32)
+    int result = ::_write(fd, data, static_cast<unsigned int>(size));
+#else
+    ssize_t result = ::write(fd, data, size);
+#endif
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "write");
+    }
+    data += result;
+    size -= static_cast<size_t>(result);
+  }
+}
+
+} // namespace detail
+
+// Appends to a caller-owned vector. prepare()/commit() let generated
+// serialize_delimited() encode straight into the vector's storage.
+class VectorWriter {
+public:
+  explicit VectorWriter(std::vector<uint8_t> &buffer) : buffer_(buffer) {}
+
+  void write(const uint8_t *data, size_t size) {
+    buffer_.insert(buffer_.end(), data, data + size);
+  }
+
+  uint8_t *prepare(size_t size) {
+    pending_ = buffer_.size();
+    buffer_.resize(pending_ + size);
+    return buffer_.data() + pending_;
+  }
+
+  void commit(size_t size) { buffer_.resize(pending_ + size); }
+
+private:
+  std::vector<uint8_t> &buffer_;
+  size_t pending_ = 0;
+};
+
+// Buffered writer over a file descriptor (file, pipe or socket). Frames
+// smaller than the buffer are encoded in place and flushed in batches.
+class FdWriter {
+public:
+  explicit FdWriter(int fd, size_t buffer_size = 64 * 1024)
+      : fd_(fd), buffer_(buffer_size) {}
+
+  FdWriter(const FdWriter &) = delete;
+  FdWriter &operator=(const FdWriter &) = delete;
+
+  ~FdWriter() {
+    try {
+      flush();
+    } catch (...) {
+    }
+  }
+
+  void write(const uint8_t *data, size_t size) {
+    if (size > buffer_.size() - used_) {
+      flush();
+    }
+    if (size >= buffer_.size()) {
+      detail::sys_write_all(fd_, data, size);
+      return;
+    }
+    std::memcpy(buffer_.data() + used_, data, size);
+    used_ += size;
+  }
+
+  uint8_t *prepare(size_t size) {
+    if (size > buffer_.size() - used_) {
+      flush();
+      if (size > buffer_.size()) {
+        buffer_.resize(size);
+      }
+    }
+    return buffer_.data() + used_;
+  }
+
+  void commit(size_t size) { used_ += size; }
+
+  void flush() {
+    detail::sys_write_all(fd_, buffer_.data(), used_);
+    used_ = 0;
+  }
+
+private:
+  int fd_;
+  std::vector<uint8_t> buffer_;
+  size_t used_ = 0;
+};
+
+class FdReader {
+public:
+  explicit FdReader(int fd) : fd_(fd) {}
+
+  size_t read(uint8_t *data, size_t size) {
+    return detail::sys_read(fd_, data, size);
+  }
+
+private:
+  int fd_;
+};
+
+class SpanReader {
+public:
+  explicit SpanReader(std::span<const uint8_t> data) : data_(data) {}
+
+  size_t read(uint8_t *data, size_t size) {
+    size_t count = size < data_.size() ? size : data_.size();
+    std::memcpy(data, data_.data(), count);
+    data_ = data_.subspan(count);
+    return count;
+  }
+
+private:
+  std::span<const uint8_t> data_;
+};
+
+// Incremental framer for length-delimited message streams. Bytes arrive in
+// arbitrary chunks (via prepare()/commit(), feed() or fill()); next() yields
+// each complete message as a view into the internal buffer. Partial frames
+// stay where they are and are only moved to the front when the buffer runs
+// out of room, so consumed messages are never copied again.
+//
+// With a checksum, every frame carries one after its payload (as written by
+// write_delimited() with the same checksum). next() verifies it on bytes
+// that were just received, so the message is still in cache when decoded,
+// and reports MALFORMED on a mismatch.
+class StreamReader {
+public:
+  explicit StreamReader(size_t max_message_size = DEFAULT_MAX_MESSAGE_SIZE,
+                        Checksum checksum = Checksum::NONE)
+      : max_message_size_(max_message_size), checksum_(checksum) {}
+
+  // Returns at least `min_size` writable bytes at the end of the buffer.
+  // Invalidates spans previously returned by next().
+  std::span<uint8_t> prepare(size_t min_size = 4096) {
+    if (min_size < pending_frame_) {
+      min_size = pending_frame_;
+    }
+    if (buffer_.size() - end_ < min_size) {
+      compact();
+      if (buffer_.size() - end_ < min_size) {
+        buffer_.resize(end_ + min_size);
+      }
+    }
+    return std::span<uint8_t>(buffer_.data() + end_, buffer_.size() - end_);
+  }
+
+  void commit(size_t size) { end_ += size; }
+
+  void feed(std::span<const uint8_t> data) {
+    std::span<uint8_t> space = prepare(data.size());
+    std::memcpy(space.data(), data.data(), data.size());
+    commit(data.size());
+  }
+
+  // Performs a single read() into the buffer; returns 0 at end of stream.
+  template <ByteReader Reader>
+  size_t fill(Reader &reader, size_t min_size = 4096) {
+    std::span<uint8_t> space = prepare(min_size);
+    size_t count = reader.read(space.data(), space.size());
+    commit(count);
+    return count;
+  }
+
+  ReadStatus next(std::span<const uint8_t> &message) {
+    std::span<const uint8_t> available(buffer_.data() + begin_, end_ - begin_);
+
+    uint64_t length = 0;
+    size_t prefix_size = 0;
+    ReadStatus status = read_varint(available, length, prefix_size);
+    if (status != ReadStatus::OK) {
+      return status;
+    }
+    if (length > max_message_size_) {
+      return ReadStatus::MALFORMED;
+    }
+
+    size_t trailer_size = checksum_ == Checksum::CRC32C ? CRC32C_SIZE : 0;
+    size_t frame_size =
+        prefix_size + static_cast<size_t>(length) + trailer_size;
+    if (available.size() < frame_size) {
+      pending_frame_ = frame_size - available.size();
+      return ReadStatus::NEED_MORE;
+    }
+
+    std::span<const uint8_t> payload =
+        available.subspan(prefix_size, static_cast<size_t>(length));
+    if (trailer_size != 0 &&
+        crc32c(payload) != load_crc32c(payload.data() + payload.size())) {
+      return ReadStatus::MALFORMED;
+    }
+    message = payload;
+    begin_ += frame_size;
+    pending_frame_ = 0;
+    return ReadStatus::OK;
+  }
+
+  size_t buffered() const { return end_ - begin_; }
+
+private:
+  void compact() {
+    if (begin_ == 0) {
+      return;
+    }
+    if (begin_ != end_) {
+      std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+    }
+    end_ -= begin_;
+    begin_ = 0;
+  }
+
+  std::vector<uint8_t> buffer_;
+  size_t begin_ = 0;
+  size_t end_ = 0;
+  size_t pending_frame_ = 0;
+  size_t max_message_size_;
+  Checksum checksum_;
+};
+
+template <ByteWriter Writer>
+void write_delimited(Writer &writer, std::span<const uint8_t> message,
+                     Checksum checksum = Checksum::NONE) {
+  uint8_t prefix[MAX_VARINT_SIZE];
+  size_t prefix_size =
+      static_cast<size_t>(write_varint(prefix, message.size()) - prefix);
+  writer.write(prefix, prefix_size);
+  writer.write(message.data(), message.size());
+  if (checksum == Checksum::CRC32C) {
+    uint8_t trailer[CRC32C_SIZE];
+    store_crc32c(trailer, crc32c(message));
+    writer.write(trailer, sizeof(trailer));
+  }
+}
+
+namespace detail {
+
+// Forwards to `writer` and folds everything after the first `skip` bytes
+// (the length prefix) into a running CRC32C as it is written.
+template <ByteWriter Writer> class Crc32cWriter {
+public:
+  Crc32cWriter(Writer &writer, size_t skip) : writer_(writer), skip_(skip) {}
+
+  void write(const uint8_t *data, size_t size) {
+    writer_.write(data, size);
+    update(data, size);
+  }
+
+  uint8_t *prepare(size_t size)
+    requires requires(Writer &w, size_t n) { w.prepare(n); }
+  {
+    pending_ = writer_.prepare(size);
+    return pending_;
+  }
+
+  void commit(size_t size)
+    requires requires(Writer &w, size_t n) { w.commit(n); }
+  {
+    update(pending_, size);
+    writer_.commit(size);
+  }
+
+  uint32_t crc() const { return crc_; }
+
+private:
+  void update(const uint8_t *data, size_t size) {
+    size_t skipped = skip_ < size ? skip_ : size;
+    skip_ -= skipped;
+    crc_ = crc32c(std::span<const uint8_t>(data + skipped, size - skipped),
+                  crc_);
+  }
+
+  Writer &writer_;
+  size_t skip_;
+  uint8_t *pending_ = nullptr;
+  uint32_t crc_ = 0;
+};
+
+} // namespace detail
+
+// Frames a generated message like write_delimited(). With a checksum, the
+// CRC is taken over each piece the message writes while it is still in
+// cache, instead of in a second pass over the frame.
+template <ByteWriter Writer, typename T>
+void write_message(Writer &writer, const T &message,
+                   Checksum checksum = Checksum::NONE) {
+  if (checksum == Checksum::NONE) {
+    message.serialize_delimited(writer);
+    return;
+  }
+  detail::Crc32cWriter<Writer> checked(writer,
+                                       varint_size(message.byte_size()));
+  message.serialize_delimited(checked);
+  uint8_t trailer[CRC32C_SIZE];
+  store_crc32c(trailer, checked.crc());
+  writer.write(trailer, sizeof(trailer));
+}
+
+// Pulls the next complete frame out of `reader` (a StreamReader or any
+// framer with the same next()) and decodes it in place.
+template <typename Framer, typename T>
+ReadStatus read_message(Framer &reader, T &message) {
+  std::span<const uint8_t> frame;
+  ReadStatus status = reader.next(frame);
+  if (status == ReadStatus::OK && !message.deserialize(frame)) {
+    return ReadStatus::MALFORMED;
+  }
+  return status;
+}
+
+} // namespace serialkit
+
+#endif // SERIALKIT_STREAM_HPP
@@ -0,0 +1,149 @@
+#ifndef SERIALKIT_TASK_HPP
+#define SERIALKIT_TASK_HPP
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace serialkit {
+
+template <typename T = void> class task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+  // Resumes whoever awaited the task, without growing the stack.
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      return handle.promise().continuation;
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() { error = std::current_exception(); }
+
+  std::coroutine_handle<> continuation = std::noop_coroutine();
+  std::exception_ptr error;
+};
+
+template <typename T> struct TaskPromise : TaskPromiseBase {
+  task<T> get_return_object();
+
+  template <typename U> void return_value(U &&result) {
+    value.emplace(std::forward<U>(result));
+  }
+
+  T take() {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return std::move(*value);
+  }
+
+  std::optional<T> value;
+};
+
+template <> struct TaskPromise<void> : TaskPromiseBase {
+  task<void> get_return_object();
+
+  void return_void() const noexcept {}
+
+  void take() const {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+};
+
+} // namespace detail
+
+// Lazily started coroutine returning T. It runs when first awaited, and
+// resumes its awaiter by symmetric transfer on completion, so long chains
+// of synchronously completing tasks do not grow the stack. Scheduling is
+// left entirely to whatever the innermost awaitable suspends on (a socket
+// readiness callback, an event loop queue), so no executor is involved.
+//
+// Top-level code that cannot co_await calls start() and, once done(),
+// result().
+template <typename T> class task {
+public:
+  using promise_type = detail::TaskPromise<T>;
+
+  task() = default;
+  explicit task(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  task(task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+  task &operator=(task &&other) noexcept {
+    if (this != &other) {
+      destroy();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+
+  task(const task &) = delete;
+  task &operator=(const task &) = delete;
+
+  ~task() { destroy(); }
+
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      std::coroutine_handle<promise_type> handle;
+
+      bool await_ready() const noexcept { return handle.done(); }
+
+      std::coroutine_handle<>
+      await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+      }
+
+      T await_resume() { return handle.promise().take(); }
+    };
+    return Awaiter{handle_};
+  }
+
+  // Runs the task until its first suspension.
+  void start() { handle_.resume(); }
+
+  bool done() const { return handle_.done(); }
+
+  // The returned value, or the exception the task exited with.
+  T result() { return handle_.promise().take(); }
+
+private:
+  void destroy() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T> task<T> TaskPromise<T>::get_return_object() {
+  return task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline task<void> TaskPromise<void>::get_return_object() {
+  return task<void>(
+      std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+} // namespace serialkit
+
+#endif // SERIALKIT_TASK_HPP
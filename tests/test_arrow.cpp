@@ -0,0 +1,363 @@
+#include "codegen_test.hpp"
+#include "serialkit/arrow.hpp"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace arrow_test {
+
+// Shaped like generated code for:
+//   enum Level { LOW = 0; HIGH = 1; }
+//   model Point { int32 x = 1; int32 y = 2; }
+//   model Event {
+//     uint64 id = 1; interned string host = 2; Level level = 3;
+//     optional double value = 4; packed repeated uint32 samples = 5;
+//     bitmap repeated bool flags = 6; optional Point at = 7;
+//     repeated string labels = 8; repeated Point path = 9; }
+enum class Level : int32_t { LOW = 0, HIGH = 1 };
+
+struct Point {
+  int32_t x = 0;
+  int32_t y = 0;
+};
+
+struct Event {
+  uint64_t id = 0;
+  std::string host;
+  Level level = Level::LOW;
+  std::optional<double> value;
+  std::vector<uint32_t> samples;
+  std::vector<bool> flags;
+  std::optional<Point> at;
+  std::vector<std::string> labels;
+  std::vector<Point> path;
+};
+
+} // namespace arrow_test
+
+namespace serialkit {
+
+template <> struct enum_traits<arrow_test::Level> {
+  static constexpr std::string_view name = "Level";
+  static constexpr enum_value<arrow_test::Level> values[] = {
+      {arrow_test::Level::LOW, "LOW"}, {arrow_test::Level::HIGH, "HIGH"}};
+};
+
+template <> struct model_traits<arrow_test::Point> {
+  static constexpr std::string_view name = "Point";
+  static constexpr auto fields = std::make_tuple(
+      field_descriptor<&arrow_test::Point::x>{1, "x", 0, 0},
+      field_descriptor<&arrow_test::Point::y>{2, "y", 0, 0});
+};
+
+template <> struct model_traits<arrow_test::Event> {
+  static constexpr std::string_view name = "Event";
+  static constexpr auto fields = std::make_tuple(
+      field_descriptor<&arrow_test::Event::id>{1, "id", 0, 0},
+      field_descriptor<&arrow_test::Event::host>{2, "host", 2,
+                                                 FIELD_INTERNED},
+      field_descriptor<&arrow_test::Event::level>{3, "level", 2, 0},
+      field_descriptor<&arrow_test::Event::value>{4, "value", 1,
+                                                  FIELD_OPTIONAL},
+      field_descriptor<&arrow_test::Event::samples>{
+          5, "samples", 2, FIELD_REPEATED | FIELD_PACKED},
+      field_descriptor<&arrow_test::Event::flags>{
+          6, "flags", 7, FIELD_REPEATED | FIELD_BITMAP},
+      field_descriptor<&arrow_test::Event::at>{7, "at", 2, FIELD_OPTIONAL},
+      field_descriptor<&arrow_test::Event::labels>{8, "labels", 2,
+                                                   FIELD_REPEATED},
+      field_descriptor<&arrow_test::Event::path>{9, "path", 2,
+                                                 FIELD_REPEATED});
+};
+
+} // namespace serialkit
+
+using namespace serialkit;
+using arrow_test::Event;
+using arrow_test::Level;
+using arrow_test::Point;
+
+namespace {
+
+std::vector<Event> make_events() {
+  std::vector<Event> events(3);
+  events[0].id = 1;
+  events[0].host = "alpha";
+  events[0].level = Level::HIGH;
+  events[0].value = 2.5;
+  events[0].samples = {1, 2, 3};
+  events[0].flags = {true, false, true};
+  events[0].at = Point{4, 5};
+  events[0].labels = {"a", "bc"};
+  events[0].path = {{1, 1}, {2, 2}};
+
+  events[1].id = 2;
+  events[1].host = "beta";
+
+  events[2].id = 3;
+  events[2].host = "alpha";
+  events[2].value = -1.0;
+  events[2].samples = {7};
+  events[2].flags = {false, false, false, false, false, false, false, false,
+                     true};
+  events[2].path = {{3, -3}};
+  return events;
+}
+
+void expect_equal(const Event &a, const Event &b) {
+  EXPECT_EQ(a.id, b.id);
+  EXPECT_EQ(a.host, b.host);
+  EXPECT_EQ(a.level, b.level);
+  EXPECT_EQ(a.value, b.value);
+  EXPECT_EQ(a.samples, b.samples);
+  EXPECT_EQ(a.flags, b.flags);
+  ASSERT_EQ(a.at.has_value(), b.at.has_value());
+  if (a.at) {
+    EXPECT_EQ(a.at->x, b.at->x);
+    EXPECT_EQ(a.at->y, b.at->y);
+  }
+  EXPECT_EQ(a.labels, b.labels);
+  ASSERT_EQ(a.path.size(), b.path.size());
+  for (size_t i = 0; i < a.path.size(); ++i) {
+    EXPECT_EQ(a.path[i].x, b.path[i].x);
+    EXPECT_EQ(a.path[i].y, b.path[i].y);
+  }
+}
+
+int64_t child_index(const ArrowSchema &schema, std::string_view name) {
+  for (int64_t i = 0; i < schema.n_children; ++i) {
+    if (name == schema.children[i]->name) {
+      return i;
+    }
+  }
+  throw std::out_of_range("no child");
+}
+
+const ArrowSchema &child(const ArrowSchema &schema, std::string_view name) {
+  return *schema.children[child_index(schema, name)];
+}
+
+} // namespace
+
+class ArrowTest : public ::testing::Test {};
+
+TEST_F(ArrowTest, ExportsSchema) {
+  std::vector<Event> events = make_events();
+  ArrowSchema schema;
+  ArrowArray array;
+  to_arrow_columns(events, &schema, &array);
+
+  EXPECT_STREQ(schema.format, "+s");
+  ASSERT_EQ(schema.n_children, 9);
+  EXPECT_STREQ(child(schema, "id").format, "L");
+  EXPECT_STREQ(child(schema, "value").format, "g");
+  EXPECT_TRUE(child(schema, "value").flags & ARROW_FLAG_NULLABLE);
+  EXPECT_STREQ(child(schema, "samples").format, "+l");
+  EXPECT_STREQ(child(schema, "samples").children[0]->format, "I");
+  EXPECT_STREQ(child(schema, "flags").children[0]->format, "b");
+  EXPECT_STREQ(child(schema, "at").format, "+s");
+  EXPECT_STREQ(child(schema, "path").children[0]->format, "+s");
+
+  // Enums and interned strings are dictionary-encoded.
+  const ArrowSchema &level = child(schema, "level");
+  EXPECT_STREQ(level.format, "i");
+  ASSERT_NE(level.dictionary, nullptr);
+  EXPECT_STREQ(level.dictionary->format, "u");
+  const ArrowSchema &host = child(schema, "host");
+  EXPECT_STREQ(host.format, "i");
+  ASSERT_NE(host.dictionary, nullptr);
+  EXPECT_STREQ(child(schema, "labels").children[0]->format, "u");
+
+  schema.release(&schema);
+  array.release(&array);
+  EXPECT_EQ(schema.release, nullptr);
+  EXPECT_EQ(array.release, nullptr);
+}
+
+TEST_F(ArrowTest, ExportsBuffers) {
+  std::vector<Event> events = make_events();
+  ArrowSchema schema;
+  ArrowArray array;
+  to_arrow_columns(events, &schema, &array);
+
+  EXPECT_EQ(array.length, 3);
+  const ArrowArray &id = *array.children[child_index(schema, "id")];
+  EXPECT_EQ(id.n_buffers, 2);
+  EXPECT_EQ(id.buffers[0], nullptr);
+  const auto *ids = static_cast<const uint64_t *>(id.buffers[1]);
+  EXPECT_EQ(ids[0], 1u);
+  EXPECT_EQ(ids[2], 3u);
+
+  const ArrowArray &value = *array.children[child_index(schema, "value")];
+  EXPECT_EQ(value.null_count, 1);
+  EXPECT_EQ(static_cast<const uint8_t *>(value.buffers[0])[0], 0b101);
+
+  const ArrowArray &host = *array.children[child_index(schema, "host")];
+  const auto *host_ids = static_cast<const int32_t *>(host.buffers[1]);
+  EXPECT_EQ(host_ids[0], 0);
+  EXPECT_EQ(host_ids[1], 1);
+  EXPECT_EQ(host_ids[2], 0);
+  EXPECT_EQ(host.dictionary->length, 2);
+
+  const ArrowArray &level = *array.children[child_index(schema, "level")];
+  EXPECT_EQ(level.dictionary->length, 2);
+  EXPECT_EQ(static_cast<const int32_t *>(level.buffers[1])[0], 1);
+
+  const ArrowArray &samples = *array.children[child_index(schema, "samples")];
+  const auto *offsets = static_cast<const int32_t *>(samples.buffers[1]);
+  EXPECT_EQ(offsets[0], 0);
+  EXPECT_EQ(offsets[1], 3);
+  EXPECT_EQ(offsets[2], 3);
+  EXPECT_EQ(offsets[3], 4);
+  const auto *items =
+      static_cast<const uint32_t *>(samples.children[0]->buffers[1]);
+  EXPECT_EQ(items[3], 7u);
+
+  const ArrowArray &flags = *array.children[child_index(schema, "flags")];
+  const auto *bits =
+      static_cast<const uint8_t *>(flags.children[0]->buffers[1]);
+  EXPECT_EQ(bits[0], 0b101);
+  EXPECT_EQ(bits[1], 0b1000);
+
+  schema.release(&schema);
+  array.release(&array);
+}
+
+TEST_F(ArrowTest, RoundTrip) {
+  std::vector<Event> events = make_events();
+  ArrowSchema schema;
+  ArrowArray array;
+  to_arrow_columns(events, &schema, &array);
+
+  std::vector<Event> decoded;
+  from_arrow(&schema, &array, decoded);
+  ASSERT_EQ(decoded.size(), events.size());
+  for (size_t i = 0; i < events.size(); ++i) {
+    expect_equal(events[i], decoded[i]);
+  }
+
+  // Rows are appended.
+  from_arrow(&schema, &array, decoded);
+  EXPECT_EQ(decoded.size(), 2 * events.size());
+  expect_equal(events[0], decoded[3]);
+
+  schema.release(&schema);
+  array.release(&array);
+}
+
+TEST_F(ArrowTest, ImportsSlice) {
+  std::vector<Event> events = make_events();
+  ArrowSchema schema;
+  ArrowArray array;
+  to_arrow_columns(events, &schema, &array);
+
+  // A consumer slicing the batch to its last two rows.
+  array.offset = 1;
+  array.length = 2;
+  std::vector<Event> decoded;
+  from_arrow(&schema, &array, decoded);
+  ASSERT_EQ(decoded.size(), 2u);
+  expect_equal(events[1], decoded[0]);
+  expect_equal(events[2], decoded[1]);
+
+  array.offset = 0;
+  array.length = 3;
+  schema.release(&schema);
+  array.release(&array);
+}
+
+TEST_F(ArrowTest, MovedChildIsNotReleasedTwice) {
+  std::vector<Event> events = make_events();
+  ArrowSchema schema;
+  ArrowArray array;
+  to_arrow_columns(events, &schema, &array);
+
+  // Consumers may move a child out and release it on their own.
+  ArrowArray moved = *array.children[0];
+  array.children[0]->release = nullptr;
+  array.release(&array);
+  EXPECT_EQ(static_cast<const uint64_t *>(moved.buffers[1])[1], 2u);
+  moved.release(&moved);
+  schema.release(&schema);
+}
+
+TEST_F(ArrowTest, RejectsMismatchedType) {
+  std::vector<Point> points = {{1, 2}};
+  ArrowSchema schema;
+  ArrowArray array;
+  to_arrow_columns(points, &schema, &array);
+
+  // Columns named like Event fields but of other types.
+  std::vector<Event> events;
+  const char *original = schema.children[0]->name;
+  schema.children[0]->name = "host";
+  EXPECT_THROW(from_arrow(&schema, &array, events), std::runtime_error);
+  EXPECT_TRUE(events.empty());
+
+  // Unrelated columns are ignored.
+  schema.children[0]->name = "unrelated";
+  from_arrow(&schema, &array, events);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].id, 0u);
+
+  schema.children[0]->name = original;
+  schema.release(&schema);
+  array.release(&array);
+}
+
+TEST_F(ArrowTest, EmptyBatch) {
+  std::vector<Event> events;
+  ArrowSchema schema;
+  ArrowArray array;
+  to_arrow_columns(events, &schema, &array);
+
+  EXPECT_EQ(array.length, 0);
+  const ArrowArray &labels = *array.children[child_index(schema, "labels")];
+  ASSERT_NE(labels.buffers[1], nullptr);
+  EXPECT_EQ(static_cast<const int32_t *>(labels.buffers[1])[0], 0);
+
+  std::vector<Event> decoded;
+  from_arrow(&schema, &array, decoded);
+  EXPECT_TRUE(decoded.empty());
+
+  schema.release(&schema);
+  array.release(&array);
+}
+
+TEST_F(ArrowTest, GeneratedStructFields) {
+  // Struct types get model_traits too, and map to Arrow structs.
+  std::vector<codegen_test::Body> bodies(2);
+  bodies[0].id = 1;
+  bodies[0].pose = {{1.0f, 2.0f, 3.0f}, 4, 0.5};
+  bodies[0].path = {{{0.0f, -1.0f, 2.5f}, 1, -0.25}};
+  bodies[0].samples = {9, 8};
+  bodies[1].id = 2;
+  bodies[1].path = {bodies[0].pose, bodies[0].pose};
+
+  ArrowSchema schema;
+  ArrowArray array;
+  to_arrow_columns(bodies, &schema, &array);
+
+  const ArrowSchema &pose = child(schema, "pose");
+  EXPECT_STREQ(pose.format, "+s");
+  EXPECT_STREQ(child(pose, "flags").format, "C");
+  EXPECT_STREQ(child(pose, "w").format, "g");
+  const ArrowSchema &pos = child(pose, "pos");
+  EXPECT_STREQ(pos.format, "+s");
+  EXPECT_STREQ(child(pos, "x").format, "f");
+  EXPECT_STREQ(child(schema, "path").children[0]->format, "+s");
+
+  const ArrowArray &poses = *array.children[child_index(schema, "pose")];
+  const ArrowArray &positions = *poses.children[child_index(pose, "pos")];
+  const ArrowArray &xs = *positions.children[child_index(pos, "x")];
+  EXPECT_EQ(static_cast<const float *>(xs.buffers[1])[0], 1.0f);
+
+  std::vector<codegen_test::Body> decoded;
+  from_arrow(&schema, &array, decoded);
+  EXPECT_EQ(decoded, bodies);
+
+  schema.release(&schema);
+  array.release(&array);
+}
@@ -0,0 +1,261 @@
+#include "serialkit/async_file.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+
+#if !defined(_WIN32)
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace serialkit;
+
+namespace {
+
+std::string record_text(int i) {
+  // Every 100th record is larger than the 4 KiB test buffers.
+  return i % 100 == 7 ? std::string(10000 + i, 'x')
+                      : "record-" + std::to_string(i);
+}
+
+std::string file_contents(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), {});
+}
+
+} // namespace
+
+class AsyncFileTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    std::string base = (std::filesystem::temp_directory_path() /
+                        ("serialkit_async_file_test_" +
+                         std::string(::testing::UnitTest::GetInstance()
+                                         ->current_test_info()
+                                         ->name())))
+                           .string();
+    path = base + ".skr";
+    reference_path = base + ".reference.skr";
+
+    backends = {IoBackend::SYNC};
+    int fd = detail::sys_open(path, true);
+    if (AsyncFile(fd).backend() == IoBackend::IO_URING) {
+      backends.push_back(IoBackend::IO_URING);
+    }
+    detail::sys_close(fd);
+  }
+
+  void TearDown() override {
+    std::filesystem::remove(path);
+    std::filesystem::remove(reference_path);
+  }
+
+  AsyncFileOptions options(IoBackend backend) const {
+    AsyncFileOptions result;
+    result.buffer_size = 4096;
+    result.queue_depth = 4;
+    result.backend = backend;
+    return result;
+  }
+
+  std::string path;
+  std::string reference_path;
+  std::vector<IoBackend> backends;
+};
+
+TEST_F(AsyncFileTest, PositionalWritesAndReads) {
+  for (IoBackend backend : backends) {
+    SCOPED_TRACE(static_cast<int>(backend));
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    ASSERT_GE(fd, 0);
+    {
+      AsyncFile file(fd, options(backend));
+      EXPECT_EQ(file.backend(), backend);
+
+      // More writes than buffers, submitted out of file order.
+      for (int i = 15; i >= 0; --i) {
+        uint8_t *buffer = file.acquire();
+        std::memset(buffer, 'a' + i, 4096);
+        file.submit_write(buffer, 4096, static_cast<uint64_t>(i) * 4096);
+      }
+      file.drain();
+
+      uint8_t *first = file.acquire();
+      uint8_t *last = file.acquire();
+      file.submit_read(first, 4096, 0);
+      file.submit_read(last, 4096, 15 * 4096 + 100);
+      file.flush();
+      EXPECT_EQ(file.wait(last), 4096u - 100);
+      EXPECT_EQ(last[0], 'a' + 15);
+      EXPECT_EQ(file.wait(first), 4096u);
+      EXPECT_EQ(first[4095], 'a');
+      file.release(first);
+      file.release(last);
+    }
+    ::close(fd);
+    EXPECT_EQ(std::filesystem::file_size(path), 16u * 4096);
+  }
+}
+
+TEST_F(AsyncFileTest, ReadsHoldBuffersUntilReleased) {
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  ASSERT_GE(fd, 0);
+  AsyncFileOptions single = options(IoBackend::SYNC);
+  single.queue_depth = 1;
+  AsyncFile file(fd, single);
+
+  uint8_t *buffer = file.acquire();
+  file.submit_read(buffer, 16, 0);
+  EXPECT_EQ(file.try_acquire(), nullptr);
+  EXPECT_EQ(file.wait(buffer), 0u);
+  EXPECT_THROW(file.acquire(), std::logic_error);
+  file.release(buffer);
+  EXPECT_EQ(file.try_acquire(), buffer);
+  ::close(fd);
+}
+
+TEST_F(AsyncFileTest, RecordFilesMatchSynchronousWriter) {
+  Lz4Codec codec;
+  for (const Codec *block_codec : {static_cast<const Codec *>(nullptr),
+                                   static_cast<const Codec *>(&codec)}) {
+    {
+      RecordFileWriter writer(reference_path, block_codec, 8192);
+      for (int i = 0; i < 3000; ++i) {
+        writer.append(TextMessage{record_text(i)});
+      }
+    }
+
+    for (IoBackend backend : backends) {
+      SCOPED_TRACE(static_cast<int>(backend));
+      {
+        AsyncRecordFileWriter writer(path, block_codec, 8192,
+                                     options(backend));
+        for (int i = 0; i < 3000; ++i) {
+          writer.append(TextMessage{record_text(i)});
+        }
+        writer.close();
+      }
+      ASSERT_EQ(file_contents(path), file_contents(reference_path));
+
+      RecordFileReader reader(path, codec);
+      ASSERT_EQ(reader.size(), 3000u);
+      TextMessage message;
+      ASSERT_TRUE(reader.read(2107, message));
+      EXPECT_EQ(message.text, record_text(2107));
+    }
+  }
+}
+
+TEST_F(AsyncFileTest, ScannerReadsRecordsInOrder) {
+  Lz4Codec codec;
+  for (const Codec *block_codec : {static_cast<const Codec *>(nullptr),
+                                   static_cast<const Codec *>(&codec)}) {
+    {
+      RecordFileWriter writer(path, block_codec, 8192);
+      for (int i = 0; i < 3000; ++i) {
+        writer.append(TextMessage{record_text(i)});
+      }
+    }
+
+    for (IoBackend backend : backends) {
+      SCOPED_TRACE(static_cast<int>(backend));
+      RecordFileScanner scanner(path, codec, options(backend));
+      EXPECT_EQ(scanner.size(), 3000u);
+      EXPECT_EQ(scanner.compressed(), block_codec != nullptr);
+
+      TextMessage message;
+      int count = 0;
+      bool ordered = true;
+      while (scanner.read(message)) {
+        ordered &= message.text == record_text(count++);
+      }
+      EXPECT_TRUE(ordered);
+      EXPECT_EQ(count, 3000);
+      EXPECT_FALSE(scanner.read(message));
+    }
+  }
+}
+
+TEST_F(AsyncFileTest, ScannerHandlesEmptyAndCorruptedFiles) {
+  RecordFileWriter(path).close();
+  {
+    RecordFileScanner scanner(path);
+    std::span<const uint8_t> record;
+    EXPECT_FALSE(scanner.next(record));
+  }
+
+  {
+    RecordFileWriter writer(path);
+    writer.append(TextMessage{"first"});
+    writer.append(TextMessage{"second"});
+  }
+  // Claim three records in the footer.
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(-16, std::ios::end);
+    file.put(3);
+  }
+  RecordFileScanner scanner(path);
+  TextMessage message;
+  EXPECT_TRUE(scanner.read(message));
+  EXPECT_TRUE(scanner.read(message));
+  EXPECT_EQ(message.text, "second");
+  EXPECT_THROW(scanner.read(message), std::runtime_error);
+
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "definitely not a record file, but long enough";
+  }
+  EXPECT_THROW(RecordFileScanner bad(path), std::runtime_error);
+}
+
+TEST_F(AsyncFileTest, ScannerVerifiesChecksums) {
+  Lz4Codec codec;
+  for (const Codec *block_codec : {static_cast<const Codec *>(nullptr),
+                                   static_cast<const Codec *>(&codec)}) {
+    {
+      RecordFileWriter writer(reference_path, Checksum::CRC32C, block_codec,
+                              8192);
+      for (int i = 0; i < 500; ++i) {
+        writer.append(TextMessage{record_text(i)});
+      }
+    }
+
+    for (IoBackend backend : backends) {
+      SCOPED_TRACE(static_cast<int>(backend));
+      {
+        AsyncRecordFileWriter writer(path, Checksum::CRC32C, block_codec,
+                                     8192, options(backend));
+        for (int i = 0; i < 500; ++i) {
+          writer.append(TextMessage{record_text(i)});
+        }
+        writer.close();
+      }
+      ASSERT_EQ(file_contents(path), file_contents(reference_path));
+
+      RecordFileScanner scanner(path, codec, options(backend));
+      TextMessage message;
+      int count = 0;
+      while (scanner.read(message)) {
+        EXPECT_EQ(message.text, record_text(count++));
+      }
+      EXPECT_EQ(count, 500);
+    }
+  }
+
+  // A flipped bit in the first block.
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    char byte = 0;
+    file.seekg(RECORD_FILE_HEADER_SIZE + 3);
+    file.get(byte);
+    file.seekp(RECORD_FILE_HEADER_SIZE + 3);
+    file.put(static_cast<char>(byte ^ 0x01));
+  }
+  RecordFileScanner scanner(path, codec);
+  TextMessage message;
+  EXPECT_THROW(scanner.read(message), std::runtime_error);
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "serialkit/async_stream.hpp"
+#include "test_support.hpp"
+#include <deque>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace serialkit;
+
+namespace {
+
+// Event-loop stand-in: a read suspends until the test delivers a chunk,
+// unless chunks are already queued.
+class ChunkSource {
+public:
+  struct ReadAwaiter {
+    ChunkSource &source;
+    std::span<uint8_t> buffer;
+
+    bool await_ready() const {
+      return !source.chunks_.empty() || source.closed_;
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+      source.waiting_ = handle;
+    }
+    size_t await_resume() { return source.take(buffer); }
+  };
+
+  ReadAwaiter async_read(std::span<uint8_t> buffer) {
+    ++reads;
+    return ReadAwaiter{*this, buffer};
+  }
+
+  void deliver(std::string chunk) {
+    chunks_.push_back(std::move(chunk));
+    wake();
+  }
+
+  void close() {
+    closed_ = true;
+    wake();
+  }
+
+  size_t reads = 0;
+
+private:
+  void wake() {
+    if (waiting_) {
+      std::exchange(waiting_, {}).resume();
+    }
+  }
+
+  size_t take(std::span<uint8_t> buffer) {
+    if (chunks_.empty()) {
+      return 0;
+    }
+    std::string &chunk = chunks_.front();
+    size_t count = std::min(buffer.size(), chunk.size());
+    std::memcpy(buffer.data(), chunk.data(), count);
+    chunk.erase(0, count);
+    if (chunk.empty()) {
+      chunks_.pop_front();
+    }
+    return count;
+  }
+
+  std::deque<std::string> chunks_;
+  std::coroutine_handle<> waiting_;
+  bool closed_ = false;
+};
+
+// Counts decodes and rejects payloads starting with '!'.
+struct CountedMessage : TextMessage {
+  static inline int decodes = 0;
+
+  bool deserialize(std::span<const uint8_t> data) {
+    ++decodes;
+    if (!data.empty() && data[0] == '!') {
+      return false;
+    }
+    return TextMessage::deserialize(data);
+  }
+};
+
+std::string frame(const std::string &payload) {
+  uint8_t prefix[MAX_VARINT_SIZE];
+  size_t size =
+      static_cast<size_t>(write_varint(prefix, payload.size()) - prefix);
+  return std::string(reinterpret_cast<const char *>(prefix), size) + payload;
+}
+
+task<int> answer() { co_return 42; }
+
+task<int> add_answers(int depth) {
+  int total = 0;
+  for (int i = 0; i < depth; ++i) {
+    total += co_await answer();
+  }
+  co_return total;
+}
+
+task<void> fail() {
+  throw std::invalid_argument("boom");
+  co_return;
+}
+
+task<std::vector<std::string>>
+collect(AsyncStreamReader<ChunkSource> &stream) {
+  std::vector<std::string> texts;
+  while (auto message =
+             co_await async_parse_delimited<CountedMessage>(stream)) {
+    texts.push_back(message->text);
+  }
+  co_return texts;
+}
+
+} // namespace
+
+class AsyncStreamTest : public ::testing::Test {
+protected:
+  void SetUp() override { CountedMessage::decodes = 0; }
+
+  ChunkSource source;
+};
+
+TEST_F(AsyncStreamTest, TaskReturnsValuesAndExceptions) {
+  // Synchronously completing awaits resume by symmetric transfer.
+  task<int> sum = add_answers(10000);
+  sum.start();
+  ASSERT_TRUE(sum.done());
+  EXPECT_EQ(sum.result(), 420000);
+
+  task<void> failing = fail();
+  failing.start();
+  ASSERT_TRUE(failing.done());
+  EXPECT_THROW(failing.result(), std::invalid_argument);
+}
+
+TEST_F(AsyncStreamTest, SuspendsUntilBytesArrive) {
+  AsyncStreamReader stream(source);
+  task<std::vector<std::string>> texts = collect(stream);
+  texts.start();
+  EXPECT_FALSE(texts.done());
+
+  std::string bytes = frame("alpha") + frame("") + frame("gamma");
+  for (char byte : bytes) {
+    source.deliver(std::string(1, byte));
+    EXPECT_FALSE(texts.done());
+  }
+  source.close();
+
+  ASSERT_TRUE(texts.done());
+  EXPECT_EQ(texts.result(), (std::vector<std::string>{"alpha", "", "gamma"}));
+}
+
+TEST_F(AsyncStreamTest, LargeMessageIsDecodedOnce) {
+  std::string payload(10 * 1024 * 1024, 'p');
+  std::string bytes = frame(payload);
+
+  AsyncStreamReader stream(source);
+  task<std::optional<CountedMessage>> message =
+      async_parse_delimited<CountedMessage>(stream);
+  message.start();
+
+  const size_t chunk = bytes.size() / 1000 + 1;
+  for (size_t offset = 0; offset < bytes.size(); offset += chunk) {
+    EXPECT_FALSE(message.done());
+    source.deliver(bytes.substr(offset, chunk));
+  }
+
+  ASSERT_TRUE(message.done());
+  auto result = message.result();
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->text.size(), payload.size());
+  EXPECT_EQ(CountedMessage::decodes, 1);
+  // One read per chunk: the buffer grows to the announced frame size.
+  EXPECT_LE(source.reads, 1002u);
+}
+
+TEST_F(AsyncStreamTest, ReportsMalformedAndTruncatedStreams) {
+  {
+    AsyncStreamReader stream(source);
+    source.deliver(frame("!bad"));
+    auto message = async_parse_delimited<CountedMessage>(stream);
+    message.start();
+    ASSERT_TRUE(message.done());
+    EXPECT_THROW(message.result(), std::runtime_error);
+  }
+
+  {
+    ChunkSource truncated;
+    AsyncStreamReader stream(truncated);
+    truncated.deliver(frame("complete").substr(0, 4));
+    truncated.close();
+    auto message = async_parse_delimited<CountedMessage>(stream);
+    message.start();
+    ASSERT_TRUE(message.done());
+    EXPECT_THROW(message.result(), std::runtime_error);
+  }
+
+  {
+    ChunkSource oversized;
+    AsyncStreamReader stream(oversized, 16);
+    oversized.deliver(frame(std::string(17, 'x')));
+    std::span<const uint8_t> bytes;
+    auto status = stream.next(bytes);
+    status.start();
+    ASSERT_TRUE(status.done());
+    EXPECT_EQ(status.result(), ReadStatus::MALFORMED);
+  }
+}
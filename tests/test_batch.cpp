@@ -0,0 +1,142 @@
+#include "serialkit/batch.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace serialkit;
+
+namespace {
+
+struct Record {
+  uint32_t id = 0;
+  std::string payload;
+
+  size_t byte_size() const { return varint_size(id) + payload.size(); }
+
+  uint8_t *serialize_to(uint8_t *out) const {
+    out = write_varint(out, id);
+    std::memcpy(out, payload.data(), payload.size());
+    return out + payload.size();
+  }
+
+  bool deserialize(std::span<const uint8_t> data) {
+    uint64_t value = 0;
+    size_t consumed = 0;
+    if (read_varint(data, value, consumed) != ReadStatus::OK ||
+        value > UINT32_MAX) {
+      return false;
+    }
+    id = static_cast<uint32_t>(value);
+    payload.assign(reinterpret_cast<const char *>(data.data()) + consumed,
+                   data.size() - consumed);
+    return true;
+  }
+
+  template <typename Writer> void serialize_delimited(Writer &writer) const {
+    std::vector<uint8_t> frame(varint_size(byte_size()) + byte_size());
+    serialize_to(write_varint(frame.data(), byte_size()));
+    writer.write(frame.data(), frame.size());
+  }
+};
+
+struct PlainWriter {
+  std::vector<uint8_t> bytes;
+
+  void write(const uint8_t *data, size_t size) {
+    bytes.insert(bytes.end(), data, data + size);
+  }
+};
+
+} // namespace
+
+class BatchTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    for (uint32_t i = 0; i < 5000; ++i) {
+      records.push_back({i * 37, std::string(i % 300, 'a' + i % 26)});
+    }
+    VectorWriter writer(expected);
+    for (const auto &record : records) {
+      record.serialize_delimited(writer);
+    }
+  }
+
+  std::vector<Record> records;
+  std::vector<uint8_t> expected;
+};
+
+TEST_F(BatchTest, MatchesSerialOrderOnThreadPool) {
+  ThreadPool pool(4);
+  std::vector<uint8_t> output = {0xFF};
+  VectorWriter writer(output);
+  serialize_batch(records, writer, pool, 7);
+
+  ASSERT_EQ(output.size(), expected.size() + 1);
+  EXPECT_TRUE(std::equal(expected.begin(), expected.end(), output.begin() + 1));
+}
+
+TEST_F(BatchTest, WriterWithoutPrepare) {
+  InlineExecutor executor;
+  PlainWriter writer;
+  serialize_batch(std::span<const Record>(records), writer, executor);
+  EXPECT_EQ(writer.bytes, expected);
+}
+
+TEST_F(BatchTest, EmptyBatch) {
+  ThreadPool pool(2);
+  PlainWriter writer;
+  serialize_batch(std::span<const Record>(), writer, pool);
+  EXPECT_TRUE(writer.bytes.empty());
+}
+
+TEST_F(BatchTest, ParallelParseStream) {
+  ThreadPool pool(4);
+  std::vector<Record> parsed = {Record{1, "stale"}};
+  ASSERT_EQ(parallel_parse_stream(expected, parsed, pool, 16), ReadStatus::OK);
+
+  ASSERT_EQ(parsed.size(), records.size());
+  for (size_t i = 0; i < records.size(); ++i) {
+    EXPECT_EQ(parsed[i].id, records[i].id);
+    EXPECT_EQ(parsed[i].payload, records[i].payload);
+  }
+}
+
+TEST_F(BatchTest, IndexFrames) {
+  std::vector<size_t> offsets;
+  ASSERT_EQ(index_frames(expected, offsets), ReadStatus::OK);
+  ASSERT_EQ(offsets.size(), records.size() + 1);
+  EXPECT_EQ(offsets.front(), 0u);
+  EXPECT_EQ(offsets.back(), expected.size());
+
+  std::span<const uint8_t> truncated(expected.data(), expected.size() - 1);
+  EXPECT_EQ(index_frames(truncated, offsets), ReadStatus::NEED_MORE);
+}
+
+TEST_F(BatchTest, ParallelParseRejectsBadMessage) {
+  std::vector<uint8_t> stream = expected;
+  const uint8_t bad[] = {0x02, 0xFF, 0xFF};
+  stream.insert(stream.end(), bad, bad + sizeof(bad));
+
+  ThreadPool pool(4);
+  std::vector<Record> parsed;
+  EXPECT_EQ(parallel_parse_stream(stream, parsed, pool), ReadStatus::MALFORMED);
+}
+
+TEST_F(BatchTest, GeneratedModels) {
+  auto bodies = make_bodies(2000);
+  std::vector<uint8_t> serial;
+  VectorWriter serial_writer(serial);
+  for (const auto &body : bodies) {
+    body.serialize_delimited(serial_writer);
+  }
+
+  ThreadPool pool(4);
+  std::vector<uint8_t> batched;
+  VectorWriter writer(batched);
+  serialize_batch(bodies, writer, pool, 16);
+  EXPECT_EQ(batched, serial);
+
+  std::vector<codegen_test::Body> parsed;
+  ASSERT_EQ(parallel_parse_stream(batched, parsed, pool, 16), ReadStatus::OK);
+  EXPECT_EQ(parsed, bodies);
+}
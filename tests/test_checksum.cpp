@@ -0,0 +1,67 @@
+#include "serialkit/checksum.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace serialkit;
+
+namespace {
+
+std::span<const uint8_t> as_bytes(const std::string &text) {
+  return std::span<const uint8_t>(
+      reinterpret_cast<const uint8_t *>(text.data()), text.size());
+}
+
+// Bit-at-a-time reference.
+uint32_t reference_crc32c(std::span<const uint8_t> data) {
+  uint32_t crc = ~0u;
+  for (uint8_t byte : data) {
+    crc ^= byte;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0);
+    }
+  }
+  return ~crc;
+}
+
+} // namespace
+
+TEST(ChecksumTest, KnownValues) {
+  EXPECT_EQ(crc32c(as_bytes("")), 0u);
+  EXPECT_EQ(crc32c(as_bytes("123456789")), 0xE3069283u);
+
+  // RFC 3720 B.4: 32 bytes of zeros and of ones.
+  std::vector<uint8_t> zeros(32, 0x00);
+  std::vector<uint8_t> ones(32, 0xFF);
+  EXPECT_EQ(crc32c(zeros), 0x8A9136AAu);
+  EXPECT_EQ(crc32c(ones), 0x62A8AB43u);
+}
+
+TEST(ChecksumTest, MatchesReferenceAtEveryLength) {
+  std::vector<uint8_t> data(300);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i * 131 + 7);
+  }
+  for (size_t size = 0; size <= data.size(); ++size) {
+    std::span<const uint8_t> prefix(data.data(), size);
+    ASSERT_EQ(crc32c(prefix), reference_crc32c(prefix)) << size;
+  }
+}
+
+TEST(ChecksumTest, ContinuesAcrossPieces) {
+  std::string text = "integrity checks over a message split in pieces";
+  uint32_t whole = crc32c(as_bytes(text));
+  for (size_t split = 0; split <= text.size(); ++split) {
+    uint32_t crc = crc32c(as_bytes(text.substr(0, split)));
+    crc = crc32c(as_bytes(text.substr(split)), crc);
+    ASSERT_EQ(crc, whole) << split;
+  }
+}
+
+TEST(ChecksumTest, StoresLittleEndian) {
+  uint8_t trailer[CRC32C_SIZE];
+  store_crc32c(trailer, 0xE3069283u);
+  EXPECT_EQ(trailer[0], 0x83);
+  EXPECT_EQ(trailer[3], 0xE3);
+  EXPECT_EQ(load_crc32c(trailer), 0xE3069283u);
+}
@@ -188,7 +188,7 @@ TEST_F(CodeGenTest, GenerateSerializeMethod) {
 
   EXPECT_NE(source_code.find("std::vector<uint8_t> Simple::serialize()"),
             std::string::npos);
-  EXPECT_NE(source_code.find("buffer.reserve"), std::string::npos);
+  EXPECT_NE(source_code.find("buffer(byte_size())"), std::string::npos);
   EXPECT_NE(source_code.find("return buffer"), std::string::npos);
 }
 
@@ -209,9 +209,164 @@ TEST_F(CodeGenTest, GenerateDeserializeMethod) {
   std::string source_code = codegen.generate_source();
 
   EXPECT_NE(source_code.find("bool Simple::deserialize"), std::string::npos);
-  EXPECT_NE(source_code.find("uint32_t field_number"), std::string::npos);
-  EXPECT_NE(source_code.find("uint8_t wire_type"), std::string::npos);
-  EXPECT_NE(source_code.find("switch (field_number)"), std::string::npos);
+  EXPECT_NE(source_code.find("uint32_t sk_field_number"), std::string::npos);
+  EXPECT_NE(source_code.find("uint8_t sk_wire_type"), std::string::npos);
+  EXPECT_NE(source_code.find("switch (sk_field_number)"), std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateByteSizeAndSerializeTo) {
+  std::string source = R"(
+    namespace test;
+
+    model Simple {
+      int32 id = 1;
+      string name = 2;
+      optional Simple child = 3;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator codegen(*schema);
+  std::string header = codegen.generate_header();
+  std::string source_code = codegen.generate_source();
+
+  EXPECT_NE(header.find("size_t byte_size() const;"), std::string::npos);
+  EXPECT_NE(header.find("uint8_t* serialize_to(uint8_t* out) const;"),
+            std::string::npos);
+  EXPECT_NE(header.find("void serialize_to(std::vector<uint8_t>& buffer)"),
+            std::string::npos);
+  EXPECT_NE(source_code.find("size_t Simple::byte_size() const"),
+            std::string::npos);
+  EXPECT_NE(
+      source_code.find("sk_size += 1 + "
+                       "detail::length_delimited_size(name.size())"),
+            std::string::npos);
+  EXPECT_NE(source_code.find("*sk_out++ = 0x08;"), std::string::npos);
+  EXPECT_NE(source_code.find("sk_out = sk_value.serialize_to(sk_out);"),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateSpanDeserialize) {
+  std::string source = R"(
+    namespace test;
+
+    model Item {
+      string name = 1;
+    }
+
+    model Container {
+      repeated Item items = 1;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator codegen(*schema);
+  std::string header = codegen.generate_header();
+  std::string source_code = codegen.generate_source();
+
+  EXPECT_NE(header.find("#include <span>"), std::string::npos);
+  EXPECT_NE(header.find("bool deserialize(std::span<const uint8_t> data);"),
+            std::string::npos);
+  EXPECT_NE(source_code.find(
+                "sk_item.deserialize(sk_data.subspan(sk_pos, sk_length))"),
+            std::string::npos);
+  EXPECT_NE(source_code.find(
+                "if (sk_length > sk_data.size() - sk_pos) return false;"),
+            std::string::npos);
+  EXPECT_EQ(source_code.find("item_data"), std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateDelimitedMethods) {
+  std::string source = R"(
+    namespace test;
+
+    model Event {
+      uint64 id = 1;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator codegen(*schema);
+  std::string header = codegen.generate_header();
+
+  EXPECT_NE(header.find("void serialize_delimited(Writer& sk_writer) const"),
+            std::string::npos);
+  EXPECT_NE(header.find("bool parse_delimited(Reader& sk_reader)"),
+            std::string::npos);
+  EXPECT_NE(header.find("sk_writer.prepare(sk_prefix_size + sk_size)"),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateSerializeIov) {
+  std::string source = R"(
+    namespace test;
+
+    model Blob {
+      uint64 id = 1;
+      uint32 flags = 2;
+      string body = 3;
+      repeated string parts = 4;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator codegen(*schema);
+  std::string header = codegen.generate_header();
+  std::string source_code = codegen.generate_source();
+
+  EXPECT_NE(header.find("void serialize_iov(IovWriter& sk_writer) const"),
+            std::string::npos);
+  EXPECT_NE(source_code.find("void Blob::serialize_iov(std::vector<uint8_t>& "
+                             "sk_scratch,"),
+            std::string::npos);
+  EXPECT_NE(source_code.find(
+                "append_string_iov(sk_scratch, sk_references, sk_threshold, "
+                "body);"),
+            std::string::npos);
+  EXPECT_NE(source_code.find(
+                "append_string_iov(sk_scratch, sk_references, sk_threshold, "
+                "sk_item);"),
+            std::string::npos);
+
+  // Consecutive scalar fields share one scratch allocation.
+  size_t method = source_code.find("void Blob::serialize_iov(");
+  size_t first = source_code.find("append_space(sk_scratch, sk_size)", method);
+  ASSERT_NE(first, std::string::npos);
+  EXPECT_EQ(source_code.find("append_space(sk_scratch, sk_size)", first + 1),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GeneratePackedDeserializer) {
+  std::string source = R"(
+    namespace test;
+
+    model Series {
+      packed repeated uint32 counts = 1;
+      packed repeated double values = 2;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator codegen(*schema);
+  std::string source_code = codegen.generate_source();
+
+  EXPECT_NE(source_code.find("size_t sk_end = sk_pos + sk_length;"),
+            std::string::npos);
+  EXPECT_NE(source_code.find(
+                "counts.push_back(static_cast<uint32_t>(sk_value))"),
+            std::string::npos);
+  EXPECT_NE(source_code.find("if (sk_length % 8 != 0) return false;"),
+            std::string::npos);
 }
 
 TEST_F(CodeGenTest, GenerateAllPrimitiveTypes) {
@@ -439,4 +594,947 @@ TEST_F(CodeGenTest, test) {
   cpp << codegen.generate_source();
   ;
   cpp.close();
-}
\ No newline at end of file
+}
+TEST_F(CodeGenTest, GenerateResumableDecoder) {
+  std::string source = R"(
+    namespace test;
+
+    model Point {
+      int32 x = 1;
+      packed repeated float weights = 2;
+    }
+
+    model Track {
+      string name = 1;
+      repeated Point points = 2;
+      optional Point origin = 3;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator plain(*schema);
+  EXPECT_EQ(plain.generate_header().find("ResumableDecoder"),
+            std::string::npos);
+
+  CodeGenOptions options;
+  options.resumable_decoder = true;
+  CodeGenerator codegen(*schema, options);
+  std::string header = codegen.generate_header();
+  std::string source_code = codegen.generate_source();
+
+  // The status is shared by every schema and the base is internal, so
+  // neither can clash with the schema's own types.
+  EXPECT_EQ(header.find("enum class DecodeStatus"), std::string::npos);
+  EXPECT_NE(header.find("#include \"serialkit/decoder.hpp\""),
+            std::string::npos);
+  EXPECT_NE(header.find("class ResumableDecoder {\n"
+                        "public:\n"
+                        "  using DecodeStatus = ::serialkit::DecodeStatus;\n"),
+            std::string::npos);
+  EXPECT_NE(header.find("class TrackDecoder : public detail::ResumableDecoder"),
+            std::string::npos);
+  EXPECT_NE(header.find("TrackDecoder(Track& target, uint64_t size);"),
+            std::string::npos);
+  EXPECT_NE(source_code.find("::serialkit::DecodeStatus "
+                             "detail::ResumableDecoder::feed("),
+            std::string::npos);
+
+  // Nested models are decoded in place and refer to their own hooks.
+  EXPECT_NE(source_code.find("return {&message.points.emplace_back(), 0};"),
+            std::string::npos);
+  EXPECT_NE(source_code.find("return {&message.origin.emplace(), 0};"),
+            std::string::npos);
+  EXPECT_NE(source_code.find("return FieldKind::PACKED_FIXED32;"),
+            std::string::npos);
+  EXPECT_NE(source_code.find("TrackDecoder::TrackDecoder(Track& target)\n"
+                             "    : detail::ResumableDecoder(&target, 1, "
+                             "true, 0) {}"),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateStreamWriter) {
+  std::string source = R"(
+    namespace test;
+
+    model SensorBatch {
+      uint64 id = 1;
+      string source = 2;
+      packed repeated double readings = 3;
+      repeated string tags = 4;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator plain(*schema);
+  EXPECT_EQ(plain.generate_header().find("StreamWriter"), std::string::npos);
+
+  CodeGenOptions options;
+  options.stream_writer = true;
+  CodeGenerator codegen(*schema, options);
+  std::string header = codegen.generate_header();
+  std::string source_code = codegen.generate_source();
+
+  // The shared base is internal, so a model named Message cannot clash.
+  EXPECT_NE(header.find("namespace detail {\n\n"
+                        "// Encodes one message field by field"),
+            std::string::npos);
+  EXPECT_NE(header.find("class SensorBatchStreamWriter : public "
+                        "detail::MessageStreamWriter"),
+            std::string::npos);
+  EXPECT_NE(header.find("void write_id(uint64_t value);"), std::string::npos);
+  EXPECT_NE(header.find("void write_source(const std::string& value);"),
+            std::string::npos);
+  EXPECT_NE(header.find("void append_readings(double item);"),
+            std::string::npos);
+  EXPECT_NE(header.find("void append_tags(Range&& items)"), std::string::npos);
+
+  // Packed elements go to the open packed run, tagged as length-delimited.
+  EXPECT_NE(source_code.find("uint8_t* sk_out = packed_space(26, 8);"),
+            std::string::npos);
+  EXPECT_NE(source_code.find("void SensorBatchStreamWriter::append_tags("
+                             "const std::string& item) {\n"
+                             "  uint8_t* sk_out = field_space(1 + "
+                             "detail::length_delimited_size(item.size()));"),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateModelTraits) {
+  std::string source = R"(
+    namespace test;
+
+    model Reading {
+      uint64 id = 1;
+      packed repeated double values = 2;
+      optional string unit = 3;
+    }
+
+    struct Offset {
+      int32 dx;
+      int32 dy;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  // Without --reflection the header needs nothing from the runtime.
+  CodeGenerator plain(*schema);
+  std::string plain_header = plain.generate_header();
+  EXPECT_EQ(plain_header.find("model_traits"), std::string::npos);
+  EXPECT_EQ(plain_header.find("#include \"serialkit/"), std::string::npos);
+
+  CodeGenOptions options;
+  options.reflection = true;
+  CodeGenerator codegen(*schema, options);
+  std::string header = codegen.generate_header();
+
+  EXPECT_NE(header.find("template <> struct model_traits<test::Reading> {"),
+            std::string::npos);
+  EXPECT_NE(header.find("static constexpr std::string_view name = "
+                        "\"Reading\";"),
+            std::string::npos);
+  EXPECT_NE(header.find("field_descriptor<&test::Reading::id>{1, \"id\", 0, "
+                        "0},"),
+            std::string::npos);
+  // Packed runs are tagged as length-delimited.
+  EXPECT_NE(header.find("field_descriptor<&test::Reading::values>{2, "
+                        "\"values\", 2, FIELD_REPEATED | FIELD_PACKED},"),
+            std::string::npos);
+  EXPECT_NE(header.find("field_descriptor<&test::Reading::unit>{3, \"unit\", "
+                        "2, FIELD_OPTIONAL});"),
+            std::string::npos);
+  // Struct members are numbered by position.
+  EXPECT_NE(header.find("template <> struct model_traits<test::Offset> {"),
+            std::string::npos);
+  EXPECT_NE(header.find("field_descriptor<&test::Offset::dy>{2, \"dy\", 0, "
+                        "0});"),
+            std::string::npos);
+  // The descriptors themselves come from the runtime header.
+  EXPECT_NE(header.find("#include \"serialkit/reflection.hpp\""),
+            std::string::npos);
+  EXPECT_EQ(header.find("struct field_descriptor"), std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateEnumTraits) {
+  std::string source = R"(
+    namespace test;
+
+    enum Level {
+      LOW = 0;
+      HIGH = 5;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator plain(*schema);
+  EXPECT_EQ(plain.generate_header().find("enum_traits"), std::string::npos);
+
+  CodeGenOptions options;
+  options.reflection = true;
+  CodeGenerator codegen(*schema, options);
+  std::string header = codegen.generate_header();
+
+  EXPECT_NE(header.find("template <> struct enum_traits<test::Level> {"),
+            std::string::npos);
+  EXPECT_NE(header.find("static constexpr enum_value<test::Level> values[] = "
+                        "{\n      {test::Level::LOW, \"LOW\"},\n      "
+                        "{test::Level::HIGH, \"HIGH\"}};"),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateHeaderOnly) {
+  std::string source = R"(
+    namespace test;
+
+    model Vector3 {
+      float x = 1;
+      float y = 2;
+      float z = 3;
+    }
+
+    model Label {
+      string text = 1;
+      Vector3 at = 2;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenOptions options;
+  options.header_only = true;
+  CodeGenerator codegen(*schema, options);
+  std::string header = codegen.generate_header();
+
+  EXPECT_TRUE(codegen.generate_source().empty());
+  EXPECT_EQ(header.find("namespace {"), std::string::npos);
+  EXPECT_NE(header.find("constexpr size_t varint_size(uint64_t value)"),
+            std::string::npos);
+
+  // Helpers live in a detail namespace, guarded so that several schemas
+  // of one namespace can be included together.
+  EXPECT_NE(header.find("namespace detail {\n\n"
+                        "#ifndef SERIALKIT_TEST_WIRE_HELPERS\n"
+                        "#define SERIALKIT_TEST_WIRE_HELPERS\n"),
+            std::string::npos);
+
+  // Fixed-size scalar models get constexpr codecs, declared and defined.
+  EXPECT_NE(header.find("  constexpr size_t byte_size() const;"),
+            std::string::npos);
+  EXPECT_NE(header.find("constexpr uint8_t* Vector3::serialize_to("
+                        "uint8_t* sk_out) const {"),
+            std::string::npos);
+  EXPECT_NE(header.find("constexpr bool Vector3::deserialize("
+                        "std::span<const uint8_t> sk_data) {"),
+            std::string::npos);
+  EXPECT_NE(header.find("inline std::vector<uint8_t> Vector3::serialize() "
+                        "const {"),
+            std::string::npos);
+
+  // Everything else is inline.
+  EXPECT_NE(header.find("inline size_t Label::byte_size() const {"),
+            std::string::npos);
+  EXPECT_EQ(header.find("constexpr size_t Label::byte_size"),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateJson) {
+  std::string source = R"(
+    namespace test;
+
+    enum Level {
+      LOW = 0;
+      HIGH = 1;
+    }
+
+    model Event {
+      uint64 id = 1;
+      Level level = 2;
+      optional string note = 3;
+      repeated Event children = 4;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenOptions options;
+  options.json = true;
+  CodeGenerator codegen(*schema, options);
+  std::string header = codegen.generate_header();
+  std::string impl = codegen.generate_source();
+
+  EXPECT_NE(header.find("#include <charconv>"), std::string::npos);
+  EXPECT_NE(header.find("  std::string to_json() const;"), std::string::npos);
+  EXPECT_NE(header.find("  void to_json(Writer& sk_writer) const {\n"
+                        "    detail::JsonOut sk_out(sk_writer);\n"
+                        "    append_json(sk_out);\n"
+                        "    sk_out.finish();"),
+            std::string::npos);
+  EXPECT_NE(header.find("  bool from_json(std::string_view json);"),
+            std::string::npos);
+  EXPECT_NE(header.find("class JsonOut {"), std::string::npos);
+  EXPECT_NE(header.find("  void append_json(detail::JsonOut& out) const;"),
+            std::string::npos);
+
+  EXPECT_NE(impl.find("struct JsonParser {"), std::string::npos);
+  EXPECT_NE(impl.find("inline void json_write_string(JsonOut& out, "
+                      "std::string_view value) {"),
+            std::string::npos);
+
+  // Keys are dispatched on their FNV-1a hash, computed at generation time.
+  EXPECT_NE(impl.find("    case 0x8b72e07b55c3ac0ull:\n"
+                      "      if (key == \"id\") return "
+                      "parser.parse_number(message.id);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("if (key == \"level\") return "
+                      "Level_parse_json(parser, message.level);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("parser.parse_optional(message.note, [&](auto& value) "
+                      "{ return parser.parse_string(value); })"),
+            std::string::npos);
+  EXPECT_NE(impl.find("parser.parse_array(message.children, [&](auto& value) "
+                      "{ return Event_parse_json(parser, value); })"),
+            std::string::npos);
+
+  // Enums are written by name.
+  EXPECT_NE(impl.find("  case Level::HIGH:\n    out += \"\\\"HIGH\\\"\";"),
+            std::string::npos);
+  EXPECT_NE(impl.find("if (key == \"HIGH\") return (value = Level::HIGH, "
+                      "true);"),
+            std::string::npos);
+
+  // Members after the first field, which is always written, start with a
+  // comma known at generation time.
+  EXPECT_NE(impl.find("  sk_out += '{';\n"
+                      "  sk_out += \"\\\"id\\\":\";\n"
+                      "  detail::json_write_number(sk_out, id);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("  sk_out += \",\\\"level\\\":\";"),
+            std::string::npos);
+  EXPECT_NE(impl.find("  if (note.has_value()) {"), std::string::npos);
+  EXPECT_NE(impl.find("    children[sk_i].append_json(sk_out);"),
+            std::string::npos);
+
+  // Without the option nothing JSON-related is generated.
+  CodeGenerator plain(*schema);
+  EXPECT_EQ(plain.generate_header().find("to_json"), std::string::npos);
+  EXPECT_EQ(plain.generate_source().find("JsonParser"), std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateJsonTranscoder) {
+  std::string source = R"(
+    namespace test;
+
+    model Event {
+      uint64 id = 1;
+      optional string note = 2;
+      repeated string tags = 3;
+      repeated Event children = 4;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenOptions options;
+  options.json = true;
+  CodeGenerator codegen(*schema, options);
+  std::string header = codegen.generate_header();
+  std::string impl = codegen.generate_source();
+
+  EXPECT_NE(header.find("  static bool transcode_to_json("
+                        "std::span<const uint8_t> data,\n"
+                        "                                std::string& out);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("inline bool Event_transcode_json("
+                      "std::span<const uint8_t> data,\n"
+                      "    JsonOut& sk_out) {"),
+            std::string::npos);
+  EXPECT_NE(header.find("    detail::JsonOut sk_out(sk_writer);\n"
+                        "    bool sk_ok = transcode_to_json(sk_data, sk_out);"),
+            std::string::npos);
+
+  // Strings are escaped straight from the wire bytes.
+  EXPECT_NE(impl.find("json_write_string(sk_out, std::string_view("
+                      "reinterpret_cast<const char*>(value.data()), length));"),
+            std::string::npos);
+  EXPECT_NE(
+      impl.find("if (!Event_transcode_json(value, sk_out)) return false;"),
+            std::string::npos);
+
+  // Adjacent elements share one array; a later run needs the decoded model,
+  // which is found before anything is written.
+  EXPECT_NE(impl.find("      if (open != 3) {"), std::string::npos);
+  EXPECT_NE(impl.find("inline bool Event_runs_split("
+                      "std::span<const uint8_t> data) {"),
+            std::string::npos);
+  EXPECT_NE(impl.find("        if (seen[2]) return true;"), std::string::npos);
+  EXPECT_NE(impl.find("  if (Event_runs_split(data)) {\n"
+                      "    return json_transcode_decoded<Event>(data, "
+                      "sk_out);"),
+            std::string::npos);
+
+  // Fields missing from the wire are written with their defaults.
+  EXPECT_NE(impl.find("  if (!seen[0]) {\n"
+                      "    json_key(sk_out, more, \"\\\"id\\\":\");"),
+            std::string::npos);
+  EXPECT_NE(impl.find("    json_key(sk_out, more, \"\\\"tags\\\":[]\");"),
+            std::string::npos);
+  EXPECT_EQ(impl.find("if (!seen[1])"), std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateStruct) {
+  std::string source = R"(
+    namespace test;
+
+    struct Vector3 {
+      float x;
+      float y;
+      float z;
+    }
+
+    struct Vertex {
+      Vector3 position;
+      uint16 index;
+      bool visible;
+    }
+
+    model Mesh {
+      Vector3 origin = 1;
+      repeated Vector3 positions = 2;
+      repeated Vertex vertices = 3;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator codegen(*schema);
+  std::string header = codegen.generate_header();
+  std::string impl = codegen.generate_source();
+
+  EXPECT_NE(header.find("#include <bit>"), std::string::npos);
+  EXPECT_NE(header.find("struct Vector3 {"), std::string::npos);
+  EXPECT_NE(header.find("static constexpr size_t WIRE_SIZE = 12;"),
+            std::string::npos);
+  EXPECT_NE(header.find("static constexpr size_t WIRE_SIZE = 15;"),
+            std::string::npos);
+  EXPECT_NE(header.find("const uint8_t* deserialize_from(const uint8_t* in);"),
+            std::string::npos);
+
+  // Fields are stored back to back; nested structs inline.
+  EXPECT_NE(impl.find("sk_out = detail::store_le(sk_out, index);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("sk_out = position.serialize_to(sk_out);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("sk_in = detail::load_le(sk_in, visible);"),
+            std::string::npos);
+
+  // Repeated structs are one run, copied whole when the layout allows.
+  EXPECT_NE(impl.find("size_t sk_length = positions.size() * "
+                      "Vector3::WIRE_SIZE;"),
+            std::string::npos);
+  EXPECT_NE(impl.find("std::memcpy(sk_out, positions.data(), sk_length);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("std::memcpy(positions.data() + sk_offset, "
+                      "sk_data.data() + sk_pos, sk_length);"),
+            std::string::npos);
+  EXPECT_NE(impl.find(
+                "if (sk_length % Vertex::WIRE_SIZE != 0) return false;"),
+            std::string::npos);
+
+  // Bools are normalised, so Vertex arrays never decode by memcpy.
+  EXPECT_EQ(impl.find("std::memcpy(vertices.data() + offset"),
+            std::string::npos);
+  EXPECT_NE(impl.find(
+                "sk_in = vertices[sk_offset + sk_i].deserialize_from(sk_in);"),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateColumnar) {
+  std::string source = R"(
+    namespace test;
+
+    model Sample {
+      uint64 timestamp = 1;
+      double value = 2;
+      bool ok = 3;
+      string host = 4;
+      optional int32 delta = 5;
+    }
+
+    model Batch {
+      columnar repeated Sample rows = 1;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenOptions options;
+  options.reflection = true;
+  CodeGenerator codegen(*schema, options);
+  std::string header = codegen.generate_header();
+  std::string impl = codegen.generate_source();
+
+  EXPECT_NE(header.find("#include <unordered_map>"), std::string::npos);
+  EXPECT_NE(header.find("FIELD_REPEATED | FIELD_COLUMNAR"), std::string::npos);
+
+  EXPECT_NE(impl.find("struct StringColumn {"), std::string::npos);
+  EXPECT_NE(impl.find("size_t Sample_columns_size(std::span<const Sample> "
+                      "rows) {"),
+            std::string::npos);
+  EXPECT_NE(impl.find("size += 1 + detail::length_delimited_size("
+                      "detail::Sample_columns_size(rows));"),
+            std::string::npos);
+  EXPECT_NE(impl.find("sk_out = detail::Sample_write_columns(sk_out, rows);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("if (!detail::Sample_read_columns("
+                      "sk_data.subspan(sk_pos, sk_length), rows)) {"),
+            std::string::npos);
+
+  // One column per element field: varints, fixed width, bits, dictionary.
+  EXPECT_NE(impl.find("timestamp_length += varint_size("
+                      "static_cast<uint64_t>(row.timestamp));"),
+            std::string::npos);
+  EXPECT_NE(impl.find("size_t value_length = rows.size() * sizeof(double);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("size_t ok_length = (rows.size() + 7) / 8;"),
+            std::string::npos);
+  EXPECT_NE(impl.find("host_column.add(row.host);"), std::string::npos);
+  EXPECT_NE(impl.find("size_t delta_length = (rows.size() + 7) / 8;"),
+            std::string::npos);
+
+  // Plain repeated model fields keep their per-element encoding.
+  EXPECT_EQ(impl.find("for (const auto& item : rows)"), std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateUtf8) {
+  std::string source = R"(
+    namespace test;
+
+    model Row {
+      utf8 string name = 1;
+    }
+
+    model Message {
+      utf8 string title = 1;
+      optional utf8 string note = 2;
+      repeated utf8 string tags = 3;
+      string raw = 4;
+      columnar repeated Row rows = 5;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenOptions options;
+  options.resumable_decoder = true;
+  options.reflection = true;
+  CodeGenerator codegen(*schema, options);
+  std::string header = codegen.generate_header();
+  std::string impl = codegen.generate_source();
+
+  EXPECT_NE(header.find("#if defined(__SSSE3__)\n#include <tmmintrin.h>"),
+            std::string::npos);
+  EXPECT_NE(header.find("field_descriptor<&test::Message::title>{1, "
+                        "\"title\", 2, FIELD_UTF8}"),
+            std::string::npos);
+  EXPECT_NE(impl.find("struct Utf8Checker {"), std::string::npos);
+  EXPECT_NE(impl.find("inline bool utf8_scan(char* out, const uint8_t* in, "
+                      "size_t size) {"),
+            std::string::npos);
+
+  // Strings are validated while they are copied out of the input.
+  EXPECT_NE(impl.find(
+                "if (!detail::utf8_assign(title, sk_data.data() + sk_pos, "
+                "sk_length))"),
+            std::string::npos);
+  EXPECT_NE(impl.find("if (!detail::utf8_assign(note.emplace(), sk_data.data() "
+                      "+ sk_pos, sk_length))"),
+            std::string::npos);
+  EXPECT_NE(impl.find("if (!detail::utf8_assign(detail::next_element(tags, "
+                      "sk_tags_used), sk_data.data() + sk_pos, sk_length))"),
+            std::string::npos);
+  EXPECT_NE(impl.find("raw.assign(reinterpret_cast<const char*>"),
+            std::string::npos);
+  EXPECT_NE(impl.find("for (std::string_view entry : dictionary) {\n"
+                      "        if (!utf8_valid(entry)) return false;"),
+            std::string::npos);
+
+  // The resumable decoder checks each string once it is complete.
+  EXPECT_NE(impl.find("    return FieldKind::UTF8_STRING;"), std::string::npos);
+  EXPECT_NE(impl.find("!utf8_valid(*string_)"), std::string::npos);
+
+  // Schemas without utf8 fields get no validator.
+  auto plain = parse_schema("namespace test; model M { string s = 1; }");
+  ASSERT_NE(plain, nullptr);
+  CodeGenerator plain_codegen(*plain);
+  plain_codegen.generate_header();
+  EXPECT_EQ(plain_codegen.generate_source().find("utf8_"), std::string::npos);
+
+  // --utf8 validates every string field.
+  CodeGenOptions strict;
+  strict.utf8 = true;
+  CodeGenerator strict_codegen(*plain, strict);
+  strict_codegen.generate_header();
+  EXPECT_NE(strict_codegen.generate_source().find(
+                "if (!detail::utf8_assign(s, sk_data.data() + sk_pos, "
+                "sk_length))"),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateChecksummed) {
+  std::string source = R"(
+    namespace test;
+
+    checksummed model Frame {
+      uint32 id = 1;
+      string body = 2;
+    }
+
+    model Envelope {
+      Frame frame = 1;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenOptions options;
+  options.resumable_decoder = true;
+  options.stream_writer = true;
+  CodeGenerator codegen(*schema, options);
+  std::string header = codegen.generate_header();
+  std::string impl = codegen.generate_source();
+
+  EXPECT_NE(header.find("#if defined(__SSE4_2__) && defined(__x86_64__)\n"
+                        "#include <nmmintrin.h>"),
+            std::string::npos);
+  EXPECT_NE(impl.find("inline uint32_t crc32c(const uint8_t* data, size_t "
+                      "size, uint32_t crc = 0) {"),
+            std::string::npos);
+  EXPECT_NE(impl.find("_mm_crc32_u64(value, word)"), std::string::npos);
+  EXPECT_NE(impl.find("constexpr Crc32cTables make_crc32c_tables()"),
+            std::string::npos);
+
+  // The trailer is part of the encoded message.
+  EXPECT_NE(impl.find("size += 4; // CRC32C"), std::string::npos);
+  EXPECT_NE(impl.find("return detail::store_crc32c(sk_out, "
+                      "detail::crc32c(sk_begin, static_cast<size_t>(sk_out - "
+                      "sk_begin)));"),
+            std::string::npos);
+  EXPECT_NE(impl.find("bool Frame::parse(std::span<const uint8_t> sk_data, "
+                      "bool sk_replace) {\n"
+                      "  if (!detail::verify_crc32c(sk_data)) return false;"),
+            std::string::npos);
+  EXPECT_EQ(impl.find("bool Envelope::parse(std::span<const uint8_t> sk_data, "
+                      "bool sk_replace) {\n  if (!verify_crc32c(sk_data))"),
+            std::string::npos);
+
+  // The decoder gathers checksummed messages before decoding them.
+  EXPECT_NE(impl.find("    return FieldKind::CHECKSUMMED;"), std::string::npos);
+  EXPECT_NE(impl.find("    return message.frame.deserialize(bytes);"),
+            std::string::npos);
+  EXPECT_NE(
+      header.find(": detail::MessageStreamWriter(writer, chunk_size, true) {}"),
+      std::string::npos);
+
+  // Schemas without checksummed models are unchanged.
+  auto plain = parse_schema("namespace test; model M { string s = 1; }");
+  ASSERT_NE(plain, nullptr);
+  CodeGenerator plain_codegen(*plain, options);
+  EXPECT_EQ(plain_codegen.generate_header().find("nmmintrin"),
+            std::string::npos);
+  EXPECT_EQ(plain_codegen.generate_source().find("crc32c"), std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateHash) {
+  std::string source = R"(
+    namespace test;
+
+    struct Point {
+      float x;
+      float y;
+    }
+
+    model Item {
+      uint32 id = 2;
+      string name = 1;
+      optional Point at = 3;
+      packed repeated double weights = 4;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator codegen(*schema);
+  std::string header = codegen.generate_header();
+  std::string impl = codegen.generate_source();
+
+  EXPECT_NE(header.find("uint64_t hash(uint64_t seed = 0) const;"),
+            std::string::npos);
+  EXPECT_NE(impl.find("struct FieldHasher {"), std::string::npos);
+
+  // Struct fields are hashed in declaration order, without numbers.
+  EXPECT_NE(impl.find("uint64_t Point::hash(uint64_t sk_seed) const {\n"
+                      "  detail::FieldHasher sk_hasher(sk_seed);\n"
+                      "  sk_hasher.add_bits(x);\n"
+                      "  sk_hasher.add_bits(y);\n"
+                      "  return sk_hasher.finish();\n"),
+            std::string::npos);
+
+  // Model fields are hashed in field-number order.
+  size_t body = impl.find("uint64_t Item::hash(uint64_t sk_seed) const {");
+  ASSERT_NE(body, std::string::npos);
+  size_t name = impl.find("sk_hasher.add_string(name);", body);
+  size_t id = impl.find("sk_hasher.add(static_cast<uint64_t>(id));", body);
+  ASSERT_NE(name, std::string::npos);
+  ASSERT_NE(id, std::string::npos);
+  EXPECT_LT(name, id);
+  EXPECT_NE(impl.find("  if (at.has_value()) {\n"
+                      "    sk_hasher.add(3);\n"
+                      "    sk_hasher.add((*at).hash());\n",
+                      body),
+            std::string::npos);
+  EXPECT_NE(impl.find("  sk_hasher.add(weights.size());\n"
+                      "  for (const auto& sk_element : weights) {\n"
+                      "    sk_hasher.add_bits(sk_element);\n",
+                      body),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateComparisons) {
+  std::string source = R"(
+    namespace test;
+
+    struct Point {
+      float x;
+      float y;
+    }
+
+    model Plain {
+      uint32 id = 1;
+      string name = 2;
+    }
+
+    model Item {
+      repeated string tags = 1;
+      string name = 2;
+      optional Plain plain = 3;
+      uint32 id = 4;
+      Point at = 5;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator codegen(*schema);
+  std::string header = codegen.generate_header();
+  std::string impl = codegen.generate_source();
+
+  EXPECT_NE(header.find("#include <compare>"), std::string::npos);
+  EXPECT_NE(header.find("  bool operator==(const Point& rhs) const = default;\n"
+                        "  std::partial_ordering operator<=>(const Point& "
+                        "rhs) const = default;"),
+            std::string::npos);
+
+  // Declaration order already puts the scalar first.
+  EXPECT_NE(header.find("  bool operator==(const Plain& rhs) const = default;\n"
+                        "  std::strong_ordering operator<=>(const Plain& "
+                        "rhs) const = default;"),
+            std::string::npos);
+  EXPECT_EQ(impl.find("Plain::operator=="), std::string::npos);
+
+  // Otherwise the cheap fields are compared first.
+  EXPECT_NE(header.find("  bool operator==(const Item& rhs) const;\n"),
+            std::string::npos);
+  EXPECT_NE(header.find("std::partial_ordering operator<=>(const Item& rhs)"),
+            std::string::npos);
+  EXPECT_NE(impl.find("bool Item::operator==(const Item& sk_rhs) const {\n"
+                      "  return id == sk_rhs.id &&\n"
+                      "         at == sk_rhs.at &&\n"
+                      "         name == sk_rhs.name &&\n"
+                      "         plain == sk_rhs.plain &&\n"
+                      "         tags == sk_rhs.tags;\n"
+                      "}"),
+            std::string::npos);
+
+  EXPECT_NE(header.find("template <> struct hash<test::Item> {\n"
+                        "  size_t operator()(const test::Item& value) const "
+                        "noexcept {\n"
+                        "    return static_cast<size_t>(value.hash());"),
+            std::string::npos);
+  EXPECT_NE(header.find("template <> struct hash<test::Point> {"),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateDiff) {
+  std::string source = R"(
+    namespace test;
+
+    model Pose {
+      float x = 1;
+      optional string label = 2;
+    }
+
+    model Snapshot {
+      uint64 tick = 1;
+      optional Pose focus = 2;
+      packed repeated float heights = 3;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenOptions options;
+  options.diff = true;
+  CodeGenerator codegen(*schema, options);
+  std::string header = codegen.generate_header();
+  std::string impl = codegen.generate_source();
+
+  EXPECT_NE(header.find("  static bool diff(const Snapshot& previous, const "
+                        "Snapshot& current,\n"
+                        "                   std::vector<uint8_t>& patch);"),
+            std::string::npos);
+  EXPECT_NE(header.find("                   Writer& sk_writer, "
+                        "std::vector<uint8_t>& sk_scratch) {\n"
+                        "    sk_scratch.clear();\n"),
+            std::string::npos);
+  EXPECT_NE(header.find("    thread_local std::vector<uint8_t> sk_scratch;\n"),
+            std::string::npos);
+  EXPECT_EQ(header.find("std::vector<uint8_t> sk_patch;"), std::string::npos);
+  EXPECT_NE(header.find("  bool apply_patch(std::span<const uint8_t> patch, "
+                        "size_t& pos);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("inline bool parse_varint("), std::string::npos);
+
+  // One byte of changed bits, one of presence bits.
+  EXPECT_NE(impl.find("bool Pose::diff(const Pose& sk_previous, const Pose& "
+                      "sk_current,\n"
+                      "    std::vector<uint8_t>& sk_patch) {\n"
+                      "  size_t sk_mask = sk_patch.size();\n"
+                      "  sk_patch.resize(sk_mask + 2);\n"),
+            std::string::npos);
+  EXPECT_NE(impl.find("  if (!detail::same_bits(sk_previous.x, sk_current.x)) "
+                      "{\n"
+                      "    sk_patch[sk_mask + 0] |= 0x01;\n"
+                      "    detail::write_patch(sk_patch, sk_previous.x, "
+                      "sk_current.x);\n"),
+            std::string::npos);
+  EXPECT_NE(impl.find("      sk_patch[sk_mask + 0] |= 0x02;\n"
+                      "      sk_patch[sk_mask + 1] |= 0x01;\n"
+                      "      detail::write_patch(sk_patch, "
+                      "(*sk_current.label));\n"),
+            std::string::npos);
+
+  // Nested models are patched recursively, floats in arrays by XOR.
+  EXPECT_NE(impl.find("    if (Pose::diff(sk_previous.focus ? "
+                      "*sk_previous.focus : detail::empty_value<Pose>(),\n"
+                      "            *sk_current.focus, sk_patch) ||\n"),
+            std::string::npos);
+  EXPECT_NE(impl.find(
+                "        detail::write_patch(sk_patch, sk_before[sk_i], "
+                "sk_after[sk_i]);\n"),
+            std::string::npos);
+  EXPECT_NE(impl.find("      if (!focus.has_value()) focus.emplace();\n"
+                      "      if (!(*focus).apply_patch(sk_patch, sk_pos)) "
+                      "return false;\n"),
+            std::string::npos);
+  EXPECT_NE(impl.find("    heights.resize(sk_count);\n"), std::string::npos);
+
+  CodeGenerator plain_codegen(*schema);
+  EXPECT_EQ(plain_codegen.generate_header().find("apply_patch"),
+            std::string::npos);
+  EXPECT_EQ(plain_codegen.generate_source().find("write_patch"),
+            std::string::npos);
+}
+
+TEST_F(CodeGenTest, GenerateClearAndMerge) {
+  std::string source = R"(
+    namespace test;
+
+    model Item {
+      string name = 1;
+    }
+
+    model Order {
+      uint64 id = 1;
+      optional string note = 2;
+      repeated string tags = 3;
+      Item head = 4;
+      repeated Item items = 5;
+    }
+  )";
+
+  auto schema = parse_schema(source);
+  ASSERT_NE(schema, nullptr);
+
+  CodeGenerator codegen(*schema);
+  std::string header = codegen.generate_header();
+  std::string impl = codegen.generate_source();
+
+  EXPECT_NE(header.find("  bool merge(std::span<const uint8_t> data);"),
+            std::string::npos);
+  EXPECT_NE(header.find("  void clear();"), std::string::npos);
+  EXPECT_NE(header.find("private:\n  bool parse(std::span<const uint8_t> "
+                        "data, bool replace);\n};"),
+            std::string::npos);
+
+  // clear() keeps capacity and recurses into nested models.
+  EXPECT_NE(impl.find("void Order::clear() {\n"
+                      "  id = {};\n"
+                      "  note.reset();\n"
+                      "  tags.clear();\n"
+                      "  head.clear();\n"
+                      "  items.clear();\n"
+                      "}"),
+            std::string::npos);
+
+  // Both entry points share one decoder.
+  EXPECT_NE(impl.find("bool Order::deserialize(std::span<const uint8_t> "
+                      "sk_data) {\n  return parse(sk_data, true);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("bool Order::merge(std::span<const uint8_t> sk_data) {\n"
+                      "  return parse(sk_data, false);"),
+            std::string::npos);
+
+  // Replacing decodes into the elements already there instead of
+  // appending, and trims whatever the new message did not fill.
+  EXPECT_NE(impl.find("  if (sk_replace) {\n"
+                      "    id = {};\n"
+                      "    note.reset();\n"
+                      "  }\n"
+                      "  size_t sk_tags_used = sk_replace ? 0 : tags.size();\n"
+                      "  bool sk_head_seen = false;\n"
+                      "  size_t sk_items_used = sk_replace ? 0 : "
+                      "items.size();\n"),
+            std::string::npos);
+  EXPECT_NE(impl.find("next_element(tags, sk_tags_used)\n"
+                      "          .assign(reinterpret_cast<const char*>"),
+            std::string::npos);
+  EXPECT_NE(impl.find("auto& sk_item = detail::next_element(items, "
+                      "sk_items_used);"),
+            std::string::npos);
+  EXPECT_NE(impl.find("if (!(sk_replace && !sk_head_seen ? "
+                      "head.deserialize(sk_message)\n"
+                      "                                      : "
+                      "head.merge(sk_message))) {"),
+            std::string::npos);
+  EXPECT_NE(impl.find("  tags.resize(sk_tags_used);\n"
+                      "  if (sk_replace && !sk_head_seen) head.clear();\n"
+                      "  items.resize(sk_items_used);\n"
+                      "  return true;"),
+            std::string::npos);
+}
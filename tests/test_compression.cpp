@@ -0,0 +1,165 @@
+#include "serialkit/compression.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+using namespace serialkit;
+
+namespace {
+
+std::span<const uint8_t> as_bytes(const std::string &text) {
+  return std::span<const uint8_t>(
+      reinterpret_cast<const uint8_t *>(text.data()), text.size());
+}
+
+std::string as_string(std::span<const uint8_t> bytes) {
+  return std::string(reinterpret_cast<const char *>(bytes.data()),
+                     bytes.size());
+}
+
+} // namespace
+
+class CompressionTest : public ::testing::Test {
+protected:
+  std::vector<uint8_t> compress(const Codec &codec,
+                                std::span<const uint8_t> input) {
+    std::vector<uint8_t> output(codec.max_compressed_size(input.size()));
+    output.resize(codec.compress(input, output.data()));
+    return output;
+  }
+
+  void expect_round_trip(const Codec &codec, std::span<const uint8_t> input) {
+    std::vector<uint8_t> compressed = compress(codec, input);
+    std::vector<uint8_t> restored(input.size());
+    ASSERT_TRUE(codec.decompress(compressed, restored));
+    EXPECT_TRUE(std::equal(input.begin(), input.end(), restored.begin()));
+  }
+
+  std::vector<uint8_t> random_bytes(size_t size) {
+    std::mt19937 rng(42);
+    std::vector<uint8_t> bytes(size);
+    for (auto &byte : bytes) {
+      byte = static_cast<uint8_t>(rng());
+    }
+    return bytes;
+  }
+
+  Lz4Codec lz4;
+};
+
+TEST_F(CompressionTest, Lz4RoundTrip) {
+  expect_round_trip(lz4, {});
+  expect_round_trip(lz4, as_bytes("short"));
+  expect_round_trip(lz4, as_bytes(std::string(100000, 'a')));
+  expect_round_trip(lz4, random_bytes(70000));
+
+  std::string text;
+  for (int i = 0; i < 5000; ++i) {
+    text += "user_" + std::to_string(i % 97) + ";status=ACTIVE;";
+  }
+  expect_round_trip(lz4, as_bytes(text));
+}
+
+TEST_F(CompressionTest, Lz4ShrinksRepetitiveData) {
+  std::string text(64 * 1024, 'x');
+  EXPECT_LT(compress(lz4, as_bytes(text)).size(), text.size() / 100);
+}
+
+TEST_F(CompressionTest, Lz4KnownEncoding) {
+  // 4 literals "abcd", then a match of 8 bytes at offset 4, then the
+  // mandatory 5 trailing literals.
+  std::string text = "abcdabcdabcdzzzzz";
+  std::vector<uint8_t> compressed = compress(lz4, as_bytes(text));
+  ASSERT_GE(compressed.size(), 4u);
+  EXPECT_EQ(compressed[0], 0x44);
+  EXPECT_EQ(compressed[5], 0x04);
+  EXPECT_EQ(compressed[6], 0x00);
+}
+
+TEST_F(CompressionTest, Lz4RejectsMalformedInput) {
+  std::string text(1000, 'q');
+  std::vector<uint8_t> compressed = compress(lz4, as_bytes(text));
+
+  std::vector<uint8_t> wrong_size(999);
+  EXPECT_FALSE(lz4.decompress(compressed, wrong_size));
+
+  std::vector<uint8_t> restored(1000);
+  std::vector<uint8_t> truncated(compressed.begin(), compressed.end() - 1);
+  EXPECT_FALSE(lz4.decompress(truncated, restored));
+
+  const uint8_t bad_offset[] = {0x10, 'a', 0x05, 0x00, 0x00};
+  EXPECT_FALSE(lz4.decompress(bad_offset, restored));
+
+  EXPECT_FALSE(lz4.decompress({}, restored));
+}
+
+TEST_F(CompressionTest, IncompressibleBlocksAreStored) {
+  std::vector<uint8_t> raw = random_bytes(1000);
+  std::vector<uint8_t> block;
+  encode_block(lz4, raw, block);
+  EXPECT_EQ(block[0], static_cast<uint8_t>(CodecId::STORED));
+
+  std::vector<uint8_t> decoded;
+  ASSERT_TRUE(decode_block(lz4, block, decoded, raw.size()));
+  EXPECT_EQ(decoded, raw);
+  EXPECT_FALSE(decode_block(lz4, block, decoded, raw.size() - 1));
+}
+
+TEST_F(CompressionTest, BlockStreamRoundTrip) {
+  std::vector<uint8_t> stream;
+  VectorWriter output(stream);
+  std::vector<std::string> messages;
+  {
+    BlockWriter writer(output, lz4, 1024);
+    for (int i = 0; i < 2000; ++i) {
+      messages.push_back("event " + std::to_string(i % 10));
+      writer.append(as_bytes(messages.back()));
+    }
+    messages.push_back(std::string(5000, 'B'));
+    writer.append(as_bytes(messages.back()));
+  }
+
+  size_t raw_size = 0;
+  for (const auto &message : messages) {
+    raw_size += message.size() + 1;
+  }
+  EXPECT_LT(stream.size(), raw_size / 4);
+
+  BlockReader reader(lz4);
+  size_t received = 0;
+  for (size_t offset = 0; offset < stream.size(); offset += 777) {
+    size_t chunk = std::min<size_t>(777, stream.size() - offset);
+    reader.feed(std::span<const uint8_t>(stream.data() + offset, chunk));
+
+    std::span<const uint8_t> message;
+    while (reader.next(message) == ReadStatus::OK) {
+      ASSERT_LT(received, messages.size());
+      EXPECT_EQ(as_string(message), messages[received]);
+      ++received;
+    }
+  }
+  EXPECT_EQ(received, messages.size());
+}
+
+TEST_F(CompressionTest, BlockReaderRejectsCorruptedBlock) {
+  std::vector<uint8_t> stream;
+  VectorWriter output(stream);
+  {
+    BlockWriter writer(output, lz4);
+    writer.append(as_bytes(std::string(500, 'c')));
+  }
+  stream[2] = static_cast<uint8_t>(CodecId::ZSTD) + 1;
+
+  BlockReader reader(lz4);
+  reader.feed(stream);
+  std::span<const uint8_t> message;
+  EXPECT_EQ(reader.next(message), ReadStatus::MALFORMED);
+}
+
+#if defined(SERIALKIT_HAS_ZSTD)
+TEST_F(CompressionTest, ZstdRoundTrip) {
+  ZstdCodec zstd;
+  expect_round_trip(zstd, as_bytes(std::string(100000, 'z')));
+  expect_round_trip(zstd, random_bytes(70000));
+}
+#endif
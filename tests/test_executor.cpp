@@ -0,0 +1,127 @@
+#include "serialkit/executor.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace serialkit;
+
+static_assert(Executor<InlineExecutor>);
+static_assert(Executor<ThreadPool>);
+
+class ExecutorTest : public ::testing::Test {
+protected:
+  ThreadPool pool{4};
+};
+
+TEST_F(ExecutorTest, CoversEveryIndexOnce) {
+  std::vector<std::atomic<int>> hits(10007);
+  pool.parallel_for(hits.size(), 64, [&](size_t begin, size_t end) {
+    ASSERT_LE(end - begin, 64u);
+    for (size_t i = begin; i < end; ++i) {
+      hits[i].fetch_add(1);
+    }
+  });
+
+  for (const auto &hit : hits) {
+    EXPECT_EQ(hit.load(), 1);
+  }
+}
+
+TEST_F(ExecutorTest, EmptyAndSingleChunk) {
+  int calls = 0;
+  pool.parallel_for(0, 8, [&](size_t, size_t) { ++calls; });
+  EXPECT_EQ(calls, 0);
+
+  pool.parallel_for(5, 8, [&](size_t begin, size_t end) {
+    EXPECT_EQ(begin, 0u);
+    EXPECT_EQ(end, 5u);
+    ++calls;
+  });
+  EXPECT_EQ(calls, 1);
+}
+
+TEST_F(ExecutorTest, NestedParallelFor) {
+  std::atomic<size_t> total{0};
+  pool.parallel_for(16, 1, [&](size_t, size_t) {
+    pool.parallel_for(100, 10, [&](size_t begin, size_t end) {
+      total.fetch_add(end - begin);
+    });
+  });
+  EXPECT_EQ(total.load(), 1600u);
+}
+
+TEST_F(ExecutorTest, PropagatesExceptions) {
+  EXPECT_THROW(pool.parallel_for(1000, 10,
+                                 [](size_t begin, size_t) {
+                                   if (begin == 500) {
+                                     throw std::runtime_error("chunk failed");
+                                   }
+                                 }),
+               std::runtime_error);
+
+  std::atomic<size_t> total{0};
+  pool.parallel_for(1000, 10, [&](size_t begin, size_t end) {
+    total.fetch_add(end - begin);
+  });
+  EXPECT_EQ(total.load(), 1000u);
+}
+
+TEST_F(ExecutorTest, UnevenWorkIsBalanced) {
+  std::vector<std::atomic<int>> hits(512);
+  pool.parallel_for(hits.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (i % 64 == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      hits[i].fetch_add(1);
+    }
+  });
+
+  for (const auto &hit : hits) {
+    EXPECT_EQ(hit.load(), 1);
+  }
+}
+
+TEST_F(ExecutorTest, ConcurrentCallers) {
+  std::atomic<size_t> total{0};
+  std::vector<std::thread> callers;
+  for (int t = 0; t < 4; ++t) {
+    callers.emplace_back([&] {
+      for (int round = 0; round < 50; ++round) {
+        pool.parallel_for(1000, 16, [&](size_t begin, size_t end) {
+          total.fetch_add(end - begin);
+        });
+      }
+    });
+  }
+  for (auto &caller : callers) {
+    caller.join();
+  }
+  EXPECT_EQ(total.load(), 4u * 50 * 1000);
+}
+
+TEST_F(ExecutorTest, WorkDequeStealsFromTop) {
+  detail::WorkDeque<int> deque(2);
+  int items[5] = {0, 1, 2, 3, 4};
+  for (int &item : items) {
+    deque.push(&item);
+  }
+
+  EXPECT_EQ(deque.steal(), &items[0]);
+  EXPECT_EQ(deque.pop(), &items[4]);
+  EXPECT_EQ(deque.steal(), &items[1]);
+  EXPECT_EQ(deque.pop(), &items[3]);
+  EXPECT_EQ(deque.pop(), &items[2]);
+  EXPECT_EQ(deque.pop(), nullptr);
+  EXPECT_EQ(deque.steal(), nullptr);
+  EXPECT_TRUE(deque.empty());
+}
+
+TEST_F(ExecutorTest, DefaultExecutor) {
+  ThreadPool &executor = default_executor();
+  EXPECT_GE(executor.concurrency(), 1u);
+  EXPECT_EQ(&executor, &default_executor());
+}
@@ -0,0 +1,168 @@
+#include "serialkit/frame_ring.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+using namespace serialkit;
+
+namespace {
+
+struct Counter {
+  uint32_t producer = 0;
+  uint32_t sequence = 0;
+
+  size_t byte_size() const { return 8; }
+
+  uint8_t *serialize_to(uint8_t *out) const {
+    std::memcpy(out, &producer, 4);
+    std::memcpy(out + 4, &sequence, 4);
+    return out + 8;
+  }
+};
+
+std::span<const uint8_t> as_bytes(const std::string &text) {
+  return std::span<const uint8_t>(
+      reinterpret_cast<const uint8_t *>(text.data()), text.size());
+}
+
+std::string as_string(std::span<const uint8_t> bytes) {
+  return std::string(reinterpret_cast<const char *>(bytes.data()),
+                     bytes.size());
+}
+
+} // namespace
+
+class FrameRingTest : public ::testing::Test {
+protected:
+  std::vector<std::span<const uint8_t>> frames;
+};
+
+TEST_F(FrameRingTest, ReserveCommitPoll) {
+  FrameRing ring(256);
+
+  uint8_t *first = ring.reserve(5);
+  ASSERT_NE(first, nullptr);
+  std::memcpy(first, "hello", 5);
+
+  uint8_t *second = ring.reserve(10);
+  ASSERT_NE(second, nullptr);
+  std::memcpy(second, "world", 5);
+  ring.commit(second, 5);
+
+  // The second frame is committed but waits behind the first.
+  EXPECT_EQ(ring.poll(frames), 0u);
+
+  ring.commit(first, 5);
+  ASSERT_EQ(ring.poll(frames), 2u);
+  EXPECT_EQ(as_string(frames[0]), "hello");
+  EXPECT_EQ(as_string(frames[1]), "world");
+
+  ring.release();
+  EXPECT_EQ(ring.poll(frames), 0u);
+}
+
+TEST_F(FrameRingTest, CursorsStayCacheLineAligned) {
+  // The cursors are cache-line aligned, so the ring is too, even after a
+  // member that would otherwise leave it at an 8-byte offset.
+  struct Placed {
+    char tag;
+    FrameRing ring{256};
+  } placed;
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&placed.ring) % 64, 0u);
+
+  ASSERT_TRUE(placed.ring.try_push(as_bytes("aligned")));
+  ASSERT_EQ(placed.ring.poll(frames), 1u);
+  EXPECT_EQ(as_string(frames[0]).substr(1), "aligned");
+}
+
+TEST_F(FrameRingTest, FullRingAndWrapAround) {
+  FrameRing ring(128);
+  EXPECT_EQ(ring.capacity(), 128u);
+  EXPECT_THROW(ring.reserve(ring.max_frame_size() + 1), std::length_error);
+
+  // 3 records of 40 bytes leave 8 bytes at the end of the ring.
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(ring.try_push(as_bytes(std::string(30, 'a' + i))));
+  }
+  EXPECT_FALSE(ring.try_push(as_bytes(std::string(30, 'x'))));
+
+  ASSERT_EQ(ring.poll(frames, 1), 1u);
+  ring.release();
+
+  // Padding fills the last 8 bytes and the record lands at the start.
+  ASSERT_TRUE(ring.try_push(as_bytes(std::string(30, 'w'))));
+  EXPECT_FALSE(ring.try_push(as_bytes("")));
+
+  ASSERT_EQ(ring.poll(frames), 3u);
+  EXPECT_EQ(frames[0][1], 'b');
+  EXPECT_EQ(frames[1][1], 'c');
+  EXPECT_EQ(frames[2].data(), frames[0].data() - 40);
+  EXPECT_EQ(frames[2][0], 30);
+  EXPECT_EQ(as_string(frames[2].subspan(1)), std::string(30, 'w'));
+  ring.release();
+
+  ASSERT_TRUE(ring.try_push(as_bytes("again")));
+  ASSERT_EQ(ring.poll(frames), 1u);
+  EXPECT_EQ(as_string(frames[0].subspan(1)), "again");
+  ring.release();
+}
+
+TEST_F(FrameRingTest, FramesFormDelimitedStream) {
+  FrameRing ring(1024);
+  ASSERT_TRUE(ring.try_push(as_bytes("one")));
+  ASSERT_TRUE(ring.try_push(Counter{7, 9}));
+
+  StreamReader reader;
+  ring.poll(frames);
+  for (auto frame : frames) {
+    reader.feed(frame);
+  }
+  ring.release();
+
+  std::span<const uint8_t> message;
+  ASSERT_EQ(reader.next(message), ReadStatus::OK);
+  EXPECT_EQ(as_string(message), "one");
+  ASSERT_EQ(reader.next(message), ReadStatus::OK);
+  EXPECT_EQ(message.size(), 8u);
+}
+
+TEST_F(FrameRingTest, ManyProducersOneConsumer) {
+  constexpr uint32_t PRODUCERS = 4;
+  constexpr uint32_t PER_PRODUCER = 20000;
+  FrameRing ring(4096);
+
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < PRODUCERS; ++p) {
+    producers.emplace_back([&ring, p] {
+      for (uint32_t i = 0; i < PER_PRODUCER; ++i) {
+        while (!ring.try_push(Counter{p, i})) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<uint32_t> next(PRODUCERS, 0);
+  size_t received = 0;
+  bool ordered = true;
+  while (received < PRODUCERS * PER_PRODUCER) {
+    if (ring.poll(frames) == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    for (auto frame : frames) {
+      Counter counter;
+      std::memcpy(&counter.producer, frame.data() + 1, 4);
+      std::memcpy(&counter.sequence, frame.data() + 5, 4);
+      ordered &= counter.sequence == next[counter.producer]++;
+      ++received;
+    }
+    ring.release();
+  }
+
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(ring.poll(frames), 0u);
+}
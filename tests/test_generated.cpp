@@ -0,0 +1,443 @@
+#include "codegen_test.hpp"
+#include "serialkit/stream.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <limits>
+#include <unordered_set>
+
+using namespace codegen_test;
+
+namespace {
+
+Pose make_pose(float x, uint8_t flags, double w) {
+  Pose pose;
+  pose.pos.x = x;
+  pose.pos.y = 2.0f;
+  pose.pos.z = 3.0f;
+  pose.flags = flags;
+  pose.w = w;
+  return pose;
+}
+
+std::vector<uint8_t> make_stream(size_t count) {
+  std::vector<uint8_t> stream;
+  serialkit::VectorWriter writer(stream);
+  for (size_t i = 0; i < count; ++i) {
+    Body body;
+    body.id = static_cast<uint32_t>(i);
+    for (size_t j = 0; j <= i; ++j) {
+      body.path.push_back(make_pose(1.0f, 4, 0.5));
+    }
+    body.serialize_delimited(writer);
+  }
+  return stream;
+}
+
+Body make_body() {
+  Body body;
+  body.id = 42;
+  body.pose = make_pose(1.0f, 4, 0.5);
+  body.path = {make_pose(2.0f, 1, -0.25), make_pose(3.0f, 0, 1e300)};
+  body.samples = {1, 300, 70000};
+  return body;
+}
+
+// Write-only sink that keeps the text and the size of the largest write.
+struct ChunkRecorder {
+  std::string text;
+  size_t writes = 0;
+  size_t largest = 0;
+
+  void write(const uint8_t *data, size_t size) {
+    text.append(reinterpret_cast<const char *>(data), size);
+    ++writes;
+    largest = std::max(largest, size);
+  }
+};
+
+// Counts read() calls, which are syscalls on an FdReader.
+struct CountingReader {
+  serialkit::SpanReader source;
+  size_t reads = 0;
+
+  size_t read(uint8_t *data, size_t size) {
+    ++reads;
+    return source.read(data, size);
+  }
+};
+
+} // namespace
+
+TEST(GeneratedTest, StructEqualityOutOfDeclarationOrder) {
+  Pose a = make_pose(1.0f, 4, 0.5);
+  EXPECT_EQ(a, make_pose(1.0f, 4, 0.5));
+  EXPECT_NE(a, make_pose(1.5f, 4, 0.5));
+  EXPECT_NE(a, make_pose(1.0f, 5, 0.5));
+  EXPECT_NE(a, make_pose(1.0f, 4, 0.25));
+  EXPECT_LT(a, make_pose(1.5f, 0, 0.0));
+}
+
+TEST(GeneratedTest, ModelWithStructFields) {
+  Body body;
+  body.id = 7;
+  body.pose = make_pose(1.0f, 4, 0.5);
+  body.path.push_back(make_pose(2.0f, 1, 0.0));
+
+  Body copy;
+  ASSERT_TRUE(copy.deserialize(body.serialize()));
+  EXPECT_EQ(copy, body);
+
+  copy.path[0].flags = 2;
+  EXPECT_NE(copy, body);
+
+  std::unordered_set<Body> bodies{body, copy};
+  EXPECT_EQ(bodies.size(), 2u);
+  EXPECT_EQ(bodies.count(body), 1u);
+}
+
+TEST(GeneratedTest, ParseDelimitedRejectsOversizedPrefix) {
+  // A ten-byte prefix announcing close to 2^64 bytes.
+  std::vector<uint8_t> hostile(9, 0xFF);
+  hostile.push_back(0x01);
+  serialkit::SpanReader reader(hostile);
+  std::vector<uint8_t> buffer;
+  Body body;
+  EXPECT_FALSE(body.parse_delimited(reader, buffer));
+  EXPECT_EQ(buffer.capacity(), 0u);
+
+  // One byte over the default limit of 64 MiB.
+  std::vector<uint8_t> over = {0x81, 0x80, 0x80, 0x20};
+  serialkit::SpanReader over_reader(over);
+  EXPECT_FALSE(body.parse_delimited(over_reader));
+
+  std::vector<uint8_t> stream = make_stream(1);
+  serialkit::SpanReader small_reader(stream);
+  EXPECT_FALSE(body.parse_delimited(small_reader, buffer, 4));
+}
+
+TEST(GeneratedTest, ParseDelimitedReusesBuffer) {
+  std::vector<uint8_t> stream = make_stream(4);
+  serialkit::SpanReader reader(stream);
+  std::vector<uint8_t> buffer;
+  buffer.reserve(1024);
+  const uint8_t *storage = buffer.data();
+
+  Body body;
+  for (uint32_t i = 0; i < 4; ++i) {
+    ASSERT_TRUE(body.parse_delimited(reader, buffer));
+    EXPECT_EQ(body.id, i);
+    EXPECT_EQ(body.path.size(), i + 1);
+  }
+  EXPECT_EQ(buffer.data(), storage);
+  EXPECT_FALSE(body.parse_delimited(reader, buffer));
+}
+
+TEST(GeneratedTest, ParseDelimitedThroughFramer) {
+  std::vector<uint8_t> stream = make_stream(16);
+  CountingReader reader{serialkit::SpanReader(stream)};
+  serialkit::StreamReader framer;
+
+  Body body;
+  for (uint32_t i = 0; i < 16; ++i) {
+    ASSERT_TRUE(body.parse_delimited(framer, reader));
+    EXPECT_EQ(body.id, i);
+    EXPECT_EQ(body.path.size(), i + 1);
+  }
+  EXPECT_FALSE(body.parse_delimited(framer, reader));
+  // The whole stream fits in one fill, plus the read that sees its end.
+  EXPECT_EQ(reader.reads, 2u);
+
+  serialkit::StreamReader strict(4);
+  serialkit::SpanReader source(stream);
+  EXPECT_FALSE(body.parse_delimited(strict, source));
+}
+
+TEST(GeneratedTest, EqualFloatsHashEqually) {
+  Pose positive = make_pose(0.0f, 4, 0.0);
+  Pose negative = make_pose(-0.0f, 4, -0.0);
+  ASSERT_EQ(positive, negative);
+  EXPECT_EQ(positive.hash(), negative.hash());
+  EXPECT_EQ(std::hash<Pose>{}(positive), std::hash<Pose>{}(negative));
+  EXPECT_EQ((std::unordered_set<Pose>{positive, negative}.size()), 1u);
+
+  Body a;
+  a.pose = positive;
+  Body b;
+  b.pose = negative;
+  ASSERT_EQ(a, b);
+  EXPECT_EQ((std::unordered_set<Body>{a, b}.size()), 1u);
+
+  // NaNs never compare equal, but all of them hash alike.
+  Pose quiet = make_pose(1.0f, 4, std::numeric_limits<double>::quiet_NaN());
+  Pose negated = make_pose(1.0f, 4, -std::numeric_limits<double>::quiet_NaN());
+  EXPECT_EQ(quiet.hash(), negated.hash());
+}
+
+TEST(GeneratedTest, PackedVarintsAreBounded) {
+  Body body;
+  body.samples = {1, 300, 70000};
+  std::vector<uint8_t> data = body.serialize();
+  Body decoded;
+  ASSERT_TRUE(decoded.deserialize(data));
+  EXPECT_EQ(decoded.samples, body.samples);
+
+  // Field 4, 12 bytes: an element of 11 continuation bytes and a final one.
+  std::vector<uint8_t> overlong(14, 0xFF);
+  overlong[0] = 0x22;
+  overlong[1] = 12;
+  overlong[13] = 0x01;
+  EXPECT_FALSE(decoded.deserialize(overlong));
+
+  // The last element is cut off at the end of the packed run.
+  std::vector<uint8_t> truncated = {0x22, 3, 0x01, 0xAC, 0x82, 0x08};
+  EXPECT_FALSE(decoded.deserialize(truncated));
+  truncated[1] = 4;
+  ASSERT_TRUE(decoded.deserialize(truncated));
+  EXPECT_EQ(decoded.samples, (std::vector<uint32_t>{1, 131372}));
+}
+
+TEST(GeneratedTest, FieldsNamedLikeGeneratedLocals) {
+  Buffer buffer;
+  buffer.size = uint64_t{1} << 40;
+  buffer.out = "out";
+  buffer.pos.push_back(make_pose(1.0f, 4, 0.5));
+  buffer.data = std::string(200, 'd');
+
+  std::vector<uint8_t> bytes = buffer.serialize();
+  EXPECT_EQ(buffer.byte_size(), bytes.size());
+  Buffer decoded;
+  ASSERT_TRUE(decoded.deserialize(bytes));
+  EXPECT_EQ(decoded, buffer);
+
+  std::vector<uint8_t> stream;
+  serialkit::VectorWriter writer(stream);
+  buffer.serialize_delimited(writer);
+  serialkit::SpanReader reader(stream);
+  Buffer parsed;
+  ASSERT_TRUE(parsed.parse_delimited(reader));
+  EXPECT_EQ(parsed, buffer);
+  EXPECT_EQ(parsed.hash(), buffer.hash());
+}
+
+TEST(GeneratedTest, JsonRoundTrip) {
+  Body body = make_body();
+  Body parsed;
+  ASSERT_TRUE(parsed.from_json(body.to_json()));
+  EXPECT_EQ(parsed, body);
+
+  Resumable resumable;
+  resumable.status = codegen_test::DecodeStatus::STALE;
+  resumable.devices.push_back(Device{});
+  resumable.devices[0].name = "caf\xC3\xA9 \"quoted\"\n";
+  resumable.devices[0].mode = Mode::ACTIVE;
+  Resumable parsed_resumable;
+  ASSERT_TRUE(parsed_resumable.from_json(resumable.to_json()));
+  EXPECT_EQ(parsed_resumable, resumable);
+
+  EXPECT_FALSE(parsed.from_json("{\"id\": "));
+}
+
+TEST(GeneratedTest, TranscodeMatchesToJson) {
+  Body body = make_body();
+  std::string json;
+  ASSERT_TRUE(Body::transcode_to_json(body.serialize(), json));
+  EXPECT_EQ(json, body.to_json());
+
+  Message message;
+  message.text = "hello";
+  message.body = body;
+  json.clear();
+  ASSERT_TRUE(Message::transcode_to_json(message.serialize(), json));
+  EXPECT_EQ(json, message.to_json());
+}
+
+TEST(GeneratedTest, ToJsonStreamsIntoWriter) {
+  Body body = make_body();
+  body.path.resize(100, make_pose(4.0f, 2, 0.125));
+  std::string json = body.to_json();
+  ASSERT_GT(json.size(), 4 * detail::JsonOut::CHUNK_SIZE);
+
+  ChunkRecorder recorder;
+  body.to_json(recorder);
+  EXPECT_EQ(recorder.text, json);
+  EXPECT_GT(recorder.writes, 4u);
+  EXPECT_LE(recorder.largest, detail::JsonOut::CHUNK_SIZE);
+
+  std::vector<uint8_t> bytes = {'>'};
+  serialkit::VectorWriter writer(bytes);
+  body.to_json(writer);
+  EXPECT_EQ(std::string(bytes.begin() + 1, bytes.end()), json);
+
+  std::string appended = "[";
+  body.append_json(appended);
+  EXPECT_EQ(appended, "[" + json);
+}
+
+TEST(GeneratedTest, TranscodeStreamsIntoWriter) {
+  Body body = make_body();
+  body.path.resize(100, make_pose(4.0f, 2, 0.125));
+  std::vector<uint8_t> wire = body.serialize();
+  std::string json;
+  ASSERT_TRUE(Body::transcode_to_json(wire, json));
+  ASSERT_GT(json.size(), 4 * detail::JsonOut::CHUNK_SIZE);
+
+  // Without prepare(), text goes out in pieces of a fixed scratch buffer.
+  ChunkRecorder recorder;
+  ASSERT_TRUE(Body::transcode_to_json(wire, recorder));
+  EXPECT_EQ(recorder.text, json);
+  EXPECT_GT(recorder.writes, 4u);
+  EXPECT_LE(recorder.largest, detail::JsonOut::CHUNK_SIZE);
+
+  std::vector<uint8_t> bytes = {'>'};
+  serialkit::VectorWriter writer(bytes);
+  ASSERT_TRUE(Body::transcode_to_json(wire, writer));
+  EXPECT_EQ(std::string(bytes.begin() + 1, bytes.end()), json);
+}
+
+TEST(GeneratedTest, TranscodeMergesSplitRuns) {
+  // Two messages back to back split `devices` around `status`.
+  Resumable first;
+  first.status = codegen_test::DecodeStatus::STALE;
+  first.devices = {Device{}};
+  first.devices[0].name = "first";
+  Resumable second = first;
+  second.devices[0].name = "second";
+  std::vector<uint8_t> wire = first.serialize();
+  std::vector<uint8_t> tail = second.serialize();
+  wire.insert(wire.end(), tail.begin(), tail.end());
+
+  Resumable merged;
+  ASSERT_TRUE(merged.deserialize(wire));
+  ASSERT_EQ(merged.devices.size(), 2u);
+  ChunkRecorder recorder;
+  ASSERT_TRUE(Resumable::transcode_to_json(wire, recorder));
+  EXPECT_EQ(recorder.text, merged.to_json());
+}
+
+TEST(GeneratedTest, JsonCommasAfterOptionalFields) {
+  Note note;
+  EXPECT_EQ(note.to_json(), "{\"tags\":[]}");
+  note.rank = 3;
+  EXPECT_EQ(note.to_json(), "{\"rank\":3,\"tags\":[]}");
+  note.label = "x";
+  note.tags = {"a", "b"};
+  EXPECT_EQ(note.to_json(),
+            "{\"label\":\"x\",\"rank\":3,\"tags\":[\"a\",\"b\"]}");
+
+  std::string json;
+  ASSERT_TRUE(Note::transcode_to_json(note.serialize(), json));
+  EXPECT_EQ(json, note.to_json());
+  Note parsed;
+  ASSERT_TRUE(parsed.from_json(json));
+  EXPECT_EQ(parsed, note);
+}
+
+TEST(GeneratedTest, DiffAndApplyPatch) {
+  Body previous = make_body();
+  Body current = previous;
+  current.id = 43;
+  current.path[1].flags = 7;
+  current.samples.push_back(5);
+
+  std::vector<uint8_t> patch;
+  ASSERT_TRUE(Body::diff(previous, current, patch));
+  EXPECT_LT(patch.size(), current.byte_size());
+  Body patched = previous;
+  ASSERT_TRUE(patched.apply_patch(patch));
+  EXPECT_EQ(patched, current);
+
+  // Equal values still produce a patch, which changes nothing.
+  patch.clear();
+  EXPECT_FALSE(Body::diff(current, current, patch));
+  ASSERT_TRUE(patched.apply_patch(patch));
+  EXPECT_EQ(patched, current);
+}
+
+TEST(GeneratedTest, DiffIntoWriterReusesScratch) {
+  Body previous = make_body();
+  Body current = previous;
+  current.id = 43;
+  current.samples.push_back(5);
+  std::vector<uint8_t> expected;
+  ASSERT_TRUE(Body::diff(previous, current, expected));
+
+  std::vector<uint8_t> patch;
+  serialkit::VectorWriter writer(patch);
+  std::vector<uint8_t> scratch;
+  ASSERT_TRUE(Body::diff(previous, current, writer, scratch));
+  EXPECT_EQ(patch, expected);
+  const uint8_t *storage = scratch.data();
+  ASSERT_TRUE(Body::diff(previous, current, writer, scratch));
+  EXPECT_EQ(scratch.data(), storage);
+  EXPECT_EQ(patch.size(), 2 * expected.size());
+
+  std::vector<uint8_t> pooled;
+  serialkit::VectorWriter pooled_writer(pooled);
+  ASSERT_TRUE(Body::diff(previous, current, pooled_writer));
+  EXPECT_FALSE(Body::diff(current, current, pooled_writer));
+  Body patched = previous;
+  size_t pos = 0;
+  ASSERT_TRUE(patched.apply_patch(pooled, pos));
+  ASSERT_TRUE(patched.apply_patch(pooled, pos));
+  EXPECT_EQ(pos, pooled.size());
+  EXPECT_EQ(patched, current);
+}
+
+TEST(GeneratedTest, DecoderTakesOneByteAtATime) {
+  Message message;
+  message.text = "hello";
+  message.body = make_body();
+  std::vector<uint8_t> frame;
+  serialkit::VectorWriter writer(frame);
+  message.serialize_delimited(writer);
+
+  Message decoded;
+  MessageDecoder decoder(decoded);
+  for (size_t i = 0; i < frame.size(); ++i) {
+    ASSERT_EQ(decoder.status(), serialkit::DecodeStatus::NEED_MORE);
+    size_t consumed = 0;
+    decoder.feed(std::span<const uint8_t>(&frame[i], 1), consumed);
+    EXPECT_EQ(consumed, 1u);
+  }
+  EXPECT_EQ(decoder.status(), serialkit::DecodeStatus::DONE);
+  EXPECT_EQ(decoded, message);
+
+  // A bare message of known size, followed by bytes of the next one.
+  std::vector<uint8_t> bare = message.serialize();
+  size_t size = bare.size();
+  bare.push_back(0x0A);
+  Message bare_decoded;
+  MessageDecoder bare_decoder(bare_decoded, size);
+  size_t consumed = 0;
+  EXPECT_EQ(bare_decoder.feed(bare, consumed), serialkit::DecodeStatus::DONE);
+  EXPECT_EQ(consumed, size);
+  EXPECT_EQ(bare_decoded, message);
+}
+
+TEST(GeneratedTest, StreamWriterMatchesSerialize) {
+  Body body = make_body();
+  std::vector<uint8_t> whole;
+  serialkit::VectorWriter whole_sink(whole);
+  BodyStreamWriter whole_writer(whole_sink);
+  whole_writer.write_id(body.id);
+  whole_writer.write_pose(body.pose);
+  whole_writer.append_path(body.path);
+  whole_writer.append_samples(body.samples);
+  whole_writer.finish();
+  EXPECT_EQ(whole, body.serialize());
+
+  // A small chunk size splits the packed run, which still decodes alike.
+  std::vector<uint8_t> split;
+  serialkit::VectorWriter split_sink(split);
+  BodyStreamWriter writer(split_sink, 4);
+  writer.write_id(body.id);
+  writer.write_pose(body.pose);
+  writer.append_path(body.path);
+  writer.append_samples(body.samples);
+  writer.finish();
+  EXPECT_EQ(writer.bytes_written(), split.size());
+  EXPECT_NE(split, whole);
+  Body decoded;
+  ASSERT_TRUE(decoded.deserialize(split));
+  EXPECT_EQ(decoded, body);
+}
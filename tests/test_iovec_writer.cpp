@@ -0,0 +1,160 @@
+#include "serialkit/iovec_writer.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+#if !defined(_WIN32)
+#include <thread>
+#include <unistd.h>
+#endif
+
+using namespace serialkit;
+
+namespace {
+
+// Hand-written equivalent of a generated model with one scalar and one
+// string field.
+struct Document {
+  uint32_t id = 0;
+  std::string body;
+
+  size_t byte_size() const {
+    return 1 + varint_size(id) + 1 + varint_size(body.size()) + body.size();
+  }
+
+  void serialize_iov(
+      std::vector<uint8_t> &scratch,
+      std::vector<std::pair<size_t, std::span<const uint8_t>>> &references,
+      size_t threshold) const {
+    size_t offset = scratch.size();
+    scratch.resize(offset + 2 + varint_size(id) + varint_size(body.size()));
+    uint8_t *out = scratch.data() + offset;
+    *out++ = 0x08;
+    out = write_varint(out, id);
+    *out++ = 0x12;
+    write_varint(out, body.size());
+
+    std::span<const uint8_t> bytes(
+        reinterpret_cast<const uint8_t *>(body.data()), body.size());
+    if (body.size() >= threshold) {
+      references.emplace_back(scratch.size(), bytes);
+    } else {
+      scratch.insert(scratch.end(), bytes.begin(), bytes.end());
+    }
+  }
+
+  template <typename IovWriter> void serialize_iov(IovWriter &writer) const {
+    serialize_iov(writer.scratch(), writer.references(), writer.threshold());
+  }
+};
+
+std::string joined(const IovecWriter &writer) {
+  std::string result;
+  for (auto slice : writer.slices()) {
+    result.append(reinterpret_cast<const char *>(slice.data()), slice.size());
+  }
+  return result;
+}
+
+} // namespace
+
+class IovecWriterTest : public ::testing::Test {
+protected:
+  Document small{1, "tiny"};
+  Document large{2, std::string(10000, 'L')};
+};
+
+TEST_F(IovecWriterTest, LargeStringsAreReferenced) {
+  IovecWriter writer(64);
+  writer.append(small);
+  writer.append(large);
+
+  ASSERT_EQ(writer.references().size(), 1u);
+  EXPECT_EQ(writer.references()[0].second.data(),
+            reinterpret_cast<const uint8_t *>(large.body.data()));
+
+  auto slices = writer.slices();
+  ASSERT_EQ(slices.size(), 2u);
+  EXPECT_EQ(slices[1].data(),
+            reinterpret_cast<const uint8_t *>(large.body.data()));
+  EXPECT_EQ(writer.size(), small.byte_size() + large.byte_size());
+
+  std::string output = joined(writer);
+  EXPECT_EQ(output.substr(0, 8), std::string("\x08\x01\x12\x04tiny", 8));
+  EXPECT_EQ(output.substr(output.size() - 10000), large.body);
+}
+
+TEST_F(IovecWriterTest, ScratchBetweenReferencesKeepsWireOrder) {
+  IovecWriter writer(64);
+  writer.append(large);
+  writer.append(small);
+  writer.append(large);
+
+  auto slices = writer.slices();
+  ASSERT_EQ(slices.size(), 4u);
+  EXPECT_EQ(slices[1].size(), 10000u);
+  EXPECT_EQ(slices[2].size(), small.byte_size() + 5u);
+  EXPECT_EQ(slices[3].size(), 10000u);
+
+  writer.clear();
+  EXPECT_EQ(writer.size(), 0u);
+  EXPECT_TRUE(writer.slices().empty());
+}
+
+TEST_F(IovecWriterTest, ThresholdControlsCopying) {
+  IovecWriter copying(1 << 20);
+  copying.append(large);
+  EXPECT_TRUE(copying.references().empty());
+  EXPECT_EQ(copying.slices().size(), 1u);
+
+  IovecWriter referencing(4);
+  referencing.append(small);
+  EXPECT_EQ(referencing.references().size(), 1u);
+  EXPECT_EQ(joined(referencing), std::string("\x08\x01\x12\x04tiny", 8));
+}
+
+TEST_F(IovecWriterTest, DelimitedFramesReadBack) {
+  IovecWriter writer(64);
+  writer.append_delimited(large);
+  writer.append_delimited(small);
+
+  StreamReader reader;
+  std::string output = joined(writer);
+  reader.feed(std::span<const uint8_t>(
+      reinterpret_cast<const uint8_t *>(output.data()), output.size()));
+
+  std::span<const uint8_t> message;
+  ASSERT_EQ(reader.next(message), ReadStatus::OK);
+  EXPECT_EQ(message.size(), large.byte_size());
+  ASSERT_EQ(reader.next(message), ReadStatus::OK);
+  EXPECT_EQ(message.size(), small.byte_size());
+  EXPECT_EQ(reader.next(message), ReadStatus::NEED_MORE);
+}
+
+#if !defined(_WIN32)
+TEST_F(IovecWriterTest, WriteAllToPipe) {
+  IovecWriter writer(64);
+  for (int i = 0; i < 2000; ++i) {
+    writer.append(i % 2 == 0 ? small : large);
+  }
+  ASSERT_GT(writer.slices().size(), static_cast<size_t>(IOV_MAX));
+
+  int fds[2];
+  ASSERT_EQ(::pipe(fds), 0);
+
+  std::string received;
+  std::thread consumer([&] {
+    char buffer[65536];
+    ssize_t count;
+    while ((count = ::read(fds[0], buffer, sizeof(buffer))) > 0) {
+      received.append(buffer, static_cast<size_t>(count));
+    }
+  });
+
+  writer.write_all(fds[1]);
+  ::close(fds[1]);
+  consumer.join();
+  ::close(fds[0]);
+
+  EXPECT_EQ(received, joined(writer));
+}
+#endif
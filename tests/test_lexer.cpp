@@ -10,16 +10,21 @@ TEST(LexerTest, EmptySource) {
 }
 
 TEST(LexerTest, Keywords) {
-  Lexer lexer("namespace enum model optional repeated packed interned bitmap");
+  Lexer lexer("namespace enum model struct optional repeated packed interned "
+              "bitmap columnar utf8 checksummed");
 
   EXPECT_EQ(lexer.next_token().type, TokenType::NAMESPACE);
   EXPECT_EQ(lexer.next_token().type, TokenType::ENUM);
   EXPECT_EQ(lexer.next_token().type, TokenType::MODEL);
+  EXPECT_EQ(lexer.next_token().type, TokenType::STRUCT);
   EXPECT_EQ(lexer.next_token().type, TokenType::OPTIONAL);
   EXPECT_EQ(lexer.next_token().type, TokenType::REPEATED);
   EXPECT_EQ(lexer.next_token().type, TokenType::PACKED);
   EXPECT_EQ(lexer.next_token().type, TokenType::INTERNED);
   EXPECT_EQ(lexer.next_token().type, TokenType::BITMAP);
+  EXPECT_EQ(lexer.next_token().type, TokenType::COLUMNAR);
+  EXPECT_EQ(lexer.next_token().type, TokenType::UTF8);
+  EXPECT_EQ(lexer.next_token().type, TokenType::CHECKSUMMED);
   EXPECT_EQ(lexer.next_token().type, TokenType::END_OF_FILE);
 }
 
@@ -329,3 +329,58 @@ TEST(ParserTest, FindModel) {
 
   EXPECT_EQ(schema->find_model("NotFound"), nullptr);
 }
+
+TEST(ParserTest, ParseStruct) {
+  const char *source = R"(
+        namespace test;
+
+        struct Vector3 {
+            float x;
+            float y;
+            float z;
+        }
+
+        model Path { repeated Vector3 points = 1; }
+    )";
+
+  Lexer lexer(source);
+  Parser parser(lexer);
+  auto schema = parser.parse_schema();
+
+  ASSERT_EQ(schema->declarations.size(), 2);
+  auto *found_struct = schema->find_struct("Vector3");
+  ASSERT_NE(found_struct, nullptr);
+  ASSERT_EQ(found_struct->fields.size(), 3);
+  EXPECT_EQ(found_struct->fields[2]->name, "z");
+  EXPECT_EQ(found_struct->fields[2]->number, 3);
+  EXPECT_EQ(schema->find_model("Vector3"), nullptr);
+  EXPECT_EQ(schema->find_struct("Path"), nullptr);
+}
+
+TEST(ParserTest, ParseChecksummedModel) {
+  const char *source = R"(
+        namespace test;
+        checksummed model Frame { uint32 id = 1; }
+        model Plain { Frame frame = 1; }
+    )";
+
+  Lexer lexer(source);
+  Parser parser(lexer);
+  auto schema = parser.parse_schema();
+
+  ASSERT_EQ(schema->declarations.size(), 2);
+  ASSERT_NE(schema->find_model("Frame"), nullptr);
+  EXPECT_TRUE(schema->find_model("Frame")->checksummed);
+  EXPECT_FALSE(schema->find_model("Plain")->checksummed);
+}
+
+TEST(ParserTest, StructFieldsHaveNoNumbers) {
+  const char *source = R"(
+        namespace test;
+        struct Vector2 { float x = 1; float y = 2; }
+    )";
+
+  Lexer lexer(source);
+  Parser parser(lexer);
+  EXPECT_THROW(parser.parse_schema(), ParseError);
+}
@@ -0,0 +1,205 @@
+#include "serialkit/record_file.hpp"
+#include "test_support.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace serialkit;
+
+class RecordFileTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    path = (std::filesystem::temp_directory_path() /
+            ("serialkit_record_file_test_" +
+             std::string(::testing::UnitTest::GetInstance()
+                             ->current_test_info()
+                             ->name()) +
+             ".skr"))
+               .string();
+  }
+
+  void TearDown() override { std::filesystem::remove(path); }
+
+  std::string path;
+};
+
+TEST_F(RecordFileTest, RandomAccessToRecords) {
+  {
+    RecordFileWriter writer(path);
+    for (int i = 0; i < 1000; ++i) {
+      writer.append(TextMessage{"record-" + std::to_string(i)});
+    }
+    EXPECT_EQ(writer.size(), 1000u);
+  }
+
+  RecordFileReader reader(path);
+  ASSERT_EQ(reader.size(), 1000u);
+  EXPECT_EQ(as_string(reader.record(0)), "record-0");
+  EXPECT_EQ(as_string(reader.record(999)), "record-999");
+
+  TextMessage message;
+  ASSERT_TRUE(reader.read(517, message));
+  EXPECT_EQ(message.text, "record-517");
+}
+
+TEST_F(RecordFileTest, RawAndLargeRecords) {
+  std::string large(200000, 'L');
+  {
+    RecordFileWriter writer(path);
+    const uint8_t raw[] = {1, 2, 3};
+    writer.append(std::span<const uint8_t>(raw));
+    writer.append(TextMessage{""});
+    writer.append(TextMessage{large});
+    writer.close();
+  }
+
+  RecordFileReader reader(path);
+  ASSERT_EQ(reader.size(), 3u);
+  auto raw = reader.record(0);
+  ASSERT_EQ(raw.size(), 3u);
+  EXPECT_EQ(raw[2], 3);
+  EXPECT_TRUE(reader.record(1).empty());
+  EXPECT_EQ(as_string(reader.record(2)), large);
+}
+
+TEST_F(RecordFileTest, EmptyFile) {
+  RecordFileWriter(path).close();
+
+  RecordFileReader reader(path);
+  EXPECT_EQ(reader.size(), 0u);
+  EXPECT_THROW(reader.record(0), std::out_of_range);
+}
+
+TEST_F(RecordFileTest, RejectsCorruptedFiles) {
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "definitely not a record file, but long enough";
+  }
+  EXPECT_THROW(RecordFileReader reader(path), std::runtime_error);
+
+  {
+    RecordFileWriter writer(path);
+    writer.append(TextMessage{"payload"});
+  }
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  EXPECT_THROW(RecordFileReader reader(path), std::runtime_error);
+}
+
+TEST_F(RecordFileTest, MissingFileThrows) {
+  EXPECT_THROW(RecordFileReader reader(path + ".missing"), std::system_error);
+}
+
+TEST_F(RecordFileTest, CompressedBlocks) {
+  Lz4Codec codec;
+  {
+    RecordFileWriter writer(path, &codec, 4096);
+    for (int i = 0; i < 5000; ++i) {
+      writer.append(TextMessage{"compressed-record-" + std::to_string(i)});
+    }
+  }
+  EXPECT_LT(std::filesystem::file_size(path), 5000u * 20 / 2);
+
+  RecordFileReader reader(path, codec);
+  ASSERT_TRUE(reader.compressed());
+  ASSERT_EQ(reader.size(), 5000u);
+
+  TextMessage message;
+  for (size_t i : {4999u, 0u, 1u, 2500u, 2501u, 17u}) {
+    ASSERT_TRUE(reader.read(i, message));
+    EXPECT_EQ(message.text, "compressed-record-" + std::to_string(i));
+  }
+  EXPECT_THROW(reader.record(5000), std::out_of_range);
+}
+
+TEST_F(RecordFileTest, CompressedEmptyFile) {
+  Lz4Codec codec;
+  RecordFileWriter(path, &codec).close();
+
+  RecordFileReader reader(path, codec);
+  EXPECT_TRUE(reader.compressed());
+  EXPECT_EQ(reader.size(), 0u);
+}
+
+TEST_F(RecordFileTest, ChecksummedRecords) {
+  {
+    RecordFileWriter writer(path, Checksum::CRC32C);
+    for (int i = 0; i < 100; ++i) {
+      writer.append(TextMessage{"checked-" + std::to_string(i)});
+    }
+    const uint8_t raw[] = {1, 2, 3};
+    writer.append(std::span<const uint8_t>(raw));
+  }
+
+  RecordFileReader reader(path);
+  ASSERT_TRUE(reader.checksummed());
+  ASSERT_EQ(reader.size(), 101u);
+  EXPECT_EQ(as_string(reader.record(42)), "checked-42");
+  EXPECT_EQ(reader.record(100).size(), 3u);
+
+  // Flip one payload byte of the last record.
+  size_t offset = std::filesystem::file_size(path) - RECORD_FILE_FOOTER_SIZE -
+                  101 * 8 - CRC32C_SIZE - 1;
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.put(4);
+  }
+  RecordFileReader corrupted(path);
+  EXPECT_EQ(as_string(corrupted.record(0)), "checked-0");
+  EXPECT_THROW(corrupted.record(100), std::runtime_error);
+}
+
+TEST_F(RecordFileTest, ChecksummedBlocks) {
+  Lz4Codec codec;
+  {
+    RecordFileWriter writer(path, Checksum::CRC32C, &codec, 1024);
+    for (int i = 0; i < 1000; ++i) {
+      writer.append(TextMessage{"block-record-" + std::to_string(i)});
+    }
+  }
+
+  RecordFileReader reader(path, codec);
+  ASSERT_TRUE(reader.compressed());
+  ASSERT_TRUE(reader.checksummed());
+  TextMessage message;
+  for (size_t i : {999u, 0u, 500u}) {
+    ASSERT_TRUE(reader.read(i, message));
+    EXPECT_EQ(message.text, "block-record-" + std::to_string(i));
+  }
+
+  {
+    // A byte inside the first block.
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    char byte = 0;
+    file.seekg(RECORD_FILE_HEADER_SIZE + 4);
+    file.get(byte);
+    file.seekp(RECORD_FILE_HEADER_SIZE + 4);
+    file.put(static_cast<char>(byte ^ 0x20));
+  }
+  RecordFileReader corrupted(path, codec);
+  EXPECT_THROW(corrupted.read(0, message), std::runtime_error);
+  EXPECT_TRUE(corrupted.read(999, message));
+}
+
+TEST_F(RecordFileTest, GeneratedModels) {
+  auto bodies = make_bodies(500);
+  Lz4Codec codec;
+  const Codec *block_codecs[] = {nullptr, &codec};
+  for (const Codec *block_codec : block_codecs) {
+    {
+      RecordFileWriter writer(path, Checksum::CRC32C, block_codec, 4096);
+      for (const auto &body : bodies) {
+        writer.append(body);
+      }
+    }
+
+    RecordFileReader reader(path, codec);
+    ASSERT_EQ(reader.size(), bodies.size());
+    codegen_test::Body body;
+    for (size_t i : {499u, 0u, 250u, 7u}) {
+      ASSERT_TRUE(reader.read(i, body));
+      EXPECT_EQ(body, bodies[i]);
+    }
+  }
+}
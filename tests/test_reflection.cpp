@@ -0,0 +1,138 @@
+#include "codegen_test.hpp"
+#include "serialkit/reflection.hpp"
+#include <gtest/gtest.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace reflection_test {
+
+// Shaped like generated code for:
+//   model Reading { uint64 id = 1; string unit = 2;
+//                   packed repeated double values = 3; optional int32 bias = 7; }
+struct Reading {
+  uint64_t id = 0;
+  std::string unit;
+  std::vector<double> values;
+  std::optional<int32_t> bias;
+};
+
+} // namespace reflection_test
+
+namespace serialkit {
+
+template <> struct model_traits<reflection_test::Reading> {
+  static constexpr std::string_view name = "Reading";
+  static constexpr auto fields = std::make_tuple(
+      field_descriptor<&reflection_test::Reading::id>{1, "id", 0, 0},
+      field_descriptor<&reflection_test::Reading::unit>{2, "unit", 2, 0},
+      field_descriptor<&reflection_test::Reading::values>{
+          3, "values", 2, FIELD_REPEATED | FIELD_PACKED},
+      field_descriptor<&reflection_test::Reading::bias>{7, "bias", 0,
+                                                        FIELD_OPTIONAL});
+};
+
+} // namespace serialkit
+
+using namespace serialkit;
+using reflection_test::Reading;
+
+namespace {
+
+// Generic code written once against the traits.
+constexpr uint32_t max_field_number() {
+  uint32_t result = 0;
+  for_each_descriptor<Reading>([&](const auto &field) {
+    result = field.number > result ? field.number : result;
+  });
+  return result;
+}
+
+template <typename T> size_t populated_fields(const T &model) {
+  size_t count = 0;
+  for_each_field(model, [&](const auto &, const auto &value) {
+    using Value = std::remove_cvref_t<decltype(value)>;
+    if constexpr (requires { value.has_value(); }) {
+      count += value.has_value();
+    } else if constexpr (requires { value.empty(); }) {
+      count += !value.empty();
+    } else {
+      count += value != Value{};
+    }
+  });
+  return count;
+}
+
+} // namespace
+
+class ReflectionTest : public ::testing::Test {};
+
+TEST_F(ReflectionTest, DescriptorsAreConstexpr) {
+  static_assert(Reflected<Reading>);
+  static_assert(!Reflected<int>);
+  static_assert(field_count<Reading> == 4);
+  static_assert(max_field_number() == 7);
+  static_assert(std::get<1>(model_traits<Reading>::fields).name == "unit");
+  static_assert(std::get<2>(model_traits<Reading>::fields).modifiers &
+                FIELD_PACKED);
+  static_assert(
+      std::is_same_v<decltype(std::get<3>(model_traits<Reading>::fields)
+                                  .member),
+                     std::optional<int32_t> Reading::*const>);
+  EXPECT_EQ(model_traits<Reading>::name, "Reading");
+}
+
+TEST_F(ReflectionTest, ForEachFieldVisitsMembersInOrder) {
+  Reading reading;
+  EXPECT_EQ(populated_fields(reading), 0u);
+
+  for_each_field(reading, [](const auto &field, auto &value) {
+    if constexpr (std::is_same_v<std::remove_cvref_t<decltype(value)>,
+                                 uint64_t>) {
+      value = field.number * 100;
+    }
+  });
+  reading.values = {1.5};
+  reading.bias = -2;
+  EXPECT_EQ(reading.id, 100u);
+  EXPECT_EQ(populated_fields(reading), 3u);
+
+  std::string names;
+  for_each_descriptor<Reading>(
+      [&](const auto &field) { names += std::string(field.name) + ","; });
+  EXPECT_EQ(names, "id,unit,values,bias,");
+}
+
+// The same generic code, against the traits the compiler emits.
+TEST_F(ReflectionTest, CompilerEmittedTraits) {
+  using codegen_test::Body;
+  using codegen_test::Device;
+  using codegen_test::Mode;
+  static_assert(Reflected<Body>);
+  static_assert(field_count<Body> == 4);
+  static_assert(std::get<3>(model_traits<Body>::fields).modifiers ==
+                (FIELD_REPEATED | FIELD_PACKED));
+  static_assert(std::is_same_v<
+                decltype(std::get<1>(model_traits<Body>::fields).member),
+                codegen_test::Pose Body::*const>);
+  static_assert(ReflectedEnum<Mode>);
+  static_assert(enum_traits<Mode>::values[1].value == Mode::ACTIVE);
+  EXPECT_EQ(model_traits<Body>::name, "Body");
+  EXPECT_EQ(enum_traits<Mode>::values[1].name, "ACTIVE");
+
+  Body body;
+  EXPECT_EQ(populated_fields(body), 0u);
+  body.id = 3;
+  body.samples = {1, 2};
+  EXPECT_EQ(populated_fields(body), 2u);
+
+  Device device{};
+  EXPECT_EQ(populated_fields(device), 0u);
+  device.mode = Mode::ACTIVE;
+  EXPECT_EQ(populated_fields(device), 1u);
+
+  std::string names;
+  for_each_descriptor<Body>(
+      [&](const auto &field) { names += std::string(field.name) + ","; });
+  EXPECT_EQ(names, "id,pose,path,samples,");
+}
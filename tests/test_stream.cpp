@@ -0,0 +1,238 @@
+#include "serialkit/stream.hpp"
+#include "test_support.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <string>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+using namespace serialkit;
+
+class StreamTest : public ::testing::Test {
+protected:
+  std::vector<uint8_t> encode_frames(const std::vector<std::string> &texts) {
+    std::vector<uint8_t> stream;
+    VectorWriter writer(stream);
+    for (const auto &text : texts) {
+      write_delimited(writer, as_bytes(text));
+    }
+    return stream;
+  }
+};
+
+TEST_F(StreamTest, VarintRoundTrip) {
+  const uint64_t values[] = {0, 1, 127, 128, 300, 16383, 16384, ~0ull};
+
+  for (uint64_t value : values) {
+    uint8_t buffer[MAX_VARINT_SIZE];
+    uint8_t *end = write_varint(buffer, value);
+    EXPECT_EQ(static_cast<size_t>(end - buffer), varint_size(value));
+
+    uint64_t decoded = 0;
+    size_t consumed = 0;
+    EXPECT_EQ(read_varint(std::span<const uint8_t>(buffer, end), decoded,
+                          consumed),
+              ReadStatus::OK);
+    EXPECT_EQ(decoded, value);
+    EXPECT_EQ(consumed, varint_size(value));
+  }
+}
+
+TEST_F(StreamTest, VarintIncompleteAndMalformed) {
+  const uint8_t partial[] = {0x80, 0x80};
+  uint64_t value = 0;
+  size_t consumed = 0;
+  EXPECT_EQ(read_varint(partial, value, consumed), ReadStatus::NEED_MORE);
+
+  std::vector<uint8_t> overlong(11, 0x80);
+  EXPECT_EQ(read_varint(overlong, value, consumed), ReadStatus::MALFORMED);
+}
+
+TEST_F(StreamTest, ReadsCompleteFrames) {
+  auto stream = encode_frames({"alpha", "", "gamma"});
+
+  StreamReader reader;
+  reader.feed(stream);
+
+  std::span<const uint8_t> message;
+  ASSERT_EQ(reader.next(message), ReadStatus::OK);
+  EXPECT_EQ(as_string(message), "alpha");
+  ASSERT_EQ(reader.next(message), ReadStatus::OK);
+  EXPECT_EQ(as_string(message), "");
+  ASSERT_EQ(reader.next(message), ReadStatus::OK);
+  EXPECT_EQ(as_string(message), "gamma");
+  EXPECT_EQ(reader.next(message), ReadStatus::NEED_MORE);
+  EXPECT_EQ(reader.buffered(), 0u);
+}
+
+TEST_F(StreamTest, ReassemblesByteByByte) {
+  std::string large(1000, 'x');
+  auto stream = encode_frames({"first", large, "last"});
+
+  StreamReader reader;
+  std::vector<std::string> received;
+  for (uint8_t byte : stream) {
+    reader.feed(std::span<const uint8_t>(&byte, 1));
+    std::span<const uint8_t> message;
+    while (reader.next(message) == ReadStatus::OK) {
+      received.push_back(as_string(message));
+    }
+  }
+
+  ASSERT_EQ(received.size(), 3u);
+  EXPECT_EQ(received[0], "first");
+  EXPECT_EQ(received[1], large);
+  EXPECT_EQ(received[2], "last");
+}
+
+TEST_F(StreamTest, PrepareReservesRoomForPendingFrame) {
+  std::string large(10000, 'y');
+  auto stream = encode_frames({large});
+
+  StreamReader reader;
+  reader.feed(std::span<const uint8_t>(stream.data(), 3));
+
+  std::span<const uint8_t> message;
+  ASSERT_EQ(reader.next(message), ReadStatus::NEED_MORE);
+
+  auto space = reader.prepare(1);
+  ASSERT_GE(space.size(), stream.size() - 3);
+  std::memcpy(space.data(), stream.data() + 3, stream.size() - 3);
+  reader.commit(stream.size() - 3);
+
+  ASSERT_EQ(reader.next(message), ReadStatus::OK);
+  EXPECT_EQ(message.size(), large.size());
+}
+
+TEST_F(StreamTest, RejectsOversizedFrame) {
+  auto stream = encode_frames({std::string(100, 'z')});
+
+  StreamReader reader(64);
+  reader.feed(stream);
+
+  std::span<const uint8_t> message;
+  EXPECT_EQ(reader.next(message), ReadStatus::MALFORMED);
+}
+
+TEST_F(StreamTest, ReadMessageDecodesInPlace) {
+  auto stream = encode_frames({"hello", "world"});
+
+  StreamReader reader;
+  SpanReader source(stream);
+  while (reader.fill(source) > 0) {
+  }
+
+  TextMessage message;
+  ASSERT_EQ(read_message(reader, message), ReadStatus::OK);
+  EXPECT_EQ(message.text, "hello");
+  ASSERT_EQ(read_message(reader, message), ReadStatus::OK);
+  EXPECT_EQ(message.text, "world");
+  EXPECT_EQ(read_message(reader, message), ReadStatus::NEED_MORE);
+}
+
+TEST_F(StreamTest, VectorWriterPrepareCommit) {
+  std::vector<uint8_t> buffer = {0xAA};
+  VectorWriter writer(buffer);
+
+  uint8_t *out = writer.prepare(8);
+  out[0] = 1;
+  out[1] = 2;
+  writer.commit(2);
+
+  EXPECT_EQ(buffer, (std::vector<uint8_t>{0xAA, 1, 2}));
+}
+
+TEST_F(StreamTest, ChecksummedFrames) {
+  std::string large(1000, 'c');
+  std::vector<uint8_t> stream;
+  VectorWriter writer(stream);
+  write_delimited(writer, as_bytes("first"), Checksum::CRC32C);
+  write_delimited(writer, as_bytes(large), Checksum::CRC32C);
+  write_delimited(writer, as_bytes(""), Checksum::CRC32C);
+  EXPECT_EQ(stream.size(), encode_frames({"first", large, ""}).size() +
+                               3 * CRC32C_SIZE);
+
+  StreamReader reader(DEFAULT_MAX_MESSAGE_SIZE, Checksum::CRC32C);
+  std::vector<std::string> received;
+  for (uint8_t byte : stream) {
+    reader.feed(std::span<const uint8_t>(&byte, 1));
+    std::span<const uint8_t> message;
+    while (reader.next(message) == ReadStatus::OK) {
+      received.push_back(as_string(message));
+    }
+  }
+  ASSERT_EQ(received.size(), 3u);
+  EXPECT_EQ(received[0], "first");
+  EXPECT_EQ(received[1], large);
+  EXPECT_EQ(received[2], "");
+}
+
+TEST_F(StreamTest, ChecksumMismatchIsMalformed) {
+  std::vector<uint8_t> stream;
+  VectorWriter writer(stream);
+  write_delimited(writer, as_bytes("payload"), Checksum::CRC32C);
+
+  for (size_t i = 1; i < stream.size(); ++i) {
+    std::vector<uint8_t> corrupted = stream;
+    corrupted[i] ^= 0x01;
+    StreamReader reader(DEFAULT_MAX_MESSAGE_SIZE, Checksum::CRC32C);
+    reader.feed(corrupted);
+    std::span<const uint8_t> message;
+    EXPECT_EQ(reader.next(message), ReadStatus::MALFORMED) << i;
+  }
+}
+
+#if !defined(_WIN32)
+TEST_F(StreamTest, FramesOverPipe) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+
+  {
+    FdWriter writer(fds[1], 16);
+    write_delimited(writer, as_bytes("over"));
+    write_delimited(writer, as_bytes(std::string(40, 'p')));
+    write_delimited(writer, as_bytes("pipe"));
+  }
+  close(fds[1]);
+
+  FdReader source(fds[0]);
+  StreamReader reader;
+  std::vector<std::string> received;
+  while (reader.fill(source, 8) > 0) {
+    std::span<const uint8_t> message;
+    while (reader.next(message) == ReadStatus::OK) {
+      received.push_back(as_string(message));
+    }
+  }
+  close(fds[0]);
+
+  ASSERT_EQ(received.size(), 3u);
+  EXPECT_EQ(received[0], "over");
+  EXPECT_EQ(received[1], std::string(40, 'p'));
+  EXPECT_EQ(received[2], "pipe");
+}
+#endif
+
+TEST_F(StreamTest, GeneratedModelsInOddChunks) {
+  auto bodies = make_bodies(200);
+  std::vector<uint8_t> stream;
+  VectorWriter writer(stream);
+  for (const auto &body : bodies) {
+    write_message(writer, body, Checksum::CRC32C);
+  }
+
+  StreamReader reader(DEFAULT_MAX_MESSAGE_SIZE, Checksum::CRC32C);
+  std::vector<codegen_test::Body> received;
+  for (size_t offset = 0; offset < stream.size(); offset += 13) {
+    size_t size = std::min<size_t>(13, stream.size() - offset);
+    reader.feed(std::span<const uint8_t>(stream.data() + offset, size));
+    codegen_test::Body body;
+    while (read_message(reader, body) == ReadStatus::OK) {
+      received.push_back(body);
+    }
+  }
+
+  EXPECT_EQ(received, bodies);
+}
@@ -0,0 +1,69 @@
+#ifndef SERIALKIT_TEST_SUPPORT_HPP
+#define SERIALKIT_TEST_SUPPORT_HPP
+
+#include "codegen_test.hpp"
+#include "serialkit/stream.hpp"
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+// Hand-written message whose payload is its text. serialize_delimited()
+// takes the prepare()/commit() path when the writer offers it, as the
+// generated code does.
+struct TextMessage {
+  std::string text;
+
+  size_t byte_size() const { return text.size(); }
+
+  template <typename Writer> void serialize_delimited(Writer &writer) const {
+    if constexpr (requires { writer.prepare(text.size()); }) {
+      size_t prefix_size = serialkit::varint_size(text.size());
+      uint8_t *out = writer.prepare(prefix_size + text.size());
+      out = serialkit::write_varint(out, text.size());
+      std::memcpy(out, text.data(), text.size());
+      writer.commit(prefix_size + text.size());
+    } else {
+      serialkit::write_delimited(
+          writer,
+          std::span<const uint8_t>(
+              reinterpret_cast<const uint8_t *>(text.data()), text.size()));
+    }
+  }
+
+  bool deserialize(std::span<const uint8_t> data) {
+    text.assign(reinterpret_cast<const char *>(data.data()), data.size());
+    return true;
+  }
+};
+
+inline std::span<const uint8_t> as_bytes(const std::string &text) {
+  return std::span<const uint8_t>(
+      reinterpret_cast<const uint8_t *>(text.data()), text.size());
+}
+
+inline std::string as_string(std::span<const uint8_t> bytes) {
+  return std::string(reinterpret_cast<const char *>(bytes.data()),
+                     bytes.size());
+}
+
+// Generated messages from tests/schemas/codegen_test.skit, growing with the
+// index so that length prefixes cross the one-byte boundary.
+inline std::vector<codegen_test::Body> make_bodies(size_t count) {
+  std::vector<codegen_test::Body> bodies(count);
+  for (size_t i = 0; i < count; ++i) {
+    codegen_test::Body &body = bodies[i];
+    body.id = static_cast<uint32_t>(i * 37);
+    body.pose.pos.x = static_cast<float>(i);
+    body.pose.flags = static_cast<uint8_t>(i);
+    body.pose.w = 0.5 * static_cast<double>(i);
+    body.path.resize(i % 7, body.pose);
+    for (size_t j = 0; j < i % 50; ++j) {
+      body.samples.push_back(static_cast<uint32_t>(j * j * 1000));
+    }
+  }
+  return bodies;
+}
+
+#endif // SERIALKIT_TEST_SUPPORT_HPP
@@ -124,6 +124,29 @@ TEST_F(ValidatorTest, FieldNumberInReservedRange) {
             std::string::npos);
 }
 
+TEST_F(ValidatorTest, FieldNameWithReservedPrefix) {
+  const char *source = R"(
+    namespace test;
+
+    struct Point {
+      float sk_x;
+    }
+
+    model User {
+      string sk_name = 1;
+    }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  ASSERT_EQ(validator.get_errors().size(), 2);
+  EXPECT_NE(validator.get_errors()[0].message.find("reserved prefix"),
+            std::string::npos);
+  EXPECT_NE(validator.get_errors()[1].message.find("reserved prefix"),
+            std::string::npos);
+}
+
 TEST_F(ValidatorTest, PackedWithoutRepeated) {
   const char *source = R"(
     namespace test;
@@ -403,3 +426,189 @@ TEST_F(ValidatorTest, ComplexValidSchema) {
 
   EXPECT_TRUE(validator.get_errors().empty());
 }
+
+TEST_F(ValidatorTest, ValidStruct) {
+  const char *source = R"(
+    namespace test;
+
+    struct Vector3 { float x; float y; float z; }
+    struct Vertex { Vector3 position; uint8 flags; bool visible; }
+
+    model Mesh {
+      repeated Vertex vertices = 1;
+      optional Vector3 origin = 2;
+    }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  EXPECT_TRUE(validator.get_errors().empty());
+}
+
+TEST_F(ValidatorTest, StructWithVariableSizeField) {
+  const char *source = R"(
+    namespace test;
+
+    enum Kind { A = 0; }
+    model Label { string text = 1; }
+    struct Bad { string name; Kind kind; Label label; }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  ASSERT_EQ(validator.get_errors().size(), 3);
+  EXPECT_NE(validator.get_errors()[0].message.find("fixed size"),
+            std::string::npos);
+  EXPECT_NE(validator.get_errors()[1].message.find("not 'Kind'"),
+            std::string::npos);
+  EXPECT_NE(validator.get_errors()[2].message.find("not 'Label'"),
+            std::string::npos);
+}
+
+TEST_F(ValidatorTest, StructFieldModifiers) {
+  const char *source = R"(
+    namespace test;
+    struct Bad { repeated int32 values; }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  ASSERT_FALSE(validator.get_errors().empty());
+  EXPECT_NE(validator.get_errors()[0].message.find("cannot have modifiers"),
+            std::string::npos);
+}
+
+TEST_F(ValidatorTest, RecursiveStruct) {
+  const char *source = R"(
+    namespace test;
+    struct A { int32 value; B next; }
+    struct B { A back; }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  ASSERT_EQ(validator.get_errors().size(), 2);
+  EXPECT_NE(validator.get_errors()[0].message.find("cannot contain itself"),
+            std::string::npos);
+}
+
+TEST_F(ValidatorTest, ValidColumnar) {
+  const char *source = R"(
+    namespace test;
+
+    enum Level { LOW = 0; HIGH = 1; }
+
+    model Sample {
+      uint64 timestamp = 1;
+      double value = 2;
+      optional string host = 3;
+      Level level = 4;
+    }
+
+    model Batch {
+      columnar repeated Sample rows = 1;
+    }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  EXPECT_TRUE(validator.get_errors().empty());
+}
+
+TEST_F(ValidatorTest, ColumnarWithoutRepeated) {
+  const char *source = R"(
+    namespace test;
+    model Sample { int32 value = 1; }
+    model Batch { columnar Sample row = 1; }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  ASSERT_FALSE(validator.get_errors().empty());
+  EXPECT_NE(validator.get_errors()[0].message.find("requires 'repeated'"),
+            std::string::npos);
+}
+
+TEST_F(ValidatorTest, ColumnarPrimitive) {
+  const char *source = R"(
+    namespace test;
+    model Batch { columnar repeated int32 values = 1; }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  ASSERT_EQ(validator.get_errors().size(), 1);
+  EXPECT_NE(validator.get_errors()[0].message.find("only be used with model"),
+            std::string::npos);
+}
+
+TEST_F(ValidatorTest, ColumnarNestedElementField) {
+  const char *source = R"(
+    namespace test;
+    model Point { int32 x = 1; }
+    model Sample { repeated int32 values = 1; Point at = 2; }
+    model Batch { columnar repeated Sample rows = 1; }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  ASSERT_EQ(validator.get_errors().size(), 2);
+  EXPECT_NE(validator.get_errors()[0].message.find("field 'values'"),
+            std::string::npos);
+  EXPECT_NE(validator.get_errors()[1].message.find("field 'at'"),
+            std::string::npos);
+}
+
+TEST_F(ValidatorTest, Utf8String) {
+  const char *source = R"(
+    namespace test;
+    model Message {
+      utf8 string title = 1;
+      optional utf8 interned string author = 2;
+      repeated utf8 string tags = 3;
+    }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  EXPECT_TRUE(validator.get_errors().empty());
+}
+
+TEST_F(ValidatorTest, Utf8WithNonString) {
+  const char *source = R"(
+    namespace test;
+    model Message { repeated utf8 byte payload = 1; }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  ASSERT_EQ(validator.get_errors().size(), 1);
+  EXPECT_NE(validator.get_errors()[0].message.find(
+                "'utf8' modifier can only be used with 'string' type"),
+            std::string::npos);
+}
+
+TEST_F(ValidatorTest, ColumnarChecksummedElement) {
+  const char *source = R"(
+    namespace test;
+    checksummed model Sample { int32 value = 1; }
+    model Batch { repeated Sample rows = 1; columnar repeated Sample cols = 2; }
+  )";
+
+  Validator validator;
+  parse_and_validate(source, validator);
+
+  ASSERT_EQ(validator.get_errors().size(), 1);
+  EXPECT_NE(validator.get_errors()[0].message.find("it is checksummed"),
+            std::string::npos);
+}